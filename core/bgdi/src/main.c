@@ -49,6 +49,7 @@
 #include "bgdrtm.h"
 #include "xstrings.h"
 #include "dirs.h"
+#include "savestate.h"
 
 #include "bgd_version.h"
 
@@ -259,6 +260,7 @@ int main( int argc, char *argv[] )
 
     bennugd_internal_string_init() ;
     init_c_type() ;
+    savestate_init() ;
 
     /* Init application title for windowed modes */
 
@@ -87,6 +87,11 @@ extern int dcb_load_from( file * fp, const char * dcbname, int offset ) ;
 extern char * getid_name( unsigned int code );
 
 extern void mnemonic_dump( int i, int param );
+extern char * mnemonic_name( int i );
+
+#ifdef OPCODE_NGRAMS
+extern void opcode_ngrams_dump();
+#endif
 
 /* --------------------------------------------------------------------------- */
 
@@ -468,6 +468,8 @@ int dcb_load_from( file * fp, const char * filename, int offset )
                 procs[n].errorcode = dcb.proc[n].data.OErrorCode ;
             else
                 procs[n].errorcode = 0 ;
+
+            procdef_predecode( &procs[n] ) ;
         }
 
         if ( dcb.proc[n].data.NPriStrings )
@@ -37,8 +37,6 @@
 
 //#define FIXED_PREC 12
 
-#define FIXED_PREC      10000
-
 //#define FIXED_PREC_MED  5000
 //#define FIXED_PREC_DEC  1000
 
@@ -41,6 +41,7 @@
 #include "sysprocs_p.h"
 #include "instance.h"
 #include "xstrings.h"
+#include "savestate.h"
 
 #undef STACK_SIZE
 #define STACK_SIZE 4096
@@ -49,7 +50,6 @@
 
 #define INSTANCE_MIN_PRIORITY       -32768
 #define INSTANCE_MAX_PRIORITY       32767
-#define INSTANCE_NORMALIZE_PRIORITY 32768 // used for get an array index from 0 to 65535
 
 /* ---------------------------------------------------------------------- */
 /* Módulo de gestión de instancias, con las funciones de incialización y  */
@@ -57,42 +57,260 @@
 /* ---------------------------------------------------------------------- */
 
 #define HASH(id)            (unsigned int)((id)&0x0000ffff)
-#define HASH_PRIORITY(id)   (unsigned int)(((id) + INSTANCE_NORMALIZE_PRIORITY) & 0x0000ffff)
 #define HASH_INSTANCE(id)   (unsigned int)(((( uint32_t )(id)) >> 2 ) & 0x0000ffff)
 #define HASH_SIZE           65536
 
-INSTANCE ** hashed_by_id = NULL;
 INSTANCE ** hashed_by_instance = NULL;
 INSTANCE ** hashed_by_type = NULL;
-INSTANCE ** hashed_by_priority = NULL;
 
 INSTANCE * first_instance = NULL ;
 
-/* Priority lists */
+static int instance_maxid =  FIRST_INSTANCE_ID ;
+
+/* ---------------------------------------------------------------------- */
+/* Instance pools                                                         */
+/*                                                                        */
+/* Every process definition has its own pool of blocks, each one holding  */
+/* the INSTANCE, its local, private and public data and its stack. Blocks */
+/* are carved from slabs of about 64K. Freed blocks are queued and reused */
+/* oldest first, so the address of a just destroyed instance doesn't come */
+/* back right away (instance_exists() tells instances apart by address).  */
+/* ---------------------------------------------------------------------- */
 
-static INSTANCE * iterator_by_priority  = NULL ;
-static int        iterator_pos          = INSTANCE_MAX_PRIORITY;
+#define POOL_ALIGN(n)       ( ( ( n ) + 15 ) & ~15 )
+#define POOL_SLAB_SIZE      65536
+#define POOL_MIN_BLOCKS     4
 
-static int instance_maxid =  FIRST_INSTANCE_ID ;
+static INSTANCE * instance_alloc( PROCDEF * proc )
+{
+    uint8_t * block;
+    INSTANCE * r;
+    int blocks;
+
+    if ( !proc->pool_block_size )
+        proc->pool_block_size = POOL_ALIGN( sizeof( INSTANCE ) ) +
+                                POOL_ALIGN( local_size + 4 ) +
+                                POOL_ALIGN( proc->private_size + 4 ) +
+                                POOL_ALIGN( proc->public_size + 4 ) +
+                                STACK_SIZE;
+
+    if ( proc->pool_free_first )
+    {
+        block = proc->pool_free_first;
+        proc->pool_free_first = *( void ** ) block;
+        if ( !proc->pool_free_first ) proc->pool_free_last = NULL;
+    }
+    else
+    {
+        if ( ( uint8_t * ) proc->pool_next + proc->pool_block_size > ( uint8_t * ) proc->pool_end )
+        {
+            blocks = POOL_SLAB_SIZE / proc->pool_block_size;
+            if ( blocks < POOL_MIN_BLOCKS ) blocks = POOL_MIN_BLOCKS;
+
+            if ( !( proc->pool_next = bgd_malloc( blocks * proc->pool_block_size ) ) ) return NULL;
+            proc->pool_end = ( uint8_t * ) proc->pool_next + blocks * proc->pool_block_size;
+        }
+
+        block = proc->pool_next;
+        proc->pool_next = block + proc->pool_block_size;
+    }
+
+    r = ( INSTANCE * ) block;
+    memset( r, 0, sizeof( INSTANCE ) );
+    block += POOL_ALIGN( sizeof( INSTANCE ) );
+
+    r->locdata = block;
+    block += POOL_ALIGN( local_size + 4 );
+    r->pridata = block;
+    block += POOL_ALIGN( proc->private_size + 4 );
+    r->pubdata = block;
+    block += POOL_ALIGN( proc->public_size + 4 );
+    r->stack   = ( int * ) block;
+
+    return r;
+}
+
+/* ---------------------------------------------------------------------- */
 
-static int instance_min_actual_prio = INSTANCE_MAX_PRIORITY ;
-static int instance_max_actual_prio = INSTANCE_MIN_PRIORITY ;
+static void instance_free( INSTANCE * r )
+{
+    PROCDEF * proc = r->proc;
+
+    *( void ** ) r = NULL;
+
+    if ( proc->pool_free_last ) *( void ** ) proc->pool_free_last = r;
+    else proc->pool_free_first = r;
+
+    proc->pool_free_last = r;
+}
 
 /* ---------------------------------------------------------------------- */
 /* By id                                                                  */
+/*                                                                        */
+/* Ids in use are marked in a bitmap, with a summary bit for every full   */
+/* bitmap word, so finding the next free id takes a few word scans. The   */
+/* instances are found through an open addressing table (linear probing,  */
+/* backward shift on removal) sized for the current instance count.       */
+/* ---------------------------------------------------------------------- */
+
+#define ID_COUNT            ( LAST_INSTANCE_ID - FIRST_INSTANCE_ID + 1 )
+#define ID_WORDS            ( ID_COUNT / 64 )
+#define ID_SUMMARY_WORDS    ( ID_WORDS / 64 )
+#define ID_BIT(n)           ( ( uint64_t ) 1 << ( ( n ) & 63 ) )
+
+#define BY_ID_MIN_SIZE      64
+
+typedef struct
+{
+    int id ;
+    INSTANCE * instance ;
+}
+INSTANCE_BY_ID ;
+
+static uint64_t id_used[ ID_WORDS ] ;           /* Bit set: id in use */
+static uint64_t id_full[ ID_SUMMARY_WORDS ] ;   /* Bit set: id_used word is full */
+
+static INSTANCE_BY_ID * hashed_by_id = NULL ;
+static int hashed_by_id_size = 0 ;              /* Power of 2 */
+static int hashed_by_id_count = 0 ;
+
+/* ---------------------------------------------------------------------- */
+
+static inline int id_first_set( uint64_t bits )
+{
+#if defined( __GNUC__ )
+    return __builtin_ctzll( bits );
+#else
+    int n = 0;
+    while ( !( bits & 1 ) ) { bits >>= 1; n++; }
+    return n;
+#endif
+}
+
+/* ---------------------------------------------------------------------- */
+
+static void id_mark( int id, int used )
+{
+    int n = id - FIRST_INSTANCE_ID, word = n >> 6;
+
+    if ( n < 0 || n >= ID_COUNT ) return;
+
+    if ( used )
+    {
+        id_used[word] |= ID_BIT( n );
+        if ( !~id_used[word] ) id_full[word >> 6] |= ID_BIT( word );
+    }
+    else
+    {
+        id_used[word] &= ~ID_BIT( n );
+        id_full[word >> 6] &= ~ID_BIT( word );
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+
+/* First free id at or after FIRST_INSTANCE_ID + from, -1 if none */
+
+static int id_find_free( int from )
+{
+    int word = from >> 6, summary;
+    uint64_t bits;
+
+    if ( from < 0 || from >= ID_COUNT ) return -1;
+
+    bits = ~id_used[word] & ( ~( uint64_t ) 0 << ( from & 63 ) );
+    if ( bits ) return FIRST_INSTANCE_ID + ( word << 6 ) + id_first_set( bits );
+
+    /* Skip full words through the summary */
+    for ( word++; word < ID_WORDS; word = ( summary + 1 ) << 6 )
+    {
+        summary = word >> 6;
+        bits = ~id_full[summary] & ( ~( uint64_t ) 0 << ( word & 63 ) );
+        if ( bits )
+        {
+            word = ( summary << 6 ) + id_first_set( bits );
+            return FIRST_INSTANCE_ID + ( word << 6 ) + id_first_set( ~id_used[word] );
+        }
+    }
+
+    return -1;
+}
+
+/* ---------------------------------------------------------------------- */
+
+static void instance_resize_list_by_id( int size )
+{
+    INSTANCE_BY_ID * old = hashed_by_id ;
+    int n, slot, old_size = hashed_by_id_size ;
+
+    hashed_by_id = bgd_calloc( size, sizeof( INSTANCE_BY_ID ) );
+    assert( hashed_by_id );
+    hashed_by_id_size = size;
+
+    for ( n = 0; n < old_size; n++ )
+    {
+        if ( !old[n].instance ) continue;
+        for ( slot = old[n].id & ( size - 1 ); hashed_by_id[slot].instance; slot = ( slot + 1 ) & ( size - 1 ) );
+        hashed_by_id[slot] = old[n];
+    }
+
+    if ( old ) bgd_free( old );
+}
+
 /* ---------------------------------------------------------------------- */
 
 void instance_add_to_list_by_id( INSTANCE * r, uint32_t id )
 {
-    if ( !hashed_by_id ) hashed_by_id = bgd_calloc( HASH_SIZE, sizeof( INSTANCE * ) );
-    hashed_by_id[HASH( id )] = r;
+    int slot, mask;
+
+    if ( !hashed_by_id ) instance_resize_list_by_id( BY_ID_MIN_SIZE );
+    else if ( ( hashed_by_id_count + 1 ) * 4 > hashed_by_id_size * 3 ) instance_resize_list_by_id( hashed_by_id_size * 2 );
+
+    mask = hashed_by_id_size - 1;
+    for ( slot = id & mask; hashed_by_id[slot].instance; slot = ( slot + 1 ) & mask );
+
+    hashed_by_id[slot].id = id;
+    hashed_by_id[slot].instance = r;
+    hashed_by_id_count++;
+
+    id_mark( id, 1 );
 }
 
 /* ---------------------------------------------------------------------- */
 
 void instance_remove_from_list_by_id( INSTANCE * r, uint32_t id )
 {
-    hashed_by_id[HASH( id )] = NULL;
+    int slot, next, home, mask, n;
+
+    if ( !hashed_by_id ) return;
+
+    mask = hashed_by_id_size - 1;
+    for ( slot = id & mask; hashed_by_id[slot].instance && hashed_by_id[slot].instance != r; slot = ( slot + 1 ) & mask );
+
+    /* PROCESS_ID changed by the program, look for the instance itself */
+    if ( !hashed_by_id[slot].instance )
+    {
+        for ( n = 0; n < hashed_by_id_size && hashed_by_id[n].instance != r; n++ );
+        if ( n == hashed_by_id_size ) return;
+        slot = n;
+    }
+
+    id_mark( hashed_by_id[slot].id, 0 );
+
+    /* Move back the entries of the probe sequence that would become unreachable */
+    for ( next = ( slot + 1 ) & mask; hashed_by_id[next].instance; next = ( next + 1 ) & mask )
+    {
+        home = hashed_by_id[next].id & mask;
+        if ( slot <= next ? ( slot < home && home <= next ) : ( slot < home || home <= next ) ) continue;
+        hashed_by_id[slot] = hashed_by_id[next];
+        slot = next;
+    }
+
+    hashed_by_id[slot].id = 0;
+    hashed_by_id[slot].instance = NULL;
+    hashed_by_id_count--;
+
+    if ( hashed_by_id_size > BY_ID_MIN_SIZE && hashed_by_id_count * 8 < hashed_by_id_size ) instance_resize_list_by_id( hashed_by_id_size / 2 );
 }
 
 /* ---------------------------------------------------------------------- */
@@ -153,67 +371,447 @@ void instance_remove_from_list_by_type( INSTANCE * r, uint32_t type )
 
 /* ---------------------------------------------------------------------- */
 /* By priority                                                            */
+/*                                                                        */
+/* The scheduler walks run_list, a dense array sorted by priority (higher */
+/* first) and, within a priority, by insertion (newer first, as the old   */
+/* priority buckets did). Removed instances leave a hole and new or moved */
+/* ones wait in run_pending; both are merged in when the iterator starts  */
+/* over, so the list is only rebuilt when something changed.              */
+/*                                                                        */
+/* Sleeping and frozen instances are moved to run_parked and aren't       */
+/* visited until instance_status_changed() sees them runnable again.      */
+/* Killed and dead instances stay in the run list, they still have code   */
+/* to run (ONEXIT) before being destroyed.                                */
+/*                                                                        */
+/* Each entry caches the STATUS and FRAME_PERCENT locals, so waiting      */
+/* instances and those done with the frame are skipped without touching   */
+/* their locals. Nothing walks the instances at the end of a frame: an    */
+/* entry takes 100 from FRAME_PERCENT for every frame ended since it was  */
+/* last seen, and SAVED_STATUS is written from the cached STATUS before   */
+/* the cache is read again. So the locals are only up to date for the    */
+/* instance running and for those out of the lists; anybody else reading */
+/* them calls instance_sync_locals(), and anybody writing STATUS,         */
+/* FRAME_PERCENT or PRIORITY of another instance calls instance_touch()   */
+/* first, or instance_status_changed() after.                             */
 /* ---------------------------------------------------------------------- */
 
-void instance_add_to_list_by_priority( INSTANCE * r, int32_t priority )
+#define SCHED_NONE          0
+#define SCHED_RUN           1
+#define SCHED_PENDING       2
+#define SCHED_PARKED        3
+
+#define SCHED_COUNTS(s)     ( ( s ) == STATUS_RUNNING || ( s ) == STATUS_KILLED || ( s ) == STATUS_DEAD )
+#define SCHED_PARKS(s)      ( ( s ) == STATUS_SLEEPING || ( s ) == STATUS_FROZEN )
+
+typedef struct
+{
+    INSTANCE * instance ;
+    int32_t status ;
+    int32_t frame_percent ;
+    unsigned int frame ;        /* sched_frame when frame_percent was last brought up to date */
+}
+RUN_ENTRY ;
+
+static RUN_ENTRY * run_list = NULL ;
+static int run_count = 0 ;
+static int run_size = 0 ;
+static int run_holes = 0 ;
+static int run_pos = 0 ;
+
+static INSTANCE ** run_pending = NULL ;
+static int run_pending_count = 0 ;
+static int run_pending_size = 0 ;
+
+static RUN_ENTRY * run_parked = NULL ;
+static int run_parked_count = 0 ;
+static int run_parked_size = 0 ;
+
+/* Instances whose PRIORITY changed, moved at the end of the frame */
+
+static INSTANCE ** run_dirty = NULL ;
+static int run_dirty_count = 0 ;
+static int run_dirty_size = 0 ;
+
+/* Instances whose locals were handed to another one, read again before the next runs */
+
+static INSTANCE ** run_touched = NULL ;
+static int run_touched_count = 0 ;
+static int run_touched_size = 0 ;
+
+static INSTANCE * run_last = NULL ;
+static unsigned int run_seq = 0 ;
+static unsigned int sched_frame = 0 ;
+
+/* ---------------------------------------------------------------------- */
+
+/* Appends an instance to a list, returns its position plus one */
+
+static int sched_push( INSTANCE *** list, int * count, int * size, INSTANCE * r )
+{
+    if ( *count >= *size )
+    {
+        *size = *size ? *size * 2 : 256 ;
+        *list = bgd_realloc( *list, *size * sizeof( INSTANCE * ) ) ;
+        assert( *list ) ;
+    }
+
+    ( *list )[ ( *count )++ ] = r ;
+    return *count ;
+}
+
+/* ---------------------------------------------------------------------- */
+
+static inline RUN_ENTRY * sched_entry( INSTANCE * r )
+{
+    switch ( r->sched_list )
+    {
+        case SCHED_RUN:     return &run_list[ r->sched_index ] ;
+        case SCHED_PARKED:  return &run_parked[ r->sched_index ] ;
+    }
+    return NULL ;
+}
+
+/* ---------------------------------------------------------------------- */
+
+/* Takes 100 from FRAME_PERCENT for every frame ended since the entry was
+ * last brought up to date, if it was running, killed or dead. The cached
+ * STATUS is the one it had all that time, it's read again only after
+ * this */
+
+static inline void sched_catch_up( RUN_ENTRY * e )
+{
+    if ( e->frame != sched_frame )
+    {
+        if ( SCHED_COUNTS( e->status ) ) e->frame_percent -= 100 * ( int32_t )( sched_frame - e->frame ) ;
+        e->frame = sched_frame ;
+    }
+}
+
+/* Writes SAVED_STATUS, the STATUS at the end of the last frame, if no
+ * frame ended since it was last written the local is still good */
+
+static inline void sched_save_status( RUN_ENTRY * e )
+{
+    INSTANCE * r = e->instance ;
+
+    if ( r->sched_saved != sched_frame )
+    {
+        LOCDWORD( r, SAVED_STATUS ) = e->status ;
+        r->sched_saved = sched_frame ;
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+
+static void sched_check_priority( INSTANCE * r )
+{
+    if ( LOCINT32( r, PRIORITY ) != r->last_priority && !r->sched_dirty )
+        r->sched_dirty = sched_push( &run_dirty, &run_dirty_count, &run_dirty_size, r ) ;
+}
+
+/* Fills an entry from the locals of an instance out of the lists */
+
+static void sched_init( RUN_ENTRY * e, INSTANCE * r )
+{
+    e->instance = r ;
+    e->status = LOCDWORD( r, STATUS ) ;
+    e->frame_percent = LOCINT32( r, FRAME_PERCENT ) ;
+    e->frame = sched_frame ;
+    sched_check_priority( r ) ;
+}
+
+/* Reads the STATUS local again, after the frames ended with the old one
+ * are accounted for */
+
+static void sched_load( RUN_ENTRY * e )
+{
+    sched_catch_up( e ) ;
+    sched_save_status( e ) ;
+    e->status = LOCDWORD( e->instance, STATUS ) ;
+    sched_check_priority( e->instance ) ;
+}
+
+/* ---------------------------------------------------------------------- */
+
+static void sched_park( INSTANCE * r )
+{
+    if ( run_parked_count >= run_parked_size )
+    {
+        run_parked_size = run_parked_size ? run_parked_size * 2 : 256 ;
+        run_parked = bgd_realloc( run_parked, run_parked_size * sizeof( RUN_ENTRY ) ) ;
+        assert( run_parked ) ;
+    }
+
+    r->sched_list = SCHED_PARKED ;
+    r->sched_index = run_parked_count ;
+    sched_init( &run_parked[ run_parked_count++ ], r ) ;
+}
+
+/* ---------------------------------------------------------------------- */
+
+/* Nonzero if a runs before b */
+
+static inline int sched_before( INSTANCE * a, INSTANCE * b )
+{
+    if ( a->last_priority != b->last_priority ) return a->last_priority > b->last_priority ;
+    return ( int32_t )( a->sched_seq - b->sched_seq ) > 0 ;
+}
+
+static int sched_compare( const void * a, const void * b )
+{
+    INSTANCE * ia = *( INSTANCE ** ) a, * ib = *( INSTANCE ** ) b ;
+
+    if ( !ia || !ib ) return !ia - !ib ;        /* Holes last */
+    return sched_before( ib, ia ) - sched_before( ia, ib ) ;
+}
+
+/* ---------------------------------------------------------------------- */
+
+/* Takes back the locals of an instance that ran or was touched, they
+ * may have been changed */
+
+static void sched_reload( INSTANCE * r )
+{
+    RUN_ENTRY * e = sched_entry( r ) ;
+
+    if ( e ) e->frame_percent = LOCINT32( r, FRAME_PERCENT ) ;
+    instance_status_changed( r ) ;
+}
+
+static void sched_sync_last()
+{
+    INSTANCE * r ;
+    int n ;
+
+    if ( ( r = run_last ) )
+    {
+        run_last = NULL ;
+        sched_reload( r ) ;
+    }
+
+    for ( n = 0; n < run_touched_count; n++ )
+    {
+        if ( !( r = run_touched[n] ) ) continue ;
+        r->sched_touched = 0 ;
+        sched_reload( r ) ;
+    }
+
+    run_touched_count = 0 ;
+}
+
+/* ---------------------------------------------------------------------- */
+
+/* Merges the pending instances into the run list and closes the holes */
+
+static void sched_rebuild()
 {
-    unsigned int hash ;
+    int n, live, pending, total, first ;
+
+    if ( !run_holes && !run_pending_count ) return ;
+
+    /* Close the holes */
+    for ( live = 0; live < run_count && run_list[ live ].instance; live++ ) ;
+    for ( first = n = live; n < run_count; n++ )
+        if ( run_list[n].instance ) run_list[ live++ ] = run_list[n] ;
+
+    /* Usually a few instances, created or moved in the last frame */
+    qsort( run_pending, run_pending_count, sizeof( INSTANCE * ), sched_compare ) ;
+    for ( pending = 0; pending < run_pending_count && run_pending[ pending ]; pending++ ) ;
 
+    if ( live + pending > run_size )
+    {
+        while ( run_size < live + pending ) run_size = run_size ? run_size * 2 : 256 ;
+        run_list = bgd_realloc( run_list, run_size * sizeof( RUN_ENTRY ) ) ;
+        assert( run_list ) ;
+    }
+
+    /* Merge from the end */
+    n = total = live + pending ;
+    while ( pending > 0 )
+    {
+        if ( live > 0 && sched_before( run_pending[ pending - 1 ], run_list[ live - 1 ].instance ) )
+            run_list[ --n ] = run_list[ --live ] ;
+        else
+            sched_init( &run_list[ --n ], run_pending[ --pending ] ) ;
+    }
+
+    /* Instances before the first hole or insertion kept their place */
+    if ( live < first ) first = live ;
+
+    for ( n = first; n < total; n++ )
+    {
+        run_list[n].instance->sched_list = SCHED_RUN ;
+        run_list[n].instance->sched_index = n ;
+    }
+
+    run_count = total ;
+    run_pending_count = 0 ;
+    run_holes = 0 ;
+}
+
+void instance_add_to_list_by_priority( INSTANCE * r, int32_t priority )
+{
     if ( priority < INSTANCE_MIN_PRIORITY ) priority = LOCINT32( r, PRIORITY ) = INSTANCE_MIN_PRIORITY;
     if ( priority > INSTANCE_MAX_PRIORITY ) priority = LOCINT32( r, PRIORITY ) = INSTANCE_MAX_PRIORITY;
 
-    hash = HASH_PRIORITY( priority );
+    r->last_priority = priority ;
+    r->sched_seq = ++run_seq ;
+    r->sched_saved = sched_frame ;
+    r->sched_list = SCHED_PENDING ;
+    r->sched_index = sched_push( &run_pending, &run_pending_count, &run_pending_size, r ) - 1 ;
+}
 
-    if ( !hashed_by_priority ) hashed_by_priority = bgd_calloc( HASH_SIZE, sizeof( INSTANCE * ) );
+/* ---------------------------------------------------------------------- */
 
-    r->prev_by_priority = NULL ;
-    r->next_by_priority = hashed_by_priority[hash];
-    if ( r->next_by_priority ) r->next_by_priority->prev_by_priority = r ;
-    hashed_by_priority[hash] = r;
-    r->last_priority = priority ;
+void instance_remove_from_list_by_priority( INSTANCE * r )
+{
+    RUN_ENTRY * e = sched_entry( r ) ;
 
-    if ( priority < instance_min_actual_prio ) instance_min_actual_prio = priority ;
-    if ( priority > instance_max_actual_prio ) instance_max_actual_prio = priority ;
+    /* The locals of the instance running are newer than its entry */
+    if ( e && r != run_last )
+    {
+        sched_catch_up( e ) ;
+        sched_save_status( e ) ;
+        LOCINT32( r, FRAME_PERCENT ) = e->frame_percent ;
+    }
+
+    switch ( r->sched_list )
+    {
+        case SCHED_RUN:
+            e->instance = NULL ;
+            run_holes++ ;
+            break ;
+
+        case SCHED_PENDING:
+            run_pending[ r->sched_index ] = NULL ;
+            break ;
+
+        case SCHED_PARKED:
+            *e = run_parked[ --run_parked_count ] ;
+            e->instance->sched_index = r->sched_index ;
+            break ;
+    }
+
+    r->sched_list = SCHED_NONE ;
 }
 
 /* ---------------------------------------------------------------------- */
 
-void instance_remove_from_list_by_priority( INSTANCE * r )
+/* Drops a destroyed instance from the lists waiting for the next run or
+ * the end of the frame */
+
+static void sched_forget( INSTANCE * r )
 {
-    unsigned int hash = HASH_PRIORITY( r->last_priority );
+    if ( r->sched_dirty ) run_dirty[ r->sched_dirty - 1 ] = NULL ;
+    if ( r->sched_touched ) run_touched[ r->sched_touched - 1 ] = NULL ;
+    if ( run_last == r ) run_last = NULL ;
+
+    r->sched_dirty = r->sched_touched = 0 ;
+}
 
-    /* Update iterator_by_priority if necessary */
+/* ---------------------------------------------------------------------- */
 
-    if ( iterator_by_priority == r ) instance_next_by_priority() ;
+/*
+ *  FUNCTION : instance_status_changed
+ *
+ *  Parks a sleeping or frozen instance, so the scheduler doesn't visit
+ *  it, or takes it back to the run list when it isn't anymore, and
+ *  refreshes the cached STATUS of the others. Code changing the STATUS
+ *  local of an instance other than the running one must call it.
+ *
+ *  PARAMS :
+ *      i               Pointer to the instance
+ *
+ *  RETURN VALUE :
+ *      None
+ */
 
-    if ( r->prev_by_priority ) r->prev_by_priority->next_by_priority = r->next_by_priority ;
-    if ( r->next_by_priority ) r->next_by_priority->prev_by_priority = r->prev_by_priority ;
+void instance_status_changed( INSTANCE * i )
+{
+    int status = LOCDWORD( i, STATUS ) ;
+    int parked = SCHED_PARKS( status ) ;
+    RUN_ENTRY * e ;
 
-    if ( hashed_by_priority[hash] == r ) hashed_by_priority[hash] = r->next_by_priority ;
+    if ( i->sched_list == SCHED_NONE ) return ;
 
-    if ( !hashed_by_priority[hash] )
+    if ( parked == ( i->sched_list == SCHED_PARKED ) )
     {
-        if ( r->last_priority == instance_min_actual_prio )
-        {
-            while ( instance_min_actual_prio < instance_max_actual_prio && !hashed_by_priority[ instance_min_actual_prio + INSTANCE_NORMALIZE_PRIORITY ] )
-                    instance_min_actual_prio++;
-        }
+        if ( ( e = sched_entry( i ) ) ) sched_load( e ) ;
+        return ;
+    }
 
-        if ( r->last_priority == instance_max_actual_prio )
-        {
-            while ( instance_max_actual_prio > instance_min_actual_prio && !hashed_by_priority[ instance_max_actual_prio + INSTANCE_NORMALIZE_PRIORITY ] )
-                    instance_max_actual_prio--;
-        }
+    instance_remove_from_list_by_priority( i ) ;
+
+    if ( parked )
+        sched_park( i ) ;
+    else
+    {
+        /* Keeps its place among the instances of the same priority */
+        i->sched_list = SCHED_PENDING ;
+        i->sched_index = sched_push( &run_pending, &run_pending_count, &run_pending_size, i ) - 1 ;
     }
 }
 
 /* ---------------------------------------------------------------------- */
 
+/*
+ *  FUNCTION : instance_touch
+ *
+ *  Brings the FRAME_PERCENT and SAVED_STATUS locals of an instance up to
+ *  date before another one gets their address, and has its STATUS,
+ *  FRAME_PERCENT and PRIORITY read again before the next instance runs.
+ *  The interpreter calls it when a process takes the address of one of
+ *  these locals in another process, as in son.status = STATUS_RUNNING.
+ *
+ *  PARAMS :
+ *      i               Pointer to the instance
+ *
+ *  RETURN VALUE :
+ *      None
+ */
+
+void instance_touch( INSTANCE * i )
+{
+    instance_sync_locals( i ) ;
+
+    if ( i->sched_list != SCHED_NONE && !i->sched_touched )
+        i->sched_touched = sched_push( &run_touched, &run_touched_count, &run_touched_size, i ) ;
+}
+
+/* ---------------------------------------------------------------------- */
+
+/*
+ *  FUNCTION : instance_sync_locals
+ *
+ *  Writes the FRAME_PERCENT and SAVED_STATUS locals of an instance,
+ *  the scheduler only keeps them up to date for the instance running.
+ *  Code reading them from another instance must call it first.
+ *
+ *  PARAMS :
+ *      i               Pointer to the instance
+ *
+ *  RETURN VALUE :
+ *      None
+ */
+
+void instance_sync_locals( INSTANCE * i )
+{
+    RUN_ENTRY * e = sched_entry( i ) ;
+
+    if ( !e || i == run_last ) return ;
+
+    sched_catch_up( e ) ;
+    sched_save_status( e ) ;
+    LOCINT32( i, FRAME_PERCENT ) = e->frame_percent ;
+}
+
+/* ---------------------------------------------------------------------- */
+
 /*
  *  FUNCTION : instance_dirty
  *
- *  Adds an instance to the dirty instances list. This is a list of all
- *  instances which priority changed since the last execution.
+ *  Moves an instance which priority changed since the last execution
+ *  to its new place. Sleeping and frozen instances stay parked.
  *
  *  PARAMS :
  *      i               Pointer to the instance
@@ -226,6 +824,7 @@ void instance_dirty( INSTANCE * i )
 {
     instance_remove_from_list_by_priority( i );
     instance_add_to_list_by_priority( i, LOCINT32( i, PRIORITY ) );
+    instance_status_changed( i );
 }
 
 /* ---------------------------------------------------------------------- */
@@ -244,8 +843,15 @@ void instance_dirty( INSTANCE * i )
 
 INSTANCE * instance_get( int id )
 {
-    if ( !hashed_by_id || !id ) return NULL;
-    return ( hashed_by_id[HASH( id )] );
+    int slot, mask;
+
+    if ( !hashed_by_id || id < FIRST_INSTANCE_ID || id > LAST_INSTANCE_ID ) return NULL;
+
+    mask = hashed_by_id_size - 1;
+    for ( slot = id & mask; hashed_by_id[slot].instance; slot = ( slot + 1 ) & mask )
+        if ( hashed_by_id[slot].id == id ) return hashed_by_id[slot].instance;
+
+    return NULL;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -265,31 +871,14 @@ INSTANCE * instance_get( int id )
 
 int instance_getid()
 {
-    int id = instance_maxid++ ;
-
-    if ( !hashed_by_id ) hashed_by_id = bgd_calloc( HASH_SIZE, sizeof( INSTANCE * ) );
+    /* Ids are given in increasing order, the freed ones are reused after wrapping */
+    int id = id_find_free( instance_maxid - FIRST_INSTANCE_ID );
 
-    if ( id <= LAST_INSTANCE_ID && !hashed_by_id[ HASH( id ) ] ) return id;
+    if ( id == -1 ) id = id_find_free( 0 );
+    if ( id == -1 ) return -1;
 
-    if ( instance_maxid > LAST_INSTANCE_ID )
-    {
-        for ( instance_maxid = FIRST_INSTANCE_ID; instance_maxid <= LAST_INSTANCE_ID; instance_maxid++ )
-        {
-            if ( !hashed_by_id[HASH( instance_maxid )] ) return instance_maxid++;
-        }
-    }
-    else
-    {
-        for ( ; instance_maxid <= LAST_INSTANCE_ID; instance_maxid++ )
-        {
-            if ( !hashed_by_id[HASH( instance_maxid )] ) return instance_maxid++;
-        }
-        for ( instance_maxid = FIRST_INSTANCE_ID; instance_maxid < id; instance_maxid++ )
-        {
-            if ( !hashed_by_id[HASH( instance_maxid )] ) return instance_maxid++;
-        }
-    }
-    return -1;
+    instance_maxid = id + 1;
+    return id;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -320,12 +909,9 @@ INSTANCE * instance_duplicate( INSTANCE * father )
 
     if ( ( pid = instance_getid() ) == -1 ) return NULL;
 
-    r = ( INSTANCE * ) bgd_calloc( 1, sizeof( INSTANCE ) ) ;
+    r = instance_alloc( father->proc ) ;
     assert( r ) ;
 
-    r->pridata          = ( int * ) bgd_malloc( father->private_size + 4 ) ;
-    r->pubdata          = ( int * ) bgd_malloc( father->public_size + 4 ) ;
-    r->locdata          = ( int * ) bgd_malloc( local_size + 4 ) ;
     r->code             = father->code ;
     r->codeptr          = father->codeptr ;
     r->exitcode         = father->exitcode ;
@@ -390,7 +976,6 @@ INSTANCE * instance_duplicate( INSTANCE * father )
 
     r->called_by = NULL;
 
-    r->stack = bgd_malloc( father->stack[0] );
     memmove(r->stack, father->stack, father->stack_ptr - father->stack);
     r->stack_ptr = &r->stack[1];
 
@@ -430,12 +1015,9 @@ INSTANCE * instance_new( PROCDEF * proc, INSTANCE * father )
 
     if ( ( pid = instance_getid() ) == -1 ) return NULL;
 
-    r = ( INSTANCE * ) bgd_calloc( 1, sizeof( INSTANCE ) ) ;
+    r = instance_alloc( proc ) ;
     assert( r ) ;
 
-    r->pridata          = ( int * ) bgd_malloc( proc->private_size + 4 ) ;
-    r->pubdata          = ( int * ) bgd_malloc( proc->public_size + 4 ) ;
-    r->locdata          = ( int * ) bgd_malloc( local_size + 4 ) ;
     r->code             = proc->code ;
     r->codeptr          = proc->code ;
     r->exitcode         = proc->exitcode ;
@@ -506,7 +1088,6 @@ INSTANCE * instance_new( PROCDEF * proc, INSTANCE * father )
 
     r->called_by = NULL;
 
-    r->stack = bgd_malloc( STACK_SIZE );
     r->stack_ptr = &r->stack[1];
     r->stack[0] = STACK_SIZE;
 
@@ -636,13 +1217,9 @@ void instance_destroy( INSTANCE * r )
     instance_remove_from_list_by_instance( r );
     instance_remove_from_list_by_type( r, LOCDWORD( r, PROCESS_TYPE ) );
     instance_remove_from_list_by_priority( r );
+    sched_forget( r );
 
-    if ( r->stack ) bgd_free( r->stack ) ;
-
-    if ( r->locdata ) bgd_free( r->locdata ) ;
-    if ( r->pubdata ) bgd_free( r->pubdata ) ;
-    if ( r->pridata ) bgd_free( r->pridata ) ;
-    bgd_free( r ) ;
+    instance_free( r ) ;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -681,7 +1258,9 @@ int instance_exists( INSTANCE * r )
  *  FUNCTION : instance_next_by_priority
  *
  *  Gets the next instance pointer until no more instances are
- *  returned. Instances are returned sorted by priority.
+ *  returned. Instances are returned sorted by priority. Only
+ *  instances running, killed or dead and with FRAME_PERCENT
+ *  under 100 are returned.
  *
  *  PARAMS :
  *      None
@@ -695,21 +1274,29 @@ int instance_exists( INSTANCE * r )
 
 INSTANCE * instance_next_by_priority()
 {
-    INSTANCE * r = iterator_by_priority ;
+    RUN_ENTRY * e ;
+    INSTANCE * r ;
 
-    if ( iterator_by_priority ) iterator_by_priority = iterator_by_priority->next_by_priority;
+    sched_sync_last() ;
 
-    if ( !iterator_by_priority )
+    for ( ; run_pos < run_count; run_pos++ )
     {
-        if ( !hashed_by_priority ) return NULL;
+        e = &run_list[ run_pos ] ;
+
+        if ( !( r = e->instance ) || !SCHED_COUNTS( e->status ) ) continue ;
 
-        if ( iterator_pos < instance_min_actual_prio || iterator_pos > instance_max_actual_prio )
-            iterator_pos = instance_max_actual_prio + 1;
+        sched_catch_up( e ) ;
+        if ( e->frame_percent >= 100 ) continue ;
 
-        while ( --iterator_pos >= instance_min_actual_prio && !( iterator_by_priority = hashed_by_priority[ iterator_pos + INSTANCE_NORMALIZE_PRIORITY ] ) );
+        sched_save_status( e ) ;
+        LOCINT32( r, FRAME_PERCENT ) = e->frame_percent ;
+        run_last = r ;
+        run_pos++ ;
+        return r ;
     }
 
-    return ( r ) ;
+    instance_reset_iterator_by_priority() ;
+    return NULL ;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -762,7 +1349,96 @@ INSTANCE * instance_get_by_type( uint32_t type, INSTANCE ** context )
 
 void instance_reset_iterator_by_priority()
 {
-    iterator_by_priority = hashed_by_priority[ ( iterator_pos = instance_max_actual_prio ) + INSTANCE_NORMALIZE_PRIORITY ];
+    sched_sync_last() ;
+    sched_rebuild() ;
+    run_pos = 0 ;
+}
+
+/* ---------------------------------------------------------------------- */
+
+/*
+ *  FUNCTION : instance_end_frame
+ *
+ *  Ends the frame for every instance: the FRAME_PERCENT and SAVED_STATUS
+ *  locals are brought up to date later, when they are read or the
+ *  instance runs. Only the instances whose PRIORITY changed are visited,
+ *  to move them and save it in SAVED_PRIORITY.
+ *
+ *  PARAMS :
+ *      None
+ *
+ *  RETURN VALUE :
+ *      None
+ */
+
+void instance_end_frame()
+{
+    INSTANCE * r ;
+    int n ;
+
+    instance_reset_iterator_by_priority() ;
+
+    sched_frame++ ;
+
+    for ( n = 0; n < run_dirty_count; n++ )
+    {
+        if ( !( r = run_dirty[n] ) ) continue ;
+
+        r->sched_dirty = 0 ;
+        if ( LOCINT32( r, PRIORITY ) == r->last_priority ) continue ;
+
+        LOCINT32( r, SAVED_PRIORITY ) = LOCINT32( r, PRIORITY ) ;
+        instance_dirty( r ) ;
+    }
+
+    run_dirty_count = 0 ;
+}
+
+/* ---------------------------------------------------------------------- */
+
+/*
+ *  FUNCTION : instance_savestate_register
+ *
+ *  Registers the instance lists and iterators for save states.
+ *
+ *  PARAMS :
+ *      None
+ *
+ *  RETURN VALUE :
+ *      None
+ */
+
+void instance_savestate_register()
+{
+    savestate_register_var( id_used );
+    savestate_register_var( id_full );
+    savestate_register_ptr( hashed_by_id );
+    savestate_register_var( hashed_by_id_size );
+    savestate_register_var( hashed_by_id_count );
+    savestate_register_ptr( hashed_by_instance );
+    savestate_register_ptr( hashed_by_type );
+    savestate_register_ptr( first_instance );
+    savestate_register_var( instance_maxid );
+    savestate_register_ptr( run_list );
+    savestate_register_var( run_count );
+    savestate_register_var( run_size );
+    savestate_register_var( run_holes );
+    savestate_register_var( run_pos );
+    savestate_register_ptr( run_pending );
+    savestate_register_var( run_pending_count );
+    savestate_register_var( run_pending_size );
+    savestate_register_ptr( run_parked );
+    savestate_register_var( run_parked_count );
+    savestate_register_var( run_parked_size );
+    savestate_register_ptr( run_dirty );
+    savestate_register_var( run_dirty_count );
+    savestate_register_var( run_dirty_size );
+    savestate_register_ptr( run_touched );
+    savestate_register_var( run_touched_count );
+    savestate_register_var( run_touched_size );
+    savestate_register_ptr( run_last );
+    savestate_register_var( run_seq );
+    savestate_register_var( sched_frame );
 }
 
 /* ---------------------------------------------------------------------- */
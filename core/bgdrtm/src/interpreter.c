@@ -38,6 +38,7 @@
 #include "instance.h"
 #include "offsets.h"
 #include "xstrings.h"
+#include "profiler.h"
 
 #include <assert.h>
 
@@ -45,6 +46,138 @@
 /* Interpreter's main module                                              */
 /* ---------------------------------------------------------------------- */
 
+/* With GCC/Clang every procedure gets a threaded copy of its code at load
+ * time: one handler address per code word, parallel to the bytecode. Each
+ * handler jumps straight to the next one instead of returning to the switch,
+ * so every opcode gets its own indirect branch. Other compilers use the
+ * switch only.
+ */
+
+#if defined( __GNUC__ ) && !defined( EXIT_ON_EMPTY_STACK ) && !defined( NO_COMPUTED_GOTO ) && !defined( OPCODE_NGRAMS )
+#define USE_COMPUTED_GOTO   1
+#endif
+
+#define MN_HANDLERS         0x1000  /* Type flags + mnemonic */
+
+/* Superinstructions, handlers stored after the mnemonic ones */
+
+enum
+{
+    FUSED_PRIVATE_PUSH_LETNP = MN_HANDLERS + 1,
+    FUSED_LOCAL_PUSH_LETNP,
+    FUSED_GLOBAL_PUSH_LETNP,
+    FUSED_PUSH_ADD,
+    FUSED_PUSH_SUB,
+    FUSED_GET_PRIV_PUSH_EQ_JFALSE,
+    FUSED_GET_PRIV_PUSH_NE_JFALSE,
+    FUSED_GET_PRIV_PUSH_LT_JFALSE,
+    FUSED_GET_PRIV_PUSH_GT_JFALSE,
+    FUSED_GET_PRIV_PUSH_LTE_JFALSE,
+    FUSED_GET_PRIV_PUSH_GTE_JFALSE,
+    FUSED_GET_LOCAL_PUSH_EQ_JFALSE,
+    FUSED_GET_LOCAL_PUSH_NE_JFALSE,
+    FUSED_GET_LOCAL_PUSH_LT_JFALSE,
+    FUSED_GET_LOCAL_PUSH_GT_JFALSE,
+    FUSED_GET_LOCAL_PUSH_LTE_JFALSE,
+    FUSED_GET_LOCAL_PUSH_GTE_JFALSE,
+    FUSED_PUSH_EQ_JFALSE,
+    FUSED_PUSH_NE_JFALSE,
+    FUSED_PUSH_LT_JFALSE,
+    FUSED_PUSH_GT_JFALSE,
+    FUSED_PUSH_LTE_JFALSE,
+    FUSED_PUSH_GTE_JFALSE,
+    FUSED_HANDLERS
+};
+
+/* Sequences replaced by a superinstruction, longest first. A mnemonic
+ * matches when it runs the same handler, so type variants sharing the
+ * code are accepted too.
+ */
+
+#define FUSED_MAX_MNEMONICS 4
+
+static struct
+{
+    int mnemonics[ FUSED_MAX_MNEMONICS ];
+    int count;
+    int handler;
+}
+fused_patterns[] =
+{
+    { { MN_GET_PRIV,  MN_PUSH, MN_EQ,  MN_JFALSE }, 4, FUSED_GET_PRIV_PUSH_EQ_JFALSE   },
+    { { MN_GET_PRIV,  MN_PUSH, MN_NE,  MN_JFALSE }, 4, FUSED_GET_PRIV_PUSH_NE_JFALSE   },
+    { { MN_GET_PRIV,  MN_PUSH, MN_LT,  MN_JFALSE }, 4, FUSED_GET_PRIV_PUSH_LT_JFALSE   },
+    { { MN_GET_PRIV,  MN_PUSH, MN_GT,  MN_JFALSE }, 4, FUSED_GET_PRIV_PUSH_GT_JFALSE   },
+    { { MN_GET_PRIV,  MN_PUSH, MN_LTE, MN_JFALSE }, 4, FUSED_GET_PRIV_PUSH_LTE_JFALSE  },
+    { { MN_GET_PRIV,  MN_PUSH, MN_GTE, MN_JFALSE }, 4, FUSED_GET_PRIV_PUSH_GTE_JFALSE  },
+    { { MN_GET_LOCAL, MN_PUSH, MN_EQ,  MN_JFALSE }, 4, FUSED_GET_LOCAL_PUSH_EQ_JFALSE  },
+    { { MN_GET_LOCAL, MN_PUSH, MN_NE,  MN_JFALSE }, 4, FUSED_GET_LOCAL_PUSH_NE_JFALSE  },
+    { { MN_GET_LOCAL, MN_PUSH, MN_LT,  MN_JFALSE }, 4, FUSED_GET_LOCAL_PUSH_LT_JFALSE  },
+    { { MN_GET_LOCAL, MN_PUSH, MN_GT,  MN_JFALSE }, 4, FUSED_GET_LOCAL_PUSH_GT_JFALSE  },
+    { { MN_GET_LOCAL, MN_PUSH, MN_LTE, MN_JFALSE }, 4, FUSED_GET_LOCAL_PUSH_LTE_JFALSE },
+    { { MN_GET_LOCAL, MN_PUSH, MN_GTE, MN_JFALSE }, 4, FUSED_GET_LOCAL_PUSH_GTE_JFALSE },
+    { { MN_PRIVATE,   MN_PUSH, MN_LETNP          }, 3, FUSED_PRIVATE_PUSH_LETNP        },
+    { { MN_LOCAL,     MN_PUSH, MN_LETNP          }, 3, FUSED_LOCAL_PUSH_LETNP          },
+    { { MN_GLOBAL,    MN_PUSH, MN_LETNP          }, 3, FUSED_GLOBAL_PUSH_LETNP         },
+    { { MN_PUSH,      MN_EQ,   MN_JFALSE         }, 3, FUSED_PUSH_EQ_JFALSE            },
+    { { MN_PUSH,      MN_NE,   MN_JFALSE         }, 3, FUSED_PUSH_NE_JFALSE            },
+    { { MN_PUSH,      MN_LT,   MN_JFALSE         }, 3, FUSED_PUSH_LT_JFALSE            },
+    { { MN_PUSH,      MN_GT,   MN_JFALSE         }, 3, FUSED_PUSH_GT_JFALSE            },
+    { { MN_PUSH,      MN_LTE,  MN_JFALSE         }, 3, FUSED_PUSH_LTE_JFALSE           },
+    { { MN_PUSH,      MN_GTE,  MN_JFALSE         }, 3, FUSED_PUSH_GTE_JFALSE           },
+    { { MN_PUSH,      MN_ADD                     }, 2, FUSED_PUSH_ADD                  },
+    { { MN_PUSH,      MN_SUB                     }, 2, FUSED_PUSH_SUB                  },
+    { { 0 }, 0, 0 }
+};
+
+#ifdef USE_COMPUTED_GOTO
+#define HANDLER( name )     op_##name:
+
+/* Same checks as the top of the main loop, anything unusual goes the slow way */
+#define NEXT_OPCODE                                                                                         \
+    {                                                                                                       \
+        if ( r->stack_ptr < r->stack || must_exit || debug > 0 || debugger_show_console ) break;           \
+        status = LOCDWORD( r, STATUS );                                                                     \
+        if (( status & ~STATUS_WAITING_MASK ) == STATUS_KILLED || ( status & STATUS_WAITING_MASK ) ) break; \
+        PROFILER_OPCODE( *ptr );                                                                            \
+        goto *threaded[ ptr - r->code ];                                                                    \
+    }
+
+#define JUMP_OPCODE         NEXT_OPCODE
+
+/* <var> <value> <cmp> JFALSE: ptr[1] variable, ptr[3] value, ptr[6] target */
+#define FUSED_VAR_CMP_JFALSE( name, var, cmp )                          \
+            HANDLER( name )                                             \
+                if ( !( var( r, ptr[1] ) cmp ptr[3] ) ) {               \
+                    ptr = r->code + ptr[6];                             \
+                    JUMP_OPCODE;                                        \
+                }                                                       \
+                ptr += 7;                                               \
+                NEXT_OPCODE;
+
+/* <value> <cmp> JFALSE: ptr[1] value, ptr[4] target */
+#define FUSED_CMP_JFALSE( name, cmp )                                   \
+            HANDLER( name )                                             \
+                r->stack_ptr--;                                         \
+                if ( !( *r->stack_ptr cmp ptr[1] ) ) {                  \
+                    ptr = r->code + ptr[4];                             \
+                    JUMP_OPCODE;                                        \
+                }                                                       \
+                ptr += 5;                                               \
+                NEXT_OPCODE;
+
+static void ** handlers = NULL ;   /* [MN_HANDLERS] is the "not implemented" handler */
+#else
+#define HANDLER( name )
+#define NEXT_OPCODE         break
+#define JUMP_OPCODE         continue
+#endif
+
+/* Locals of another instance the scheduler caches: FRAME_PERCENT, STATUS,
+ * SAVED_STATUS, SAVED_PRIORITY and PRIORITY */
+
+#define SCHED_LOCAL( offset )   ( ( ( offset ) >= ( FRAME_PERCENT ) && ( offset ) <= ( SAVED_PRIORITY ) ) || ( offset ) == ( PRIORITY ) )
+
 int exit_value = 0;
 int must_exit = 0;
 
@@ -79,6 +212,111 @@ static int stack_dump( INSTANCE * r ) {
     return i;
 }
 
+/* ---------------------------------------------------------------------- */
+/* Opcode n-gram counter (build with OPCODE_NGRAMS)                       */
+/* Counts the sequences of 2 to NGRAM_MAX mnemonics executed without a    */
+/* jump in between, the candidates for new superinstructions. The most    */
+/* frequent ones are printed on exit.                                     */
+/* ---------------------------------------------------------------------- */
+
+#ifdef OPCODE_NGRAMS
+
+#define NGRAM_MAX       4
+#define NGRAM_SLOTS     65536
+#define NGRAM_TOP       40
+
+typedef struct
+{
+    uint64_t key ;      /* Mnemonics, 12 bits each, length in the top bits */
+    uint64_t count ;
+}
+NGRAM ;
+
+static NGRAM ngrams[ NGRAM_SLOTS ] ;
+static int ngram_used = 0 ;
+
+static uint64_t ngram_history = 0 ;
+static int ngram_length = 0 ;
+static int * ngram_next = NULL ;
+
+static void ngram_count( int * ptr ) {
+    uint64_t key;
+    uint32_t h;
+    int n;
+
+    /* Only straight code can be fused, start again after any jump */
+    if ( ptr != ngram_next ) ngram_length = 0;
+    ngram_next = ptr + 1 + MN_PARAMS( *ptr );
+
+    ngram_history = ( ngram_history << 12 ) | ( *ptr & 0xFFF );
+    if ( ngram_length < NGRAM_MAX ) ngram_length++;
+
+    for ( n = 2; n <= ngram_length; n++ ) {
+        key = ( ngram_history & ( ( 1ull << ( 12 * n ) ) - 1 ) ) | ( ( uint64_t ) n << 60 );
+        h = ( uint32_t )(( key * 0x9E3779B97F4A7C15ull ) >> 48 );
+
+        while ( ngrams[h].key && ngrams[h].key != key ) h = ( h + 1 ) & ( NGRAM_SLOTS - 1 );
+
+        if ( !ngrams[h].key ) {
+            /* Keep the table sparse, new sequences are dropped when it is full */
+            if ( ngram_used >= NGRAM_SLOTS / 4 * 3 ) continue;
+            ngrams[h].key = key;
+            ngram_used++;
+        }
+
+        ngrams[h].count++;
+    }
+}
+
+static int ngram_compare( const void * a, const void * b ) {
+    const NGRAM * na = ( const NGRAM * ) a, * nb = ( const NGRAM * ) b;
+    return ( na->count < nb->count ) - ( na->count > nb->count );
+}
+
+static const char * ngram_type( int op ) {
+    switch ( MN_TYPEOF( op ) ) {
+        case MN_UNSIGNED:               return ":UNSIGNED";
+        case MN_WORD:                   return ":SHORT";
+        case MN_WORD | MN_UNSIGNED:     return ":WORD";
+        case MN_BYTE:                   return ":CHAR";
+        case MN_BYTE | MN_UNSIGNED:     return ":BYTE";
+        case MN_FLOAT:                  return ":FLOAT";
+        case MN_STRING:                 return ":STRING";
+    }
+    return "";
+}
+
+void opcode_ngrams_dump() {
+    NGRAM * list = ( NGRAM * ) malloc( sizeof( NGRAM ) * ( ngram_used + 1 ) );
+    int n, m, k, count;
+
+    if ( !list ) return;
+
+    for ( n = 2; n <= NGRAM_MAX; n++ ) {
+        for ( count = 0, m = 0; m < NGRAM_SLOTS; m++ )
+            if ( ngrams[m].key && ( int )( ngrams[m].key >> 60 ) == n ) list[count++] = ngrams[m];
+
+        qsort( list, count, sizeof( NGRAM ), ngram_compare );
+
+        printf( "\n>>> Most executed sequences of %d mnemonics\n", n );
+        for ( m = 0; m < count && m < NGRAM_TOP; m++ ) {
+            printf( "%12llu ", ( unsigned long long ) list[m].count );
+            for ( k = n - 1; k >= 0; k-- ) {
+                int op = ( int )( list[m].key >> ( 12 * k ) ) & 0xFFF;
+                char * name = mnemonic_name( op );
+                if ( name ) printf( " %s%s", name, ngram_type( op ) );
+                else        printf( " 0x%03X", op );
+            }
+            printf( "\n" );
+        }
+    }
+
+    fflush( stdout );
+    free( list );
+}
+
+#endif
+
 /* ---------------------------------------------------------------------- */
 
 int instance_go_all() {
@@ -96,29 +334,29 @@ int instance_go_all() {
         i = instance_next_by_priority();
 
         i_count = 0;
+        /* Only instances with FRAME_PERCENT < 100 not sleeping, frozen or waiting are returned */
         while ( i ) {
-            if ( LOCINT32( i, FRAME_PERCENT ) < 100 ) {
-                status = LOCDWORD( i, STATUS );
-                if ( status == STATUS_RUNNING ) {
-                    /* Run instance */
-                    /* Hook */
-                    if ( process_exec_hook_count )
-                        for ( n = 0; n < process_exec_hook_count; n++ )
-                            process_exec_hook_list[n]( i );
-                    /* Hook */
-                } else if ( status != STATUS_KILLED && status != STATUS_DEAD ) { /* STATUS_SLEEPING OR STATUS_FROZEN OR STATUS_WAITING_MASK */
-                    i = instance_next_by_priority();
-                    continue;
-                }
-                /* If instance is KILLED or DEAD, run instance without exec_hook executed. */
-
-                instance_go( i );
+            status = LOCDWORD( i, STATUS );
+            if ( status == STATUS_RUNNING ) {
+                /* Run instance */
+                /* Hook */
+                if ( process_exec_hook_count )
+                    for ( n = 0; n < process_exec_hook_count; n++ )
+                        process_exec_hook_list[n]( i );
+                /* Hook */
+            } else if ( status != STATUS_KILLED && status != STATUS_DEAD ) { /* STATUS_SLEEPING OR STATUS_FROZEN OR STATUS_WAITING_MASK */
+                /* Changed behind the scheduler's back, it's parked or skipped from now on */
+                instance_status_changed( i );
+                i = instance_next_by_priority();
+                continue;
+            }
+            /* If instance is KILLED or DEAD, run instance without exec_hook executed. */
 
-                i_count++;
+            instance_go( i );
 
-                if ( must_exit ) goto instance_go_all_exit;
+            i_count++;
 
-            }
+            if ( must_exit ) goto instance_go_all_exit;
 
             i = instance_next_by_priority();
         }
@@ -127,22 +365,8 @@ int instance_go_all() {
 
         if ( !i_count ) {
             frame_completed = 1;
-            /* Honors the signal-changed status of the process and
-             * saves so it is used in this loop the next frame
-             */
-            i = first_instance;
-            while ( i ) {
-                status = LOCDWORD( i, SAVED_STATUS ) = LOCDWORD( i, STATUS );
-                // if status == STATUS_KILLED or STATUS_DEAD then the process still lives
-                if ( status == STATUS_DEAD || status == STATUS_KILLED || status == STATUS_RUNNING ) LOCINT32( i, FRAME_PERCENT ) -= 100;
-
-                if ( i->last_priority != LOCINT32( i, PRIORITY ) ) {
-                    instance_dirty( i );
-                    LOCINT32( i, SAVED_PRIORITY ) = LOCINT32( i, PRIORITY );
-                }
-
-                i = i->next;
-            }
+            /* Updates FRAME_PERCENT and priorities of the runnable instances */
+            instance_end_frame();
 
             if ( !first_instance ) break;
 
@@ -166,7 +390,404 @@ instance_go_all_exit:
 
 int instance_go( INSTANCE * r ) {
 
+#ifdef USE_COMPUTED_GOTO
+    static void * handler_table[ FUSED_HANDLERS ] = {
+        [ MN_NOP ]                                       = &&op_nop,
+        [ MN_DUP ]                                       = &&op_dup,
+        [ MN_PUSH ]                                      = &&op_push,
+        [ MN_POP ]                                       = &&op_pop,
+        [ MN_INDEX ]                                     = &&op_index,
+        [ MN_INDEX | MN_UNSIGNED ]                       = &&op_index,
+        [ MN_INDEX | MN_STRING ]                         = &&op_index,
+        [ MN_INDEX | MN_WORD ]                           = &&op_index,
+        [ MN_INDEX | MN_WORD | MN_UNSIGNED ]             = &&op_index,
+        [ MN_INDEX | MN_BYTE ]                           = &&op_index,
+        [ MN_INDEX | MN_BYTE | MN_UNSIGNED ]             = &&op_index,
+        [ MN_INDEX | MN_FLOAT ]                          = &&op_index,
+        [ MN_ARRAY ]                                     = &&op_array,
+        [ MN_CLONE ]                                     = &&op_clone,
+        [ MN_CALL ]                                      = &&op_call,
+        [ MN_PROC ]                                      = &&op_call,
+        [ MN_SYSCALL ]                                   = &&op_syscall,
+        [ MN_SYSPROC ]                                   = &&op_sysproc,
+        [ MN_PRIVATE ]                                   = &&op_private,
+        [ MN_PRIVATE | MN_UNSIGNED ]                     = &&op_private,
+        [ MN_PRIVATE | MN_WORD ]                         = &&op_private,
+        [ MN_PRIVATE | MN_BYTE ]                         = &&op_private,
+        [ MN_PRIVATE | MN_WORD | MN_UNSIGNED ]           = &&op_private,
+        [ MN_PRIVATE | MN_BYTE | MN_UNSIGNED ]           = &&op_private,
+        [ MN_PRIVATE | MN_STRING ]                       = &&op_private,
+        [ MN_PRIVATE | MN_FLOAT ]                        = &&op_private,
+        [ MN_PUBLIC ]                                    = &&op_public,
+        [ MN_PUBLIC | MN_UNSIGNED ]                      = &&op_public,
+        [ MN_PUBLIC | MN_WORD ]                          = &&op_public,
+        [ MN_PUBLIC | MN_BYTE ]                          = &&op_public,
+        [ MN_PUBLIC | MN_WORD | MN_UNSIGNED ]            = &&op_public,
+        [ MN_PUBLIC | MN_BYTE | MN_UNSIGNED ]            = &&op_public,
+        [ MN_PUBLIC | MN_STRING ]                        = &&op_public,
+        [ MN_PUBLIC | MN_FLOAT ]                         = &&op_public,
+        [ MN_LOCAL ]                                     = &&op_local,
+        [ MN_LOCAL | MN_UNSIGNED ]                       = &&op_local,
+        [ MN_LOCAL | MN_WORD ]                           = &&op_local,
+        [ MN_LOCAL | MN_BYTE ]                           = &&op_local,
+        [ MN_LOCAL | MN_WORD | MN_UNSIGNED ]             = &&op_local,
+        [ MN_LOCAL | MN_BYTE | MN_UNSIGNED ]             = &&op_local,
+        [ MN_LOCAL | MN_STRING ]                         = &&op_local,
+        [ MN_LOCAL | MN_FLOAT ]                          = &&op_local,
+        [ MN_GLOBAL ]                                    = &&op_global,
+        [ MN_GLOBAL | MN_UNSIGNED ]                      = &&op_global,
+        [ MN_GLOBAL | MN_WORD ]                          = &&op_global,
+        [ MN_GLOBAL | MN_BYTE ]                          = &&op_global,
+        [ MN_GLOBAL | MN_WORD | MN_UNSIGNED ]            = &&op_global,
+        [ MN_GLOBAL | MN_BYTE | MN_UNSIGNED ]            = &&op_global,
+        [ MN_GLOBAL | MN_STRING ]                        = &&op_global,
+        [ MN_GLOBAL | MN_FLOAT ]                         = &&op_global,
+        [ MN_REMOTE ]                                    = &&op_remote,
+        [ MN_REMOTE | MN_UNSIGNED ]                      = &&op_remote,
+        [ MN_REMOTE | MN_WORD ]                          = &&op_remote,
+        [ MN_REMOTE | MN_BYTE ]                          = &&op_remote,
+        [ MN_REMOTE | MN_WORD | MN_UNSIGNED ]            = &&op_remote,
+        [ MN_REMOTE | MN_BYTE | MN_UNSIGNED ]            = &&op_remote,
+        [ MN_REMOTE | MN_STRING ]                        = &&op_remote,
+        [ MN_REMOTE | MN_FLOAT ]                         = &&op_remote,
+        [ MN_REMOTE_PUBLIC ]                             = &&op_remote_public,
+        [ MN_REMOTE_PUBLIC | MN_UNSIGNED ]               = &&op_remote_public,
+        [ MN_REMOTE_PUBLIC | MN_WORD ]                   = &&op_remote_public,
+        [ MN_REMOTE_PUBLIC | MN_BYTE ]                   = &&op_remote_public,
+        [ MN_REMOTE_PUBLIC | MN_WORD | MN_UNSIGNED ]     = &&op_remote_public,
+        [ MN_REMOTE_PUBLIC | MN_BYTE | MN_UNSIGNED ]     = &&op_remote_public,
+        [ MN_REMOTE_PUBLIC | MN_STRING ]                 = &&op_remote_public,
+        [ MN_REMOTE_PUBLIC | MN_FLOAT ]                  = &&op_remote_public,
+        [ MN_GET_PRIV ]                                  = &&op_get_priv,
+        [ MN_GET_PRIV | MN_FLOAT ]                       = &&op_get_priv,
+        [ MN_GET_PRIV | MN_UNSIGNED ]                    = &&op_get_priv,
+        [ MN_GET_PUBLIC ]                                = &&op_get_public,
+        [ MN_GET_PUBLIC | MN_FLOAT ]                     = &&op_get_public,
+        [ MN_GET_PUBLIC | MN_UNSIGNED ]                  = &&op_get_public,
+        [ MN_GET_LOCAL ]                                 = &&op_get_local,
+        [ MN_GET_LOCAL | MN_FLOAT ]                      = &&op_get_local,
+        [ MN_GET_LOCAL | MN_UNSIGNED ]                   = &&op_get_local,
+        [ MN_GET_GLOBAL ]                                = &&op_get_global,
+        [ MN_GET_GLOBAL | MN_FLOAT ]                     = &&op_get_global,
+        [ MN_GET_GLOBAL | MN_UNSIGNED ]                  = &&op_get_global,
+        [ MN_GET_REMOTE ]                                = &&op_get_remote,
+        [ MN_GET_REMOTE | MN_FLOAT ]                     = &&op_get_remote,
+        [ MN_GET_REMOTE | MN_UNSIGNED ]                  = &&op_get_remote,
+        [ MN_GET_REMOTE_PUBLIC ]                         = &&op_get_remote_public,
+        [ MN_GET_REMOTE_PUBLIC | MN_FLOAT ]              = &&op_get_remote_public,
+        [ MN_GET_REMOTE_PUBLIC | MN_UNSIGNED ]           = &&op_get_remote_public,
+        [ MN_PTR ]                                       = &&op_ptr,
+        [ MN_PTR | MN_UNSIGNED ]                         = &&op_ptr,
+        [ MN_PTR | MN_FLOAT ]                            = &&op_ptr,
+        [ MN_PUSH | MN_STRING ]                          = &&op_push_string,
+        [ MN_GET_PRIV | MN_STRING ]                      = &&op_get_priv_string,
+        [ MN_GET_PUBLIC | MN_STRING ]                    = &&op_get_public_string,
+        [ MN_GET_LOCAL | MN_STRING ]                     = &&op_get_local_string,
+        [ MN_GET_GLOBAL | MN_STRING ]                    = &&op_get_global_string,
+        [ MN_GET_REMOTE | MN_STRING ]                    = &&op_get_remote_string,
+        [ MN_GET_REMOTE_PUBLIC | MN_STRING ]             = &&op_get_remote_public_string,
+        [ MN_STRING | MN_PTR ]                           = &&op_ptr_string,
+        [ MN_STRING | MN_POP ]                           = &&op_pop_string,
+        [ MN_WORD | MN_GET_PRIV ]                        = &&op_get_priv_word,
+        [ MN_WORD | MN_GET_PRIV | MN_UNSIGNED ]          = &&op_get_priv_word_unsigned,
+        [ MN_WORD | MN_GET_PUBLIC ]                      = &&op_get_public_word,
+        [ MN_WORD | MN_GET_PUBLIC | MN_UNSIGNED ]        = &&op_get_public_word_unsigned,
+        [ MN_WORD | MN_GET_LOCAL ]                       = &&op_get_local_word,
+        [ MN_WORD | MN_GET_LOCAL | MN_UNSIGNED ]         = &&op_get_local_word_unsigned,
+        [ MN_WORD | MN_GET_GLOBAL ]                      = &&op_get_global_word,
+        [ MN_WORD | MN_GET_GLOBAL | MN_UNSIGNED ]        = &&op_get_global_word_unsigned,
+        [ MN_WORD | MN_GET_REMOTE ]                      = &&op_get_remote_word,
+        [ MN_WORD | MN_GET_REMOTE | MN_UNSIGNED ]        = &&op_get_remote_word_unsigned,
+        [ MN_WORD | MN_GET_REMOTE_PUBLIC ]               = &&op_get_remote_public_word,
+        [ MN_WORD | MN_GET_REMOTE_PUBLIC | MN_UNSIGNED ] = &&op_get_remote_public_word_unsigned,
+        [ MN_WORD | MN_PTR ]                             = &&op_ptr_word,
+        [ MN_WORD | MN_PTR | MN_UNSIGNED ]               = &&op_ptr_word_unsigned,
+        [ MN_BYTE | MN_GET_PRIV ]                        = &&op_get_priv_byte,
+        [ MN_BYTE | MN_GET_PRIV | MN_UNSIGNED ]          = &&op_get_priv_byte_unsigned,
+        [ MN_BYTE | MN_GET_PUBLIC ]                      = &&op_get_public_byte,
+        [ MN_BYTE | MN_GET_PUBLIC | MN_UNSIGNED ]        = &&op_get_public_byte_unsigned,
+        [ MN_BYTE | MN_GET_LOCAL ]                       = &&op_get_local_byte,
+        [ MN_BYTE | MN_GET_LOCAL | MN_UNSIGNED ]         = &&op_get_local_byte_unsigned,
+        [ MN_BYTE | MN_GET_GLOBAL ]                      = &&op_get_global_byte,
+        [ MN_BYTE | MN_GET_GLOBAL | MN_UNSIGNED ]        = &&op_get_global_byte_unsigned,
+        [ MN_BYTE | MN_GET_REMOTE ]                      = &&op_get_remote_byte,
+        [ MN_BYTE | MN_GET_REMOTE | MN_UNSIGNED ]        = &&op_get_remote_byte_unsigned,
+        [ MN_BYTE | MN_GET_REMOTE_PUBLIC ]               = &&op_get_remote_public_byte,
+        [ MN_BYTE | MN_GET_REMOTE_PUBLIC | MN_UNSIGNED ] = &&op_get_remote_public_byte_unsigned,
+        [ MN_BYTE | MN_PTR ]                             = &&op_ptr_byte,
+        [ MN_BYTE | MN_PTR | MN_UNSIGNED ]               = &&op_ptr_byte_unsigned,
+        [ MN_FLOAT | MN_NEG ]                            = &&op_neg_float,
+        [ MN_FLOAT | MN_NOT ]                            = &&op_not_float,
+        [ MN_FLOAT | MN_ADD ]                            = &&op_add_float,
+        [ MN_FLOAT | MN_SUB ]                            = &&op_sub_float,
+        [ MN_FLOAT | MN_MUL ]                            = &&op_mul_float,
+        [ MN_FLOAT | MN_DIV ]                            = &&op_div_float,
+        [ MN_FLOAT2INT ]                                 = &&op_float2int,
+        [ MN_INT2FLOAT ]                                 = &&op_int2float,
+        [ MN_INT2FLOAT | MN_UNSIGNED ]                   = &&op_int2float,
+        [ MN_INT2FLOAT | MN_UNSIGNED | MN_WORD ]         = &&op_int2float_word_unsigned,
+        [ MN_INT2FLOAT | MN_UNSIGNED | MN_BYTE ]         = &&op_int2float_byte_unsigned,
+        [ MN_INT2WORD ]                                  = &&op_int2word,
+        [ MN_INT2WORD | MN_UNSIGNED ]                    = &&op_int2word,
+        [ MN_INT2BYTE ]                                  = &&op_int2byte,
+        [ MN_INT2BYTE | MN_UNSIGNED ]                    = &&op_int2byte,
+        [ MN_NEG ]                                       = &&op_neg,
+        [ MN_NEG | MN_UNSIGNED ]                         = &&op_neg,
+        [ MN_NOT ]                                       = &&op_not,
+        [ MN_NOT | MN_UNSIGNED ]                         = &&op_not,
+        [ MN_ADD ]                                       = &&op_add,
+        [ MN_SUB ]                                       = &&op_sub,
+        [ MN_MUL | MN_WORD ]                             = &&op_mul_word,
+        [ MN_MUL | MN_BYTE ]                             = &&op_mul_word,
+        [ MN_MUL ]                                       = &&op_mul_word,
+        [ MN_MUL | MN_WORD | MN_UNSIGNED ]               = &&op_mul_word_unsigned,
+        [ MN_MUL | MN_BYTE | MN_UNSIGNED ]               = &&op_mul_word_unsigned,
+        [ MN_MUL | MN_UNSIGNED ]                         = &&op_mul_word_unsigned,
+        [ MN_DIV | MN_WORD ]                             = &&op_div_word,
+        [ MN_DIV | MN_BYTE ]                             = &&op_div_word,
+        [ MN_DIV ]                                       = &&op_div_word,
+        [ MN_DIV | MN_WORD | MN_UNSIGNED ]               = &&op_div_word_unsigned,
+        [ MN_DIV | MN_BYTE | MN_UNSIGNED ]               = &&op_div_word_unsigned,
+        [ MN_DIV | MN_UNSIGNED ]                         = &&op_div_word_unsigned,
+        [ MN_MOD | MN_WORD ]                             = &&op_mod_word,
+        [ MN_MOD | MN_BYTE ]                             = &&op_mod_word,
+        [ MN_MOD ]                                       = &&op_mod_word,
+        [ MN_MOD | MN_WORD | MN_UNSIGNED ]               = &&op_mod_word_unsigned,
+        [ MN_MOD | MN_BYTE | MN_UNSIGNED ]               = &&op_mod_word_unsigned,
+        [ MN_MOD | MN_UNSIGNED ]                         = &&op_mod_word_unsigned,
+        [ MN_ROR ]                                       = &&op_ror,
+        [ MN_ROR | MN_UNSIGNED ]                         = &&op_ror_unsigned,
+        [ MN_WORD | MN_ROR ]                             = &&op_ror_word,
+        [ MN_WORD | MN_ROR | MN_UNSIGNED ]               = &&op_ror_word_unsigned,
+        [ MN_BYTE | MN_ROR ]                             = &&op_ror_byte,
+        [ MN_BYTE | MN_ROR | MN_UNSIGNED ]               = &&op_ror_byte_unsigned,
+        [ MN_ROL ]                                       = &&op_rol,
+        [ MN_ROL | MN_UNSIGNED ]                         = &&op_rol_unsigned,
+        [ MN_WORD | MN_ROL ]                             = &&op_rol_word,
+        [ MN_WORD | MN_ROL | MN_UNSIGNED ]               = &&op_rol_word_unsigned,
+        [ MN_BYTE | MN_ROL ]                             = &&op_rol_byte,
+        [ MN_BYTE | MN_ROL | MN_UNSIGNED ]               = &&op_rol_byte_unsigned,
+        [ MN_BAND ]                                      = &&op_band,
+        [ MN_BAND | MN_UNSIGNED ]                        = &&op_band,
+        [ MN_BOR ]                                       = &&op_bor,
+        [ MN_BOR | MN_UNSIGNED ]                         = &&op_bor,
+        [ MN_BXOR ]                                      = &&op_bxor,
+        [ MN_BXOR | MN_UNSIGNED ]                        = &&op_bxor,
+        [ MN_BNOT ]                                      = &&op_bnot,
+        [ MN_BNOT | MN_UNSIGNED ]                        = &&op_bnot,
+        [ MN_BYTE | MN_BNOT ]                            = &&op_bnot_byte,
+        [ MN_BYTE | MN_BNOT | MN_UNSIGNED ]              = &&op_bnot_byte_unsigned,
+        [ MN_WORD | MN_BNOT ]                            = &&op_bnot_word,
+        [ MN_WORD | MN_BNOT | MN_UNSIGNED ]              = &&op_bnot_word_unsigned,
+        [ MN_AND ]                                       = &&op_and,
+        [ MN_OR ]                                        = &&op_or,
+        [ MN_XOR ]                                       = &&op_xor,
+        [ MN_EQ ]                                        = &&op_eq,
+        [ MN_NE ]                                        = &&op_ne,
+        [ MN_GTE ]                                       = &&op_gte,
+        [ MN_GTE | MN_UNSIGNED ]                         = &&op_gte_unsigned,
+        [ MN_LTE ]                                       = &&op_lte,
+        [ MN_LTE | MN_UNSIGNED ]                         = &&op_lte_unsigned,
+        [ MN_LT ]                                        = &&op_lt,
+        [ MN_LT | MN_UNSIGNED ]                          = &&op_lt_unsigned,
+        [ MN_GT ]                                        = &&op_gt,
+        [ MN_GT | MN_UNSIGNED ]                          = &&op_gt_unsigned,
+        [ MN_EQ | MN_FLOAT ]                             = &&op_eq_float,
+        [ MN_NE | MN_FLOAT ]                             = &&op_ne_float,
+        [ MN_GTE | MN_FLOAT ]                            = &&op_gte_float,
+        [ MN_LTE | MN_FLOAT ]                            = &&op_lte_float,
+        [ MN_LT | MN_FLOAT ]                             = &&op_lt_float,
+        [ MN_GT | MN_FLOAT ]                             = &&op_gt_float,
+        [ MN_EQ | MN_STRING ]                            = &&op_eq_string,
+        [ MN_NE | MN_STRING ]                            = &&op_ne_string,
+        [ MN_GTE | MN_STRING ]                           = &&op_gte_string,
+        [ MN_LTE | MN_STRING ]                           = &&op_lte_string,
+        [ MN_LT | MN_STRING ]                            = &&op_lt_string,
+        [ MN_GT | MN_STRING ]                            = &&op_gt_string,
+        [ MN_VARADD | MN_STRING ]                        = &&op_varadd_string,
+        [ MN_LETNP | MN_STRING ]                         = &&op_letnp_string,
+        [ MN_LET | MN_STRING ]                           = &&op_let_string,
+        [ MN_ADD | MN_STRING ]                           = &&op_add_string,
+        [ MN_INT2STR ]                                   = &&op_int2str,
+        [ MN_INT2STR | MN_UNSIGNED ]                     = &&op_int2str_unsigned,
+        [ MN_INT2STR | MN_WORD ]                         = &&op_int2str_word,
+        [ MN_INT2STR | MN_UNSIGNED | MN_WORD ]           = &&op_int2str_word_unsigned,
+        [ MN_INT2STR | MN_BYTE ]                         = &&op_int2str_byte,
+        [ MN_INT2STR | MN_UNSIGNED | MN_BYTE ]           = &&op_int2str_byte_unsigned,
+        [ MN_FLOAT2STR ]                                 = &&op_float2str,
+        [ MN_CHR2STR ]                                   = &&op_chr2str,
+        [ MN_STRI2CHR ]                                  = &&op_stri2chr,
+        [ MN_STR2CHR ]                                   = &&op_str2chr,
+        [ MN_POINTER2STR ]                               = &&op_pointer2str,
+        [ MN_STR2FLOAT ]                                 = &&op_str2float,
+        [ MN_STR2INT ]                                   = &&op_str2int,
+        [ MN_A2STR ]                                     = &&op_a2str,
+        [ MN_STR2A ]                                     = &&op_str2a,
+        [ MN_STRACAT ]                                   = &&op_stracat,
+        [ MN_LETNP ]                                     = &&op_letnp,
+        [ MN_LETNP | MN_UNSIGNED ]                       = &&op_letnp,
+        [ MN_LET ]                                       = &&op_let,
+        [ MN_LET | MN_UNSIGNED ]                         = &&op_let,
+        [ MN_INC ]                                       = &&op_inc,
+        [ MN_INC | MN_UNSIGNED ]                         = &&op_inc,
+        [ MN_DEC ]                                       = &&op_dec,
+        [ MN_DEC | MN_UNSIGNED ]                         = &&op_dec,
+        [ MN_POSTDEC ]                                   = &&op_postdec,
+        [ MN_POSTDEC | MN_UNSIGNED ]                     = &&op_postdec,
+        [ MN_POSTINC ]                                   = &&op_postinc,
+        [ MN_POSTINC | MN_UNSIGNED ]                     = &&op_postinc,
+        [ MN_VARADD ]                                    = &&op_varadd,
+        [ MN_VARADD | MN_UNSIGNED ]                      = &&op_varadd,
+        [ MN_VARSUB ]                                    = &&op_varsub,
+        [ MN_VARSUB | MN_UNSIGNED ]                      = &&op_varsub,
+        [ MN_VARMUL ]                                    = &&op_varmul,
+        [ MN_VARMUL | MN_UNSIGNED ]                      = &&op_varmul,
+        [ MN_VARDIV ]                                    = &&op_vardiv,
+        [ MN_VARDIV | MN_UNSIGNED ]                      = &&op_vardiv,
+        [ MN_VARMOD ]                                    = &&op_varmod,
+        [ MN_VARMOD | MN_UNSIGNED ]                      = &&op_varmod,
+        [ MN_VAROR ]                                     = &&op_varor,
+        [ MN_VAROR | MN_UNSIGNED ]                       = &&op_varor,
+        [ MN_VARXOR ]                                    = &&op_varxor,
+        [ MN_VARXOR | MN_UNSIGNED ]                      = &&op_varxor,
+        [ MN_VARAND ]                                    = &&op_varand,
+        [ MN_VARAND | MN_UNSIGNED ]                      = &&op_varand,
+        [ MN_VARROR ]                                    = &&op_varror,
+        [ MN_VARROR | MN_UNSIGNED ]                      = &&op_varror_unsigned,
+        [ MN_VARROL ]                                    = &&op_varrol,
+        [ MN_VARROL | MN_UNSIGNED ]                      = &&op_varrol_unsigned,
+        [ MN_WORD | MN_LETNP ]                           = &&op_letnp_word,
+        [ MN_WORD | MN_LETNP | MN_UNSIGNED ]             = &&op_letnp_word,
+        [ MN_WORD | MN_LET ]                             = &&op_let_word,
+        [ MN_WORD | MN_LET | MN_UNSIGNED ]               = &&op_let_word,
+        [ MN_WORD | MN_INC ]                             = &&op_inc_word,
+        [ MN_WORD | MN_INC | MN_UNSIGNED ]               = &&op_inc_word,
+        [ MN_WORD | MN_DEC ]                             = &&op_dec_word,
+        [ MN_WORD | MN_DEC | MN_UNSIGNED ]               = &&op_dec_word,
+        [ MN_WORD | MN_POSTDEC ]                         = &&op_postdec_word,
+        [ MN_WORD | MN_POSTDEC | MN_UNSIGNED ]           = &&op_postdec_word,
+        [ MN_WORD | MN_POSTINC ]                         = &&op_postinc_word,
+        [ MN_WORD | MN_POSTINC | MN_UNSIGNED ]           = &&op_postinc_word,
+        [ MN_WORD | MN_VARADD ]                          = &&op_varadd_word,
+        [ MN_WORD | MN_VARADD | MN_UNSIGNED ]            = &&op_varadd_word,
+        [ MN_WORD | MN_VARSUB ]                          = &&op_varsub_word,
+        [ MN_WORD | MN_VARSUB | MN_UNSIGNED ]            = &&op_varsub_word,
+        [ MN_WORD | MN_VARMUL ]                          = &&op_varmul_word,
+        [ MN_WORD | MN_VARMUL | MN_UNSIGNED ]            = &&op_varmul_word,
+        [ MN_WORD | MN_VARDIV ]                          = &&op_vardiv_word,
+        [ MN_WORD | MN_VARDIV | MN_UNSIGNED ]            = &&op_vardiv_word,
+        [ MN_WORD | MN_VARMOD ]                          = &&op_varmod_word,
+        [ MN_WORD | MN_VARMOD | MN_UNSIGNED ]            = &&op_varmod_word,
+        [ MN_WORD | MN_VAROR ]                           = &&op_varor_word,
+        [ MN_WORD | MN_VAROR | MN_UNSIGNED ]             = &&op_varor_word,
+        [ MN_WORD | MN_VARXOR ]                          = &&op_varxor_word,
+        [ MN_WORD | MN_VARXOR | MN_UNSIGNED ]            = &&op_varxor_word,
+        [ MN_WORD | MN_VARAND ]                          = &&op_varand_word,
+        [ MN_WORD | MN_VARAND | MN_UNSIGNED ]            = &&op_varand_word,
+        [ MN_WORD | MN_VARROR ]                          = &&op_varror_word,
+        [ MN_WORD | MN_VARROR | MN_UNSIGNED ]            = &&op_varror_word_unsigned,
+        [ MN_WORD | MN_VARROL ]                          = &&op_varrol_word,
+        [ MN_WORD | MN_VARROL | MN_UNSIGNED ]            = &&op_varrol_word_unsigned,
+        [ MN_BYTE | MN_LETNP ]                           = &&op_letnp_byte,
+        [ MN_BYTE | MN_LETNP | MN_UNSIGNED ]             = &&op_letnp_byte,
+        [ MN_BYTE | MN_LET ]                             = &&op_let_byte,
+        [ MN_BYTE | MN_LET | MN_UNSIGNED ]               = &&op_let_byte,
+        [ MN_BYTE | MN_INC ]                             = &&op_inc_byte,
+        [ MN_BYTE | MN_INC | MN_UNSIGNED ]               = &&op_inc_byte,
+        [ MN_BYTE | MN_DEC ]                             = &&op_dec_byte,
+        [ MN_BYTE | MN_DEC | MN_UNSIGNED ]               = &&op_dec_byte,
+        [ MN_BYTE | MN_POSTDEC ]                         = &&op_postdec_byte,
+        [ MN_BYTE | MN_POSTDEC | MN_UNSIGNED ]           = &&op_postdec_byte,
+        [ MN_BYTE | MN_POSTINC ]                         = &&op_postinc_byte,
+        [ MN_BYTE | MN_POSTINC | MN_UNSIGNED ]           = &&op_postinc_byte,
+        [ MN_BYTE | MN_VARADD ]                          = &&op_varadd_byte,
+        [ MN_BYTE | MN_VARADD | MN_UNSIGNED ]            = &&op_varadd_byte,
+        [ MN_BYTE | MN_VARSUB ]                          = &&op_varsub_byte,
+        [ MN_BYTE | MN_VARSUB | MN_UNSIGNED ]            = &&op_varsub_byte,
+        [ MN_BYTE | MN_VARMUL ]                          = &&op_varmul_byte,
+        [ MN_BYTE | MN_VARMUL | MN_UNSIGNED ]            = &&op_varmul_byte,
+        [ MN_BYTE | MN_VARDIV ]                          = &&op_vardiv_byte,
+        [ MN_BYTE | MN_VARDIV | MN_UNSIGNED ]            = &&op_vardiv_byte,
+        [ MN_BYTE | MN_VARMOD ]                          = &&op_varmod_byte,
+        [ MN_BYTE | MN_VARMOD | MN_UNSIGNED ]            = &&op_varmod_byte,
+        [ MN_BYTE | MN_VAROR ]                           = &&op_varor_byte,
+        [ MN_BYTE | MN_VAROR | MN_UNSIGNED ]             = &&op_varor_byte,
+        [ MN_BYTE | MN_VARXOR ]                          = &&op_varxor_byte,
+        [ MN_BYTE | MN_VARXOR | MN_UNSIGNED ]            = &&op_varxor_byte,
+        [ MN_BYTE | MN_VARAND ]                          = &&op_varand_byte,
+        [ MN_BYTE | MN_VARAND | MN_UNSIGNED ]            = &&op_varand_byte,
+        [ MN_BYTE | MN_VARROR ]                          = &&op_varror_byte,
+        [ MN_BYTE | MN_VARROR | MN_UNSIGNED ]            = &&op_varror_byte_unsigned,
+        [ MN_BYTE | MN_VARROL ]                          = &&op_varrol_byte,
+        [ MN_BYTE | MN_VARROL | MN_UNSIGNED ]            = &&op_varrol_byte_unsigned,
+        [ MN_FLOAT | MN_LETNP ]                          = &&op_letnp_float,
+        [ MN_FLOAT | MN_LET ]                            = &&op_let_float,
+        [ MN_FLOAT | MN_INC ]                            = &&op_inc_float,
+        [ MN_FLOAT | MN_DEC ]                            = &&op_dec_float,
+        [ MN_FLOAT | MN_POSTDEC ]                        = &&op_postdec_float,
+        [ MN_FLOAT | MN_POSTINC ]                        = &&op_postinc_float,
+        [ MN_FLOAT | MN_VARADD ]                         = &&op_varadd_float,
+        [ MN_FLOAT | MN_VARSUB ]                         = &&op_varsub_float,
+        [ MN_FLOAT | MN_VARMUL ]                         = &&op_varmul_float,
+        [ MN_FLOAT | MN_VARDIV ]                         = &&op_vardiv_float,
+        [ MN_JUMP ]                                      = &&op_jump,
+        [ MN_JTRUE ]                                     = &&op_jtrue,
+        [ MN_JFALSE ]                                    = &&op_jfalse,
+        [ MN_JTTRUE ]                                    = &&op_jttrue,
+        [ MN_JTFALSE ]                                   = &&op_jtfalse,
+        [ MN_NCALL ]                                     = &&op_ncall,
+        [ MN_SWITCH ]                                    = &&op_switch,
+        [ MN_SWITCH | MN_STRING ]                        = &&op_switch_string,
+        [ MN_CASE ]                                      = &&op_case,
+        [ MN_CASE | MN_STRING ]                          = &&op_case_string,
+        [ MN_CASE_R ]                                    = &&op_case_r,
+        [ MN_CASE_R | MN_STRING ]                        = &&op_case_r_string,
+        [ MN_JNOCASE ]                                   = &&op_jnocase,
+        [ MN_TYPE ]                                      = &&op_type,
+        [ MN_FRAME ]                                     = &&op_frame,
+        [ MN_END ]                                       = &&op_end,
+        [ MN_RETURN ]                                    = &&op_return,
+        [ MN_EXITHNDLR ]                                 = &&op_exithndlr,
+        [ MN_ERRHNDLR ]                                  = &&op_errhndlr,
+        [ MN_DEBUG ]                                     = &&op_debug,
+        [ MN_SENTENCE ]                                  = &&op_sentence,
+        [ MN_HANDLERS ]                                  = &&op_invalid,
+
+        [ FUSED_PRIVATE_PUSH_LETNP ]                     = &&op_private_push_letnp,
+        [ FUSED_LOCAL_PUSH_LETNP ]                       = &&op_local_push_letnp,
+        [ FUSED_GLOBAL_PUSH_LETNP ]                      = &&op_global_push_letnp,
+        [ FUSED_PUSH_ADD ]                               = &&op_push_add,
+        [ FUSED_PUSH_SUB ]                               = &&op_push_sub,
+        [ FUSED_GET_PRIV_PUSH_EQ_JFALSE ]                = &&op_get_priv_push_eq_jfalse,
+        [ FUSED_GET_PRIV_PUSH_NE_JFALSE ]                = &&op_get_priv_push_ne_jfalse,
+        [ FUSED_GET_PRIV_PUSH_LT_JFALSE ]                = &&op_get_priv_push_lt_jfalse,
+        [ FUSED_GET_PRIV_PUSH_GT_JFALSE ]                = &&op_get_priv_push_gt_jfalse,
+        [ FUSED_GET_PRIV_PUSH_LTE_JFALSE ]               = &&op_get_priv_push_lte_jfalse,
+        [ FUSED_GET_PRIV_PUSH_GTE_JFALSE ]               = &&op_get_priv_push_gte_jfalse,
+        [ FUSED_GET_LOCAL_PUSH_EQ_JFALSE ]               = &&op_get_local_push_eq_jfalse,
+        [ FUSED_GET_LOCAL_PUSH_NE_JFALSE ]               = &&op_get_local_push_ne_jfalse,
+        [ FUSED_GET_LOCAL_PUSH_LT_JFALSE ]               = &&op_get_local_push_lt_jfalse,
+        [ FUSED_GET_LOCAL_PUSH_GT_JFALSE ]               = &&op_get_local_push_gt_jfalse,
+        [ FUSED_GET_LOCAL_PUSH_LTE_JFALSE ]              = &&op_get_local_push_lte_jfalse,
+        [ FUSED_GET_LOCAL_PUSH_GTE_JFALSE ]              = &&op_get_local_push_gte_jfalse,
+        [ FUSED_PUSH_EQ_JFALSE ]                         = &&op_push_eq_jfalse,
+        [ FUSED_PUSH_NE_JFALSE ]                         = &&op_push_ne_jfalse,
+        [ FUSED_PUSH_LT_JFALSE ]                         = &&op_push_lt_jfalse,
+        [ FUSED_PUSH_GT_JFALSE ]                         = &&op_push_gt_jfalse,
+        [ FUSED_PUSH_LTE_JFALSE ]                        = &&op_push_lte_jfalse,
+        [ FUSED_PUSH_GTE_JFALSE ]                        = &&op_push_gte_jfalse
+    };
+
+    /* Called without instance by procdef_predecode() to get the handler addresses */
+    if ( !r ) {
+        handlers = handler_table;
+        return 0;
+    }
+
+    void ** threaded = r->proc->threaded ;
+#else
     if ( !r ) return 0;
+#endif
 
     register int * ptr = r->codeptr;
 
@@ -183,6 +804,8 @@ int instance_go( INSTANCE * r ) {
 
     int debugger_step_pending = 0; // local to instance
 
+    PROFILER_ENTER_PROC( r->proc );
+
     /* ------------------------------------------------------------------------------- */
     /* Restore if exit by debug                                                        */
 
@@ -210,6 +833,10 @@ int instance_go( INSTANCE * r ) {
 main_loop_instance_go:
     trace_sentence = -1;
 
+#ifdef OPCODE_NGRAMS
+    ngram_next = NULL;
+#endif
+
     while ( !must_exit ) {
 
         /* If I was killed or I'm waiting status, then exit */
@@ -244,30 +871,45 @@ main_loop_instance_go:
             fflush(stdout);
         }
 
+#ifdef OPCODE_NGRAMS
+        ngram_count( ptr );
+#endif
+
+        PROFILER_OPCODE( *ptr );
+
+#ifdef USE_COMPUTED_GOTO
+        /* Traces show every mnemonic, superinstructions would hide some */
+        if ( threaded && debug <= 0 ) goto *threaded[ ptr - r->code ];
+#endif
+
         switch ( *ptr )
         {
             /* No operation */
             case MN_NOP:
+            HANDLER( nop )
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             /* Stack manipulation */
 
             case MN_DUP:
+            HANDLER( dup )
                 *r->stack_ptr = r->stack_ptr[-1];
                 r->stack_ptr++;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_PUSH:
+            HANDLER( push )
                 *r->stack_ptr++ = ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_POP:
+            HANDLER( pop )
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_INDEX:
             case MN_INDEX | MN_UNSIGNED:
@@ -277,26 +919,30 @@ main_loop_instance_go:
             case MN_INDEX | MN_BYTE:
             case MN_INDEX | MN_BYTE | MN_UNSIGNED:
             case MN_INDEX | MN_FLOAT: /* Add float, I don't know why it was missing (SplinterGU) */
+            HANDLER( index )
                 r->stack_ptr[-1] += ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_ARRAY:
+            HANDLER( array )
                 r->stack_ptr[-2] += ( ptr[1] * r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             /* Process calls */
 
             case MN_CLONE:
+            HANDLER( clone )
                 i = instance_duplicate( r );
                 i->codeptr = ptr + 2;
                 ptr = r->code + ptr[1];
-                continue;
+                JUMP_OPCODE;
 
             case MN_CALL:
             case MN_PROC:
+            HANDLER( call )
             {
                 PROCDEF * proc = procdef_get( ptr[1] );
 
@@ -364,6 +1010,8 @@ main_loop_instance_go:
                     if ( ptr[-2] == MN_CALL )   r->stack[0] |= STACK_RETURN_VALUE;
                     else                        r->stack[0] &= ~STACK_RETURN_VALUE;
 
+                    PROFILER_LEAVE();
+
                     return 0;
                 }
 
@@ -371,31 +1019,37 @@ main_loop_instance_go:
                 LOCDWORD( r, STATUS ) &= ~STATUS_WAITING_MASK;
                 if ( child_is_alive ) i->called_by = NULL;
 
-                break;
+                NEXT_OPCODE;
             }
 
             case MN_SYSCALL:
+            HANDLER( syscall )
                 p = sysproc_get( ptr[1] );
                 if ( !p ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Unknown system function\n", r->proc->name, LOCDWORD( r, PROCESS_ID ) );
                     exit( 0 );
                 }
                 r->stack_ptr -= p->params;
+                PROFILER_ENTER_SYSPROC( p );
                 *r->stack_ptr = ( *p->func )( r, r->stack_ptr );
+                PROFILER_LEAVE();
                 r->stack_ptr++;
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_SYSPROC:
+            HANDLER( sysproc )
                 p = sysproc_get( ptr[1] );
                 if ( !p ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Unknown system process\n", r->proc->name, LOCDWORD( r, PROCESS_ID ) );
                     exit( 0 );
                 }
                 r->stack_ptr -= p->params;
+                PROFILER_ENTER_SYSPROC( p );
                 ( *p->func )( r, r->stack_ptr );
+                PROFILER_LEAVE();
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             /* Access to variables address */
 
@@ -407,9 +1061,10 @@ main_loop_instance_go:
             case MN_PRIVATE | MN_BYTE | MN_UNSIGNED:
             case MN_PRIVATE | MN_STRING:
             case MN_PRIVATE | MN_FLOAT:
+            HANDLER( private )
                 *r->stack_ptr++ = ( uint32_t ) int_from_ptr(& PRIDWORD( r, ptr[1] ));
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_PUBLIC:
             case MN_PUBLIC | MN_UNSIGNED:
@@ -419,9 +1074,10 @@ main_loop_instance_go:
             case MN_PUBLIC | MN_BYTE | MN_UNSIGNED:
             case MN_PUBLIC | MN_STRING:
             case MN_PUBLIC | MN_FLOAT:
+            HANDLER( public )
                 *r->stack_ptr++ = ( uint32_t ) int_from_ptr(& PUBDWORD( r, ptr[1] ));
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_LOCAL:
             case MN_LOCAL | MN_UNSIGNED:
@@ -431,9 +1087,10 @@ main_loop_instance_go:
             case MN_LOCAL | MN_BYTE | MN_UNSIGNED:
             case MN_LOCAL | MN_STRING:
             case MN_LOCAL | MN_FLOAT:
+            HANDLER( local )
                 *r->stack_ptr++ = ( uint32_t ) int_from_ptr(& LOCDWORD( r, ptr[1] ));
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_GLOBAL:
             case MN_GLOBAL | MN_UNSIGNED:
@@ -443,9 +1100,10 @@ main_loop_instance_go:
             case MN_GLOBAL | MN_BYTE | MN_UNSIGNED:
             case MN_GLOBAL | MN_STRING:
             case MN_GLOBAL | MN_FLOAT:
+            HANDLER( global )
                 *r->stack_ptr++ = ( uint32_t ) int_from_ptr(& GLODWORD( ptr[1] ));
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_REMOTE:
             case MN_REMOTE | MN_UNSIGNED:
@@ -455,14 +1113,17 @@ main_loop_instance_go:
             case MN_REMOTE | MN_BYTE | MN_UNSIGNED:
             case MN_REMOTE | MN_STRING:
             case MN_REMOTE | MN_FLOAT:
+            HANDLER( remote )
                 i = instance_get( r->stack_ptr[-1] );
                 if ( !i ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Process %d not active\n", r->proc->name, LOCDWORD( r, PROCESS_ID ), r->stack_ptr[-1] );
                     exit( 0 );
                 }
+                /* It may be written, as in son.status = ... */
+                if ( SCHED_LOCAL( ptr[1] ) ) instance_touch( i );
                 r->stack_ptr[-1] = ( uint32_t ) int_from_ptr(& LOCDWORD( i, ptr[1] ));
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_REMOTE_PUBLIC:
             case MN_REMOTE_PUBLIC | MN_UNSIGNED:
@@ -472,6 +1133,7 @@ main_loop_instance_go:
             case MN_REMOTE_PUBLIC | MN_BYTE | MN_UNSIGNED:
             case MN_REMOTE_PUBLIC | MN_STRING:
             case MN_REMOTE_PUBLIC | MN_FLOAT:
+            HANDLER( remote_public )
                 i = instance_get( r->stack_ptr[-1] );
                 if ( !i ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Process %d not active\n", r->proc->name, LOCDWORD( r, PROCESS_ID ), r->stack_ptr[-1] );
@@ -479,53 +1141,60 @@ main_loop_instance_go:
                 }
                 r->stack_ptr[-1] = ( uint32_t ) int_from_ptr(& PUBDWORD( i, ptr[1] ));
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             /* Access to variables DWORD type */
 
             case MN_GET_PRIV:
             case MN_GET_PRIV | MN_FLOAT:
             case MN_GET_PRIV | MN_UNSIGNED:
+            HANDLER( get_priv )
                 *r->stack_ptr++ = PRIDWORD( r, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_GET_PUBLIC:
             case MN_GET_PUBLIC | MN_FLOAT:
             case MN_GET_PUBLIC | MN_UNSIGNED:
+            HANDLER( get_public )
                 *r->stack_ptr++ = PUBDWORD( r, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_GET_LOCAL:
             case MN_GET_LOCAL | MN_FLOAT:
             case MN_GET_LOCAL | MN_UNSIGNED:
+            HANDLER( get_local )
                 *r->stack_ptr++ = LOCDWORD( r, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_GET_GLOBAL:
             case MN_GET_GLOBAL | MN_FLOAT:
             case MN_GET_GLOBAL | MN_UNSIGNED:
+            HANDLER( get_global )
                 *r->stack_ptr++ = GLODWORD( ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_GET_REMOTE:
             case MN_GET_REMOTE | MN_FLOAT:
             case MN_GET_REMOTE | MN_UNSIGNED:
+            HANDLER( get_remote )
                 i = instance_get( r->stack_ptr[-1] );
                 if ( !i ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Process %d not active\n", r->proc->name, LOCDWORD( r, PROCESS_ID ), r->stack_ptr[-1] );
                     exit( 0 );
                 }
+                if ( SCHED_LOCAL( ptr[1] ) ) instance_sync_locals( i );
                 r->stack_ptr[-1] = LOCDWORD( i, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_GET_REMOTE_PUBLIC:
             case MN_GET_REMOTE_PUBLIC | MN_FLOAT:
             case MN_GET_REMOTE_PUBLIC | MN_UNSIGNED:
+            HANDLER( get_remote_public )
                 i = instance_get( r->stack_ptr[-1] );
                 if ( !i ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Process %d not active\n", r->proc->name, LOCDWORD( r, PROCESS_ID ), r->stack_ptr[-1] );
@@ -533,48 +1202,55 @@ main_loop_instance_go:
                 }
                 r->stack_ptr[-1] = PUBDWORD( i, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_PTR:
             case MN_PTR | MN_UNSIGNED:
             case MN_PTR | MN_FLOAT:
+            HANDLER( ptr )
                 r->stack_ptr[-1] = *( int32_t * )ptr_from_int(r->stack_ptr[-1]);
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             /* Access to variables STRING type */
 
             case MN_PUSH | MN_STRING:
+            HANDLER( push_string )
                 *r->stack_ptr++ = ptr[1];
                 string_use( r->stack_ptr[-1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_GET_PRIV | MN_STRING:
+            HANDLER( get_priv_string )
                 *r->stack_ptr++ = PRIDWORD( r, ptr[1] );
                 string_use( r->stack_ptr[-1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_GET_PUBLIC | MN_STRING:
+            HANDLER( get_public_string )
                 *r->stack_ptr++ = PUBDWORD( r, ptr[1] );
                 string_use( r->stack_ptr[-1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_GET_LOCAL | MN_STRING:
+            HANDLER( get_local_string )
                 *r->stack_ptr++ = LOCDWORD( r, ptr[1] );
                 string_use( r->stack_ptr[-1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_GET_GLOBAL | MN_STRING:
+            HANDLER( get_global_string )
                 *r->stack_ptr++ = GLODWORD( ptr[1] );
                 string_use( r->stack_ptr[-1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_GET_REMOTE | MN_STRING:
+            HANDLER( get_remote_string )
                 i = instance_get( r->stack_ptr[-1] );
                 if ( !i ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Process %d not active\n", r->proc->name, LOCDWORD( r, PROCESS_ID ), r->stack_ptr[-1] );
@@ -583,9 +1259,10 @@ main_loop_instance_go:
                 r->stack_ptr[-1] = LOCDWORD( i, ptr[1] );
                 string_use( r->stack_ptr[-1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_GET_REMOTE_PUBLIC | MN_STRING:
+            HANDLER( get_remote_public_string )
                 i = instance_get( r->stack_ptr[-1] );
                 if ( !i ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Process %d not active\n", r->proc->name, LOCDWORD( r, PROCESS_ID ), r->stack_ptr[-1] );
@@ -594,63 +1271,74 @@ main_loop_instance_go:
                 r->stack_ptr[-1] = PUBDWORD( i, ptr[1] );
                 string_use( r->stack_ptr[-1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_STRING | MN_PTR:
+            HANDLER( ptr_string )
                 r->stack_ptr[-1] = *( int32_t * )ptr_from_int(r->stack_ptr[-1]);
                 string_use( r->stack_ptr[-1] );
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_STRING | MN_POP:
+            HANDLER( pop_string )
                 string_discard( r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             /* Access to variables WORD type */
 
             case MN_WORD | MN_GET_PRIV:
+            HANDLER( get_priv_word )
                 *r->stack_ptr++ = PRIINT16( r, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_GET_PRIV | MN_UNSIGNED:
+            HANDLER( get_priv_word_unsigned )
                 *r->stack_ptr++ = PRIWORD( r, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_GET_PUBLIC:
+            HANDLER( get_public_word )
                 *r->stack_ptr++ = PUBINT16( r, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_GET_PUBLIC | MN_UNSIGNED:
+            HANDLER( get_public_word_unsigned )
                 *r->stack_ptr++ = PUBWORD( r, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_GET_LOCAL:
+            HANDLER( get_local_word )
                 *r->stack_ptr++ = LOCINT16( r, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_GET_LOCAL | MN_UNSIGNED:
+            HANDLER( get_local_word_unsigned )
                 *r->stack_ptr++ = LOCWORD( r, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_GET_GLOBAL:
+            HANDLER( get_global_word )
                 *r->stack_ptr++ = GLOINT16( ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_GET_GLOBAL | MN_UNSIGNED:
+            HANDLER( get_global_word_unsigned )
                 *r->stack_ptr++ = GLOWORD( ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_GET_REMOTE:
+            HANDLER( get_remote_word )
                 i = instance_get( r->stack_ptr[-1] );
                 if ( !i ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Process %d not active\n", r->proc->name, LOCDWORD( r, PROCESS_ID ), r->stack_ptr[-1] );
@@ -658,9 +1346,10 @@ main_loop_instance_go:
                 }
                 r->stack_ptr[-1] = LOCINT16( i, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_GET_REMOTE | MN_UNSIGNED:
+            HANDLER( get_remote_word_unsigned )
                 i = instance_get( r->stack_ptr[-1] );
                 if ( !i ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Process %d not active\n", r->proc->name, LOCDWORD( r, PROCESS_ID ), r->stack_ptr[-1] );
@@ -668,9 +1357,10 @@ main_loop_instance_go:
                 }
                 r->stack_ptr[-1] = LOCWORD( i, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_GET_REMOTE_PUBLIC:
+            HANDLER( get_remote_public_word )
                 i = instance_get( r->stack_ptr[-1] );
                 if ( !i ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Process %d not active\n", r->proc->name, LOCDWORD( r, PROCESS_ID ), r->stack_ptr[-1] );
@@ -678,9 +1368,10 @@ main_loop_instance_go:
                 }
                 r->stack_ptr[-1] = PUBINT16( i, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_GET_REMOTE_PUBLIC | MN_UNSIGNED:
+            HANDLER( get_remote_public_word_unsigned )
                 i = instance_get( r->stack_ptr[-1] );
                 if ( !i ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Process %d not active\n", r->proc->name, LOCDWORD( r, PROCESS_ID ), r->stack_ptr[-1] );
@@ -688,61 +1379,72 @@ main_loop_instance_go:
                 }
                 r->stack_ptr[-1] = PUBWORD( i, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_PTR:
+            HANDLER( ptr_word )
                 r->stack_ptr[-1] = *( int16_t * )ptr_from_int(r->stack_ptr[-1]);
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_PTR | MN_UNSIGNED:
+            HANDLER( ptr_word_unsigned )
                 r->stack_ptr[-1] = *( uint16_t * )ptr_from_int(r->stack_ptr[-1]);
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             /* Access to variables BYTE type */
 
             case MN_BYTE | MN_GET_PRIV:
+            HANDLER( get_priv_byte )
                 *r->stack_ptr++ = PRIINT8( r, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_GET_PRIV | MN_UNSIGNED:
+            HANDLER( get_priv_byte_unsigned )
                 *r->stack_ptr++ = PRIBYTE( r, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_GET_PUBLIC:
+            HANDLER( get_public_byte )
                 *r->stack_ptr++ = PUBINT8( r, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_GET_PUBLIC | MN_UNSIGNED:
+            HANDLER( get_public_byte_unsigned )
                 *r->stack_ptr++ = PUBBYTE( r, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_GET_LOCAL:
+            HANDLER( get_local_byte )
                 *r->stack_ptr++ = LOCINT8( r, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_GET_LOCAL | MN_UNSIGNED:
+            HANDLER( get_local_byte_unsigned )
                 *r->stack_ptr++ = LOCBYTE( r, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_GET_GLOBAL:
+            HANDLER( get_global_byte )
                 *r->stack_ptr++ = GLOINT8( ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_GET_GLOBAL | MN_UNSIGNED:
+            HANDLER( get_global_byte_unsigned )
                 *r->stack_ptr++ = GLOBYTE( ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_GET_REMOTE:
+            HANDLER( get_remote_byte )
                 i = instance_get( r->stack_ptr[-1] );
                 if ( !i ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Process %d not active\n", r->proc->name, LOCDWORD( r, PROCESS_ID ), r->stack_ptr[-1] );
@@ -750,9 +1452,10 @@ main_loop_instance_go:
                 }
                 r->stack_ptr[-1] = LOCINT8( i, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_GET_REMOTE | MN_UNSIGNED:
+            HANDLER( get_remote_byte_unsigned )
                 i = instance_get( r->stack_ptr[-1] );
                 if ( !i ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Process %d not active\n", r->proc->name, LOCDWORD( r, PROCESS_ID ), r->stack_ptr[-1] );
@@ -760,9 +1463,10 @@ main_loop_instance_go:
                 }
                 r->stack_ptr[-1] = LOCBYTE( i, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_GET_REMOTE_PUBLIC:
+            HANDLER( get_remote_public_byte )
                 i = instance_get( r->stack_ptr[-1] );
                 if ( !i ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Process %d not active\n", r->proc->name, LOCDWORD( r, PROCESS_ID ), r->stack_ptr[-1] );
@@ -770,9 +1474,10 @@ main_loop_instance_go:
                 }
                 r->stack_ptr[-1] = PUBINT8( i, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_GET_REMOTE_PUBLIC | MN_UNSIGNED:
+            HANDLER( get_remote_public_byte_unsigned )
                 i = instance_get( r->stack_ptr[-1] );
                 if ( !i ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Process %d not active\n", r->proc->name, LOCDWORD( r, PROCESS_ID ), r->stack_ptr[-1] );
@@ -780,132 +1485,153 @@ main_loop_instance_go:
                 }
                 r->stack_ptr[-1] = PUBBYTE( i, ptr[1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_PTR:
+            HANDLER( ptr_byte )
                 r->stack_ptr[-1] = *(( int8_t * )ptr_from_int(r->stack_ptr[-1]) );
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_PTR | MN_UNSIGNED:
+            HANDLER( ptr_byte_unsigned )
                 r->stack_ptr[-1] = *(( uint8_t * )ptr_from_int(r->stack_ptr[-1]) );
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             /* Floating point math */
 
             case MN_FLOAT | MN_NEG:
+            HANDLER( neg_float )
                 *( float * )&r->stack_ptr[-1] = -*(( float * ) & r->stack_ptr[-1] );
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_FLOAT | MN_NOT:
+            HANDLER( not_float )
                 *( float * )&r->stack_ptr[-1] = ( float ) !*(( float * ) & r->stack_ptr[-1] );
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_FLOAT | MN_ADD:
+            HANDLER( add_float )
                 *( float * )&r->stack_ptr[-2] += *(( float * ) & r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_FLOAT | MN_SUB:
+            HANDLER( sub_float )
                 *( float * )&r->stack_ptr[-2] -= *(( float * ) & r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_FLOAT | MN_MUL:
+            HANDLER( mul_float )
                 *( float * )&r->stack_ptr[-2] *= *(( float * ) & r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_FLOAT | MN_DIV:
+            HANDLER( div_float )
                 *( float * )&r->stack_ptr[-2] /= *(( float * ) & r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_FLOAT2INT:
+            HANDLER( float2int )
                 *( int32_t * )&( r->stack_ptr[-ptr[1] - 1] ) = ( int32_t ) * ( float * ) & ( r->stack_ptr[-ptr[1] - 1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_INT2FLOAT:
             case MN_INT2FLOAT | MN_UNSIGNED:
+            HANDLER( int2float )
                 *( float * )&( r->stack_ptr[-ptr[1] - 1] ) = ( float ) * ( int32_t * ) & ( r->stack_ptr[-ptr[1] - 1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_INT2FLOAT | MN_UNSIGNED | MN_WORD:
+            HANDLER( int2float_word_unsigned )
                 *( float * )&( r->stack_ptr[-ptr[1] - 1] ) = ( float ) * ( uint16_t * ) & ( r->stack_ptr[-ptr[1] - 1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_INT2FLOAT | MN_UNSIGNED | MN_BYTE:
+            HANDLER( int2float_byte_unsigned )
                 *( float * )&( r->stack_ptr[-ptr[1] - 1] ) = ( float ) * ( uint8_t * ) & ( r->stack_ptr[-ptr[1] - 1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_INT2WORD:
             case MN_INT2WORD | MN_UNSIGNED:
+            HANDLER( int2word )
                 *( uint32_t * )&( r->stack_ptr[-ptr[1] - 1] ) = ( int32_t )( uint16_t ) * ( int32_t * ) & ( r->stack_ptr[-ptr[1] - 1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_INT2BYTE:
             case MN_INT2BYTE | MN_UNSIGNED:
+            HANDLER( int2byte )
                 *( uint32_t * )&( r->stack_ptr[-ptr[1] - 1] ) = ( int32_t )( uint8_t ) * ( int32_t * ) & ( r->stack_ptr[-ptr[1] - 1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             /* Mathematical operations */
 
             case MN_NEG:
             case MN_NEG | MN_UNSIGNED:
+            HANDLER( neg )
                 r->stack_ptr[-1] = -r->stack_ptr[-1];
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_NOT:
             case MN_NOT | MN_UNSIGNED:
+            HANDLER( not )
                 r->stack_ptr[-1] = !( r->stack_ptr[-1] );
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_ADD:
+            HANDLER( add )
                 r->stack_ptr[-2] += r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_SUB:
+            HANDLER( sub )
                 r->stack_ptr[-2] -= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_MUL | MN_WORD:
             case MN_MUL | MN_BYTE:
             case MN_MUL:
+            HANDLER( mul_word )
                 r->stack_ptr[-2] *= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_MUL | MN_WORD | MN_UNSIGNED:
             case MN_MUL | MN_BYTE | MN_UNSIGNED:
             case MN_MUL | MN_UNSIGNED:
+            HANDLER( mul_word_unsigned )
                 r->stack_ptr[-2] = ( uint32_t )r->stack_ptr[-2] * ( uint32_t )r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_DIV | MN_WORD:
             case MN_DIV | MN_BYTE:
             case MN_DIV:
+            HANDLER( div_word )
                 if ( r->stack_ptr[-1] == 0 ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Division by zero\n", r->proc->name, LOCDWORD( r, PROCESS_ID ) );
                     exit( 0 );
@@ -913,11 +1639,12 @@ main_loop_instance_go:
                 r->stack_ptr[-2] /= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_DIV | MN_WORD | MN_UNSIGNED:
             case MN_DIV | MN_BYTE | MN_UNSIGNED:
             case MN_DIV | MN_UNSIGNED:
+            HANDLER( div_word_unsigned )
                 if ( r->stack_ptr[-1] == 0 ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Division by zero\n", r->proc->name, LOCDWORD( r, PROCESS_ID ) );
                     exit( 0 );
@@ -925,11 +1652,12 @@ main_loop_instance_go:
                 r->stack_ptr[-2] = ( uint32_t )r->stack_ptr[-2] / ( uint32_t )r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_MOD | MN_WORD:
             case MN_MOD | MN_BYTE:
             case MN_MOD:
+            HANDLER( mod_word )
                 if ( r->stack_ptr[-1] == 0 ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Division by zero\n", r->proc->name, LOCDWORD( r, PROCESS_ID ) );
                     exit( 0 );
@@ -937,11 +1665,12 @@ main_loop_instance_go:
                 r->stack_ptr[-2] %= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_MOD | MN_WORD | MN_UNSIGNED:
             case MN_MOD | MN_BYTE | MN_UNSIGNED:
             case MN_MOD | MN_UNSIGNED:
+            HANDLER( mod_word_unsigned )
                 if ( r->stack_ptr[-1] == 0 ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Division by zero\n", r->proc->name, LOCDWORD( r, PROCESS_ID ) );
                     exit( 0 );
@@ -949,310 +1678,356 @@ main_loop_instance_go:
                 r->stack_ptr[-2] = ( uint32_t )r->stack_ptr[-2] % ( uint32_t )r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             /* Bitwise operations */
 
             case MN_ROR:
+            HANDLER( ror )
                 ( r->stack_ptr[-2] ) = (( int32_t )r->stack_ptr[-2] ) >> r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_ROR | MN_UNSIGNED:
+            HANDLER( ror_unsigned )
                 r->stack_ptr[-2] = (( uint32_t ) r->stack_ptr[-2] ) >> r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_ROR:
+            HANDLER( ror_word )
                 r->stack_ptr[-2] = (( int16_t ) r->stack_ptr[-2] ) >> r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_ROR | MN_UNSIGNED:
+            HANDLER( ror_word_unsigned )
                 r->stack_ptr[-2] = (( uint16_t ) r->stack_ptr[-2] ) >> r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_ROR:
+            HANDLER( ror_byte )
                 r->stack_ptr[-2] = (( int8_t ) r->stack_ptr[-2] >> r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_ROR | MN_UNSIGNED:
+            HANDLER( ror_byte_unsigned )
                 r->stack_ptr[-2] = (( uint8_t ) r->stack_ptr[-2] ) >> r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_ROL:
+            HANDLER( rol )
                 ( r->stack_ptr[-2] ) = (( int32_t )r->stack_ptr[-2] ) << r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             /* All the next ROL operations, don't could be necessaries, but well... */
 
             case MN_ROL | MN_UNSIGNED:
+            HANDLER( rol_unsigned )
                 ( r->stack_ptr[-2] ) = ( uint32_t )( r->stack_ptr[-2] << r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_ROL:
+            HANDLER( rol_word )
                 ( r->stack_ptr[-2] ) = (( int16_t )r->stack_ptr[-2] ) << r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_ROL | MN_UNSIGNED:
+            HANDLER( rol_word_unsigned )
                 ( r->stack_ptr[-2] ) = ( uint16_t )( r->stack_ptr[-2] << r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_ROL:
+            HANDLER( rol_byte )
                 ( r->stack_ptr[-2] ) = (( int8_t )r->stack_ptr[-2] ) << r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_ROL | MN_UNSIGNED:
+            HANDLER( rol_byte_unsigned )
                 ( r->stack_ptr[-2] ) = ( uint8_t )( r->stack_ptr[-2] << r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BAND:
             case MN_BAND | MN_UNSIGNED:
+            HANDLER( band )
                 r->stack_ptr[-2] &= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BOR:
             case MN_BOR | MN_UNSIGNED:
+            HANDLER( bor )
                 r->stack_ptr[-2] |= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BXOR:
             case MN_BXOR | MN_UNSIGNED:
+            HANDLER( bxor )
                 r->stack_ptr[-2] ^= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BNOT:
             case MN_BNOT | MN_UNSIGNED:
+            HANDLER( bnot )
                 r->stack_ptr[-1] = ~( r->stack_ptr[-1] );
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_BNOT:
+            HANDLER( bnot_byte )
                 r->stack_ptr[-1] = ( int8_t ) ~( r->stack_ptr[-1] );
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_BNOT | MN_UNSIGNED:
+            HANDLER( bnot_byte_unsigned )
                 r->stack_ptr[-1] = ( uint8_t ) ~( r->stack_ptr[-1] );
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_BNOT:
+            HANDLER( bnot_word )
                 r->stack_ptr[-1] = ( int16_t ) ~( r->stack_ptr[-1] );
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_BNOT | MN_UNSIGNED:
+            HANDLER( bnot_word_unsigned )
                 r->stack_ptr[-1] = ( uint16_t ) ~( r->stack_ptr[-1] );
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             /* Logical operations */
 
             case MN_AND:
+            HANDLER( and )
                 r->stack_ptr[-2] = r->stack_ptr[-2] && r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_OR:
+            HANDLER( or )
                 r->stack_ptr[-2] = r->stack_ptr[-2] || r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_XOR:
+            HANDLER( xor )
                 r->stack_ptr[-2] = ( r->stack_ptr[-2] != 0 ) ^( r->stack_ptr[-1] != 0 );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             /* Comparisons */
 
             case MN_EQ:
+            HANDLER( eq )
                 r->stack_ptr[-2] = ( r->stack_ptr[-2] == r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_NE:
+            HANDLER( ne )
                 r->stack_ptr[-2] = ( r->stack_ptr[-2] != r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_GTE:
+            HANDLER( gte )
                 r->stack_ptr[-2] = ( r->stack_ptr[-2] >= r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_GTE | MN_UNSIGNED:
+            HANDLER( gte_unsigned )
                 r->stack_ptr[-2] = (( uint32_t )r->stack_ptr[-2] >= ( uint32_t )r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_LTE:
+            HANDLER( lte )
                 r->stack_ptr[-2] = ( r->stack_ptr[-2] <= r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_LTE | MN_UNSIGNED:
+            HANDLER( lte_unsigned )
                 r->stack_ptr[-2] = (( uint32_t )r->stack_ptr[-2] <= ( uint32_t )r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_LT:
+            HANDLER( lt )
                 r->stack_ptr[-2] = ( r->stack_ptr[-2] < r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_LT | MN_UNSIGNED:
+            HANDLER( lt_unsigned )
                 r->stack_ptr[-2] = (( uint32_t )r->stack_ptr[-2] < ( uint32_t )r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_GT:
+            HANDLER( gt )
                 r->stack_ptr[-2] = ( r->stack_ptr[-2] > r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_GT | MN_UNSIGNED:
+            HANDLER( gt_unsigned )
                 r->stack_ptr[-2] = (( uint32_t )r->stack_ptr[-2] > ( uint32_t )r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             /* Floating point comparisons */
 
             case MN_EQ | MN_FLOAT:
+            HANDLER( eq_float )
                 r->stack_ptr[-2] = ( *( float * ) & r->stack_ptr[-2] == *( float * ) & r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_NE | MN_FLOAT:
+            HANDLER( ne_float )
                 r->stack_ptr[-2] = ( *( float * ) & r->stack_ptr[-2] != *( float * ) & r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_GTE | MN_FLOAT:
+            HANDLER( gte_float )
                 r->stack_ptr[-2] = ( *( float * ) & r->stack_ptr[-2] >= *( float * ) & r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_LTE | MN_FLOAT:
+            HANDLER( lte_float )
                 r->stack_ptr[-2] = ( *( float * ) & r->stack_ptr[-2] <= *( float * ) & r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_LT | MN_FLOAT:
+            HANDLER( lt_float )
                 r->stack_ptr[-2] = ( *( float * ) & r->stack_ptr[-2] < *( float * ) & r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_GT | MN_FLOAT:
+            HANDLER( gt_float )
                 r->stack_ptr[-2] = ( *( float * ) & r->stack_ptr[-2] > *( float * ) & r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             /* String comparisons */
 
             case MN_EQ | MN_STRING :
+            HANDLER( eq_string )
                 n = string_comp( r->stack_ptr[-2], r->stack_ptr[-1] ) == 0;
                 string_discard( r->stack_ptr[-2] );
                 string_discard( r->stack_ptr[-1] );
                 r->stack_ptr[-2] = n;
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_NE | MN_STRING :
+            HANDLER( ne_string )
                 n = string_comp( r->stack_ptr[-2], r->stack_ptr[-1] ) != 0;
                 string_discard( r->stack_ptr[-2] );
                 string_discard( r->stack_ptr[-1] );
                 r->stack_ptr[-2] = n;
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_GTE | MN_STRING :
+            HANDLER( gte_string )
                 n = string_comp( r->stack_ptr[-2], r->stack_ptr[-1] ) >= 0;
                 string_discard( r->stack_ptr[-2] );
                 string_discard( r->stack_ptr[-1] );
                 r->stack_ptr[-2] = n;
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_LTE | MN_STRING :
+            HANDLER( lte_string )
                 n = string_comp( r->stack_ptr[-2], r->stack_ptr[-1] ) <= 0;
                 string_discard( r->stack_ptr[-2] );
                 string_discard( r->stack_ptr[-1] );
                 r->stack_ptr[-2] = n;
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_LT | MN_STRING :
+            HANDLER( lt_string )
                 n = string_comp( r->stack_ptr[-2], r->stack_ptr[-1] ) <  0;
                 string_discard( r->stack_ptr[-2] );
                 string_discard( r->stack_ptr[-1] );
                 r->stack_ptr[-2] = n;
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_GT | MN_STRING :
+            HANDLER( gt_string )
                 n = string_comp( r->stack_ptr[-2], r->stack_ptr[-1] ) >  0;
                 string_discard( r->stack_ptr[-2] );
                 string_discard( r->stack_ptr[-1] );
                 r->stack_ptr[-2] = n;
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             /* String operations */
 
             case MN_VARADD | MN_STRING:
+            HANDLER( varadd_string )
                 tmp = ptr_from_int( r->stack_ptr[-2] );
                 n = *( int32_t * )tmp;
                 *( int32_t * )tmp = string_add( n, r->stack_ptr[-1] );
@@ -1261,25 +2036,28 @@ main_loop_instance_go:
                 string_discard( r->stack_ptr[-1] );
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_LETNP | MN_STRING:
+            HANDLER( letnp_string )
                 tmp = ptr_from_int( r->stack_ptr[-2] );
                 string_discard( *( int32_t * )tmp );
                 ( *( int32_t * )tmp ) = r->stack_ptr[-1];
                 r->stack_ptr -= 2;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_LET | MN_STRING:
+            HANDLER( let_string )
                 tmp = ptr_from_int( r->stack_ptr[-2] );
                 string_discard( *( int32_t * )tmp );
                 ( *( int32_t * )tmp ) = r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_ADD | MN_STRING:
+            HANDLER( add_string )
                 n = string_add( r->stack_ptr[-2], r->stack_ptr[-1] );
                 string_use( n );
                 string_discard( r->stack_ptr[-2] );
@@ -1287,51 +2065,59 @@ main_loop_instance_go:
                 r->stack_ptr--;
                 r->stack_ptr[-1] = n;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_INT2STR:
+            HANDLER( int2str )
                 r->stack_ptr[-ptr[1] - 1] = string_itoa( r->stack_ptr[-ptr[1] - 1] );
                 string_use( r->stack_ptr[-ptr[1] - 1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_INT2STR | MN_UNSIGNED:
+            HANDLER( int2str_unsigned )
                 r->stack_ptr[-ptr[1] - 1] = string_uitoa( r->stack_ptr[-ptr[1] - 1] );
                 string_use( r->stack_ptr[-ptr[1] - 1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_INT2STR | MN_WORD:
+            HANDLER( int2str_word )
                 r->stack_ptr[-ptr[1] - 1] = string_itoa( r->stack_ptr[-ptr[1] - 1] );
                 string_use( r->stack_ptr[-ptr[1] - 1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_INT2STR | MN_UNSIGNED | MN_WORD:
+            HANDLER( int2str_word_unsigned )
                 r->stack_ptr[-ptr[1] - 1] = string_uitoa( r->stack_ptr[-ptr[1] - 1] );
                 string_use( r->stack_ptr[-ptr[1] - 1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_INT2STR | MN_BYTE:
+            HANDLER( int2str_byte )
                 r->stack_ptr[-ptr[1] - 1] = string_itoa( r->stack_ptr[-ptr[1] - 1] );
                 string_use( r->stack_ptr[-ptr[1] - 1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_INT2STR | MN_UNSIGNED | MN_BYTE:
+            HANDLER( int2str_byte_unsigned )
                 r->stack_ptr[-ptr[1] - 1] = string_uitoa( r->stack_ptr[-ptr[1] - 1] );
                 string_use( r->stack_ptr[-ptr[1] - 1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_FLOAT2STR:
+            HANDLER( float2str )
                 r->stack_ptr[-ptr[1] - 1] = string_ftoa( *( float * ) & r->stack_ptr[-ptr[1] - 1] );
                 string_use( r->stack_ptr[-ptr[1] - 1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_CHR2STR:
+            HANDLER( chr2str )
             {
                 char buffer[2];
                 buffer[0] = ( uint8_t )r->stack_ptr[-ptr[1] - 1];
@@ -1339,58 +2125,65 @@ main_loop_instance_go:
                 r->stack_ptr[-ptr[1] - 1] = string_new( buffer );
                 string_use( r->stack_ptr[-ptr[1] - 1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
             }
 
             case MN_STRI2CHR:
+            HANDLER( stri2chr )
                 n = string_char( r->stack_ptr[-2], r->stack_ptr[-1] );
                 string_discard( r->stack_ptr[-2] );
                 r->stack_ptr--;
                 r->stack_ptr[-1] = n;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_STR2CHR:
+            HANDLER( str2chr )
                 n = r->stack_ptr[-ptr[1] - 1];
                 r->stack_ptr[-1] = *string_get( n );
                 string_discard( n );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_POINTER2STR:
+            HANDLER( pointer2str )
                 // This just seems to convert a pointer to a string, using the offset seems fine
                 r->stack_ptr[-ptr[1] - 1] = string_ptoa( ( void * ) (size_t)r->stack_ptr[-ptr[1] - 1] );
                 string_use( r->stack_ptr[-ptr[1] - 1] );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_STR2FLOAT:
+            HANDLER( str2float )
                 n = r->stack_ptr[-ptr[1] - 1];
                 str = ( char * )string_get( n );
                 *( float * )( &r->stack_ptr[-ptr[1] - 1] ) = str ? ( float )atof( str ) : 0.0f;
                 string_discard( n );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_STR2INT:
+            HANDLER( str2int )
                 n = r->stack_ptr[-ptr[1] - 1];
                 str = ( char * )string_get( n );
                 r->stack_ptr[-ptr[1] - 1] = str ? atoi( str ) : 0;
                 string_discard( n );
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             /* Fixed-length strings operations*/
 
             case MN_A2STR:
+            HANDLER( a2str )
                 str = ( char * )ptr_from_int( r->stack_ptr[-ptr[1] - 1] );
                 n = string_new( str );
                 string_use( n );
                 r->stack_ptr[-ptr[1] - 1] = n;
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_STR2A:
+            HANDLER( str2a )
                 n = r->stack_ptr[-1];
                 tmp = ptr_from_int(r->stack_ptr[-2]);
                 strncpy( ( char * )tmp, string_get( n ), ptr[1] );
@@ -1398,9 +2191,10 @@ main_loop_instance_go:
                 r->stack_ptr[-2] = r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_STRACAT:
+            HANDLER( stracat )
                 n = r->stack_ptr[-1];
                 tmp = ptr_from_int( r->stack_ptr[-2]);
                 strncat( ( char * )tmp, string_get( n ), (ptr[1]-1) - strlen( ( char * )tmp ) );
@@ -1408,75 +2202,85 @@ main_loop_instance_go:
                 r->stack_ptr[-2] = r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             /* Direct operations with variables DWORD type */
 
             case MN_LETNP:
             case MN_LETNP | MN_UNSIGNED:
+            HANDLER( letnp )
                 ( *( int32_t * )ptr_from_int( r->stack_ptr[-2] ) ) = r->stack_ptr[-1];
                 r->stack_ptr -= 2;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_LET:
             case MN_LET | MN_UNSIGNED:
+            HANDLER( let )
                 ( *( int32_t * )ptr_from_int( r->stack_ptr[-2] ) ) = r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_INC:
             case MN_INC | MN_UNSIGNED:
+            HANDLER( inc )
                 ( *( int32_t * )ptr_from_int( r->stack_ptr[-1] ) ) += ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_DEC:
             case MN_DEC | MN_UNSIGNED:
+            HANDLER( dec )
                 ( *( int32_t * )ptr_from_int( r->stack_ptr[-1] ) ) -= ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_POSTDEC:
             case MN_POSTDEC | MN_UNSIGNED:
+            HANDLER( postdec )
                 tmp = ptr_from_int( r->stack_ptr[-1] );
                 ( *( int32_t * )tmp ) -= ptr[1];
                 r->stack_ptr[-1] = *( int32_t * )tmp + ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_POSTINC:
             case MN_POSTINC | MN_UNSIGNED:
+            HANDLER( postinc )
                 tmp = ptr_from_int( r->stack_ptr[-1] );
                 *(( int32_t * )tmp ) += ptr[1];
                 r->stack_ptr[-1] = *( int32_t * )tmp - ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_VARADD:
             case MN_VARADD | MN_UNSIGNED:
+            HANDLER( varadd )
                 *( int32_t * )ptr_from_int( r->stack_ptr[-2] ) += r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_VARSUB:
             case MN_VARSUB | MN_UNSIGNED:
+            HANDLER( varsub )
                 *( int32_t * )ptr_from_int( r->stack_ptr[-2] ) -= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_VARMUL:
             case MN_VARMUL | MN_UNSIGNED:
+            HANDLER( varmul )
                 *( int32_t * )ptr_from_int( r->stack_ptr[-2] ) *= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_VARDIV:
             case MN_VARDIV | MN_UNSIGNED:
+            HANDLER( vardiv )
                 if ( r->stack_ptr[-1] == 0 ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Division by zero\n", r->proc->name, LOCDWORD( r, PROCESS_ID ) );
                     exit( 0 );
@@ -1484,10 +2288,11 @@ main_loop_instance_go:
                 *( int32_t * )ptr_from_int( r->stack_ptr[-2] ) /= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_VARMOD:
             case MN_VARMOD | MN_UNSIGNED:
+            HANDLER( varmod )
                 if ( r->stack_ptr[-1] == 0 ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Division by zero\n", r->proc->name, LOCDWORD( r, PROCESS_ID ) );
                     exit( 0 );
@@ -1495,120 +2300,137 @@ main_loop_instance_go:
                 *( int32_t * )ptr_from_int( r->stack_ptr[-2] ) %= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_VAROR:
             case MN_VAROR | MN_UNSIGNED:
+            HANDLER( varor )
                 *( int32_t * )ptr_from_int( r->stack_ptr[-2] ) |= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_VARXOR:
             case MN_VARXOR | MN_UNSIGNED:
+            HANDLER( varxor )
                 *( int32_t * )ptr_from_int( r->stack_ptr[-2] ) ^= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_VARAND:
             case MN_VARAND | MN_UNSIGNED:
+            HANDLER( varand )
                 *( int32_t * )ptr_from_int( r->stack_ptr[-2] ) &= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_VARROR:
+            HANDLER( varror )
                 *( int32_t * )ptr_from_int( r->stack_ptr[-2] ) >>= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_VARROR | MN_UNSIGNED:
+            HANDLER( varror_unsigned )
                 *( uint32_t * )ptr_from_int( r->stack_ptr[-2] ) >>= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_VARROL:
+            HANDLER( varrol )
                 *( int32_t * )ptr_from_int( r->stack_ptr[-2] ) <<= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_VARROL | MN_UNSIGNED:
+            HANDLER( varrol_unsigned )
                 *( uint32_t * )ptr_from_int( r->stack_ptr[-2] ) <<= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             /* Direct operations with variables WORD type */
 
             case MN_WORD | MN_LETNP:
             case MN_WORD | MN_LETNP | MN_UNSIGNED:
+            HANDLER( letnp_word )
                 ( *( int16_t * )ptr_from_int( r->stack_ptr[-2] ) ) = r->stack_ptr[-1];
                 r->stack_ptr -= 2;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_LET:
             case MN_WORD | MN_LET | MN_UNSIGNED:
+            HANDLER( let_word )
                 ( *( int16_t * )ptr_from_int( r->stack_ptr[-2] ) ) = r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_INC:
             case MN_WORD | MN_INC | MN_UNSIGNED:
+            HANDLER( inc_word )
                 ( *( int16_t * )ptr_from_int( r->stack_ptr[-1] ) ) += ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_DEC:
             case MN_WORD | MN_DEC | MN_UNSIGNED:
+            HANDLER( dec_word )
                 ( *( int16_t * )ptr_from_int( r->stack_ptr[-1] ) ) -= ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_POSTDEC:
             case MN_WORD | MN_POSTDEC | MN_UNSIGNED:
+            HANDLER( postdec_word )
                 tmp = ptr_from_int(r->stack_ptr[-1]);
                 ( *( int16_t * )tmp ) -= ptr[1];
                 r->stack_ptr[-1] = *( int16_t * )tmp + ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_POSTINC:
             case MN_WORD | MN_POSTINC | MN_UNSIGNED:
+            HANDLER( postinc_word )
                 tmp = ptr_from_int(r->stack_ptr[-1]);
                 *(( int16_t * )tmp ) += ptr[1];
                 r->stack_ptr[-1] = *( int16_t * )tmp - ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_VARADD:
             case MN_WORD | MN_VARADD | MN_UNSIGNED:
+            HANDLER( varadd_word )
                 *( int16_t * )ptr_from_int( r->stack_ptr[-2] ) += r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_VARSUB:
             case MN_WORD | MN_VARSUB | MN_UNSIGNED:
+            HANDLER( varsub_word )
                 *( int16_t * )ptr_from_int( r->stack_ptr[-2] ) -= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_VARMUL:
             case MN_WORD | MN_VARMUL | MN_UNSIGNED:
+            HANDLER( varmul_word )
                 *( int16_t * )ptr_from_int( r->stack_ptr[-2] ) *= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_VARDIV:
             case MN_WORD | MN_VARDIV | MN_UNSIGNED:
+            HANDLER( vardiv_word )
                 if (( int16_t )r->stack_ptr[-1] == 0 ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Division by zero\n", r->proc->name, LOCDWORD( r, PROCESS_ID ) );
                     exit( 0 );
@@ -1616,10 +2438,11 @@ main_loop_instance_go:
                 *( int16_t * )ptr_from_int( r->stack_ptr[-2] ) /= ( int16_t )r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_VARMOD:
             case MN_WORD | MN_VARMOD | MN_UNSIGNED:
+            HANDLER( varmod_word )
                 if (( int16_t )r->stack_ptr[-1] == 0 ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Division by zero\n", r->proc->name, LOCDWORD( r, PROCESS_ID ) );
                     exit( 0 );
@@ -1627,120 +2450,137 @@ main_loop_instance_go:
                 *( int16_t * )ptr_from_int( r->stack_ptr[-2] ) %= ( int16_t )r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_VAROR:
             case MN_WORD | MN_VAROR | MN_UNSIGNED:
+            HANDLER( varor_word )
                 *( int16_t * )ptr_from_int( r->stack_ptr[-2] ) |= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_VARXOR:
             case MN_WORD | MN_VARXOR | MN_UNSIGNED:
+            HANDLER( varxor_word )
                 *( int16_t * )ptr_from_int( r->stack_ptr[-2] ) ^= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_VARAND:
             case MN_WORD | MN_VARAND | MN_UNSIGNED:
+            HANDLER( varand_word )
                 *( int16_t * )ptr_from_int( r->stack_ptr[-2] ) &= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_VARROR:
+            HANDLER( varror_word )
                 *( int16_t * )ptr_from_int( r->stack_ptr[-2] ) >>= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_VARROR | MN_UNSIGNED:
+            HANDLER( varror_word_unsigned )
                 *( uint16_t * )ptr_from_int( r->stack_ptr[-2] ) >>= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_VARROL:
+            HANDLER( varrol_word )
                 *( int16_t * )ptr_from_int( r->stack_ptr[-2] ) <<= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_WORD | MN_VARROL | MN_UNSIGNED:
+            HANDLER( varrol_word_unsigned )
                 *( uint16_t * )ptr_from_int( r->stack_ptr[-2] ) <<= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             /* Direct operations with variables BYTE type */
 
             case MN_BYTE | MN_LETNP:
             case MN_BYTE | MN_LETNP | MN_UNSIGNED:
+            HANDLER( letnp_byte )
                 ( *( uint8_t * )ptr_from_int( r->stack_ptr[-2] ) ) = r->stack_ptr[-1];
                 r->stack_ptr -= 2;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_LET:
             case MN_BYTE | MN_LET | MN_UNSIGNED:
+            HANDLER( let_byte )
                 ( *( uint8_t * )ptr_from_int( r->stack_ptr[-2] ) ) = r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_INC:
             case MN_BYTE | MN_INC | MN_UNSIGNED:
+            HANDLER( inc_byte )
                 ( *( uint8_t * )ptr_from_int( r->stack_ptr[-1] ) ) += ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_DEC:
             case MN_BYTE | MN_DEC | MN_UNSIGNED:
+            HANDLER( dec_byte )
                 ( *( uint8_t * )ptr_from_int( r->stack_ptr[-1] ) ) -= ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_POSTDEC:
             case MN_BYTE | MN_POSTDEC | MN_UNSIGNED:
+            HANDLER( postdec_byte )
                 tmp = ptr_from_int(r->stack_ptr[-1]);
                 ( *( uint8_t * )tmp ) -= ptr[1];
                 r->stack_ptr[-1] = *( uint8_t * )tmp + ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_POSTINC:
             case MN_BYTE | MN_POSTINC | MN_UNSIGNED:
+            HANDLER( postinc_byte )
                 tmp = ptr_from_int(r->stack_ptr[-1]);
                 *(( uint8_t * )tmp ) += ptr[1];
                 r->stack_ptr[-1] = *( uint8_t * )tmp - ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_VARADD:
             case MN_BYTE | MN_VARADD | MN_UNSIGNED:
+            HANDLER( varadd_byte )
                 *( uint8_t * )ptr_from_int( r->stack_ptr[-2] ) += r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_VARSUB:
             case MN_BYTE | MN_VARSUB | MN_UNSIGNED:
+            HANDLER( varsub_byte )
                 *( uint8_t * )ptr_from_int( r->stack_ptr[-2] ) -= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_VARMUL:
             case MN_BYTE | MN_VARMUL | MN_UNSIGNED:
+            HANDLER( varmul_byte )
                 *( uint8_t * )ptr_from_int( r->stack_ptr[-2] ) *= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_VARDIV:
             case MN_BYTE | MN_VARDIV | MN_UNSIGNED:
+            HANDLER( vardiv_byte )
                 if (( uint8_t )r->stack_ptr[-1] == 0 ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Division by zero\n", r->proc->name, LOCDWORD( r, PROCESS_ID ) );
                     exit( 0 );
@@ -1748,10 +2588,11 @@ main_loop_instance_go:
                 *( uint8_t * )ptr_from_int( r->stack_ptr[-2] ) /= ( uint8_t )r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_VARMOD:
             case MN_BYTE | MN_VARMOD | MN_UNSIGNED:
+            HANDLER( varmod_byte )
                 if (( uint8_t )r->stack_ptr[-1] == 0 ) {
                     fprintf( stderr, "ERROR: Runtime error in %s(%d) - Division by zero\n", r->proc->name, LOCDWORD( r, PROCESS_ID ) );
                     exit( 0 );
@@ -1759,195 +2600,224 @@ main_loop_instance_go:
                 *( uint8_t * )ptr_from_int( r->stack_ptr[-2] ) %= ( uint8_t )r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_VAROR:
             case MN_BYTE | MN_VAROR | MN_UNSIGNED:
+            HANDLER( varor_byte )
                 *( uint8_t * )ptr_from_int( r->stack_ptr[-2] ) |= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_VARXOR:
             case MN_BYTE | MN_VARXOR | MN_UNSIGNED:
+            HANDLER( varxor_byte )
                 *( uint8_t * )ptr_from_int( r->stack_ptr[-2] ) ^= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_VARAND:
             case MN_BYTE | MN_VARAND | MN_UNSIGNED:
+            HANDLER( varand_byte )
                 *( uint8_t * )ptr_from_int( r->stack_ptr[-2] ) &= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_VARROR:
+            HANDLER( varror_byte )
                 *( int8_t * )ptr_from_int( r->stack_ptr[-2] ) >>= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_VARROR | MN_UNSIGNED:
+            HANDLER( varror_byte_unsigned )
                 *( uint8_t * )ptr_from_int( r->stack_ptr[-2] ) >>= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_VARROL:
+            HANDLER( varrol_byte )
                 *( int8_t * )ptr_from_int( r->stack_ptr[-2] ) <<= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_BYTE | MN_VARROL | MN_UNSIGNED:
+            HANDLER( varrol_byte_unsigned )
                 *( uint8_t * )ptr_from_int( r->stack_ptr[-2] ) <<= r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             /* Direct operations with variables FLOAT type */
 
             case MN_FLOAT | MN_LETNP:
+            HANDLER( letnp_float )
                 ( *( float * )ptr_from_int( r->stack_ptr[-2] ) ) = *( float * ) & r->stack_ptr[-1];
                 r->stack_ptr -= 2;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_FLOAT | MN_LET :
+            HANDLER( let_float )
                 ( *( float * )ptr_from_int( r->stack_ptr[-2] ) ) = *( float * ) & r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_FLOAT | MN_INC:
+            HANDLER( inc_float )
                 ( *( float * )ptr_from_int( r->stack_ptr[-1] ) ) += ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_FLOAT | MN_DEC:
+            HANDLER( dec_float )
                 ( *( float * )ptr_from_int( r->stack_ptr[-1] ) ) -= ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_FLOAT | MN_POSTDEC:
+            HANDLER( postdec_float )
                 tmp = ptr_from_int(r->stack_ptr[-1]);
                 ( *( float * )tmp ) -= ptr[1];
                 r->stack_ptr[-1] = *( uint32_t * )tmp + ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_FLOAT | MN_POSTINC:
+            HANDLER( postinc_float )
                 tmp = ptr_from_int(r->stack_ptr[-1]);
                 *(( float * )tmp ) += ptr[1];
                 r->stack_ptr[-1] = *( uint32_t * )tmp - ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_FLOAT | MN_VARADD:
+            HANDLER( varadd_float )
                 *( float * )ptr_from_int( r->stack_ptr[-2] ) += *( float * ) & r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_FLOAT | MN_VARSUB:
+            HANDLER( varsub_float )
                 *( float * )ptr_from_int( r->stack_ptr[-2] ) -= *( float * ) & r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_FLOAT | MN_VARMUL:
+            HANDLER( varmul_float )
                 *( float * )ptr_from_int( r->stack_ptr[-2] ) *= *( float * ) & r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_FLOAT | MN_VARDIV:
+            HANDLER( vardiv_float )
                 *( float * )ptr_from_int( r->stack_ptr[-2] ) /= *( float * ) & r->stack_ptr[-1];
                 r->stack_ptr--;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             /* Jumps */
 
             case MN_JUMP:
+            HANDLER( jump )
                 ptr = r->code + ptr[1];
-                continue;
+                JUMP_OPCODE;
 
             case MN_JTRUE:
+            HANDLER( jtrue )
                 r->stack_ptr--;
                 if ( *r->stack_ptr ) {
                     ptr = r->code + ptr[1];
-                    continue;
+                    JUMP_OPCODE;
                 }
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_JFALSE:
+            HANDLER( jfalse )
                 r->stack_ptr--;
                 if ( !*r->stack_ptr ) {
                     ptr = r->code + ptr[1];
-                    continue;
+                    JUMP_OPCODE;
                 }
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_JTTRUE:
+            HANDLER( jttrue )
                 if ( r->stack_ptr[-1] ) {
                     ptr = r->code + ptr[1];
-                    continue;
+                    JUMP_OPCODE;
                 }
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_JTFALSE:
+            HANDLER( jtfalse )
                 if ( !r->stack_ptr[-1] ) {
                     ptr = r->code + ptr[1];
-                    continue;
+                    JUMP_OPCODE;
                 }
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_NCALL:
+            HANDLER( ncall )
                 *r->stack_ptr++ = ptr - r->code + 2 ; /* Push next address */
                 ptr = r->code + ptr[1] ; /* Call function */
                 r->call_level++;
-                break;
+                NEXT_OPCODE;
 
             /* Switch */
 
             case MN_SWITCH:
+            HANDLER( switch )
                 r->switchval = *--r->stack_ptr;
                 r->cased = 0;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_SWITCH | MN_STRING:
+            HANDLER( switch_string )
                 if ( r->switchval_string != 0 ) string_discard( r->switchval_string );
                 r->switchval_string = *--r->stack_ptr;
                 r->cased = 0;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_CASE:
+            HANDLER( case )
                 if ( r->switchval == *--r->stack_ptr ) r->cased = 2;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_CASE | MN_STRING:
+            HANDLER( case_string )
                 if ( string_comp( r->switchval_string, *--r->stack_ptr ) == 0 ) r->cased = 2;
                 string_discard( *r->stack_ptr );
                 string_discard( r->stack_ptr[-1] );
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_CASE_R:
+            HANDLER( case_r )
                 r->stack_ptr -= 2;
                 if ( r->switchval >= r->stack_ptr[0] && r->switchval <= r->stack_ptr[1] ) r->cased = 1;
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_CASE_R | MN_STRING:
+            HANDLER( case_r_string )
                 r->stack_ptr -= 2;
                 if ( string_comp( r->switchval_string, r->stack_ptr[0] ) >= 0 &&
                      string_comp( r->switchval_string, r->stack_ptr[1] ) <= 0 )
@@ -1955,19 +2825,21 @@ main_loop_instance_go:
                 string_discard( r->stack_ptr[0] );
                 string_discard( r->stack_ptr[1] );
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_JNOCASE:
+            HANDLER( jnocase )
                 if ( r->cased < 1 ) {
                     ptr = r->code + ptr[1];
-                    continue;
+                    JUMP_OPCODE;
                 }
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             /* Process control */
 
             case MN_TYPE:
+            HANDLER( type )
             {
                 PROCDEF * proct = procdef_get( ptr[1] );
                 if ( !proct ) {
@@ -1976,10 +2848,11 @@ main_loop_instance_go:
                 }
                 *r->stack_ptr++ = proct->type;
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
             }
 
             case MN_FRAME:
+            HANDLER( frame )
                 LOCINT32( r, FRAME_PERCENT ) += r->stack_ptr[-1];
 
                 r->stack_ptr--;
@@ -1993,25 +2866,28 @@ main_loop_instance_go:
                         r->called_by->stack_ptr[-1] = return_value;
 
                     LOCDWORD( r->called_by, STATUS ) &= ~STATUS_WAITING_MASK;
+                    instance_status_changed( r->called_by );
                     r->called_by = NULL;
                 }
                 goto break_all;
 
             case MN_END:
+            HANDLER( end )
                 if ( r->call_level > 0 ) {
                     ptr = r->code + *--r->stack_ptr;
                     r->call_level--;
-                    continue;
+                    JUMP_OPCODE;
                 }
 
                 if ( LOCDWORD( r, STATUS ) != STATUS_DEAD ) LOCDWORD( r, STATUS ) = STATUS_KILLED;
                 goto break_all;
 
             case MN_RETURN:
+            HANDLER( return )
                 if ( r->call_level > 0 ) {
                     ptr = r->code + *--r->stack_ptr;
                     r->call_level--;
-                    continue;
+                    JUMP_OPCODE;
                 }
 
                 if ( LOCDWORD( r, STATUS ) != STATUS_DEAD ) LOCDWORD( r, STATUS ) = STATUS_KILLED;
@@ -2022,27 +2898,31 @@ main_loop_instance_go:
             /* Handlers */
 
             case MN_EXITHNDLR:
+            HANDLER( exithndlr )
                 r->exitcode = ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             case MN_ERRHNDLR:
+            HANDLER( errhndlr )
                 r->errorcode = ptr[1];
                 ptr += 2;
-                break;
+                NEXT_OPCODE;
 
             /* Others */
 
             case MN_DEBUG:
+            HANDLER( debug )
                 if ( dcb.data.NSourceFiles ) {
                     if ( debug > 0 ) printf( "\n::: DEBUG from %s(%d)\n", r->proc->name, LOCDWORD( r, PROCESS_ID ) );
                     trace_sentence = -1;
                     debugger_show_console = 1;
                 }
                 ptr++;
-                break;
+                NEXT_OPCODE;
 
             case MN_SENTENCE:
+            HANDLER( sentence )
                 trace_sentence = ptr[1];
                 trace_instance = r;
                 ptr += 2;
@@ -2051,9 +2931,63 @@ main_loop_instance_go:
                     debugger_step = 0;
                     debugger_show_console = 1;
                 }
-                break;
+                NEXT_OPCODE;
+
+#ifdef USE_COMPUTED_GOTO
+            /* Superinstructions, only reached through the threaded code.
+             * Only the last mnemonic of each sequence may have side effects,
+             * so the checks between the fused mnemonics can be skipped.
+             */
+
+            HANDLER( private_push_letnp )
+                PRIDWORD( r, ptr[1] ) = ptr[3];
+                ptr += 5;
+                NEXT_OPCODE;
+
+            HANDLER( local_push_letnp )
+                LOCDWORD( r, ptr[1] ) = ptr[3];
+                ptr += 5;
+                NEXT_OPCODE;
+
+            HANDLER( global_push_letnp )
+                GLODWORD( ptr[1] ) = ptr[3];
+                ptr += 5;
+                NEXT_OPCODE;
+
+            HANDLER( push_add )
+                r->stack_ptr[-1] += ptr[1];
+                ptr += 3;
+                NEXT_OPCODE;
+
+            HANDLER( push_sub )
+                r->stack_ptr[-1] -= ptr[1];
+                ptr += 3;
+                NEXT_OPCODE;
+
+            FUSED_VAR_CMP_JFALSE( get_priv_push_eq_jfalse, PRIINT32, == )
+            FUSED_VAR_CMP_JFALSE( get_priv_push_ne_jfalse, PRIINT32, != )
+            FUSED_VAR_CMP_JFALSE( get_priv_push_lt_jfalse, PRIINT32, < )
+            FUSED_VAR_CMP_JFALSE( get_priv_push_gt_jfalse, PRIINT32, > )
+            FUSED_VAR_CMP_JFALSE( get_priv_push_lte_jfalse, PRIINT32, <= )
+            FUSED_VAR_CMP_JFALSE( get_priv_push_gte_jfalse, PRIINT32, >= )
+
+            FUSED_VAR_CMP_JFALSE( get_local_push_eq_jfalse, LOCINT32, == )
+            FUSED_VAR_CMP_JFALSE( get_local_push_ne_jfalse, LOCINT32, != )
+            FUSED_VAR_CMP_JFALSE( get_local_push_lt_jfalse, LOCINT32, < )
+            FUSED_VAR_CMP_JFALSE( get_local_push_gt_jfalse, LOCINT32, > )
+            FUSED_VAR_CMP_JFALSE( get_local_push_lte_jfalse, LOCINT32, <= )
+            FUSED_VAR_CMP_JFALSE( get_local_push_gte_jfalse, LOCINT32, >= )
+
+            FUSED_CMP_JFALSE( push_eq_jfalse, == )
+            FUSED_CMP_JFALSE( push_ne_jfalse, != )
+            FUSED_CMP_JFALSE( push_lt_jfalse, < )
+            FUSED_CMP_JFALSE( push_gt_jfalse, > )
+            FUSED_CMP_JFALSE( push_lte_jfalse, <= )
+            FUSED_CMP_JFALSE( push_gte_jfalse, >= )
+#endif
 
             default:
+            HANDLER( invalid )
                 fprintf( stderr, "ERROR: Runtime error in %s(%d) - Mnemonic 0x%02X not implemented\n", r->proc->name, LOCDWORD( r, PROCESS_ID ), *ptr );
                 exit( 0 );
         }
@@ -2082,6 +3016,7 @@ break_all:
                 r->called_by->stack_ptr[-1] = return_value;
 
             LOCDWORD( r->called_by, STATUS ) &= ~STATUS_WAITING_MASK;
+            instance_status_changed( r->called_by );
         }
 
         r->called_by = NULL;
@@ -2110,7 +3045,62 @@ break_all:
 
     if ( r && LOCDWORD( r, STATUS ) != STATUS_KILLED && r->first_run ) r->first_run = 0;
 
+    PROFILER_LEAVE();
+
     return return_value;
 }
 
 /* ---------------------------------------------------------------------- */
+/* Peephole pass over the threaded code: the first mnemonic of a known
+ * sequence gets the superinstruction handler. The others keep their own,
+ * so jumps into the middle of a sequence still work.
+ */
+
+#ifdef USE_COMPUTED_GOTO
+static void procdef_fuse( PROCDEF * proc ) {
+    int count = proc->code_size / sizeof( int );
+    int n, m, k, pos;
+
+    for ( n = 0; n < count; n += 1 + MN_PARAMS( proc->code[n] ) ) {
+        for ( m = 0; fused_patterns[m].count; m++ ) {
+            for ( k = 0, pos = n; k < fused_patterns[m].count && pos < count; k++ ) {
+                if ( proc->threaded[pos] != handlers[ fused_patterns[m].mnemonics[k] ] ) break;
+                pos += 1 + MN_PARAMS( proc->code[pos] );
+            }
+
+            if ( k == fused_patterns[m].count ) {
+                proc->threaded[n] = handlers[ fused_patterns[m].handler ];
+                break;
+            }
+        }
+    }
+}
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Builds the threaded copy of the code used by instance_go()             */
+
+void procdef_predecode( PROCDEF * proc ) {
+#ifdef USE_COMPUTED_GOTO
+    int n, op, count = proc->code_size / sizeof( int );
+
+    if ( !proc->code || !count ) return;
+
+    if ( !handlers ) instance_go( NULL );
+
+    proc->threaded = ( void ** ) bgd_calloc( count, sizeof( void * ) );
+    if ( !proc->threaded ) return;
+
+    /* Operands and unknown mnemonics end in the "not implemented" error */
+    for ( n = 0; n < count; n++ ) proc->threaded[n] = handlers[MN_HANDLERS];
+
+    for ( n = 0; n < count; n += 1 + MN_PARAMS( op ) ) {
+        op = proc->code[n];
+        if ( op >= 0 && op < MN_HANDLERS && handlers[op] ) proc->threaded[n] = handlers[op];
+    }
+
+    procdef_fuse( proc );
+#endif
+}
+
+/* ---------------------------------------------------------------------- */
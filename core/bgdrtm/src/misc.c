@@ -40,6 +40,7 @@
 #include "dcb.h"
 #include "sysprocs_p.h"
 #include "xstrings.h"
+#include "profiler.h"
 
 #include "fmath.h"
 
@@ -307,6 +308,14 @@ void bgdrtm_entry( int argc, char * argv[] )
 
 void bgdrtm_exit( int exit_value )
 {
+#ifdef OPCODE_NGRAMS
+    opcode_ngrams_dump();
+#endif
+
+#ifdef INTERPRETER_PROFILER
+    profiler_dump();
+#endif
+
 #if LIBRETRO_CORE
 extern void request_exit_bgd();
     request_exit_bgd();
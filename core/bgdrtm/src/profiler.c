@@ -0,0 +1,521 @@
+/*
+ *  Copyright © 2006-2019 SplinterGU (Fenix/Bennugd)
+ *  Copyright © 2002-2006 Fenix Team (Fenix)
+ *  Copyright © 1999-2002 José Luis Cebrián Pagüe (Fenix)
+ *
+ *  This file is part of Bennu - Game Development
+ *
+ *  This software is provided 'as-is', without any express or implied
+ *  warranty. In no event will the authors be held liable for any damages
+ *  arising from the use of this software.
+ *
+ *  Permission is granted to anyone to use this software for any purpose,
+ *  including commercial applications, and to alter it and redistribute it
+ *  freely, subject to the following restrictions:
+ *
+ *     1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *     2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *     3. This notice may not be removed or altered from any source
+ *     distribution.
+ *
+ */
+
+#ifdef INTERPRETER_PROFILER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "bgdrtm.h"
+#include "savestate.h"
+#include "profiler.h"
+
+/* --------------------------------------------------------------------------- */
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#include <x86intrin.h>
+#define profiler_ticks()    __rdtsc()
+#elif defined( _MSC_VER ) && ( defined( _M_X64 ) || defined( _M_IX86 ) )
+#include <intrin.h>
+#define profiler_ticks()    __rdtsc()
+#else
+#define profiler_ticks()    profiler_usec()
+#endif
+
+#define PROFILER_PROC           0
+#define PROFILER_SYSPROC        1
+
+#define PROFILER_MAX_DEPTH      1024
+#define PROFILER_MAX_EVENTS     ( 1 << 19 )
+
+/* --------------------------------------------------------------------------- */
+
+typedef struct
+{
+    const char * name ;
+    uint64_t self ;
+    uint64_t calls ;
+} PROFILER_ENTRY ;
+
+typedef struct
+{
+    PROFILER_ENTRY * entries ;
+    int count ;
+} PROFILER_TABLE ;
+
+typedef struct
+{
+    int kind ;
+    int index ;
+    const char * name ;
+    uint64_t start ;
+} PROFILER_FRAME ;
+
+typedef struct
+{
+    uint64_t start ;
+    uint64_t duration ;
+    int kind ;
+    int index ;
+} PROFILER_EVENT ;
+
+/* --------------------------------------------------------------------------- */
+
+#if LIBRETRO_CORE
+int             profiler_mode = PROFILER_OFF ;
+#else
+int             profiler_mode = PROFILER_REPORT ;
+#endif
+
+uint64_t        profiler_opcodes[ 0x1000 ] ;
+
+static char *           profiler_output = NULL ;
+
+static PROFILER_TABLE   profiler_tables[ 2 ] ;
+
+/* Open calls, they follow the C stack so they are part of save states */
+static PROFILER_FRAME   profiler_frames[ PROFILER_MAX_DEPTH ] ;
+static int              profiler_depth = 0 ;
+static uint64_t         profiler_mark = 0 ;
+
+static PROFILER_EVENT * profiler_events = NULL ;
+static int              profiler_event_count = 0 ;
+static int              profiler_events_lost = 0 ;
+
+/* Profiled time, in ticks and in microseconds to convert between both */
+static uint64_t         profiler_started_ticks = 0 ;
+static uint64_t         profiler_started_usec = 0 ;
+static uint64_t         profiler_total_ticks = 0 ;
+static uint64_t         profiler_total_usec = 0 ;
+static uint64_t         profiler_base = 0 ;
+
+/* --------------------------------------------------------------------------- */
+
+static uint64_t profiler_usec()
+{
+#if LIBRETRO_CORE
+    extern uint64_t retro_get_microseconds() ;
+    return retro_get_microseconds() ;
+#else
+    struct timespec ts ;
+    timespec_get( &ts, TIME_UTC ) ;
+    return ( uint64_t ) ts.tv_sec * 1000000 + ts.tv_nsec / 1000 ;
+#endif
+}
+
+/* --------------------------------------------------------------------------- */
+
+static PROFILER_ENTRY * profiler_entry( int kind, int index, const char * name )
+{
+    PROFILER_TABLE * table = &profiler_tables[ kind ] ;
+
+    if ( index < 0 ) return NULL ;
+
+    if ( index >= table->count )
+    {
+        int count = ( index + 64 ) & ~63 ;
+        PROFILER_ENTRY * entries = realloc( table->entries, count * sizeof( PROFILER_ENTRY ) ) ;
+        if ( !entries ) return NULL ;
+        memset( entries + table->count, 0, ( count - table->count ) * sizeof( PROFILER_ENTRY ) ) ;
+        table->entries = entries ;
+        table->count = count ;
+    }
+
+    if ( !table->entries[ index ].name ) table->entries[ index ].name = name ;
+
+    return &table->entries[ index ] ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void profiler_charge( PROFILER_FRAME * frame, uint64_t now )
+{
+    PROFILER_ENTRY * entry ;
+
+    if ( !profiler_mode ) return ;
+
+    entry = profiler_entry( frame->kind, frame->index, frame->name ) ;
+    if ( entry ) entry->self += now - profiler_mark ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void profiler_event( PROFILER_FRAME * frame, uint64_t now )
+{
+    PROFILER_EVENT * event ;
+
+    if ( !profiler_events )
+    {
+        profiler_events = malloc( PROFILER_MAX_EVENTS * sizeof( PROFILER_EVENT ) ) ;
+        if ( !profiler_events ) return ;
+    }
+
+    if ( profiler_event_count >= PROFILER_MAX_EVENTS || frame->start < profiler_base )
+    {
+        profiler_events_lost++ ;
+        return ;
+    }
+
+    event = &profiler_events[ profiler_event_count++ ] ;
+    event->start = frame->start - profiler_base ;
+    event->duration = now - frame->start ;
+    event->kind = frame->kind ;
+    event->index = frame->index ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void profiler_enter( int kind, int index, const char * name )
+{
+    uint64_t now = profiler_ticks() ;
+    PROFILER_ENTRY * entry ;
+
+    /* The caller stops counting while the callee runs */
+    if ( profiler_depth > 0 && profiler_depth <= PROFILER_MAX_DEPTH )
+        profiler_charge( &profiler_frames[ profiler_depth - 1 ], now ) ;
+
+    if ( profiler_depth < PROFILER_MAX_DEPTH )
+    {
+        profiler_frames[ profiler_depth ].kind = kind ;
+        profiler_frames[ profiler_depth ].index = index ;
+        profiler_frames[ profiler_depth ].name = name ;
+        profiler_frames[ profiler_depth ].start = now ;
+    }
+
+    profiler_depth++ ;
+    profiler_mark = now ;
+
+    if ( profiler_mode && ( entry = profiler_entry( kind, index, name ) ) ) entry->calls++ ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+void profiler_enter_proc( PROCDEF * proc )
+{
+    profiler_enter( PROFILER_PROC, proc->type, proc->name ) ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+void profiler_enter_sysproc( SYSPROC * p )
+{
+    profiler_enter( PROFILER_SYSPROC, p->code, p->name ) ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+void profiler_leave()
+{
+    uint64_t now = profiler_ticks() ;
+
+    if ( profiler_depth <= 0 ) return ;
+
+    profiler_depth-- ;
+
+    if ( profiler_depth < PROFILER_MAX_DEPTH )
+    {
+        profiler_charge( &profiler_frames[ profiler_depth ], now ) ;
+        if ( profiler_mode == PROFILER_TRACE ) profiler_event( &profiler_frames[ profiler_depth ], now ) ;
+    }
+
+    profiler_mark = now ;
+}
+
+/* --------------------------------------------------------------------------- */
+/*
+ *  FUNCTION : profiler_set_mode
+ *
+ *  Starts or stops profiling. Counters are kept between runs, so the
+ *  report covers every period the profiler was enabled.
+ *
+ *  PARAMS :
+ *      mode            PROFILER_OFF, PROFILER_REPORT or PROFILER_TRACE
+ *
+ *  RETURN VALUE :
+ *      None
+ */
+
+void profiler_set_mode( int mode )
+{
+    uint64_t ticks = profiler_ticks(), usec = profiler_usec() ;
+
+    if ( mode == profiler_mode ) return ;
+
+    if ( profiler_mode )
+    {
+        profiler_total_ticks += ticks - profiler_started_ticks ;
+        profiler_total_usec += usec - profiler_started_usec ;
+    }
+
+    if ( mode )
+    {
+        profiler_started_ticks = ticks ;
+        profiler_started_usec = usec ;
+        if ( !profiler_base ) profiler_base = ticks ;
+    }
+
+    /* Open calls start counting now */
+    profiler_mark = ticks ;
+    profiler_mode = mode ;
+}
+
+/* --------------------------------------------------------------------------- */
+/*
+ *  FUNCTION : profiler_set_output
+ *
+ *  Sets the path, without extension, of the files written on exit
+ *
+ *  PARAMS :
+ *      basename        Path and file name prefix
+ *
+ *  RETURN VALUE :
+ *      None
+ */
+
+void profiler_set_output( const char * basename )
+{
+    free( profiler_output ) ;
+    profiler_output = basename ? strdup( basename ) : NULL ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void profiler_savestate_loaded()
+{
+    uint64_t now = profiler_ticks() ;
+    int n ;
+
+    /* Open calls come from the state, the time between doesn't belong to them */
+    for ( n = 0; n < profiler_depth && n < PROFILER_MAX_DEPTH; n++ ) profiler_frames[ n ].start = now ;
+    profiler_mark = now ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+void profiler_savestate_register()
+{
+    savestate_register_var( profiler_frames ) ;
+    savestate_register_var( profiler_depth ) ;
+    savestate_add_load_hook( profiler_savestate_loaded ) ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+static PROFILER_TABLE * profiler_sort_table ;
+
+static int profiler_compare( const void * a, const void * b )
+{
+    uint64_t sa = profiler_sort_table->entries[ *( const int * ) a ].self ;
+    uint64_t sb = profiler_sort_table->entries[ *( const int * ) b ].self ;
+
+    return ( sa < sb ) - ( sa > sb ) ;
+}
+
+static int profiler_compare_opcodes( const void * a, const void * b )
+{
+    uint64_t ca = profiler_opcodes[ *( const int * ) a ] ;
+    uint64_t cb = profiler_opcodes[ *( const int * ) b ] ;
+
+    return ( ca < cb ) - ( ca > cb ) ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void profiler_write_table( FILE * fp, const char * title, PROFILER_TABLE * table, double usec_per_tick, uint64_t total )
+{
+    int * order, n, count = 0 ;
+
+    if ( !table->count ) return ;
+
+    order = malloc( table->count * sizeof( int ) ) ;
+    if ( !order ) return ;
+
+    for ( n = 0; n < table->count; n++ )
+        if ( table->entries[ n ].calls ) order[ count++ ] = n ;
+
+    profiler_sort_table = table ;
+    qsort( order, count, sizeof( int ), profiler_compare ) ;
+
+    fprintf( fp, "\n%s (self time)\n\n%12s %7s %12s %10s  %s\n", title, "ms", "%", "calls", "us/call", "name" ) ;
+
+    for ( n = 0; n < count; n++ )
+    {
+        PROFILER_ENTRY * entry = &table->entries[ order[ n ] ] ;
+        fprintf( fp, "%12.3f %6.2f%% %12llu %10.3f  %s\n",
+                 entry->self * usec_per_tick / 1000.0,
+                 total ? entry->self * 100.0 / total : 0.0,
+                 ( unsigned long long ) entry->calls,
+                 entry->self * usec_per_tick / entry->calls,
+                 entry->name ? entry->name : "(?)" ) ;
+    }
+
+    free( order ) ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void profiler_write_report( FILE * fp, double usec_per_tick, uint64_t total )
+{
+    int order[ 0x1000 ], n, count = 0 ;
+    uint64_t executed = 0 ;
+
+    fprintf( fp, "BennuGD interpreter profile\n\nProfiled time: %.3f ms (%llu ticks)\n",
+             total * usec_per_tick / 1000.0, ( unsigned long long ) total ) ;
+
+    profiler_write_table( fp, "Processes and functions", &profiler_tables[ PROFILER_PROC ], usec_per_tick, total ) ;
+    profiler_write_table( fp, "System functions", &profiler_tables[ PROFILER_SYSPROC ], usec_per_tick, total ) ;
+
+    for ( n = 0; n < 0x1000; n++ )
+    {
+        if ( !profiler_opcodes[ n ] ) continue ;
+        executed += profiler_opcodes[ n ] ;
+        order[ count++ ] = n ;
+    }
+
+    qsort( order, count, sizeof( int ), profiler_compare_opcodes ) ;
+
+    /* Superinstructions are counted as their first mnemonic */
+    fprintf( fp, "\nMnemonics (%llu dispatched)\n\n%14s %7s  %s\n", ( unsigned long long ) executed, "count", "%", "mnemonic" ) ;
+
+    for ( n = 0; n < count; n++ )
+    {
+        char * name = mnemonic_name( order[ n ] ) ;
+        fprintf( fp, "%14llu %6.2f%%  %s (0x%03X)\n",
+                 ( unsigned long long ) profiler_opcodes[ order[ n ] ],
+                 profiler_opcodes[ order[ n ] ] * 100.0 / executed,
+                 name ? name : "?", order[ n ] ) ;
+    }
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void profiler_write_name( FILE * fp, const char * name )
+{
+    fputc( '"', fp ) ;
+    for ( ; name && *name; name++ )
+    {
+        if ( *name == '"' || *name == '\\' ) fputc( '\\', fp ) ;
+        if (( unsigned char ) *name >= ' ' ) fputc( *name, fp ) ;
+    }
+    fputc( '"', fp ) ;
+}
+
+static void profiler_write_trace( FILE * fp, double usec_per_tick )
+{
+    int n ;
+
+    fprintf( fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" ) ;
+    fprintf( fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"BennuGD\"}}" ) ;
+
+    for ( n = 0; n < profiler_event_count; n++ )
+    {
+        PROFILER_EVENT * event = &profiler_events[ n ] ;
+        PROFILER_TABLE * table = &profiler_tables[ event->kind ] ;
+
+        fprintf( fp, ",\n{\"name\":" ) ;
+        profiler_write_name( fp, event->index < table->count ? table->entries[ event->index ].name : NULL ) ;
+        fprintf( fp, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}",
+                 event->kind == PROFILER_PROC ? "process" : "sysproc",
+                 event->start * usec_per_tick,
+                 event->duration * usec_per_tick ) ;
+    }
+
+    fprintf( fp, "\n]}\n" ) ;
+}
+
+/* --------------------------------------------------------------------------- */
+/*
+ *  FUNCTION : profiler_dump
+ *
+ *  Writes <output>.profile.txt and, if events were recorded,
+ *  <output>.trace.json
+ *
+ *  PARAMS :
+ *      None
+ *
+ *  RETURN VALUE :
+ *      None
+ */
+
+void profiler_dump()
+{
+    const char * output = profiler_output ? profiler_output : "bgd" ;
+    char * filename ;
+    double usec_per_tick = 1.0 ;
+    uint64_t total_ticks, total_usec ;
+    FILE * fp ;
+
+    total_ticks = profiler_total_ticks ;
+    total_usec = profiler_total_usec ;
+
+    if ( profiler_mode )
+    {
+        total_ticks += profiler_ticks() - profiler_started_ticks ;
+        total_usec += profiler_usec() - profiler_started_usec ;
+    }
+
+    if ( !total_ticks ) return ;
+
+    /* Without a usable clock durations stay in ticks */
+    if ( total_usec ) usec_per_tick = ( double ) total_usec / total_ticks ;
+
+    filename = malloc( strlen( output ) + 16 ) ;
+    if ( !filename ) return ;
+
+    sprintf( filename, "%s.profile.txt", output ) ;
+    if (( fp = fopen( filename, "w" ) ) )
+    {
+        profiler_write_report( fp, usec_per_tick, total_ticks ) ;
+        fclose( fp ) ;
+        printf( "Profile written to %s\n", filename ) ;
+    }
+    else
+        fprintf( stderr, "ERROR: Can't write %s\n", filename ) ;
+
+    if ( profiler_event_count )
+    {
+        sprintf( filename, "%s.trace.json", output ) ;
+        if (( fp = fopen( filename, "w" ) ) )
+        {
+            profiler_write_trace( fp, usec_per_tick ) ;
+            fclose( fp ) ;
+            printf( "Trace written to %s (%d events, %d lost)\n", filename, profiler_event_count, profiler_events_lost ) ;
+        }
+        else
+            fprintf( stderr, "ERROR: Can't write %s\n", filename ) ;
+    }
+
+    free( filename ) ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+#endif
@@ -0,0 +1,295 @@
+/*
+ *  Copyright © 2006-2019 SplinterGU (Fenix/Bennugd)
+ *  Copyright © 2002-2006 Fenix Team (Fenix)
+ *  Copyright © 1999-2002 José Luis Cebrián Pagüe (Fenix)
+ *
+ *  This file is part of Bennu - Game Development
+ *
+ *  This software is provided 'as-is', without any express or implied
+ *  warranty. In no event will the authors be held liable for any damages
+ *  arising from the use of this software.
+ *
+ *  Permission is granted to anyone to use this software for any purpose,
+ *  including commercial applications, and to alter it and redistribute it
+ *  freely, subject to the following restrictions:
+ *
+ *     1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *     2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *     3. This notice may not be removed or altered from any source
+ *     distribution.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "bgdrtm.h"
+#include "xstrings.h"
+#include "savestate.h"
+#include "profiler.h"
+
+/* --------------------------------------------------------------------------- */
+
+#define SAVESTATE_MAGIC         0x53444742  /* "BGDS" */
+#define SAVESTATE_VERSION       1
+
+#define MAX_SAVESTATE_REGIONS   256
+#define MAX_SAVESTATE_HOOKS     32
+#define MAX_SAVESTATE_CHECKS    128
+
+/* --------------------------------------------------------------------------- */
+
+typedef struct
+{
+    void * ptr ;
+    size_t size ;
+} SAVESTATE_REGION ;
+
+typedef struct
+{
+    uint8_t * first ;
+    int count ;
+    size_t stride ;
+    int warned ;
+} SAVESTATE_CHECK ;
+
+typedef struct
+{
+    uint32_t magic ;
+    uint32_t version ;
+    uint32_t regions ;
+    uint32_t regions_size ;
+} SAVESTATE_HEADER ;
+
+/* The registry itself lives outside the heap, it must survive a load */
+
+static SAVESTATE_REGION savestate_regions[ MAX_SAVESTATE_REGIONS ] ;
+static int              savestate_region_count = 0 ;
+static size_t           savestate_regions_size = 0 ;
+
+static FN_HOOK          savestate_load_hooks[ MAX_SAVESTATE_HOOKS ] ;
+static int              savestate_load_hook_count = 0 ;
+
+static SAVESTATE_CHECK  savestate_checks[ MAX_SAVESTATE_CHECKS ] ;
+static int              savestate_check_count = 0 ;
+
+/* --------------------------------------------------------------------------- */
+
+void savestate_register( void * ptr, size_t size )
+{
+    int n ;
+
+    for ( n = 0; n < savestate_region_count; n++ )
+        if ( savestate_regions[n].ptr == ptr ) return ;
+
+    if ( savestate_region_count >= MAX_SAVESTATE_REGIONS )
+    {
+        fprintf( stderr, "ERROR: Too many save state regions\n" ) ;
+        return ;
+    }
+
+    savestate_regions[ savestate_region_count ].ptr = ptr ;
+    savestate_regions[ savestate_region_count ].size = size ;
+    savestate_region_count++ ;
+    savestate_regions_size += size ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Pointers to check on save: count items, stride bytes apart */
+
+void savestate_check_pointers( void * first, int count, size_t stride )
+{
+    int n ;
+
+    for ( n = 0; n < savestate_check_count; n++ )
+        if ( savestate_checks[n].first == first ) return ;
+
+    if ( savestate_check_count >= MAX_SAVESTATE_CHECKS )
+    {
+        fprintf( stderr, "ERROR: Too many save state pointer checks\n" ) ;
+        return ;
+    }
+
+    savestate_checks[ savestate_check_count ].first = first ;
+    savestate_checks[ savestate_check_count ].count = count ;
+    savestate_checks[ savestate_check_count ].stride = stride ;
+    savestate_checks[ savestate_check_count ].warned = 0 ;
+    savestate_check_count++ ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+void savestate_register_pointers( void * ptr, size_t size )
+{
+    savestate_register( ptr, size ) ;
+    savestate_check_pointers( ptr, size / sizeof( void * ), sizeof( void * ) ) ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+#ifndef NDEBUG
+static int savestate_pointer_ok( const uint8_t * p )
+{
+    int n ;
+
+    if ( !p || bgd_malloc_owns( p ) ) return 1 ;
+
+    for ( n = 0; n < savestate_region_count; n++ )
+        if ( p >= ( uint8_t * ) savestate_regions[n].ptr && p < ( uint8_t * ) savestate_regions[n].ptr + savestate_regions[n].size ) return 1 ;
+
+    return 0 ;
+}
+
+/* A pointer out of the heap and the globals is left dangling by a load */
+
+static void savestate_check()
+{
+    SAVESTATE_CHECK * c ;
+    const uint8_t * p ;
+    int n, i ;
+
+    for ( n = 0; n < savestate_check_count; n++ )
+    {
+        c = &savestate_checks[n] ;
+        if ( c->warned ) continue ;
+
+        for ( i = 0; i < c->count; i++ )
+        {
+            p = *( const uint8_t ** )( c->first + i * c->stride ) ;
+            if ( !savestate_pointer_ok( p ) )
+            {
+                fprintf( stderr, "WARNING: Save state pointer %p at %p (item %d) is not in the heap\n", p, c->first + i * c->stride, i ) ;
+                c->warned = 1 ;
+                break ;
+            }
+        }
+    }
+}
+#endif
+
+/* --------------------------------------------------------------------------- */
+
+void savestate_add_load_hook( FN_HOOK hook )
+{
+    int n ;
+
+    for ( n = 0; n < savestate_load_hook_count; n++ )
+        if ( savestate_load_hooks[n] == hook ) return ;
+
+    if ( savestate_load_hook_count >= MAX_SAVESTATE_HOOKS )
+    {
+        fprintf( stderr, "ERROR: Too many save state hooks\n" ) ;
+        return ;
+    }
+
+    savestate_load_hooks[ savestate_load_hook_count++ ] = hook ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+/*
+ *  FUNCTION : savestate_init
+ *
+ *  Registers the interpreter globals. Modules register their own state
+ *  from module_initialize.
+ *
+ *  PARAMS :
+ *      None
+ *
+ *  RETURN VALUE :
+ *      None
+ */
+
+void savestate_init()
+{
+    instance_savestate_register() ;
+    string_savestate_register() ;
+#ifdef INTERPRETER_PROFILER
+    profiler_savestate_register() ;
+#endif
+}
+
+/* --------------------------------------------------------------------------- */
+
+size_t savestate_size()
+{
+    size_t heap_size = bgd_malloc_state_size() ;
+
+    if ( !heap_size ) return 0 ;
+
+    return sizeof( SAVESTATE_HEADER ) + savestate_regions_size + heap_size ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+int savestate_save( void * data, size_t size )
+{
+    SAVESTATE_HEADER header = { SAVESTATE_MAGIC, SAVESTATE_VERSION, savestate_region_count, savestate_regions_size } ;
+    uint8_t * dst = data ;
+    int n ;
+
+    if ( size < sizeof( header ) + savestate_regions_size ) return 0 ;
+
+    memcpy( dst, &header, sizeof( header ) ) ;
+    dst += sizeof( header ) ;
+
+    for ( n = 0; n < savestate_region_count; n++ )
+    {
+        memcpy( dst, savestate_regions[n].ptr, savestate_regions[n].size ) ;
+        dst += savestate_regions[n].size ;
+    }
+
+    if ( !bgd_malloc_state_save( dst, size - ( dst - ( uint8_t * ) data ) ) ) return 0 ;
+
+#ifndef NDEBUG
+    savestate_check() ;
+#endif
+
+    return 1 ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+int savestate_load( const void * data, size_t size )
+{
+    SAVESTATE_HEADER header ;
+    const uint8_t * src = data ;
+    int n ;
+
+    if ( size < sizeof( header ) ) return 0 ;
+
+    memcpy( &header, src, sizeof( header ) ) ;
+    src += sizeof( header ) ;
+
+    if ( header.magic != SAVESTATE_MAGIC ||
+         header.version != SAVESTATE_VERSION ||
+         header.regions != savestate_region_count ||
+         header.regions_size != savestate_regions_size ||
+         size < sizeof( header ) + savestate_regions_size )
+        return 0 ;
+
+    /* Heap first, it refuses states from other sessions */
+    if ( !bgd_malloc_state_load( src + savestate_regions_size, size - sizeof( header ) - savestate_regions_size ) ) return 0 ;
+
+    for ( n = 0; n < savestate_region_count; n++ )
+    {
+        memcpy( savestate_regions[n].ptr, src, savestate_regions[n].size ) ;
+        src += savestate_regions[n].size ;
+    }
+
+    for ( n = 0; n < savestate_load_hook_count; n++ )
+        savestate_load_hooks[n]() ;
+
+    return 1 ;
+}
+
+/* --------------------------------------------------------------------------- */
@@ -46,6 +46,8 @@
 
 #include "files.h"
 #include "xctype.h"
+#include "xstrings.h"
+#include "savestate.h"
 
 /****************************************************************************/
 
@@ -207,6 +209,25 @@ void bennugd_internal_string_init()
     string_bmp_start = 0;
 }
 
+/****************************************************************************/
+/* FUNCTION : string_savestate_register                                     */
+/****************************************************************************/
+/* Registers the string tables for save states. The tables themselves are   */
+/* in the heap, only the pointers and counters live here.                   */
+/****************************************************************************/
+
+void string_savestate_register()
+{
+    savestate_register_ptr( string_mem );
+    savestate_register_var( string_reserved );
+    savestate_register_ptr( string_ptr );
+    savestate_register_ptr( string_uct );
+    savestate_register_ptr( string_bmp );
+    savestate_register_var( string_allocated );
+    savestate_register_var( string_bmp_start );
+    savestate_register_var( string_last_id );
+}
+
 /****************************************************************************/
 /* FUNCTION : string_dump                                                   */
 /****************************************************************************/
@@ -68,6 +68,26 @@ void bgd_malloc_cleanup()
 #define rpcalloc calloc
 #define rprealloc realloc
 #define rpfree free
+
+size_t bgd_malloc_state_size()
+{
+	return 0;
+}
+
+int bgd_malloc_state_save( void * data, size_t size )
+{
+	return false;
+}
+
+int bgd_malloc_state_load( const void * data, size_t size )
+{
+	return false;
+}
+
+int bgd_malloc_owns( const void * p )
+{
+	return false;
+}
 #else
 #define TLS_MODEL
 //#define ENABLE_THREAD_CACHE 0
@@ -78,6 +98,9 @@ void bgd_malloc_cleanup()
 
 _Atomic ptrdiff_t allocation_offset = 0;
 
+static void state_pages_discarded( void * address, size_t size );
+static void state_tracking_stop();
+
 static void* bgd_mmap(size_t size, size_t* offset)
 {
 	// taken from rpmalloc implementation
@@ -132,6 +155,8 @@ static void bgd_unmap(void* address, size_t size, size_t offset, size_t release)
 		size = release;
 	}
 
+	state_pages_discarded(address, size);
+
 #if PLATFORM_WINDOWS
     if (!VirtualFree(address, size, MEM_DECOMMIT))
 	{
@@ -172,7 +197,8 @@ int bgd_malloc_initialize()
     // Later all allocated memory will be served by pages committed in this window.
     // This makes it posible to use 32 bit offset addressing relative to the start of the window.
 #if PLATFORM_WINDOWS
-	allocated_chunk = VirtualAlloc(0, reseved_address_space, MEM_RESERVE, PAGE_READWRITE);
+	// Write watch lets incremental save states find the pages written since the last snapshot
+	allocated_chunk = VirtualAlloc(0, reseved_address_space, MEM_RESERVE | MEM_WRITE_WATCH, PAGE_READWRITE);
 #elif PLATFORM_POSIX
     allocated_chunk = mmap(NULL, reseved_address_space, PROT_NONE, MAP_ANONYMOUS|MAP_PRIVATE|MAP_UNINITIALIZED, 0, 0 );
 #else
@@ -218,6 +244,7 @@ void bgd_malloc_cleanup()
 #endif
 	log_cb(RETRO_LOG_DEBUG, "rpmalloc_finalize\n");
     rpmalloc_finalize();
+	state_tracking_stop();
 #if PLATFORM_WINDOWS
 	if (!VirtualFree(allocated_chunk, 0, MEM_RELEASE))
     {
@@ -234,6 +261,545 @@ void bgd_malloc_cleanup()
 	log_cb(RETRO_LOG_DEBUG, "bgd_malloc_cleanup complete\n");
 }
 
+/* --------------------------------------------------------------------------- */
+/* Save states                                                                 */
+/*                                                                             */
+/* Every allocation lives in the reserved window, so the whole heap can be    */
+/* captured by copying [allocated_chunk, allocated_chunk + allocation_offset) */
+/* together with the few rpmalloc globals that point into it. The blocks are */
+/* restored in place, so all pointers stay valid within the same session.     */
+
+typedef struct
+{
+	void * ptr;
+	size_t size;
+} allocator_state_region;
+
+static const allocator_state_region allocator_state_regions[] =
+{
+	{ (void *)&_memory_heap_id, sizeof( _memory_heap_id ) },
+#if ENABLE_GLOBAL_CACHE
+	{ &_memory_span_cache, sizeof( _memory_span_cache ) },
+#endif
+	{ &_memory_global_reserve, sizeof( _memory_global_reserve ) },
+	{ &_memory_global_reserve_count, sizeof( _memory_global_reserve_count ) },
+	{ &_memory_global_reserve_master, sizeof( _memory_global_reserve_master ) },
+	{ &_memory_heaps, sizeof( _memory_heaps ) },
+	{ &_memory_orphan_heaps, sizeof( _memory_orphan_heaps ) },
+#if RPMALLOC_FIRST_CLASS_HEAPS
+	{ &_memory_first_class_orphan_heaps, sizeof( _memory_first_class_orphan_heaps ) },
+#endif
+	{ NULL, 0 }
+};
+
+typedef struct
+{
+	uint64_t chunk;
+	uint64_t used;
+	uint64_t session;
+	uint64_t generation;
+} allocator_state_header;
+
+// Part of the window already made accessible for the save state copy
+static size_t state_committed_offset = 0;
+
+static int commit_window( size_t offset )
+{
+	if ( offset <= state_committed_offset )
+	{
+		return true;
+	}
+
+#if PLATFORM_WINDOWS
+	if ( !VirtualAlloc( allocated_chunk + state_committed_offset, offset - state_committed_offset, MEM_COMMIT, PAGE_READWRITE ) )
+	{
+		return false;
+	}
+#elif PLATFORM_POSIX
+	// Alignment padding between spans is never touched, but it is still PROT_NONE.
+	// Making it accessible is free until a page is actually written.
+	if ( mprotect( allocated_chunk + state_committed_offset, offset - state_committed_offset, PROT_READ | PROT_WRITE ) )
+	{
+		return false;
+	}
+#endif
+
+	state_committed_offset = offset;
+	return true;
+}
+
+/* --------------------------------------------------------------------------- */
+/* Dirty page tracking                                                         */
+/*                                                                             */
+/* Rewind saves a state every frame, mostly into a buffer that still holds an  */
+/* older snapshot of this session. Every snapshot gets a generation number and */
+/* page_generation keeps, per page, the first snapshot taken after the page    */
+/* was last written. Saving over snapshot N then only has to copy the pages    */
+/* with a generation above N, and loading snapshot N only has to restore them. */
+/* Loads write the heap like anything else, so the snapshots saved before stay */
+/* usable: run-ahead and rewind go back and forth between them every frame.   */
+/* The state keeps its full size, the frontend may drop any of the buffers.   */
+/*                                                                             */
+/* Written pages are reported by the kernel, so writes done by system calls    */
+/* are seen as well:                                                           */
+/*   - Linux 6.7+: asynchronous userfaultfd write protection + PAGEMAP_SCAN    */
+/*   - Windows:    MEM_WRITE_WATCH + GetWriteWatch                             */
+/* Elsewhere every page counts as written and each save is a full copy.        */
+
+#include <time.h>
+
+// Android app seccomp filters of older releases kill the process on userfaultfd
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/userfaultfd.h>
+#include <linux/fs.h>
+
+#if defined(__NR_userfaultfd) && defined(UFFDIO_WRITEPROTECT)
+#define STATE_TRACKING_UFFD 1
+
+// Older kernel headers lack the bits added in Linux 6.7, the ABI is stable
+#ifndef UFFD_USER_MODE_ONLY
+#define UFFD_USER_MODE_ONLY 1
+#endif
+#ifndef UFFD_FEATURE_WP_UNPOPULATED
+#define UFFD_FEATURE_WP_UNPOPULATED ( 1 << 13 )
+#endif
+#ifndef UFFD_FEATURE_WP_ASYNC
+#define UFFD_FEATURE_WP_ASYNC ( 1 << 15 )
+#endif
+#ifndef PAGEMAP_SCAN
+struct page_region
+{
+	uint64_t start;
+	uint64_t end;
+	uint64_t categories;
+};
+
+struct pm_scan_arg
+{
+	uint64_t size;
+	uint64_t flags;
+	uint64_t start;
+	uint64_t end;
+	uint64_t walk_end;
+	uint64_t vec;
+	uint64_t vec_len;
+	uint64_t max_pages;
+	uint64_t category_inverted;
+	uint64_t category_mask;
+	uint64_t category_anyof_mask;
+	uint64_t return_mask;
+};
+
+#define PM_SCAN_WP_MATCHING     ( 1 << 0 )
+#define PM_SCAN_CHECK_WPASYNC   ( 1 << 1 )
+#define PAGE_IS_WRITTEN         ( 1 << 1 )
+#define PAGEMAP_SCAN            _IOWR( 'f', 16, struct pm_scan_arg )
+#endif
+
+static int tracking_uffd = -1;
+static int tracking_pagemap = -1;
+#endif
+#endif
+
+#define STATE_SCAN_REGIONS  256
+
+static int      state_tracking = false;     // tracking started with the first save
+static int      state_tracking_pages = false; // written pages are reported by the system
+static uint64_t state_session = 0;
+static uint64_t state_generation = 0;       // last snapshot taken
+static uint64_t state_base_generation = 0;  // older snapshots don't match the heap anymore
+
+static uint64_t * page_generation = NULL;
+static size_t   page_generation_count = 0;  // pages covered by page_generation
+static size_t   tracked_offset = 0;         // part of the window watched for writes
+
+static void mark_pages( size_t first, size_t last, uint64_t generation )
+{
+	for ( size_t i = first; i < last; i++ )
+	{
+		page_generation[i] = generation;
+	}
+}
+
+static void mark_range( uintptr_t start, uintptr_t end, uint64_t generation )
+{
+	size_t first = ( start - (uintptr_t)allocated_chunk ) / _memory_page_size;
+	size_t last = ( end - (uintptr_t)allocated_chunk + _memory_page_size - 1 ) / _memory_page_size;
+
+	if ( last > page_generation_count )
+	{
+		last = page_generation_count;
+	}
+
+	mark_pages( first, last, generation );
+}
+
+static int state_tracking_start()
+{
+#if STATE_TRACKING_UFFD
+	struct uffdio_api api = { .api = UFFD_API, .features = UFFD_FEATURE_WP_ASYNC | UFFD_FEATURE_WP_UNPOPULATED };
+	struct uffdio_register reg = { .range = { (uintptr_t)allocated_chunk, reseved_address_space }, .mode = UFFDIO_REGISTER_MODE_WP };
+
+	tracking_uffd = syscall( __NR_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY );
+	if ( tracking_uffd >= 0 && !ioctl( tracking_uffd, UFFDIO_API, &api ) && !ioctl( tracking_uffd, UFFDIO_REGISTER, &reg ) )
+	{
+		tracking_pagemap = open( "/proc/self/pagemap", O_RDONLY | O_CLOEXEC );
+		if ( tracking_pagemap >= 0 )
+		{
+			return true;
+		}
+	}
+
+	log_cb( RETRO_LOG_INFO, "state_tracking_start: write tracking not available (%s), rewind will copy the whole heap\n", strerror( errno ) );
+	if ( tracking_uffd >= 0 )
+	{
+		close( tracking_uffd );
+		tracking_uffd = -1;
+	}
+	return false;
+#elif PLATFORM_WINDOWS
+	// Fails if the window was reserved without MEM_WRITE_WATCH
+	return ResetWriteWatch( allocated_chunk, reseved_address_space ) == 0;
+#else
+	return false;
+#endif
+}
+
+static void state_tracking_stop()
+{
+#if STATE_TRACKING_UFFD
+	if ( tracking_pagemap >= 0 )
+	{
+		close( tracking_pagemap );
+		tracking_pagemap = -1;
+	}
+	if ( tracking_uffd >= 0 )
+	{
+		close( tracking_uffd );
+		tracking_uffd = -1;
+	}
+#endif
+
+	free( page_generation );
+	page_generation = NULL;
+	page_generation_count = 0;
+	tracked_offset = 0;
+	state_tracking = false;
+	state_tracking_pages = false;
+	state_committed_offset = 0;
+}
+
+// Stamps the pages written since the last snapshot with the new generation
+static int collect_written_pages( uint64_t generation )
+{
+	if ( !tracked_offset )
+	{
+		return true;
+	}
+
+#if STATE_TRACKING_UFFD
+	struct page_region regions[STATE_SCAN_REGIONS];
+	struct pm_scan_arg arg =
+	{
+		.size = sizeof( arg ),
+		.flags = PM_SCAN_WP_MATCHING | PM_SCAN_CHECK_WPASYNC,
+		.start = (uintptr_t)allocated_chunk,
+		.end = (uintptr_t)allocated_chunk + tracked_offset,
+		.vec = (uintptr_t)regions,
+		.vec_len = STATE_SCAN_REGIONS,
+		.category_mask = PAGE_IS_WRITTEN,
+		.return_mask = PAGE_IS_WRITTEN,
+	};
+
+	while ( arg.start < arg.end )
+	{
+		long n = ioctl( tracking_pagemap, PAGEMAP_SCAN, &arg );
+		if ( n < 0 )
+		{
+			return false;
+		}
+
+		for ( long i = 0; i < n; i++ )
+		{
+			mark_range( regions[i].start, regions[i].end, generation );
+		}
+
+		arg.start = arg.walk_end;
+	}
+	return true;
+#elif PLATFORM_WINDOWS
+	void * pages[STATE_SCAN_REGIONS];
+	ULONG_PTR count;
+	DWORD granularity;
+
+	do
+	{
+		count = STATE_SCAN_REGIONS;
+		if ( GetWriteWatch( WRITE_WATCH_FLAG_RESET, allocated_chunk, tracked_offset, pages, &count, &granularity ) )
+		{
+			return false;
+		}
+
+		for ( ULONG_PTR i = 0; i < count; i++ )
+		{
+			mark_range( (uintptr_t)pages[i], (uintptr_t)pages[i] + granularity, generation );
+		}
+	}
+	while ( count == STATE_SCAN_REGIONS );
+	return true;
+#else
+	return false;
+#endif
+}
+
+// Starts watching pages mapped since the last snapshot
+static int watch_new_pages( size_t offset )
+{
+#if STATE_TRACKING_UFFD
+	struct uffdio_writeprotect wp = { .range = { (uintptr_t)allocated_chunk + tracked_offset, offset - tracked_offset }, .mode = UFFDIO_WRITEPROTECT_MODE_WP };
+	if ( ioctl( tracking_uffd, UFFDIO_WRITEPROTECT, &wp ) )
+	{
+		return false;
+	}
+#endif
+	// Write watch covers the whole reservation already, the new pages get reset on the next scan
+	tracked_offset = offset;
+	return true;
+}
+
+// Advances the generation and updates page_generation for a snapshot of [0, used)
+static uint64_t state_snapshot( size_t used )
+{
+	const uint64_t generation = ++state_generation;
+	const size_t pages = ( used + _memory_page_size - 1 ) / _memory_page_size;
+
+	if ( !state_tracking )
+	{
+		state_tracking = true;
+		state_tracking_pages = state_tracking_start();
+		state_session = ( (uint64_t)time( NULL ) << 32 ) ^ (uint64_t)(uintptr_t)&generation ^ (uint64_t)(uintptr_t)allocated_chunk;
+		state_base_generation = generation;
+	}
+
+	if ( pages > page_generation_count )
+	{
+		uint64_t * grown = realloc( page_generation, pages * sizeof( *page_generation ) );
+		if ( !grown )
+		{
+			// Without a page table no buffer can be trusted anymore
+			state_base_generation = generation + 1;
+			return generation;
+		}
+		page_generation = grown;
+		mark_pages( page_generation_count, pages, generation );
+		page_generation_count = pages;
+	}
+
+	if ( !state_tracking_pages )
+	{
+		mark_pages( 0, pages, generation );
+		return generation;
+	}
+
+	if ( !collect_written_pages( generation ) || ( used > tracked_offset && !watch_new_pages( used ) ) )
+	{
+		log_cb( RETRO_LOG_WARN, "state_snapshot: write tracking failed, rewind will copy the whole heap\n" );
+		state_tracking_pages = false;
+		mark_pages( 0, pages, generation );
+	}
+
+	return generation;
+}
+
+static void state_pages_discarded( void * address, size_t size )
+{
+	// Discarded pages read back as zero without being written, they belong to the next snapshot
+	if ( page_generation )
+	{
+		mark_range( (uintptr_t)address, (uintptr_t)address + size, state_generation + 1 );
+	}
+}
+
+static size_t allocator_state_globals_size()
+{
+	size_t size = 0;
+	for ( const allocator_state_region * r = allocator_state_regions; r->ptr; r++ )
+	{
+		size += r->size;
+	}
+	return size;
+}
+
+size_t bgd_malloc_state_size()
+{
+	if ( !allocated_chunk )
+	{
+		return 0;
+	}
+
+	return sizeof( allocator_state_header ) + allocator_state_globals_size() + (size_t)atomic_load( &allocation_offset );
+}
+
+int bgd_malloc_state_save( void * data, size_t size )
+{
+	allocator_state_header header = { (uint64_t)(uintptr_t)allocated_chunk, (uint64_t)atomic_load( &allocation_offset ) };
+	allocator_state_header previous = { 0 };
+	uint8_t * dst = data;
+
+	if ( !allocated_chunk || size < sizeof( header ) + allocator_state_globals_size() + header.used )
+	{
+		return false;
+	}
+
+	if ( !commit_window( header.used ) )
+	{
+		log_cb( RETRO_LOG_ERROR, "bgd_malloc_state_save: failed to access heap window\n" );
+		return false;
+	}
+
+	// The buffer may still hold one of our snapshots, then only newer pages need a copy
+	memcpy( &previous, dst, sizeof( previous ) );
+
+	header.generation = state_snapshot( header.used );
+	header.session = state_session;
+
+	memcpy( dst, &header, sizeof( header ) );
+	dst += sizeof( header );
+
+	for ( const allocator_state_region * r = allocator_state_regions; r->ptr; r++ )
+	{
+		memcpy( dst, r->ptr, r->size );
+		dst += r->size;
+	}
+
+	if ( previous.chunk != header.chunk || previous.session != header.session ||
+	     previous.generation < state_base_generation || previous.generation >= header.generation ||
+	     previous.used > header.used )
+	{
+		memcpy( dst, allocated_chunk, header.used );
+		return true;
+	}
+
+	// Copy runs of pages written after the previous snapshot, and everything mapped since
+	const size_t pages = previous.used / _memory_page_size;
+	size_t i = 0;
+
+	while ( i < pages )
+	{
+		if ( page_generation[i] <= previous.generation )
+		{
+			i++;
+			continue;
+		}
+
+		size_t first = i;
+		while ( i < pages && page_generation[i] > previous.generation )
+		{
+			i++;
+		}
+
+		memcpy( dst + first * _memory_page_size, allocated_chunk + first * _memory_page_size, ( i - first ) * _memory_page_size );
+	}
+
+	memcpy( dst + pages * _memory_page_size, allocated_chunk + pages * _memory_page_size, header.used - pages * _memory_page_size );
+	return true;
+}
+
+int bgd_malloc_state_load( const void * data, size_t size )
+{
+	allocator_state_header header;
+	const uint8_t * src = data;
+
+	if ( !allocated_chunk || size < sizeof( header ) )
+	{
+		return false;
+	}
+
+	memcpy( &header, src, sizeof( header ) );
+	src += sizeof( header );
+
+	// Pointers inside the heap are absolute, the state is only valid for this window
+	if ( header.chunk != (uint64_t)(uintptr_t)allocated_chunk || header.used > reseved_address_space )
+	{
+		log_cb( RETRO_LOG_WARN, "bgd_malloc_state_load: state belongs to a different session\n" );
+		return false;
+	}
+
+	if ( size < sizeof( header ) + allocator_state_globals_size() + header.used )
+	{
+		return false;
+	}
+
+	if ( !commit_window( header.used ) )
+	{
+		log_cb( RETRO_LOG_ERROR, "bgd_malloc_state_load: failed to access heap window\n" );
+		return false;
+	}
+
+	for ( const allocator_state_region * r = allocator_state_regions; r->ptr; r++ )
+	{
+		memcpy( r->ptr, src, r->size );
+		src += r->size;
+	}
+
+	const size_t used = (size_t)atomic_load( &allocation_offset );
+	const size_t pages = ( header.used + _memory_page_size - 1 ) / _memory_page_size;
+	uint64_t generation = 0;
+
+	// Spans mapped after the snapshot are simply forgotten, bgd_mmap will hand them out again
+	atomic_store( &allocation_offset, (ptrdiff_t)header.used );
+
+	// A snapshot of this session: stamp what was written since the last one, then the pages newer than it are the ones to restore
+	if ( state_tracking && header.session == state_session && header.generation >= state_base_generation && header.generation <= state_generation )
+	{
+		generation = state_snapshot( used > header.used ? used : header.used );
+	}
+
+	if ( !generation || header.generation < state_base_generation || pages > page_generation_count )
+	{
+		memcpy( allocated_chunk, src, header.used );
+
+		// The heap went back in time, none of the snapshots saved so far can be patched anymore
+		state_base_generation = state_generation + 1;
+		return true;
+	}
+
+	const size_t kept = ( used < header.used ? used : header.used ) / _memory_page_size;
+	size_t i = 0;
+
+	while ( i < kept )
+	{
+		if ( page_generation[i] <= header.generation )
+		{
+			i++;
+			continue;
+		}
+
+		size_t first = i;
+		while ( i < kept && page_generation[i] > header.generation )
+		{
+			i++;
+		}
+
+		memcpy( allocated_chunk + first * _memory_page_size, src + first * _memory_page_size, ( i - first ) * _memory_page_size );
+		mark_pages( first, i, generation );
+	}
+
+	// Pages forgotten by an earlier load and the partial last page are copied whole
+	memcpy( allocated_chunk + kept * _memory_page_size, src + kept * _memory_page_size, header.used - kept * _memory_page_size );
+	mark_pages( kept, pages, generation );
+	return true;
+}
+
+// True if p points inside the part of the window handed out so far, the one a state captures
+int bgd_malloc_owns( const void * p )
+{
+	return allocated_chunk && (const uint8_t*)p >= allocated_chunk && (const uint8_t*)p < allocated_chunk + atomic_load( &allocation_offset );
+}
+
 #endif // !NO_RPMALLOC
 
 void* bgd_malloc( size_t size )
@@ -191,6 +191,19 @@ struct
 }
 mnemonics_sorted[256];
 
+/* ---------------------------------------------------------------------- */
+/* Name of a mnemonic without its data type, NULL if unknown              */
+
+char * mnemonic_name( int i )
+{
+    int n ;
+
+    for ( n = 0 ; mnemonics[n].name ; n++ )
+        if ( mnemonics[n].code == ( i & MN_MASK ) ) return mnemonics[n].name ;
+
+    return NULL ;
+}
+
 /* ---------------------------------------------------------------------- */
 
 void mnemonic_dump( int i, int param )
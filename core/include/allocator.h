@@ -16,6 +16,11 @@ extern char* bgd_strdup(const char* s);
 extern int bgd_malloc_initialize();
 extern void bgd_malloc_cleanup();
 
+extern size_t bgd_malloc_state_size();
+extern int bgd_malloc_state_save( void * data, size_t size );
+extern int bgd_malloc_state_load( const void * data, size_t size );
+extern int bgd_malloc_owns( const void * p );
+
 extern uint8_t* allocated_chunk;
 
 static inline void* ptr_from_int(uint32_t input)
@@ -78,6 +83,26 @@ static inline void bgd_malloc_cleanup()
 
 }
 
+static inline size_t bgd_malloc_state_size()
+{
+    return 0;
+}
+
+static inline int bgd_malloc_state_save( void * data, size_t size )
+{
+    return 0;
+}
+
+static inline int bgd_malloc_state_load( const void * data, size_t size )
+{
+    return 0;
+}
+
+static inline int bgd_malloc_owns( const void * p )
+{
+    return 0;
+}
+
 static inline void* ptr_from_int(uint32_t input)
 {
     return (void*)input;
@@ -151,15 +151,23 @@ extern DLSYSFUNCS mod_wm_functions_exports[];
  
 /* ---------- module_initialize ---------- */
  
+extern void libblit_module_initialize();
 extern void libfont_module_initialize();
 extern void libgrbase_module_initialize();
 extern void libjoy_module_initialize();
 extern void libkey_module_initialize();
 extern void libmouse_module_initialize();
+extern void librender_module_initialize();
+extern void libscroll_module_initialize();
 extern void libsdlhandler_module_initialize();
+extern void libtext_module_initialize();
 extern void libvideo_module_initialize();
 extern void mod_cd_module_initialize();
 extern void mod_debug_module_initialize();
+extern void mod_draw_module_initialize();
+extern void mod_grproc_module_initialize();
+extern void mod_m7_module_initialize();
+extern void mod_path_module_initialize();
 extern void mod_sound_module_initialize();
 extern void mod_time_module_initialize();
  
@@ -167,6 +175,7 @@ extern void mod_time_module_initialize();
  
 extern void libjoy_module_finalize();
 extern void libkey_module_finalize();
+extern void librender_module_finalize();
 extern void libsdlhandler_module_finalize();
 extern void libvideo_module_finalize();
 extern void mod_cd_module_finalize();
@@ -176,6 +185,7 @@ extern void mod_time_module_finalize();
 /* ---------- instance_create_hook ---------- */
  
 extern void librender_instance_create_hook( INSTANCE * );
+extern void mod_grproc_instance_create_hook( INSTANCE * );
  
 /* ---------- instance_destroy_hook ---------- */
  
@@ -201,6 +211,7 @@ extern HOOK librender_handler_hooks[];
 extern HOOK libsdlhandler_handler_hooks[];
 extern HOOK libwm_handler_hooks[];
 extern HOOK mod_debug_handler_hooks[];
+extern HOOK mod_grproc_handler_hooks[];
 extern HOOK mod_timers_handler_hooks[];
  
 /* ---------- modules_dependency ---------- */
@@ -341,7 +352,7 @@ void fake_dl_init()
     __fake_dl[1].process_exec_hook            = NULL;
     __fake_dl[1].handler_hooks                = NULL;
 #else
-    __fake_dl[1].module_initialize            = NULL;
+    __fake_dl[1].module_initialize            = libblit_module_initialize;
     __fake_dl[1].module_finalize              = NULL;
     __fake_dl[1].instance_create_hook         = NULL;
     __fake_dl[1].instance_destroy_hook        = NULL;
@@ -628,8 +639,8 @@ void fake_dl_init()
     __fake_dl[8].process_exec_hook            = NULL;
     __fake_dl[8].handler_hooks                = NULL;
 #else
-    __fake_dl[8].module_initialize            = NULL;
-    __fake_dl[8].module_finalize              = NULL;
+    __fake_dl[8].module_initialize            = librender_module_initialize;
+    __fake_dl[8].module_finalize              = librender_module_finalize;
     __fake_dl[8].instance_create_hook         = librender_instance_create_hook;
     __fake_dl[8].instance_destroy_hook        = librender_instance_destroy_hook;
     __fake_dl[8].instance_pre_execute_hook    = NULL;
@@ -669,7 +680,7 @@ void fake_dl_init()
     __fake_dl[9].process_exec_hook            = NULL;
     __fake_dl[9].handler_hooks                = NULL;
 #else
-    __fake_dl[9].module_initialize            = NULL;
+    __fake_dl[9].module_initialize            = libscroll_module_initialize;
     __fake_dl[9].module_finalize              = NULL;
     __fake_dl[9].instance_create_hook         = NULL;
     __fake_dl[9].instance_destroy_hook        = NULL;
@@ -751,7 +762,7 @@ void fake_dl_init()
     __fake_dl[11].process_exec_hook            = NULL;
     __fake_dl[11].handler_hooks                = NULL;
 #else
-    __fake_dl[11].module_initialize            = NULL;
+    __fake_dl[11].module_initialize            = libtext_module_initialize;
     __fake_dl[11].module_finalize              = NULL;
     __fake_dl[11].instance_create_hook         = NULL;
     __fake_dl[11].instance_destroy_hook        = NULL;
@@ -1079,7 +1090,7 @@ void fake_dl_init()
     __fake_dl[19].process_exec_hook            = NULL;
     __fake_dl[19].handler_hooks                = NULL;
 #else
-    __fake_dl[19].module_initialize            = NULL;
+    __fake_dl[19].module_initialize            = mod_draw_module_initialize;
     __fake_dl[19].module_finalize              = NULL;
     __fake_dl[19].instance_create_hook         = NULL;
     __fake_dl[19].instance_destroy_hook        = NULL;
@@ -1243,14 +1254,14 @@ void fake_dl_init()
     __fake_dl[23].process_exec_hook            = NULL;
     __fake_dl[23].handler_hooks                = NULL;
 #else
-    __fake_dl[23].module_initialize            = NULL;
+    __fake_dl[23].module_initialize            = mod_grproc_module_initialize;
     __fake_dl[23].module_finalize              = NULL;
-    __fake_dl[23].instance_create_hook         = NULL;
+    __fake_dl[23].instance_create_hook         = mod_grproc_instance_create_hook;
     __fake_dl[23].instance_destroy_hook        = NULL;
     __fake_dl[23].instance_pre_execute_hook    = NULL;
     __fake_dl[23].instance_pos_execute_hook    = NULL;
     __fake_dl[23].process_exec_hook            = mod_grproc_process_exec_hook;
-    __fake_dl[23].handler_hooks                = NULL;
+    __fake_dl[23].handler_hooks                = mod_grproc_handler_hooks;
 #endif
     __fake_dl[23].modules_dependency           = mod_grproc_modules_dependency;
     __fake_dl[23].module_config                = NULL;
@@ -1366,7 +1377,7 @@ void fake_dl_init()
     __fake_dl[26].process_exec_hook            = NULL;
     __fake_dl[26].handler_hooks                = NULL;
 #else
-    __fake_dl[26].module_initialize            = NULL;
+    __fake_dl[26].module_initialize            = mod_m7_module_initialize;
     __fake_dl[26].module_finalize              = NULL;
     __fake_dl[26].instance_create_hook         = NULL;
     __fake_dl[26].instance_destroy_hook        = NULL;
@@ -1612,7 +1623,7 @@ void fake_dl_init()
     __fake_dl[32].process_exec_hook            = NULL;
     __fake_dl[32].handler_hooks                = NULL;
 #else
-    __fake_dl[32].module_initialize            = NULL;
+    __fake_dl[32].module_initialize            = mod_path_module_initialize;
     __fake_dl[32].module_finalize              = NULL;
     __fake_dl[32].instance_create_hook         = NULL;
     __fake_dl[32].instance_destroy_hook        = NULL;
@@ -48,6 +48,10 @@
 
 typedef long int fixed ;
 
+/* Fixed point values are scaled by FIXED_PREC, fixtoi truncates towards 0 */
+
+#define FIXED_PREC      10000
+
 extern fixed ftofix( float x );
 extern float fixtof( fixed x );
 extern fixed itofix( int x );
@@ -40,6 +40,7 @@ extern int        procdef_count;
 
 extern PROCDEF  * procdef_get( int n );
 extern PROCDEF  * procdef_get_by_name(char * name );
+extern void       procdef_predecode( PROCDEF * proc );
 extern SYSPROC  * sysproc_get( int code );
 extern int        sysproc_add( char * name, char * paramtypes, int type, void * func );
 extern void       sysproc_init();
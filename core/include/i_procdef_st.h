@@ -39,6 +39,7 @@ typedef struct _procdef
 	int * pubdata ;
 
 	int * code ;
+	void ** threaded ;     /* Handler per code word, NULL if the switch is used */
 
 	int exitcode ;
 	int errorcode ;
@@ -61,6 +62,13 @@ typedef struct _procdef
 	char * name ;
 
     int breakpoint;
+
+	/* Instance pool: blocks with the INSTANCE, its data and its stack */
+	int pool_block_size ;
+	void * pool_next ;          /* Unused space of the last slab */
+	void * pool_end ;
+	void * pool_free_first ;    /* Freed blocks, reused oldest first */
+	void * pool_free_last ;
 }
 PROCDEF ;
 
@@ -64,8 +64,14 @@ extern int          instance_exists( INSTANCE * i ) ;
 
 extern INSTANCE     * instance_next_by_priority();
 extern void         instance_dirty( INSTANCE * i ) ;
+extern void         instance_status_changed( INSTANCE * i ) ;
+extern void         instance_touch( INSTANCE * i ) ;
+extern void         instance_sync_locals( INSTANCE * i ) ;
 
 extern void         instance_reset_iterator_by_priority() ;
+extern void         instance_end_frame() ;
+
+extern void         instance_savestate_register() ;
 
 /* Las siguientes funciones son el punto de entrada del intérprete */
 
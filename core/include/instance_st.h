@@ -65,12 +65,20 @@ typedef struct _instance
     struct _instance * next ;
     struct _instance * prev ;
 
-    /* Linked list by priority */
+    /* Scheduler: run, pending or parked list and position in it */
 
-    struct _instance * next_by_priority ;
-    struct _instance * prev_by_priority ;
+    int sched_list ;
+    int sched_index ;
+    unsigned int sched_seq ;
     int last_priority ;
 
+    /* Frame SAVED_STATUS was written in, position plus one in the lists
+       of instances to move or read again (0 if not there) */
+
+    unsigned int sched_saved ;
+    int sched_dirty ;
+    int sched_touched ;
+
     /* Linked list by process_type */
 
     struct _instance * next_by_type ;
@@ -0,0 +1,78 @@
+/*
+ *  Copyright © 2006-2019 SplinterGU (Fenix/Bennugd)
+ *  Copyright © 2002-2006 Fenix Team (Fenix)
+ *  Copyright © 1999-2002 José Luis Cebrián Pagüe (Fenix)
+ *
+ *  This file is part of Bennu - Game Development
+ *
+ *  This software is provided 'as-is', without any express or implied
+ *  warranty. In no event will the authors be held liable for any damages
+ *  arising from the use of this software.
+ *
+ *  Permission is granted to anyone to use this software for any purpose,
+ *  including commercial applications, and to alter it and redistribute it
+ *  freely, subject to the following restrictions:
+ *
+ *     1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *     2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *     3. This notice may not be removed or altered from any source
+ *     distribution.
+ *
+ */
+
+#ifndef __PROFILER_H
+#define __PROFILER_H
+
+/* --------------------------------------------------------------------------- */
+/* Interpreter profiler                                                        */
+/*                                                                             */
+/* Only built with the INTERPRETER_PROFILER option, otherwise every PROFILER_ */
+/* macro expands to nothing. Counts executed mnemonics and the self time of   */
+/* every process and system function. On exit a flat report is written and,  */
+/* in trace mode, a Chrome trace (chrome://tracing, Perfetto) as well.        */
+/* --------------------------------------------------------------------------- */
+
+#define PROFILER_OFF        0
+#define PROFILER_REPORT     1
+#define PROFILER_TRACE      2
+
+#ifdef INTERPRETER_PROFILER
+
+#include <stdint.h>
+
+#include "i_procdef_st.h"
+
+extern int      profiler_mode ;
+extern uint64_t profiler_opcodes[] ;
+
+extern void     profiler_set_mode( int mode ) ;
+extern void     profiler_set_output( const char * basename ) ;
+extern void     profiler_savestate_register() ;
+extern void     profiler_enter_proc( PROCDEF * proc ) ;
+extern void     profiler_enter_sysproc( SYSPROC * p ) ;
+extern void     profiler_leave() ;
+extern void     profiler_dump() ;
+
+#define PROFILER_OPCODE(op)         if ( profiler_mode ) profiler_opcodes[ ( op ) & 0x0FFF ]++
+#define PROFILER_ENTER_PROC(proc)   profiler_enter_proc( proc )
+#define PROFILER_ENTER_SYSPROC(p)   profiler_enter_sysproc( p )
+#define PROFILER_LEAVE()            profiler_leave()
+
+#else
+
+#define PROFILER_OPCODE(op)
+#define PROFILER_ENTER_PROC(proc)
+#define PROFILER_ENTER_SYSPROC(p)
+#define PROFILER_LEAVE()
+
+#endif
+
+/* --------------------------------------------------------------------------- */
+
+#endif
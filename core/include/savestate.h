@@ -0,0 +1,82 @@
+/*
+ *  Copyright © 2006-2019 SplinterGU (Fenix/Bennugd)
+ *  Copyright © 2002-2006 Fenix Team (Fenix)
+ *  Copyright © 1999-2002 José Luis Cebrián Pagüe (Fenix)
+ *
+ *  This file is part of Bennu - Game Development
+ *
+ *  This software is provided 'as-is', without any express or implied
+ *  warranty. In no event will the authors be held liable for any damages
+ *  arising from the use of this software.
+ *
+ *  Permission is granted to anyone to use this software for any purpose,
+ *  including commercial applications, and to alter it and redistribute it
+ *  freely, subject to the following restrictions:
+ *
+ *     1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *     2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *     3. This notice may not be removed or altered from any source
+ *     distribution.
+ *
+ */
+
+#ifndef __SAVESTATE_H
+#define __SAVESTATE_H
+
+#include <stddef.h>
+
+#include "sysprocs_st.h"
+
+/* --------------------------------------------------------------------------- */
+/* Save states                                                                 */
+/*                                                                             */
+/* A state is the whole allocator heap plus every global registered here.      */
+/* Globals that point into the heap (list heads, counters, tables) must be     */
+/* registered by their owner, otherwise they get out of sync with the heap     */
+/* after a load. States are only valid within the running session.             */
+/*                                                                             */
+/* Every buffer a global points to must come from bgd_malloc, memory from libc */
+/* or SDL is not in the state. Pointers registered with savestate_register_ptr */
+/* or savestate_check_field are checked on save in debug builds: NULL, inside  */
+/* the heap or inside a registered global.                                     */
+/*                                                                             */
+/* Not saved on purpose, rebuilt after a load:                                 */
+/*  - the screen and scaler surfaces (SDL), redrawn whole (librender hook)     */
+/*  - the Mode 7 line tables (mod_m7 hook)                                     */
+/*  - the palette conversion and transparency tables (libgrbase hook)          */
+/*  - the start time of the profiled calls in progress (profiler hook)         */
+/*  - the bitmap serial counter. Serials never repeat, so the collision masks  */
+/*    and scroll caches keyed by them can't match a stale graph                */
+/*                                                                             */
+/* Buffers made at startup and never replaced (cos table, opcode handlers)     */
+/* need no registering. The profiler output stays out of the heap, it          */
+/* describes the run, not the game.                                            */
+/* --------------------------------------------------------------------------- */
+
+extern void   savestate_init() ;
+extern void   savestate_register( void * ptr, size_t size ) ;
+extern void   savestate_register_pointers( void * ptr, size_t size ) ;
+extern void   savestate_check_pointers( void * first, int count, size_t stride ) ;
+extern void   savestate_add_load_hook( FN_HOOK hook ) ;
+
+extern size_t savestate_size() ;
+extern int    savestate_save( void * data, size_t size ) ;
+extern int    savestate_load( const void * data, size_t size ) ;
+
+#define savestate_register_var(v)   savestate_register( &(v), sizeof( v ) )
+
+/* A pointer or an array of pointers */
+#define savestate_register_ptr(v)   savestate_register_pointers( &(v), sizeof( v ) )
+
+/* A pointer field of every item of a registered array */
+#define savestate_check_field(a,f)  savestate_check_pointers( &(a)[0].f, sizeof( a ) / sizeof( (a)[0] ), sizeof( (a)[0] ) )
+
+/* --------------------------------------------------------------------------- */
+
+#endif
@@ -69,4 +69,6 @@ extern int          string_pad( int code, int length, int align ) ;
 extern int          string_format( double number, int dec, char point, char thousands ) ;
 extern int          string_concat( int code1, char * str2 ) ;
 
+extern void         string_savestate_register() ;
+
 #endif
@@ -12,6 +12,8 @@
 #include <math.h>
 #include <string/stdstring.h>
 #include <bgd_version.h>
+#include <savestate.h>
+#include <profiler.h>
 
 static struct retro_vfs_interface_info retro_vfs_interface_info = { 3, NULL};
 
@@ -77,6 +79,7 @@ char* libretro_base_dir;
 bool retro_enable_frame_limiter=true;
 bool force_frame_limiter=false;
 bool case_insensitive_file_io=true;
+int libretro_render_threads=1;
 
 typedef enum enum_libretro_scale_mode_override
 {
@@ -85,7 +88,10 @@ typedef enum enum_libretro_scale_mode_override
     libretro_scale_mode_override_2x,
     libretro_scale_mode_override_2xhq,
     libretro_scale_mode_override_2xscanlines,
-    libretro_scale_mode_override_2xunfiltered
+    libretro_scale_mode_override_2xunfiltered,
+    libretro_scale_mode_override_3x,
+    libretro_scale_mode_override_3xsmooth,
+    libretro_scale_mode_override_2xhq_twice
 } enum_libretro_scale_mode_override_t;
 
 enum_libretro_scale_mode_override_t scale_override = libretro_scale_mode_override_off;
@@ -96,15 +102,70 @@ static bool bgd_finished = false;
 static bool game_unloading = false;
 extern int fps_value;
 
-void suspend_bgd()
+// Save states
+// The bgd thread is always suspended in suspend_bgd() when the frontend asks for a state.
+// Its stack from there up to run_bennugd() is stored with the heap. Registers are not part
+// of the stack, so a resume context taken right before suspending restores the callee saved
+// registers of the whole call chain after a load.
+#if defined(__GNUC__) && SIZE_MAX > UINT32_MAX
+#define BGD_SAVESTATES 1
+#else
+#define BGD_SAVESTATES 0
+#endif
+
+#define BGD_STATE_MAGIC         0x54535242 // "BRST"
+#define BGD_STATE_STACK_MARGIN  1024
+#define BGD_STATE_SIZE_ALIGN    (1024*1024)
+
+typedef struct bgd_state_header
 {
+    uint32_t magic;
+    uint32_t stack_size;
+    uint64_t stack_bottom;
+} bgd_state_header_t;
+
+static uint8_t* bgd_stack_top = NULL;
+static uint8_t* bgd_stack_bottom = NULL;
+static void* bgd_resume_context[5];
+static bool bgd_resume_pending = false;
+
+#if BGD_SAVESTATES
+static void __attribute__((noinline)) resume_bgd_from_state()
+{
+    __builtin_longjmp(bgd_resume_context, 1);
+}
+#endif
+
+void __attribute__((noinline)) suspend_bgd()
+{
+#if BGD_SAVESTATES
+    volatile uint8_t marker = 0;
+
+    if (__builtin_setjmp(bgd_resume_context))
+    {
+        // Resumed on a loaded state
+        return;
+    }
+
+    bgd_stack_bottom = (uint8_t*)&marker - BGD_STATE_STACK_MARGIN;
+    co_switch(main_thread);
+
+    if (bgd_resume_pending)
+    {
+        bgd_resume_pending = false;
+        resume_bgd_from_state();
+    }
+#else
     co_switch(main_thread);
+#endif
 }
 
 void request_exit_bgd()
 {
     if (!game_unloading)
     {
+        // Not a resumable point for save states
+        bgd_stack_bottom = NULL;
         environ_cb(RETRO_ENVIRONMENT_SHUTDOWN, NULL);
         co_switch(main_thread);
     }
@@ -147,6 +208,12 @@ const char* override_scaling_2x_optval = "2x";
 const char* override_scaling_2xhq_optval = "2xhq";
 const char* override_scaling_2xscanlines_optval = "2xscanlines";
 const char* override_scaling_2xunfiltered_optval = "2xunfiltered";
+const char* override_scaling_3x_optval = "3x";
+const char* override_scaling_3xsmooth_optval = "3xsmooth";
+const char* override_scaling_2xhq_twice_optval = "2xhq_twice";
+
+const char * render_threads_opt = BGD_CORE_OPTION("render_threads");
+const char * render_threads_off_optval = "off";
 
 const char * mouse_emulation_opt = BGD_CORE_OPTION("mouse_emulation");
 const char * mouse_emulation_off_optval = "off";
@@ -156,6 +223,13 @@ const char * mouse_emulation_right_analog_optval = "right analog";
 const char * mouse_emulation_dead_zone_opt = BGD_CORE_OPTION("mouse_emulation_dead_zone");
 const char * mouse_emulation_scaling_opt = BGD_CORE_OPTION("mouse_emulation_scale");
 
+#ifdef INTERPRETER_PROFILER
+const char * profiler_opt = BGD_CORE_OPTION("profiler");
+const char * profiler_off_optval = "off";
+const char * profiler_report_optval = "report";
+const char * profiler_trace_optval = "trace";
+#endif
+
 
 
 static mouse_button_mapping_t mouse_button_mappings[]=
@@ -291,6 +365,26 @@ static void set_core_options()
                 { override_scaling_2xhq_optval, "2X HQ"},
                 { override_scaling_2xscanlines_optval, "2X Scanlines"},
                 { override_scaling_2xunfiltered_optval, "2X Unfiltered"},
+                { override_scaling_3x_optval, "3X"},
+                { override_scaling_3xsmooth_optval, "3X Smooth (blended Scale3x)"},
+                { override_scaling_2xhq_twice_optval, "4X (2X HQ twice)"},
+                { NULL, NULL}
+            }
+        },
+        {
+            .key =  render_threads_opt,
+            .desc= "Render threads",
+            .info = "Draw sprites using several threads, each one drawing a horizontal band of the screen.\n"
+                    "Other objects, like scrolls and texts, are still drawn by the main thread.\n"
+            ,
+            .default_value = "off",
+            .values = {
+                { render_threads_off_optval, "Off"},
+                { "2", "2"},
+                { "3", "3"},
+                { "4", "4"},
+                { "6", "6"},
+                { "8", "8"},
                 { NULL, NULL}
             }
         },
@@ -335,6 +429,20 @@ static void set_core_options()
         get_mouse_button_mapping(4),
         get_mouse_button_mapping(5),
         get_mouse_button_mapping(6),
+#ifdef INTERPRETER_PROFILER
+        {
+            .key = profiler_opt,
+            .desc = "Interpreter profiler",
+            .info = "Count executed mnemonics and time spent in every process and system function.\n"
+                    "A report, and in trace mode a Chrome trace, is written to the save directory on exit.",
+            .default_value = profiler_off_optval,
+            .values = {
+                { profiler_off_optval, "Off"},
+                { profiler_report_optval, "Report"},
+                { profiler_trace_optval, "Report and trace"},
+                { NULL, NULL} }
+        },
+#endif
         {NULL}
     };
     #undef DECILE
@@ -603,6 +711,18 @@ static void update_variables()
             {
                 scale_override = libretro_scale_mode_override_2xunfiltered;
             }
+            else if (string_is_equal_case_insensitive(override_scaling_option, override_scaling_3x_optval))
+            {
+                scale_override = libretro_scale_mode_override_3x;
+            }
+            else if (string_is_equal_case_insensitive(override_scaling_option, override_scaling_3xsmooth_optval))
+            {
+                scale_override = libretro_scale_mode_override_3xsmooth;
+            }
+            else if (string_is_equal_case_insensitive(override_scaling_option, override_scaling_2xhq_twice_optval))
+            {
+                scale_override = libretro_scale_mode_override_2xhq_twice;
+            }
             else
             {
                 scale_override = libretro_scale_mode_override_off;
@@ -614,6 +734,20 @@ static void update_variables()
         }
     }
 
+    // Render threads
+    {
+        const char* render_threads_option=get_option_value(render_threads_opt);
+        int threads=1;
+        if (render_threads_option && 1==sscanf(render_threads_option, "%d", &threads) && threads>1)
+        {
+            libretro_render_threads = threads;
+        }
+        else
+        {
+            libretro_render_threads = 1;
+        }
+    }
+
     // Case insensitive file io emulation
     case_insensitive_file_io = get_boolean_option(case_insensitive_file_io_opt, true);
 
@@ -675,6 +809,25 @@ static void update_variables()
     {        
         update_mouse_button_option(&mouse_button_mappings[i]);
     }
+
+#ifdef INTERPRETER_PROFILER
+    // Interpreter profiler
+    {
+        const char* profiler_option=get_option_value(profiler_opt);
+        if (profiler_option && string_is_equal_case_insensitive(profiler_option, profiler_report_optval))
+        {
+            profiler_set_mode(PROFILER_REPORT);
+        }
+        else if (profiler_option && string_is_equal_case_insensitive(profiler_option, profiler_trace_optval))
+        {
+            profiler_set_mode(PROFILER_TRACE);
+        }
+        else
+        {
+            profiler_set_mode(PROFILER_OFF);
+        }
+    }
+#endif
 }
 
 void retro_set_environment(retro_environment_t cb)
@@ -697,19 +850,101 @@ void retro_reset(void)
 
 }
 
+static size_t bgd_state_stack_size()
+{
+    if (!BGD_SAVESTATES || bgd_finished || !bgd_stack_top || !bgd_stack_bottom || bgd_stack_bottom >= bgd_stack_top)
+    {
+        return 0;
+    }
+
+    return bgd_stack_top - bgd_stack_bottom;
+}
+
 size_t retro_serialize_size(void)
 {
-   return 0;
+    const size_t stack_size = bgd_state_stack_size();
+    if (!stack_size)
+    {
+        return 0;
+    }
+
+    const size_t core_size = savestate_size();
+    if (!core_size)
+    {
+        return 0;
+    }
+
+    // The heap grows while the game runs, leave some room so the frontend doesn't need to reallocate every frame
+    size_t size = sizeof(bgd_state_header_t) + sizeof(bgd_resume_context) + stack_size + core_size;
+    return (size + BGD_STATE_SIZE_ALIGN - 1) & ~(size_t)(BGD_STATE_SIZE_ALIGN - 1);
 }
 
 bool retro_serialize(void *data_, size_t size)
 {
-   return false;
+    const size_t stack_size = bgd_state_stack_size();
+    if (!stack_size)
+    {
+        return false;
+    }
+
+    const bgd_state_header_t header = { BGD_STATE_MAGIC, stack_size, (uint64_t)(uintptr_t)bgd_stack_bottom };
+    const size_t fixed_size = sizeof(header) + sizeof(bgd_resume_context) + stack_size;
+    uint8_t* data = data_;
+
+    if (size < fixed_size)
+    {
+        return false;
+    }
+
+    memcpy(data, &header, sizeof(header));
+    data += sizeof(header);
+    memcpy(data, bgd_resume_context, sizeof(bgd_resume_context));
+    data += sizeof(bgd_resume_context);
+    memcpy(data, bgd_stack_bottom, stack_size);
+    data += stack_size;
+
+    return savestate_save(data, size - fixed_size);
 }
 
 bool retro_unserialize(const void *data_, size_t size)
 {
-   return false;
+    const size_t stack_size = bgd_state_stack_size();
+    const uint8_t* data = data_;
+    bgd_state_header_t header;
+
+    if (!stack_size || size < sizeof(header))
+    {
+        return false;
+    }
+
+    memcpy(&header, data, sizeof(header));
+    data += sizeof(header);
+
+    // The stack can only be put back if bgd is suspended at the same depth
+    if (header.magic != BGD_STATE_MAGIC || header.stack_size != stack_size || header.stack_bottom != (uint64_t)(uintptr_t)bgd_stack_bottom)
+    {
+        log_cb(RETRO_LOG_WARN, "retro_unserialize: incompatible state\n");
+        return false;
+    }
+
+    const size_t fixed_size = sizeof(header) + sizeof(bgd_resume_context) + stack_size;
+    if (size < fixed_size)
+    {
+        return false;
+    }
+
+    if (!savestate_load(data + sizeof(bgd_resume_context) + stack_size, size - fixed_size))
+    {
+        log_cb(RETRO_LOG_WARN, "retro_unserialize: failed to restore heap\n");
+        return false;
+    }
+
+    memcpy(bgd_resume_context, data, sizeof(bgd_resume_context));
+    data += sizeof(bgd_resume_context);
+    memcpy(bgd_stack_bottom, data, stack_size);
+
+    bgd_resume_pending = true;
+    return true;
 }
 
 void *retro_get_memory_data(unsigned id)
@@ -734,6 +969,9 @@ void retro_cheat_reset(void)
 extern int bgdi_main(int argc, char*argv[]);
 static void run_bennugd(void)
 {
+    volatile uint8_t stack_top_marker = 0;
+    bgd_stack_top = (uint8_t*)&stack_top_marker;
+
     char* arg0=get_content_basename();
     char* arg1=NULL;
     int argc = 1;
@@ -901,11 +1139,24 @@ bool retro_load_game(const struct retro_game_info *info)
 
     init_filesystem( info->path, save_dir, &retro_vfs_interface_info, case_insensitive_file_io);
 
+#ifdef INTERPRETER_PROFILER
+    if (save_dir)
+    {
+        char profiler_output[PATH_MAX_LENGTH];
+        fill_pathname_join(profiler_output, save_dir, get_content_basename(), sizeof(profiler_output));
+        profiler_set_output(profiler_output);
+    }
+#endif
+
     environ_cb(RETRO_ENVIRONMENT_SET_FRAME_TIME_CALLBACK, &(struct retro_frame_time_callback)
     {
         &retro_frame_time_callback
     });
 
+    // States hold absolute heap and stack addresses
+    uint64_t serialization_quirks = RETRO_SERIALIZATION_QUIRK_CORE_VARIABLE_SIZE | RETRO_SERIALIZATION_QUIRK_SINGLE_SESSION;
+    environ_cb(RETRO_ENVIRONMENT_SET_SERIALIZATION_QUIRKS, &serialization_quirks);
+
     co_switch(bgd_thread);
     return true;
 }
@@ -35,6 +35,17 @@
 
 #include "libblit.h"
 
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#include <SDL_cpuinfo.h>
+#define BLIT_SIMD
+#define BLIT_SSE2
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#include <arm_neon.h>
+#define BLIT_SIMD
+#define BLIT_NEON
+#endif
+
 /* --------------------------------------------------------------------------- */
 
 /* Define some constants and structs used by the blitter */
@@ -64,36 +75,45 @@ VERTEX;
 
 typedef _POINTF VECTOR;
 
-typedef void ( DRAW_SPAN )( GRAPH *, GRAPH *, int, int, int, int, int, int, int );
-typedef void ( DRAW_HSPAN )( void *, void *, int, int, int, int, int );
 typedef int ( BLEND_FUNC )( int, int );
 
 /* --------------------------------------------------------------------------- */
 
-/* Conversion tables used by transparency /blending
+/* Blend parameters of a single gr_blit/gr_rotated_blit call
  *
- * In 16 bits, this two lookup tables will be used as:
+ * In 16 bits, the two lookup tables will be used as:
  *
  *      Dest_color = ghost1[screen_color] + ghost2[graphic_color]
  *
  * In transparency mode, both tables are the assigned to the ghostcolor global table
  * (a table that reduces all color components to half)
+ *
+ * The context lives in the caller's stack and is handed to the span functions,
+ * so blits into disjoint regions don't share any state.
  */
 
-uint16_t  * ghost1;
-uint16_t  * ghost2;
-uint8_t   * ghost8;
-
-uint32_t * pcolorequiv = NULL ;
+typedef struct
+{
+    uint16_t    * ghost1;
+    uint16_t    * ghost2;
+    uint8_t     * ghost8;
+    uint32_t    * pcolorequiv;
+    uint32_t    factor;
+    uint32_t    factor2;
+    BLEND_FUNC  * blend_func;
+    int         posx;           /* Parameter for 1to8, 1to16 and 1to32 */
+}
+BLIT_CONTEXT;
 
-uint32_t _factor ;
-uint32_t _factor2 ;
+typedef void ( DRAW_SPAN )( BLIT_CONTEXT *, GRAPH *, GRAPH *, int, int, int, int, int, int, int );
+typedef void ( DRAW_HSPAN )( BLIT_CONTEXT *, void *, void *, int, int, int, int, int );
 
 /* --------------------------------------------------------------------------- */
 
-/* Calculates additive blend value */
+/* With render threads several blits share the destination at once. While set,
+ * the blits leave its flags alone and the caller updates them after the join */
 
-static BLEND_FUNC * blend_func;
+int gr_blit_defer_dest = 0;
 
 /* --------------------------------------------------------------------------- */
 
@@ -228,7 +248,7 @@ static int compare_vertex_y( const void* left, const void* right )
 /* --------------------------------------------------------------------------- */
 
 /*
-static void draw_span_1to1(GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct)
+static void draw_span_1to1( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct)
 {
     uint8_t *ptr = (uint8_t *)dest->data + dest->pitch * y + x/8 ;
     int cs = s, ct = t, i;
@@ -246,7 +266,7 @@ static void draw_span_1to1(GRAPH * dest, GRAPH * orig, int x, int y, int pixels,
     }
 }
 
-static void draw_span_1to1_nocolorkey(GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct)
+static void draw_span_1to1_nocolorkey( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct)
 {
     uint8_t *ptr = (uint8_t *)dest->data + dest->pitch * y + x/8 ;
     int cs = s, ct = t, i;
@@ -270,7 +290,7 @@ static void draw_span_1to1_nocolorkey(GRAPH * dest, GRAPH * orig, int x, int y,
 /* 1 to 8                                                                      */
 /* --------------------------------------------------------------------------- */
 
-static void draw_span_1to8( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_1to8( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
     uint8_t *ptr = ( uint8_t * ) dest->data + dest->pitch * y + x ;
     int cs = s, ct = t;
@@ -289,7 +309,7 @@ static void draw_span_1to8( GRAPH * dest, GRAPH * orig, int x, int y, int pixels
 /* 8 to 8                                                                      */
 /* --------------------------------------------------------------------------- */
 
-static void draw_span_8to8_nocolorkey( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_8to8_nocolorkey( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
     uint8_t *ptr = ( uint8_t * ) dest->data + dest->pitch * y + x;
     int cs = s, ct = t;
@@ -302,8 +322,9 @@ static void draw_span_8to8_nocolorkey( GRAPH * dest, GRAPH * orig, int x, int y,
     }
 }
 
-static void draw_span_8to8_translucent( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_8to8_translucent( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    uint8_t * ghost8 = ctx->ghost8;
     uint8_t *ptr = ( uint8_t * ) dest->data + dest->pitch * y + x;
     int cs = s, ct = t;
 
@@ -316,7 +337,7 @@ static void draw_span_8to8_translucent( GRAPH * dest, GRAPH * orig, int x, int y
     }
 }
 
-static void draw_span_8to8( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_8to8( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
     uint8_t *ptr = ( uint8_t * ) dest->data + dest->pitch * y + x;
     int cs = s, ct = t;
@@ -330,8 +351,9 @@ static void draw_span_8to8( GRAPH * dest, GRAPH * orig, int x, int y, int pixels
     }
 }
 
-static void draw_span_8to8_ablend( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_8to8_ablend( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
     uint8_t *ptr = ( uint8_t * ) dest->data + dest->pitch * y + x;
     int cs = s, ct = t;
 
@@ -345,8 +367,10 @@ static void draw_span_8to8_ablend( GRAPH * dest, GRAPH * orig, int x, int y, int
     }
 }
 
-static void draw_span_8to8_tablend( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_8to8_tablend( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint8_t * ghost8 = ctx->ghost8;
     uint8_t *ptr = ( uint8_t * ) dest->data + dest->pitch * y + x;
     int cs = s, ct = t;
 
@@ -363,7 +387,7 @@ static void draw_span_8to8_tablend( GRAPH * dest, GRAPH * orig, int x, int y, in
 /* 1 to 16                                                                     */
 /* --------------------------------------------------------------------------- */
 
-static void draw_span_1to16( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_1to16( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
     uint16_t *ptr = ( uint16_t * ) dest->data + ( dest->pitch * y >> 1 ) + x ;
     int cs = s, ct = t;
@@ -382,8 +406,9 @@ static void draw_span_1to16( GRAPH * dest, GRAPH * orig, int x, int y, int pixel
 /* 8 to 16                                                                     */
 /* --------------------------------------------------------------------------- */
 
-static void draw_span_8to16( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_8to16( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
     uint16_t *ptr = ( uint16_t * ) dest->data + ( dest->pitch * y >> 1 ) + x;
     int cs = s, ct = t;
 
@@ -396,8 +421,10 @@ static void draw_span_8to16( GRAPH * dest, GRAPH * orig, int x, int y, int pixel
     }
 }
 
-static void draw_span_8to16_ablend( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_8to16_ablend( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
     uint16_t *ptr = ( uint16_t * ) dest->data + ( dest->pitch * y >> 1 ) + x;
     int cs = s, ct = t;
 
@@ -410,8 +437,11 @@ static void draw_span_8to16_ablend( GRAPH * dest, GRAPH * orig, int x, int y, in
     }
 }
 
-static void draw_span_8to16_tablend( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_8to16_tablend( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
+    uint16_t * ghost1 = ctx->ghost1, * ghost2 = ctx->ghost2;
     uint16_t *ptr = ( uint16_t * ) dest->data + ( dest->pitch * y >> 1 ) + x;
     int cs = s, ct = t;
 
@@ -424,8 +454,10 @@ static void draw_span_8to16_tablend( GRAPH * dest, GRAPH * orig, int x, int y, i
     }
 }
 
-static void draw_span_8to16_translucent( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_8to16_translucent( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
+    uint16_t * ghost1 = ctx->ghost1, * ghost2 = ctx->ghost2;
     uint16_t *ptr = ( uint16_t * ) dest->data + ( dest->pitch * y >> 1 ) + x;
     int cs = s, ct = t;
 
@@ -438,8 +470,9 @@ static void draw_span_8to16_translucent( GRAPH * dest, GRAPH * orig, int x, int
     }
 }
 
-static void draw_span_8to16_nocolorkey( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_8to16_nocolorkey( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
     uint16_t *ptr = ( uint16_t * ) dest->data + ( dest->pitch * y >> 1 ) + x;
     int cs = s, ct = t;
 
@@ -455,8 +488,9 @@ static void draw_span_8to16_nocolorkey( GRAPH * dest, GRAPH * orig, int x, int y
 /* 8 to 32                                                                     */
 /* --------------------------------------------------------------------------- */
 
-static void draw_span_8to32( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_8to32( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
     uint32_t *ptr = ( uint32_t * ) dest->data + ( dest->pitch * y >> 2 ) + x;
     int cs = s, ct = t;
 
@@ -469,8 +503,10 @@ static void draw_span_8to32( GRAPH * dest, GRAPH * orig, int x, int y, int pixel
     }
 }
 
-static void draw_span_8to32_ablend( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_8to32_ablend( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
     uint32_t *ptr = ( uint32_t * ) dest->data + ( dest->pitch * y >> 2 ) + x;
     int cs = s, ct = t;
 
@@ -483,8 +519,11 @@ static void draw_span_8to32_ablend( GRAPH * dest, GRAPH * orig, int x, int y, in
     }
 }
 
-static void draw_span_8to32_tablend( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_8to32_tablend( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
+    uint32_t _factor = ctx->factor, _factor2 = ctx->factor2;
     uint32_t *ptr = ( uint32_t * ) dest->data + ( dest->pitch * y >> 2 ) + x;
     int cs = s, ct = t;
     uint32_t r, g, b, c;
@@ -512,8 +551,10 @@ static void draw_span_8to32_tablend( GRAPH * dest, GRAPH * orig, int x, int y, i
     }
 }
 
-static void draw_span_8to32_translucent( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_8to32_translucent( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
+    uint32_t _factor = ctx->factor, _factor2 = ctx->factor2;
     uint32_t *ptr = ( uint32_t * ) dest->data + ( dest->pitch * y >> 2 ) + x;
     int cs = s, ct = t;
     uint32_t r, g, b, c;
@@ -541,8 +582,9 @@ static void draw_span_8to32_translucent( GRAPH * dest, GRAPH * orig, int x, int
     }
 }
 
-static void draw_span_8to32_nocolorkey( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_8to32_nocolorkey( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
     uint32_t *ptr = ( uint32_t * ) dest->data + ( dest->pitch * y >> 2 ) + x;
     int cs = s, ct = t;
 
@@ -559,7 +601,7 @@ static void draw_span_8to32_nocolorkey( GRAPH * dest, GRAPH * orig, int x, int y
 /* 16 to 16                                                                    */
 /* --------------------------------------------------------------------------- */
 
-static void draw_span_16to16( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_16to16( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
     uint16_t *ptr = ( uint16_t * ) dest->data + ( dest->pitch * y >> 1 ) + x;
     int cs = s, ct = t;
@@ -574,8 +616,9 @@ static void draw_span_16to16( GRAPH * dest, GRAPH * orig, int x, int y, int pixe
     }
 }
 
-static void draw_span_16to16_ablend( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_16to16_ablend( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
     uint16_t *ptr = ( uint16_t * ) dest->data + ( dest->pitch * y >> 1 ) + x;
     int cs = s, ct = t;
     uint16_t * tex ;
@@ -589,8 +632,10 @@ static void draw_span_16to16_ablend( GRAPH * dest, GRAPH * orig, int x, int y, i
     }
 }
 
-static void draw_span_16to16_tablend( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_16to16_tablend( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint16_t * ghost1 = ctx->ghost1, * ghost2 = ctx->ghost2;
     uint16_t *ptr = ( uint16_t * ) dest->data + ( dest->pitch * y >> 1 ) + x;
     int cs = s, ct = t;
     uint16_t * tex ;
@@ -604,8 +649,9 @@ static void draw_span_16to16_tablend( GRAPH * dest, GRAPH * orig, int x, int y,
     }
 }
 
-static void draw_span_16to16_translucent( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_16to16_translucent( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    uint16_t * ghost1 = ctx->ghost1, * ghost2 = ctx->ghost2;
     uint16_t *ptr = ( uint16_t * ) dest->data + ( dest->pitch * y >> 1 ) + x;
     int cs = s, ct = t;
     uint16_t * tex ;
@@ -619,7 +665,7 @@ static void draw_span_16to16_translucent( GRAPH * dest, GRAPH * orig, int x, int
     }
 }
 
-static void draw_span_16to16_nocolorkey( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_16to16_nocolorkey( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
     uint16_t *ptr = ( uint16_t * ) dest->data + ( dest->pitch * y >> 1 ) + x;
     int cs = s, ct = t;
@@ -637,7 +683,7 @@ static void draw_span_16to16_nocolorkey( GRAPH * dest, GRAPH * orig, int x, int
 /* 16 to 32                                                                    */
 /* --------------------------------------------------------------------------- */
 
-static void draw_span_16to32( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_16to32( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
     uint32_t *ptr = ( uint32_t * ) dest->data + ( dest->pitch * y >> 2 ) + x;
     int cs = s, ct = t;
@@ -652,8 +698,9 @@ static void draw_span_16to32( GRAPH * dest, GRAPH * orig, int x, int y, int pixe
     }
 }
 
-static void draw_span_16to32_ablend( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_16to32_ablend( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
     uint32_t *ptr = ( uint32_t * ) dest->data + ( dest->pitch * y >> 2 ) + x;
     int cs = s, ct = t;
     uint16_t * tex ;
@@ -667,8 +714,10 @@ static void draw_span_16to32_ablend( GRAPH * dest, GRAPH * orig, int x, int y, i
     }
 }
 
-static void draw_span_16to32_tablend( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_16to32_tablend( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint32_t _factor = ctx->factor, _factor2 = ctx->factor2;
     uint32_t *ptr = ( uint32_t * ) dest->data + ( dest->pitch * y >> 2 ) + x;
     int cs = s, ct = t;
     uint16_t * tex ;
@@ -697,8 +746,9 @@ static void draw_span_16to32_tablend( GRAPH * dest, GRAPH * orig, int x, int y,
     }
 }
 
-static void draw_span_16to32_translucent( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_16to32_translucent( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    uint32_t _factor = ctx->factor, _factor2 = ctx->factor2;
     uint32_t *ptr = ( uint32_t * ) dest->data + ( dest->pitch * y >> 2 ) + x;
     int cs = s, ct = t;
     uint16_t * tex ;
@@ -727,7 +777,7 @@ static void draw_span_16to32_translucent( GRAPH * dest, GRAPH * orig, int x, int
     }
 }
 
-static void draw_span_16to32_nocolorkey( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_16to32_nocolorkey( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
     uint32_t *ptr = ( uint32_t * ) dest->data + ( dest->pitch * y >> 2 ) + x;
     int cs = s, ct = t;
@@ -746,7 +796,7 @@ static void draw_span_16to32_nocolorkey( GRAPH * dest, GRAPH * orig, int x, int
 /* 1 to 32                                                                     */
 /* --------------------------------------------------------------------------- */
 
-static void draw_span_1to32( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_1to32( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
     uint32_t *ptr = ( uint32_t * ) dest->data + ( dest->pitch * y >> 2 ) + x ;
     int cs = s, ct = t;
@@ -765,8 +815,9 @@ static void draw_span_1to32( GRAPH * dest, GRAPH * orig, int x, int y, int pixel
 /* 32 to 32                                                                    */
 /* --------------------------------------------------------------------------- */
 
-static void draw_span_32to32( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_32to32( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    uint32_t _factor, _factor2;
     uint32_t *ptr = ( uint32_t * ) dest->data + ( dest->pitch * y >> 2 ) + x;
     int cs = s, ct = t;
     uint32_t * tex ;
@@ -801,8 +852,10 @@ static void draw_span_32to32( GRAPH * dest, GRAPH * orig, int x, int y, int pixe
     }
 }
 
-static void draw_span_32to32_ablend( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_32to32_ablend( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint32_t _factor, _factor2;
     uint32_t *ptr = ( uint32_t * ) dest->data + ( dest->pitch * y >> 2 ) + x;
     int cs = s, ct = t;
     uint32_t * tex ;
@@ -837,8 +890,10 @@ static void draw_span_32to32_ablend( GRAPH * dest, GRAPH * orig, int x, int y, i
     }
 }
 
-static void draw_span_32to32_tablend( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_32to32_tablend( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint32_t _factor = ctx->factor, _factor2 = ctx->factor2;
     uint32_t *ptr = ( uint32_t * ) dest->data + ( dest->pitch * y >> 2 ) + x;
     int cs = s, ct = t;
     uint32_t * tex ;
@@ -880,8 +935,9 @@ static void draw_span_32to32_tablend( GRAPH * dest, GRAPH * orig, int x, int y,
     }
 }
 
-static void draw_span_32to32_translucent( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_32to32_translucent( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
+    uint32_t _factor = ctx->factor, _factor2 = ctx->factor2;
     uint32_t *ptr = ( uint32_t * ) dest->data + ( dest->pitch * y >> 2 ) + x;
     int cs = s, ct = t;
     uint32_t * tex ;
@@ -923,7 +979,7 @@ static void draw_span_32to32_translucent( GRAPH * dest, GRAPH * orig, int x, int
     }
 }
 
-static void draw_span_32to32_nocolorkey( GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
+static void draw_span_32to32_nocolorkey( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct )
 {
     uint32_t *ptr = ( uint32_t * ) dest->data + ( dest->pitch * y >> 2 ) + x;
     int cs = s, ct = t;
@@ -962,16 +1018,13 @@ static void draw_span_32to32_nocolorkey( GRAPH * dest, GRAPH * orig, int x, int
  *
  */
 
-/* Parameter for 1to8 and 16to8 */
-static int posx;
-
 /* --------------------------------------------------------------------------- */
 /* 1 to 8                                                                      */
 /* --------------------------------------------------------------------------- */
 
-static void draw_hspan_1to8( uint8_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_1to8( BLIT_CONTEXT * ctx, uint8_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
-    int mask, omask = ( 0x80 >> ( posx & 7 ) );
+    int mask, omask = ( 0x80 >> ( ctx->posx & 7 ) );
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1001,7 +1054,7 @@ static void draw_hspan_1to8( uint8_t *scr, uint8_t * tex, int pixels, int incs,
 /* 8 to 8                                                                      */
 /* --------------------------------------------------------------------------- */
 
-static void draw_hspan_8to8_nocolorkey( uint8_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_8to8_nocolorkey( BLIT_CONTEXT * ctx, uint8_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
@@ -1017,8 +1070,9 @@ static void draw_hspan_8to8_nocolorkey( uint8_t *scr, uint8_t * tex, int pixels,
     }
 }
 
-static void draw_hspan_8to8_translucent( uint8_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_8to8_translucent( BLIT_CONTEXT * ctx, uint8_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    uint8_t * ghost8 = ctx->ghost8;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1034,8 +1088,10 @@ static void draw_hspan_8to8_translucent( uint8_t *scr, uint8_t * tex, int pixels
     }
 }
 
-static void draw_hspan_8to8_tablend( uint8_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_8to8_tablend( BLIT_CONTEXT * ctx, uint8_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint8_t * ghost8 = ctx->ghost8;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1051,8 +1107,9 @@ static void draw_hspan_8to8_tablend( uint8_t *scr, uint8_t * tex, int pixels, in
     }
 }
 
-static void draw_hspan_8to8_ablend( uint8_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_8to8_ablend( BLIT_CONTEXT * ctx, uint8_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1068,7 +1125,7 @@ static void draw_hspan_8to8_ablend( uint8_t *scr, uint8_t * tex, int pixels, int
     }
 }
 
-static void draw_hspan_8to8( uint8_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_8to8( BLIT_CONTEXT * ctx, uint8_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
@@ -1089,9 +1146,9 @@ static void draw_hspan_8to8( uint8_t *scr, uint8_t * tex, int pixels, int incs,
 /* 1 to 16                                                                     */
 /* --------------------------------------------------------------------------- */
 
-static void draw_hspan_1to16( uint16_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_1to16( BLIT_CONTEXT * ctx, uint16_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
-    int mask, omask = ( 0x80 >> ( posx & 7 ) );
+    int mask, omask = ( 0x80 >> ( ctx->posx & 7 ) );
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1121,8 +1178,9 @@ static void draw_hspan_1to16( uint16_t *scr, uint8_t * tex, int pixels, int incs
 /* 8 to 16                                                                    */
 /* --------------------------------------------------------------------------- */
 
-static void draw_hspan_8to16( uint16_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_8to16( BLIT_CONTEXT * ctx, uint16_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1138,8 +1196,10 @@ static void draw_hspan_8to16( uint16_t *scr, uint8_t * tex, int pixels, int incs
     }
 }
 
-static void draw_hspan_8to16_ablend( uint16_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_8to16_ablend( BLIT_CONTEXT * ctx, uint16_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1155,8 +1215,11 @@ static void draw_hspan_8to16_ablend( uint16_t *scr, uint8_t * tex, int pixels, i
     }
 }
 
-static void draw_hspan_8to16_tablend( uint16_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_8to16_tablend( BLIT_CONTEXT * ctx, uint16_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
+    uint16_t * ghost1 = ctx->ghost1, * ghost2 = ctx->ghost2;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1172,8 +1235,10 @@ static void draw_hspan_8to16_tablend( uint16_t *scr, uint8_t * tex, int pixels,
     }
 }
 
-static void draw_hspan_8to16_translucent( uint16_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_8to16_translucent( BLIT_CONTEXT * ctx, uint16_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
+    uint16_t * ghost1 = ctx->ghost1, * ghost2 = ctx->ghost2;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1189,8 +1254,9 @@ static void draw_hspan_8to16_translucent( uint16_t *scr, uint8_t * tex, int pixe
     }
 }
 
-static void draw_hspan_8to16_nocolorkey( uint16_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_8to16_nocolorkey( BLIT_CONTEXT * ctx, uint16_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1209,7 +1275,7 @@ static void draw_hspan_8to16_nocolorkey( uint16_t *scr, uint8_t * tex, int pixel
 /* 16 to 16                                                                    */
 /* --------------------------------------------------------------------------- */
 
-static void draw_hspan_16to16( uint16_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_16to16( BLIT_CONTEXT * ctx, uint16_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
@@ -1226,8 +1292,9 @@ static void draw_hspan_16to16( uint16_t *scr, uint16_t * tex, int pixels, int in
     }
 }
 
-static void draw_hspan_16to16_ablend( uint16_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_16to16_ablend( BLIT_CONTEXT * ctx, uint16_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1243,8 +1310,10 @@ static void draw_hspan_16to16_ablend( uint16_t *scr, uint16_t * tex, int pixels,
     }
 }
 
-static void draw_hspan_16to16_tablend( uint16_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_16to16_tablend( BLIT_CONTEXT * ctx, uint16_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint16_t * ghost1 = ctx->ghost1, * ghost2 = ctx->ghost2;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1260,8 +1329,9 @@ static void draw_hspan_16to16_tablend( uint16_t *scr, uint16_t * tex, int pixels
     }
 }
 
-static void draw_hspan_16to16_translucent( uint16_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_16to16_translucent( BLIT_CONTEXT * ctx, uint16_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    uint16_t * ghost1 = ctx->ghost1, * ghost2 = ctx->ghost2;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1277,7 +1347,7 @@ static void draw_hspan_16to16_translucent( uint16_t *scr, uint16_t * tex, int pi
     }
 }
 
-static void draw_hspan_16to16_nocolorkey( uint16_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_16to16_nocolorkey( BLIT_CONTEXT * ctx, uint16_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
@@ -1297,9 +1367,9 @@ static void draw_hspan_16to16_nocolorkey( uint16_t *scr, uint16_t * tex, int pix
 /* 1 to 32                                                                     */
 /* --------------------------------------------------------------------------- */
 
-static void draw_hspan_1to32( uint32_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_1to32( BLIT_CONTEXT * ctx, uint32_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
-    int mask, omask = ( 0x80 >> ( posx & 7 ) );
+    int mask, omask = ( 0x80 >> ( ctx->posx & 7 ) );
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1329,8 +1399,9 @@ static void draw_hspan_1to32( uint32_t *scr, uint8_t * tex, int pixels, int incs
 /* 8 to 32                                                                    */
 /* --------------------------------------------------------------------------- */
 
-static void draw_hspan_8to32( uint32_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_8to32( BLIT_CONTEXT * ctx, uint32_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1346,8 +1417,10 @@ static void draw_hspan_8to32( uint32_t *scr, uint8_t * tex, int pixels, int incs
     }
 }
 
-static void draw_hspan_8to32_ablend( uint32_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_8to32_ablend( BLIT_CONTEXT * ctx, uint32_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1363,8 +1436,11 @@ static void draw_hspan_8to32_ablend( uint32_t *scr, uint8_t * tex, int pixels, i
     }
 }
 
-static void draw_hspan_8to32_tablend( uint32_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_8to32_tablend( BLIT_CONTEXT * ctx, uint32_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
+    uint32_t _factor = ctx->factor, _factor2 = ctx->factor2;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
     uint32_t r, g, b, c;
@@ -1394,8 +1470,10 @@ static void draw_hspan_8to32_tablend( uint32_t *scr, uint8_t * tex, int pixels,
     }
 }
 
-static void draw_hspan_8to32_translucent( uint32_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_8to32_translucent( BLIT_CONTEXT * ctx, uint32_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
+    uint32_t _factor = ctx->factor, _factor2 = ctx->factor2;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
     uint32_t r, g, b, c;
@@ -1425,8 +1503,9 @@ static void draw_hspan_8to32_translucent( uint32_t *scr, uint8_t * tex, int pixe
     }
 }
 
-static void draw_hspan_8to32_nocolorkey( uint32_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_8to32_nocolorkey( BLIT_CONTEXT * ctx, uint32_t *scr, uint8_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    uint32_t * pcolorequiv = ctx->pcolorequiv;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1446,7 +1525,7 @@ static void draw_hspan_8to32_nocolorkey( uint32_t *scr, uint8_t * tex, int pixel
 /* 16 to 32                                                                    */
 /* --------------------------------------------------------------------------- */
 
-static void draw_hspan_16to32( uint32_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_16to32( BLIT_CONTEXT * ctx, uint32_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
@@ -1463,8 +1542,9 @@ static void draw_hspan_16to32( uint32_t *scr, uint16_t * tex, int pixels, int in
     }
 }
 
-static void draw_hspan_16to32_ablend( uint32_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_16to32_ablend( BLIT_CONTEXT * ctx, uint32_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
 
@@ -1480,8 +1560,10 @@ static void draw_hspan_16to32_ablend( uint32_t *scr, uint16_t * tex, int pixels,
     }
 }
 
-static void draw_hspan_16to32_tablend( uint32_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_16to32_tablend( BLIT_CONTEXT * ctx, uint32_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint32_t _factor = ctx->factor, _factor2 = ctx->factor2;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
     uint32_t r, g, b, c;
@@ -1511,8 +1593,9 @@ static void draw_hspan_16to32_tablend( uint32_t *scr, uint16_t * tex, int pixels
     }
 }
 
-static void draw_hspan_16to32_translucent( uint32_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_16to32_translucent( BLIT_CONTEXT * ctx, uint32_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    uint32_t _factor = ctx->factor, _factor2 = ctx->factor2;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
     uint32_t r, g, b, c;
@@ -1542,7 +1625,7 @@ static void draw_hspan_16to32_translucent( uint32_t *scr, uint16_t * tex, int pi
     }
 }
 
-static void draw_hspan_16to32_nocolorkey( uint32_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_16to32_nocolorkey( BLIT_CONTEXT * ctx, uint32_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
@@ -1563,8 +1646,9 @@ static void draw_hspan_16to32_nocolorkey( uint32_t *scr, uint16_t * tex, int pix
 /* 32 to 32                                                                    */
 /* --------------------------------------------------------------------------- */
 
-static void draw_hspan_32to32( uint32_t *scr, uint32_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_32to32( BLIT_CONTEXT * ctx, uint32_t *scr, uint32_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    uint32_t _factor, _factor2;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
     uint32_t r, g, b, c;
@@ -1601,8 +1685,10 @@ static void draw_hspan_32to32( uint32_t *scr, uint32_t * tex, int pixels, int in
     }
 }
 
-static void draw_hspan_32to32_ablend( uint32_t *scr, uint32_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_32to32_ablend( BLIT_CONTEXT * ctx, uint32_t *scr, uint32_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint32_t _factor, _factor2;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
     uint32_t r, g, b, c;
@@ -1639,8 +1725,10 @@ static void draw_hspan_32to32_ablend( uint32_t *scr, uint32_t * tex, int pixels,
     }
 }
 
-static void draw_hspan_32to32_tablend( uint32_t *scr, uint32_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_32to32_tablend( BLIT_CONTEXT * ctx, uint32_t *scr, uint32_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    BLEND_FUNC * blend_func = ctx->blend_func;
+    uint32_t _factor = ctx->factor, _factor2 = ctx->factor2;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
     uint32_t r, g, b;
@@ -1682,8 +1770,9 @@ static void draw_hspan_32to32_tablend( uint32_t *scr, uint32_t * tex, int pixels
     }
 }
 
-static void draw_hspan_32to32_translucent( uint32_t *scr, uint32_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_32to32_translucent( BLIT_CONTEXT * ctx, uint32_t *scr, uint32_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
+    uint32_t _factor = ctx->factor, _factor2 = ctx->factor2;
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
     int r, g, b;
@@ -1726,7 +1815,7 @@ static void draw_hspan_32to32_translucent( uint32_t *scr, uint32_t * tex, int pi
     }
 }
 
-static void draw_hspan_32to32_nocolorkey( uint32_t *scr, uint32_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
+static void draw_hspan_32to32_nocolorkey( BLIT_CONTEXT * ctx, uint32_t *scr, uint32_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc )
 {
     int i;
     uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
@@ -1742,6 +1831,438 @@ static void draw_hspan_32to32_nocolorkey( uint32_t *scr, uint32_t * tex, int pix
     }
 }
 
+/* --------------------------------------------------------------------------- */
+
+/* SIMD versions of the 32 to 32 bits alpha, additive, substractive and
+ * translucent kernels. They blend four pixels at a time and give the
+ * very same result than the scalar ones (every channel is worked as
+ * ( c * f + s * f2 ) >> 8 in 16 bits lanes, and a * factor / 255 is done
+ * as ( x + ( x >> 8 ) + 1 ) >> 8, which is exact for x in 0..65025).
+ * The pixels left at the end of each row go through the scalar kernel.
+ */
+
+#ifdef BLIT_SIMD
+
+enum
+{
+    BLEND4_ALPHA = 0,
+    BLEND4_ABLEND_ADD,
+    BLEND4_ABLEND_SUB,
+    BLEND4_TABLEND_ADD,
+    BLEND4_TABLEND_SUB,
+    BLEND4_TRANSLUCENT
+};
+
+#define BLEND4_IS_ABLEND(mode)      ( (mode) == BLEND4_ABLEND_ADD || (mode) == BLEND4_ABLEND_SUB )
+#define BLEND4_IS_TABLEND(mode)     ( (mode) == BLEND4_TABLEND_ADD || (mode) == BLEND4_TABLEND_SUB )
+#define BLEND4_IS_ADD(mode)         ( (mode) == BLEND4_ABLEND_ADD || (mode) == BLEND4_TABLEND_ADD )
+#define BLEND4_IS_SUB(mode)         ( (mode) == BLEND4_ABLEND_SUB || (mode) == BLEND4_TABLEND_SUB )
+#define BLEND4_USES_FACTOR(mode)    ( BLEND4_IS_TABLEND(mode) || (mode) == BLEND4_TRANSLUCENT )
+
+#ifdef BLIT_SSE2
+
+typedef __m128i PIXEL4;
+
+#define pixel4_load(p)          _mm_loadu_si128( ( const __m128i * )( p ) )
+#define pixel4_store(p,v)       _mm_storeu_si128( ( __m128i * )( p ), v )
+#define pixel4_reverse(v)       _mm_shuffle_epi32( v, 0x1B )
+#define pixel4_select(m,a,b)    _mm_or_si128( _mm_and_si128( m, a ), _mm_andnot_si128( m, b ) )
+
+/* Alpha of every pixel broadcast to its four 16 bits lanes */
+#define pixel4_alpha16(v)       _mm_shufflehi_epi16( _mm_shufflelo_epi16( v, 0xFF ), 0xFF )
+
+static inline __m128i blend4_factor( __m128i a, __m128i factor, __m128i factor2, __m128i * f2 )
+{
+    const __m128i c255 = _mm_set1_epi16( 255 );
+    __m128i x = _mm_mullo_epi16( a, factor );
+    __m128i q = _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16( x, _mm_srli_epi16( x, 8 ) ), _mm_set1_epi16( 1 ) ), 8 );
+    __m128i opaque = _mm_cmpeq_epi16( a, c255 );
+
+    *f2 = pixel4_select( opaque, factor2, _mm_sub_epi16( c255, q ) );
+    return pixel4_select( opaque, factor, q );
+}
+
+static inline PIXEL4 pixel4_blend( PIXEL4 t, PIXEL4 s, int mode, int factor, int factor2 )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c255 = _mm_set1_epi16( 255 );
+    const __m128i amask = _mm_set1_epi32( 0xff000000 );
+    __m128i c = t, fl, fh, f2l, f2h, rl, rh, out;
+    __m128i al = pixel4_alpha16( _mm_unpacklo_epi8( t, zero ) );
+    __m128i ah = pixel4_alpha16( _mm_unpackhi_epi8( t, zero ) );
+
+    if ( BLEND4_IS_ADD( mode ) ) c = _mm_adds_epu8( t, s );
+    else if ( BLEND4_IS_SUB( mode ) ) c = _mm_subs_epu8( _mm_subs_epu8( t, _mm_xor_si128( s, _mm_set1_epi32( -1 ) ) ), _mm_set1_epi8( 1 ) );
+
+    if ( BLEND4_USES_FACTOR( mode ) )
+    {
+        fl = blend4_factor( al, _mm_set1_epi16( factor ), _mm_set1_epi16( factor2 ), &f2l );
+        fh = blend4_factor( ah, _mm_set1_epi16( factor ), _mm_set1_epi16( factor2 ), &f2h );
+    }
+    else
+    {
+        fl = al; f2l = _mm_sub_epi16( c255, al );
+        fh = ah; f2h = _mm_sub_epi16( c255, ah );
+    }
+
+    rl = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( _mm_unpacklo_epi8( c, zero ), fl ), _mm_mullo_epi16( _mm_unpacklo_epi8( s, zero ), f2l ) ), 8 );
+    rh = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( _mm_unpackhi_epi8( c, zero ), fh ), _mm_mullo_epi16( _mm_unpackhi_epi8( s, zero ), f2h ) ), 8 );
+    out = _mm_packus_epi16( rl, rh );
+
+    if ( mode == BLEND4_ALPHA || mode == BLEND4_TRANSLUCENT )
+        out = pixel4_select( amask, _mm_max_epu8( t, s ), out );
+    else
+        out = pixel4_select( amask, s, out );
+
+    if ( BLEND4_IS_ABLEND( mode ) )
+        out = pixel4_select( _mm_cmpeq_epi32( t, amask ), _mm_or_si128( c, amask ), out );
+
+    return pixel4_select( _mm_cmpeq_epi32( t, zero ), s, out );
+}
+
+#endif
+
+#ifdef BLIT_NEON
+
+typedef uint32x4_t PIXEL4;
+
+#define pixel4_load(p)          vld1q_u32( ( const uint32_t * )( p ) )
+#define pixel4_store(p,v)       vst1q_u32( ( uint32_t * )( p ), v )
+
+static inline PIXEL4 pixel4_reverse( PIXEL4 v )
+{
+    v = vrev64q_u32( v );
+    return vextq_u32( v, v, 2 );
+}
+
+static inline uint16x8_t blend4_factor( uint16x8_t a, int factor, int factor2, uint16x8_t * f2 )
+{
+    const uint16x8_t c255 = vdupq_n_u16( 255 );
+    uint16x8_t x = vmulq_n_u16( a, factor );
+    uint16x8_t q = vshrq_n_u16( vaddq_u16( vaddq_u16( x, vshrq_n_u16( x, 8 ) ), vdupq_n_u16( 1 ) ), 8 );
+    uint16x8_t opaque = vceqq_u16( a, c255 );
+
+    *f2 = vbslq_u16( opaque, vdupq_n_u16( factor2 ), vsubq_u16( c255, q ) );
+    return vbslq_u16( opaque, vdupq_n_u16( factor ), q );
+}
+
+static inline PIXEL4 pixel4_blend( PIXEL4 t, PIXEL4 s, int mode, int factor, int factor2 )
+{
+    const uint16x8_t c255 = vdupq_n_u16( 255 );
+    const uint32x4_t amask = vdupq_n_u32( 0xff000000 );
+    uint8x16_t t8 = vreinterpretq_u8_u32( t ), s8 = vreinterpretq_u8_u32( s ), c8 = t8;
+    uint8x16_t a8 = vreinterpretq_u8_u32( vmulq_n_u32( vshrq_n_u32( t, 24 ), 0x01010101 ) );
+    uint16x8_t al = vmovl_u8( vget_low_u8( a8 ) ), ah = vmovl_u8( vget_high_u8( a8 ) );
+    uint16x8_t fl, fh, f2l, f2h, rl, rh;
+    uint32x4_t out;
+
+    if ( BLEND4_IS_ADD( mode ) ) c8 = vqaddq_u8( t8, s8 );
+    else if ( BLEND4_IS_SUB( mode ) ) c8 = vqsubq_u8( vqsubq_u8( t8, vmvnq_u8( s8 ) ), vdupq_n_u8( 1 ) );
+
+    if ( BLEND4_USES_FACTOR( mode ) )
+    {
+        fl = blend4_factor( al, factor, factor2, &f2l );
+        fh = blend4_factor( ah, factor, factor2, &f2h );
+    }
+    else
+    {
+        fl = al; f2l = vsubq_u16( c255, al );
+        fh = ah; f2h = vsubq_u16( c255, ah );
+    }
+
+    rl = vshrq_n_u16( vaddq_u16( vmulq_u16( vmovl_u8( vget_low_u8( c8 ) ), fl ), vmulq_u16( vmovl_u8( vget_low_u8( s8 ) ), f2l ) ), 8 );
+    rh = vshrq_n_u16( vaddq_u16( vmulq_u16( vmovl_u8( vget_high_u8( c8 ) ), fh ), vmulq_u16( vmovl_u8( vget_high_u8( s8 ) ), f2h ) ), 8 );
+    out = vreinterpretq_u32_u8( vcombine_u8( vmovn_u16( rl ), vmovn_u16( rh ) ) );
+
+    if ( mode == BLEND4_ALPHA || mode == BLEND4_TRANSLUCENT )
+        out = vbslq_u32( amask, vreinterpretq_u32_u8( vmaxq_u8( t8, s8 ) ), out );
+    else
+        out = vbslq_u32( amask, s, out );
+
+    if ( BLEND4_IS_ABLEND( mode ) )
+        out = vbslq_u32( vceqq_u32( t, amask ), vorrq_u32( vreinterpretq_u32_u8( c8 ), amask ), out );
+
+    return vbslq_u32( vceqq_u32( t, vdupq_n_u32( 0 ) ), s, out );
+}
+
+#endif
+
+/* --------------------------------------------------------------------------- */
+
+static inline void draw_hspan_32to32_simd( BLIT_CONTEXT * ctx, uint32_t *scr, uint32_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc, int mode, DRAW_HSPAN * tail )
+{
+    int i, factor = ctx->factor, factor2 = ctx->factor2;
+    uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
+    PIXEL4 t;
+
+    while ( l-- )
+    {
+        for ( i = pixels; i >= 4; i -= 4 )
+        {
+            if ( incs > 0 )
+                t = pixel4_load( tex );
+            else
+                t = pixel4_reverse( pixel4_load( tex - 3 ) );
+            pixel4_store( scr, pixel4_blend( t, pixel4_load( scr ), mode, factor, factor2 ) );
+            scr += 4;
+            tex += incs * 4;
+        }
+        if ( i ) tail( ctx, scr, tex, i, incs, 1, 0, 0 );
+        scr = ( uint32_t * )( _scr += scr_inc ); tex = ( uint32_t * )( _tex += tex_inc );
+    }
+}
+
+static inline void draw_span_32to32_simd( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct, int mode, DRAW_SPAN * tail )
+{
+    int n, factor = ctx->factor, factor2 = ctx->factor2;
+    uint32_t * ptr = ( uint32_t * ) dest->data + ( dest->pitch * y >> 2 ) + x, tex[4];
+
+    for ( ; pixels >= 4; pixels -= 4, x += 4, ptr += 4 )
+    {
+        for ( n = 0; n < 4; n++, s += incs, t += inct )
+            tex[n] = *(( uint32_t * ) orig->data + ( orig->pitch * ( t >> 16 ) >> 2 ) + ( s >> 16 ) );
+        pixel4_store( ptr, pixel4_blend( pixel4_load( tex ), pixel4_load( ptr ), mode, factor, factor2 ) );
+    }
+    if ( pixels ) tail( ctx, dest, orig, x, y, pixels, s, t, incs, inct );
+}
+
+#define SIMD_KERNELS(name, mode) \
+static void draw_hspan_32to32_simd_##name( BLIT_CONTEXT * ctx, uint32_t *scr, uint32_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc ) \
+{ \
+    draw_hspan_32to32_simd( ctx, scr, tex, pixels, incs, l, scr_inc, tex_inc, mode, ( DRAW_HSPAN * ) SIMD_SCALAR_##mode( draw_hspan_32to32 ) ); \
+} \
+static void draw_span_32to32_simd_##name( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct ) \
+{ \
+    draw_span_32to32_simd( ctx, dest, orig, x, y, pixels, s, t, incs, inct, mode, ( DRAW_SPAN * ) SIMD_SCALAR_##mode( draw_span_32to32 ) ); \
+}
+
+/* Scalar kernel used for the tail of every row */
+#define SIMD_SCALAR_BLEND4_ALPHA(f)         f
+#define SIMD_SCALAR_BLEND4_ABLEND_ADD(f)    f##_ablend
+#define SIMD_SCALAR_BLEND4_ABLEND_SUB(f)    f##_ablend
+#define SIMD_SCALAR_BLEND4_TABLEND_ADD(f)   f##_tablend
+#define SIMD_SCALAR_BLEND4_TABLEND_SUB(f)   f##_tablend
+#define SIMD_SCALAR_BLEND4_TRANSLUCENT(f)   f##_translucent
+
+SIMD_KERNELS( alpha, BLEND4_ALPHA )
+SIMD_KERNELS( ablend_add, BLEND4_ABLEND_ADD )
+SIMD_KERNELS( ablend_sub, BLEND4_ABLEND_SUB )
+SIMD_KERNELS( tablend_add, BLEND4_TABLEND_ADD )
+SIMD_KERNELS( tablend_sub, BLEND4_TABLEND_SUB )
+SIMD_KERNELS( translucent, BLEND4_TRANSLUCENT )
+
+/* --------------------------------------------------------------------------- */
+
+/* SIMD versions of the 16 to 16 bits translucent and blended kernels, for
+ * RGB565 screens. The alpha tables multiply each component by a factor
+ * ( c * factor >> 8, see gr_alpha16_factor ), and colorghost is the same
+ * thing with a 128 factor, so the kernels work eight pixels at a time
+ * with the components unpacked in 16 bits lanes instead of looking up
+ * the tables. The tail of each row is copied to a small buffer.
+ */
+
+enum
+{
+    BLEND8_TRANSLUCENT = 0,
+    BLEND8_ADD,
+    BLEND8_SUB
+};
+
+#ifdef BLIT_SSE2
+
+typedef __m128i PIXEL8;
+
+#define pixel8_load(p)          _mm_loadu_si128( ( const __m128i * )( p ) )
+#define pixel8_store(p,v)       _mm_storeu_si128( ( __m128i * )( p ), v )
+#define pixel8_reverse(v)       _mm_shufflehi_epi16( _mm_shufflelo_epi16( _mm_shuffle_epi32( v, 0x1B ), 0xB1 ), 0xB1 )
+
+/* Multiply the components by a factor and pack them again */
+#define pixel8_scale565(r,g,b,f) \
+    _mm_or_si128( _mm_or_si128( \
+        _mm_slli_epi16( _mm_srli_epi16( _mm_mullo_epi16( r, f ), 8 ), 11 ), \
+        _mm_slli_epi16( _mm_srli_epi16( _mm_mullo_epi16( g, f ), 8 ), 5 ) ), \
+        _mm_srli_epi16( _mm_mullo_epi16( b, f ), 8 ) )
+
+static inline PIXEL8 pixel8_blend565( PIXEL8 t, PIXEL8 s, int mode, int factor, int factor2 )
+{
+    const __m128i m5 = _mm_set1_epi16( 0x1f ), m6 = _mm_set1_epi16( 0x3f );
+    __m128i tr = _mm_srli_epi16( t, 11 ), tg = _mm_and_si128( _mm_srli_epi16( t, 5 ), m6 ), tb = _mm_and_si128( t, m5 );
+    __m128i sr = _mm_srli_epi16( s, 11 ), sg = _mm_and_si128( _mm_srli_epi16( s, 5 ), m6 ), sb = _mm_and_si128( s, m5 );
+    __m128i out;
+
+    if ( mode == BLEND8_ADD )
+    {
+        tr = _mm_min_epi16( _mm_add_epi16( tr, sr ), m5 );
+        tg = _mm_min_epi16( _mm_add_epi16( tg, sg ), m6 );
+        tb = _mm_min_epi16( _mm_add_epi16( tb, sb ), m5 );
+    }
+    else if ( mode == BLEND8_SUB )
+    {
+        tr = _mm_subs_epu16( _mm_add_epi16( tr, sr ), _mm_set1_epi16( 32 ) );
+        tg = _mm_subs_epu16( _mm_add_epi16( tg, sg ), _mm_set1_epi16( 64 ) );
+        tb = _mm_subs_epu16( _mm_add_epi16( tb, sb ), _mm_set1_epi16( 32 ) );
+    }
+
+    out = _mm_add_epi16( pixel8_scale565( tr, tg, tb, _mm_set1_epi16( factor ) ),
+                         pixel8_scale565( sr, sg, sb, _mm_set1_epi16( factor2 ) ) );
+
+    return pixel4_select( _mm_cmpeq_epi16( t, _mm_setzero_si128() ), s, out );
+}
+
+#endif
+
+#ifdef BLIT_NEON
+
+typedef uint16x8_t PIXEL8;
+
+#define pixel8_load(p)          vld1q_u16( ( const uint16_t * )( p ) )
+#define pixel8_store(p,v)       vst1q_u16( ( uint16_t * )( p ), v )
+
+static inline PIXEL8 pixel8_reverse( PIXEL8 v )
+{
+    v = vrev64q_u16( v );
+    return vextq_u16( v, v, 4 );
+}
+
+/* Multiply the components by a factor and pack them again */
+#define pixel8_scale565(r,g,b,f) \
+    vorrq_u16( vorrq_u16( \
+        vshlq_n_u16( vshrq_n_u16( vmulq_n_u16( r, f ), 8 ), 11 ), \
+        vshlq_n_u16( vshrq_n_u16( vmulq_n_u16( g, f ), 8 ), 5 ) ), \
+        vshrq_n_u16( vmulq_n_u16( b, f ), 8 ) )
+
+static inline PIXEL8 pixel8_blend565( PIXEL8 t, PIXEL8 s, int mode, int factor, int factor2 )
+{
+    const uint16x8_t m5 = vdupq_n_u16( 0x1f ), m6 = vdupq_n_u16( 0x3f );
+    uint16x8_t tr = vshrq_n_u16( t, 11 ), tg = vandq_u16( vshrq_n_u16( t, 5 ), m6 ), tb = vandq_u16( t, m5 );
+    uint16x8_t sr = vshrq_n_u16( s, 11 ), sg = vandq_u16( vshrq_n_u16( s, 5 ), m6 ), sb = vandq_u16( s, m5 );
+    uint16x8_t out;
+
+    if ( mode == BLEND8_ADD )
+    {
+        tr = vminq_u16( vaddq_u16( tr, sr ), m5 );
+        tg = vminq_u16( vaddq_u16( tg, sg ), m6 );
+        tb = vminq_u16( vaddq_u16( tb, sb ), m5 );
+    }
+    else if ( mode == BLEND8_SUB )
+    {
+        tr = vqsubq_u16( vaddq_u16( tr, sr ), vdupq_n_u16( 32 ) );
+        tg = vqsubq_u16( vaddq_u16( tg, sg ), vdupq_n_u16( 64 ) );
+        tb = vqsubq_u16( vaddq_u16( tb, sb ), vdupq_n_u16( 32 ) );
+    }
+
+    out = vaddq_u16( pixel8_scale565( tr, tg, tb, factor ), pixel8_scale565( sr, sg, sb, factor2 ) );
+
+    return vbslq_u16( vceqq_u16( t, vdupq_n_u16( 0 ) ), s, out );
+}
+
+#endif
+
+/* --------------------------------------------------------------------------- */
+
+static inline void draw_hspan_16to16_simd( BLIT_CONTEXT * ctx, uint16_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc, int mode )
+{
+    int i, n, factor = ctx->factor, factor2 = ctx->factor2;
+    uint8_t * _scr = ( uint8_t * ) scr, * _tex = ( uint8_t * ) tex;
+    uint16_t t8[8] = { 0 }, s8[8] = { 0 };
+    PIXEL8 t;
+
+    while ( l-- )
+    {
+        for ( i = pixels; i >= 8; i -= 8 )
+        {
+            if ( incs > 0 )
+                t = pixel8_load( tex );
+            else
+                t = pixel8_reverse( pixel8_load( tex - 7 ) );
+            pixel8_store( scr, pixel8_blend565( t, pixel8_load( scr ), mode, factor, factor2 ) );
+            scr += 8;
+            tex += incs * 8;
+        }
+        if ( i )
+        {
+            for ( n = 0; n < i; n++ ) t8[n] = tex[n * incs], s8[n] = scr[n];
+            pixel8_store( s8, pixel8_blend565( pixel8_load( t8 ), pixel8_load( s8 ), mode, factor, factor2 ) );
+            for ( n = 0; n < i; n++ ) scr[n] = s8[n];
+        }
+        scr = ( uint16_t * )( _scr += scr_inc ); tex = ( uint16_t * )( _tex += tex_inc );
+    }
+}
+
+static inline void draw_span_16to16_simd( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct, int mode )
+{
+    int n, count, factor = ctx->factor, factor2 = ctx->factor2;
+    uint16_t * ptr = ( uint16_t * ) dest->data + ( dest->pitch * y >> 1 ) + x, t8[8] = { 0 }, s8[8] = { 0 };
+
+    for ( ; pixels > 0; pixels -= count, ptr += count )
+    {
+        count = ( pixels < 8 ) ? pixels : 8;
+        for ( n = 0; n < count; n++, s += incs, t += inct )
+            t8[n] = *(( uint16_t * ) orig->data + ( orig->pitch * ( t >> 16 ) >> 1 ) + ( s >> 16 ) );
+        if ( count == 8 )
+            pixel8_store( ptr, pixel8_blend565( pixel8_load( t8 ), pixel8_load( ptr ), mode, factor, factor2 ) );
+        else
+        {
+            for ( n = 0; n < count; n++ ) s8[n] = ptr[n];
+            pixel8_store( s8, pixel8_blend565( pixel8_load( t8 ), pixel8_load( s8 ), mode, factor, factor2 ) );
+            for ( n = 0; n < count; n++ ) ptr[n] = s8[n];
+        }
+    }
+}
+
+#define SIMD_KERNELS16(name, mode) \
+static void draw_hspan_16to16_simd_##name( BLIT_CONTEXT * ctx, uint16_t *scr, uint16_t * tex, int pixels, int incs, int l, int scr_inc, int tex_inc ) \
+{ \
+    draw_hspan_16to16_simd( ctx, scr, tex, pixels, incs, l, scr_inc, tex_inc, mode ); \
+} \
+static void draw_span_16to16_simd_##name( BLIT_CONTEXT * ctx, GRAPH * dest, GRAPH * orig, int x, int y, int pixels, int s, int t, int incs, int inct ) \
+{ \
+    draw_span_16to16_simd( ctx, dest, orig, x, y, pixels, s, t, incs, inct, mode ); \
+}
+
+SIMD_KERNELS16( translucent, BLEND8_TRANSLUCENT )
+SIMD_KERNELS16( tablend_add, BLEND8_ADD )
+SIMD_KERNELS16( tablend_sub, BLEND8_SUB )
+
+/* --------------------------------------------------------------------------- */
+
+/* Set from the CPU features by gr_blit_init, the scalar kernels are used if 0 */
+
+static int blit_simd = 0;
+
+/* Tell if the 16 bits SIMD kernels can draw a graphic (RGB565 only) */
+
+static int blit_simd565( GRAPH * gr )
+{
+    return blit_simd && gr->format->depth == 16 &&
+           sys_pixel_format->Rmask == 0xF800 && sys_pixel_format->Gmask == 0x07E0 && sys_pixel_format->Bmask == 0x001F;
+}
+
+#endif
+
+/* --------------------------------------------------------------------------- */
+/*
+ *  FUNCTION : gr_blit_init
+ *
+ *  Select the blitter kernels for the running CPU
+ *
+ *  PARAMS :
+ *      None
+ *
+ *  RETURN VALUE :
+ *      None
+ *
+ */
+
+void gr_blit_init()
+{
+#if defined( BLIT_SSE2 )
+    blit_simd = SDL_HasSSE2() ? 1 : 0;
+#elif defined( BLIT_NEON )
+    blit_simd = 1;
+#endif
+}
+
 /* --------------------------------------------------------------------------- */
 /*
  *  FUNCTION : gr_calculate_corners
@@ -1935,6 +2456,7 @@ void gr_rotated_blit(
 
     /* Pointer to the line drawing function */
     DRAW_SPAN * draw_span = NULL;
+    BLIT_CONTEXT ctx;
 
     if ( !dest ) dest = scrbitmap;
 
@@ -1952,8 +2474,8 @@ void gr_rotated_blit(
     if ( gr->blend_table )
     {
         if ( dest->format->depth == 32 ) return ;
-        ghost1 = ( uint16_t * ) gr->blend_table ;
-        ghost2 = ( uint16_t * )( gr->blend_table + 65536 ) ;
+        ctx.ghost1 = ( uint16_t * ) gr->blend_table ;
+        ctx.ghost2 = ( uint16_t * )( gr->blend_table + 65536 ) ;
         flags |= B_TRANSLUCENT ;
     }
     else if ( flags & B_ALPHA )
@@ -1962,37 +2484,47 @@ void gr_rotated_blit(
         {
             if ( flags & B_TRANSLUCENT )
             {
-                _factor = ((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) ) >> 1;
+                ctx.factor = ((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) ) >> 1;
             }
             else
             {
-                _factor = ((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) ) ;
+                ctx.factor = ((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) ) ;
             }
 
-            _factor2 = 255 - _factor ;
+            ctx.factor2 = 255 - ctx.factor ;
         }
         else if ( dest->format->depth == 16 )
         {
+#ifdef BLIT_SIMD
+            if ( blit_simd565( gr ) )
+            {
+                int alpha = ( flags & B_TRANSLUCENT ) ? ((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) >> 1 ) : (( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT );
+
+                ctx.factor = gr_alpha16_factor( alpha );
+                ctx.factor2 = gr_alpha16_factor( 255 - alpha );
+            }
+            else
+#endif
             if ( flags & B_TRANSLUCENT )
             {
-                ghost1 = gr_alpha16((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) >> 1 );
-                ghost2 = gr_alpha16( 255 - ((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) >> 1 ) );
+                ctx.ghost1 = gr_alpha16((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) >> 1 );
+                ctx.ghost2 = gr_alpha16( 255 - ((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) >> 1 ) );
             }
             else
             {
-                ghost1 = gr_alpha16(( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT );
-                ghost2 = gr_alpha16( 255 - (( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) );
+                ctx.ghost1 = gr_alpha16(( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT );
+                ctx.ghost2 = gr_alpha16( 255 - (( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) );
             }
         }
         else if ( dest->format->depth == 8 )
         {
             if ( flags & B_TRANSLUCENT )
             {
-                ghost8 = gr_alpha8((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) >> 1 );
+                ctx.ghost8 = gr_alpha8((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) >> 1 );
             }
             else
             {
-                ghost8 = gr_alpha8(( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT );
+                ctx.ghost8 = gr_alpha8(( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT );
             }
         }
 
@@ -2000,15 +2532,15 @@ void gr_rotated_blit(
     }
     else if ( flags & B_TRANSLUCENT )
     {
-        _factor = 128 ;
-        _factor2 = 128 ;
-        ghost1 = ghost2 = colorghost ;
-        ghost8 = ( uint8_t * ) trans_table ;
+        ctx.factor = 128 ;
+        ctx.factor2 = 128 ;
+        ctx.ghost1 = ctx.ghost2 = colorghost ;
+        ctx.ghost8 = ( uint8_t * ) trans_table ;
     }
 
     if ((flags & B_TRANSLUCENT) && !trans_table_updated) gr_make_trans_table() ;
 
-    blend_func = ( BLEND_FUNC * ) NULL;
+    ctx.blend_func = ( BLEND_FUNC * ) NULL;
 
     /* Choose a line drawing function */
 
@@ -2020,12 +2552,12 @@ void gr_rotated_blit(
             {
                 if ( flags & B_ABLEND )
                 {
-                    blend_func = additive_blend8;
+                    ctx.blend_func = additive_blend8;
                     draw_span = ( DRAW_SPAN * )draw_span_8to8_tablend;
                 }
                 else if ( flags & B_SBLEND )
                 {
-                    blend_func = substractive_blend8;
+                    ctx.blend_func = substractive_blend8;
                     draw_span = ( DRAW_SPAN * )draw_span_8to8_tablend;
                 }
                 else
@@ -2035,12 +2567,12 @@ void gr_rotated_blit(
             }
             else if ( flags & B_ABLEND )
             {
-                blend_func = additive_blend8;
+                ctx.blend_func = additive_blend8;
                 draw_span = ( DRAW_SPAN * )draw_span_8to8_ablend;
             }
             else if ( flags & B_SBLEND )
             {
-                blend_func = substractive_blend8;
+                ctx.blend_func = substractive_blend8;
                 draw_span = ( DRAW_SPAN * )draw_span_8to8_ablend;
             }
             else if ( flags & B_NOCOLORKEY )
@@ -2063,18 +2595,18 @@ void gr_rotated_blit(
     {
         if ( gr->format->depth == 8 )
         {
-            pcolorequiv = gr->format->palette ? gr->format->palette->colorequiv : sys_pixel_format->palette ? sys_pixel_format->palette->colorequiv : default_colorequiv ;
+            ctx.pcolorequiv = gr->format->palette ? gr->format->palette->colorequiv : sys_pixel_format->palette ? sys_pixel_format->palette->colorequiv : default_colorequiv ;
 
             if ( flags & B_TRANSLUCENT )
             {
                 if ( flags & B_ABLEND )
                 {
-                    blend_func = additive_blend16;
+                    ctx.blend_func = additive_blend16;
                     draw_span = ( DRAW_SPAN * )draw_span_8to16_tablend;
                 }
                 else if ( flags & B_SBLEND )
                 {
-                    blend_func = substractive_blend16;
+                    ctx.blend_func = substractive_blend16;
                     draw_span = ( DRAW_SPAN * )draw_span_8to16_tablend;
                 }
                 else
@@ -2084,12 +2616,12 @@ void gr_rotated_blit(
             }
             else if ( flags & B_ABLEND )
             {
-                blend_func = additive_blend16;
+                ctx.blend_func = additive_blend16;
                 draw_span = ( DRAW_SPAN * )draw_span_8to16_ablend;
             }
             else if ( flags & B_SBLEND )
             {
-                blend_func = substractive_blend16;
+                ctx.blend_func = substractive_blend16;
                 draw_span = ( DRAW_SPAN * )draw_span_8to16_ablend;
             }
             else if ( flags & B_NOCOLORKEY )
@@ -2107,12 +2639,12 @@ void gr_rotated_blit(
             {
                 if ( flags & B_ABLEND )
                 {
-                    blend_func = additive_blend16;
+                    ctx.blend_func = additive_blend16;
                     draw_span = ( DRAW_SPAN * )draw_span_16to16_tablend;
                 }
                 else if ( flags & B_SBLEND )
                 {
-                    blend_func = substractive_blend16;
+                    ctx.blend_func = substractive_blend16;
                     draw_span = ( DRAW_SPAN * )draw_span_16to16_tablend;
                 }
                 else
@@ -2122,12 +2654,12 @@ void gr_rotated_blit(
             }
             else if ( flags & B_ABLEND )
             {
-                blend_func = additive_blend16;
+                ctx.blend_func = additive_blend16;
                 draw_span = ( DRAW_SPAN * )draw_span_16to16_ablend;
             }
             else if ( flags & B_SBLEND )
             {
-                blend_func = substractive_blend16;
+                ctx.blend_func = substractive_blend16;
                 draw_span = ( DRAW_SPAN * )draw_span_16to16_ablend;
             }
             else if ( flags & B_NOCOLORKEY )
@@ -2138,6 +2670,15 @@ void gr_rotated_blit(
             {
                 draw_span = ( DRAW_SPAN * )draw_span_16to16;
             }
+#ifdef BLIT_SIMD
+            if ( blit_simd565( gr ) && !gr->blend_table )
+            {
+                if ( draw_span == ( DRAW_SPAN * )draw_span_16to16_translucent )
+                    draw_span = ( DRAW_SPAN * )draw_span_16to16_simd_translucent;
+                else if ( draw_span == ( DRAW_SPAN * )draw_span_16to16_tablend )
+                    draw_span = ( ctx.blend_func == additive_blend16 ) ? ( DRAW_SPAN * )draw_span_16to16_simd_tablend_add : ( DRAW_SPAN * )draw_span_16to16_simd_tablend_sub;
+            }
+#endif
         }
         else if ( gr->format->depth == 1 )
         {
@@ -2152,18 +2693,18 @@ void gr_rotated_blit(
     {
         if ( gr->format->depth == 8 )
         {
-            pcolorequiv = gr->format->palette ? gr->format->palette->colorequiv : sys_pixel_format->palette ? sys_pixel_format->palette->colorequiv : default_colorequiv ;
+            ctx.pcolorequiv = gr->format->palette ? gr->format->palette->colorequiv : sys_pixel_format->palette ? sys_pixel_format->palette->colorequiv : default_colorequiv ;
 
             if ( flags & B_TRANSLUCENT )
             {
                 if ( flags & B_ABLEND )
                 {
-                    blend_func = additive_blend32;
+                    ctx.blend_func = additive_blend32;
                     draw_span = ( DRAW_SPAN * )draw_span_8to32_tablend;
                 }
                 else if ( flags & B_SBLEND )
                 {
-                    blend_func = substractive_blend32;
+                    ctx.blend_func = substractive_blend32;
                     draw_span = ( DRAW_SPAN * )draw_span_8to32_tablend;
                 }
                 else
@@ -2173,12 +2714,12 @@ void gr_rotated_blit(
             }
             else if ( flags & B_ABLEND )
             {
-                blend_func = additive_blend32;
+                ctx.blend_func = additive_blend32;
                 draw_span = ( DRAW_SPAN * )draw_span_8to32_ablend;
             }
             else if ( flags & B_SBLEND )
             {
-                blend_func = substractive_blend32;
+                ctx.blend_func = substractive_blend32;
                 draw_span = ( DRAW_SPAN * )draw_span_8to32_ablend;
             }
             else if ( flags & B_NOCOLORKEY )
@@ -2196,12 +2737,12 @@ void gr_rotated_blit(
             {
                 if ( flags & B_ABLEND )
                 {
-                    blend_func = additive_blend32;
+                    ctx.blend_func = additive_blend32;
                     draw_span = ( DRAW_SPAN * )draw_span_16to32_tablend;
                 }
                 else if ( flags & B_SBLEND )
                 {
-                    blend_func = substractive_blend32;
+                    ctx.blend_func = substractive_blend32;
                     draw_span = ( DRAW_SPAN * )draw_span_16to32_tablend;
                 }
                 else
@@ -2211,12 +2752,12 @@ void gr_rotated_blit(
             }
             else if ( flags & B_ABLEND )
             {
-                blend_func = additive_blend32;
+                ctx.blend_func = additive_blend32;
                 draw_span = ( DRAW_SPAN * )draw_span_16to32_ablend;
             }
             else if ( flags & B_SBLEND )
             {
-                blend_func = substractive_blend32;
+                ctx.blend_func = substractive_blend32;
                 draw_span = ( DRAW_SPAN * )draw_span_16to32_ablend;
             }
             else if ( flags & B_NOCOLORKEY )
@@ -2234,12 +2775,12 @@ void gr_rotated_blit(
             {
                 if ( flags & B_ABLEND )
                 {
-                    blend_func = additive_blend32;
+                    ctx.blend_func = additive_blend32;
                     draw_span = ( DRAW_SPAN * )draw_span_32to32_tablend;
                 }
                 else if ( flags & B_SBLEND )
                 {
-                    blend_func = substractive_blend32;
+                    ctx.blend_func = substractive_blend32;
                     draw_span = ( DRAW_SPAN * )draw_span_32to32_tablend;
                 }
                 else
@@ -2249,12 +2790,12 @@ void gr_rotated_blit(
             }
             else if ( flags & B_ABLEND )
             {
-                blend_func = additive_blend32;
+                ctx.blend_func = additive_blend32;
                 draw_span = ( DRAW_SPAN * )draw_span_32to32_ablend;
             }
             else if ( flags & B_SBLEND )
             {
-                blend_func = substractive_blend32;
+                ctx.blend_func = substractive_blend32;
                 draw_span = ( DRAW_SPAN * )draw_span_32to32_ablend;
             }
             else if ( flags & B_NOCOLORKEY )
@@ -2265,6 +2806,19 @@ void gr_rotated_blit(
             {
                 draw_span = ( DRAW_SPAN * )draw_span_32to32;
             }
+#ifdef BLIT_SIMD
+            if ( blit_simd )
+            {
+                if ( draw_span == ( DRAW_SPAN * )draw_span_32to32 )
+                    draw_span = ( DRAW_SPAN * )draw_span_32to32_simd_alpha;
+                else if ( draw_span == ( DRAW_SPAN * )draw_span_32to32_translucent )
+                    draw_span = ( DRAW_SPAN * )draw_span_32to32_simd_translucent;
+                else if ( draw_span == ( DRAW_SPAN * )draw_span_32to32_ablend )
+                    draw_span = ( ctx.blend_func == additive_blend32 ) ? ( DRAW_SPAN * )draw_span_32to32_simd_ablend_add : ( DRAW_SPAN * )draw_span_32to32_simd_ablend_sub;
+                else if ( draw_span == ( DRAW_SPAN * )draw_span_32to32_tablend )
+                    draw_span = ( ctx.blend_func == additive_blend32 ) ? ( DRAW_SPAN * )draw_span_32to32_simd_tablend_add : ( DRAW_SPAN * )draw_span_32to32_simd_tablend_sub;
+            }
+#endif
         }
         else if ( gr->format->depth == 1 )
         {
@@ -2435,6 +2989,7 @@ void gr_rotated_blit(
             {
                 draw_span
                 (
+                    &ctx,
                     dest,
                     gr,
                     x,
@@ -2480,8 +3035,11 @@ void gr_rotated_blit(
         }
     }
 
-    dest->info_flags &= ~GI_CLEAN;
-    dest->modified = 2 ;
+    if ( !gr_blit_defer_dest )
+    {
+        dest->info_flags &= ~GI_CLEAN;
+        dest->modified = 2 ;
+    }
 }
 
 /* --------------------------------------------------------------------------- */
@@ -2513,6 +3071,7 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
     int     direction;
 
     DRAW_HSPAN  * draw_hspan = ( DRAW_HSPAN * )NULL;
+    BLIT_CONTEXT ctx;
 
     if ( !dest ) dest = scrbitmap ;
     if ( !dest->data || !gr->data ) return;
@@ -2545,8 +3104,8 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
     if ( gr->blend_table )
     {
         if ( dest->format->depth == 32 ) return ;
-        ghost1 = ( uint16_t * ) gr->blend_table ;
-        ghost2 = ( uint16_t * )( gr->blend_table + 65536 );
+        ctx.ghost1 = ( uint16_t * ) gr->blend_table ;
+        ctx.ghost2 = ( uint16_t * )( gr->blend_table + 65536 );
         flags |= B_TRANSLUCENT ;
     }
     else if ( flags & B_ALPHA )
@@ -2555,37 +3114,47 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
         {
             if ( flags & B_TRANSLUCENT )
             {
-                _factor = ((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) ) >> 1;
+                ctx.factor = ((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) ) >> 1;
             }
             else
             {
-                _factor = ((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) ) ;
+                ctx.factor = ((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) ) ;
             }
 
-            _factor2 = 255 - _factor ;
+            ctx.factor2 = 255 - ctx.factor ;
         }
         else if ( dest->format->depth == 16 )
         {
+#ifdef BLIT_SIMD
+            if ( blit_simd565( gr ) )
+            {
+                int alpha = ( flags & B_TRANSLUCENT ) ? ((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) >> 1 ) : (( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT );
+
+                ctx.factor = gr_alpha16_factor( alpha );
+                ctx.factor2 = gr_alpha16_factor( 255 - alpha );
+            }
+            else
+#endif
             if ( flags & B_TRANSLUCENT )
             {
-                ghost1 = gr_alpha16((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) >> 1 );
-                ghost2 = gr_alpha16( 255 - ((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) >> 1 ) );
+                ctx.ghost1 = gr_alpha16((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) >> 1 );
+                ctx.ghost2 = gr_alpha16( 255 - ((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) >> 1 ) );
             }
             else
             {
-                ghost1 = gr_alpha16(( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT );
-                ghost2 = gr_alpha16( 255 - (( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) );
+                ctx.ghost1 = gr_alpha16(( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT );
+                ctx.ghost2 = gr_alpha16( 255 - (( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) );
             }
         }
         else if ( dest->format->depth == 8 )
         {
             if ( flags & B_TRANSLUCENT )
             {
-                ghost8 = gr_alpha8((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) >> 1 );
+                ctx.ghost8 = gr_alpha8((( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT ) >> 1 );
             }
             else
             {
-                ghost8 = gr_alpha8(( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT );
+                ctx.ghost8 = gr_alpha8(( flags & B_ALPHA_MASK ) >> B_ALPHA_SHIFT );
             }
         }
 
@@ -2593,15 +3162,15 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
     }
     else if ( flags & B_TRANSLUCENT )
     {
-        _factor = 128 ;
-        _factor2 = 128 ;
-        ghost1 = ghost2 = colorghost ;
-        ghost8 = ( uint8_t * ) trans_table ;
+        ctx.factor = 128 ;
+        ctx.factor2 = 128 ;
+        ctx.ghost1 = ctx.ghost2 = colorghost ;
+        ctx.ghost8 = ( uint8_t * ) trans_table ;
     }
 
     if ((flags & B_TRANSLUCENT) && !trans_table_updated) gr_make_trans_table() ;
 
-    blend_func = ( BLEND_FUNC * ) NULL;
+    ctx.blend_func = ( BLEND_FUNC * ) NULL;
 
     /* Choose a line drawing function */
 
@@ -2613,12 +3182,12 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
             {
                 if ( flags & B_ABLEND )
                 {
-                    blend_func = additive_blend8;
+                    ctx.blend_func = additive_blend8;
                     draw_hspan = ( DRAW_HSPAN * )draw_hspan_8to8_tablend;
                 }
                 else if ( flags & B_SBLEND )
                 {
-                    blend_func = substractive_blend8;
+                    ctx.blend_func = substractive_blend8;
                     draw_hspan = ( DRAW_HSPAN * )draw_hspan_8to8_tablend;
                 }
                 else
@@ -2628,12 +3197,12 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
             }
             else if ( flags & B_ABLEND )
             {
-                blend_func = additive_blend8;
+                ctx.blend_func = additive_blend8;
                 draw_hspan = ( DRAW_HSPAN * )draw_hspan_8to8_ablend;
             }
             else if ( flags & B_SBLEND )
             {
-                blend_func = substractive_blend8;
+                ctx.blend_func = substractive_blend8;
                 draw_hspan = ( DRAW_HSPAN * )draw_hspan_8to8_ablend;
             }
             else if ( flags & B_NOCOLORKEY )
@@ -2656,18 +3225,18 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
     {
         if ( gr->format->depth == 8 )
         {
-            pcolorequiv = gr->format->palette ? gr->format->palette->colorequiv : sys_pixel_format->palette ? sys_pixel_format->palette->colorequiv : default_colorequiv ;
+            ctx.pcolorequiv = gr->format->palette ? gr->format->palette->colorequiv : sys_pixel_format->palette ? sys_pixel_format->palette->colorequiv : default_colorequiv ;
 
             if ( flags & B_TRANSLUCENT )
             {
                 if ( flags & B_ABLEND )
                 {
-                    blend_func = additive_blend16;
+                    ctx.blend_func = additive_blend16;
                     draw_hspan = ( DRAW_HSPAN * )draw_hspan_8to16_tablend;
                 }
                 else if ( flags & B_SBLEND )
                 {
-                    blend_func = substractive_blend16;
+                    ctx.blend_func = substractive_blend16;
                     draw_hspan = ( DRAW_HSPAN * )draw_hspan_8to16_tablend;
                 }
                 else
@@ -2677,12 +3246,12 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
             }
             else if ( flags & B_ABLEND )
             {
-                blend_func = additive_blend16;
+                ctx.blend_func = additive_blend16;
                 draw_hspan = ( DRAW_HSPAN * )draw_hspan_8to16_ablend;
             }
             else if ( flags & B_SBLEND )
             {
-                blend_func = substractive_blend16;
+                ctx.blend_func = substractive_blend16;
                 draw_hspan = ( DRAW_HSPAN * )draw_hspan_8to16_ablend;
             }
             else if ( flags & B_NOCOLORKEY )
@@ -2700,12 +3269,12 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
             {
                 if ( flags & B_ABLEND )
                 {
-                    blend_func = additive_blend16;
+                    ctx.blend_func = additive_blend16;
                     draw_hspan = ( DRAW_HSPAN * )draw_hspan_16to16_tablend;
                 }
                 else if ( flags & B_SBLEND )
                 {
-                    blend_func = substractive_blend16;
+                    ctx.blend_func = substractive_blend16;
                     draw_hspan = ( DRAW_HSPAN * )draw_hspan_16to16_tablend;
                 }
                 else
@@ -2715,12 +3284,12 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
             }
             else if ( flags & B_ABLEND )
             {
-                blend_func = additive_blend16;
+                ctx.blend_func = additive_blend16;
                 draw_hspan = ( DRAW_HSPAN * )draw_hspan_16to16_ablend;
             }
             else if ( flags & B_SBLEND )
             {
-                blend_func = substractive_blend16;
+                ctx.blend_func = substractive_blend16;
                 draw_hspan = ( DRAW_HSPAN * )draw_hspan_16to16_ablend;
             }
             else if ( flags & B_NOCOLORKEY )
@@ -2731,6 +3300,15 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
             {
                 draw_hspan = ( DRAW_HSPAN * )draw_hspan_16to16;
             }
+#ifdef BLIT_SIMD
+            if ( blit_simd565( gr ) && !gr->blend_table )
+            {
+                if ( draw_hspan == ( DRAW_HSPAN * )draw_hspan_16to16_translucent )
+                    draw_hspan = ( DRAW_HSPAN * )draw_hspan_16to16_simd_translucent;
+                else if ( draw_hspan == ( DRAW_HSPAN * )draw_hspan_16to16_tablend )
+                    draw_hspan = ( ctx.blend_func == additive_blend16 ) ? ( DRAW_HSPAN * )draw_hspan_16to16_simd_tablend_add : ( DRAW_HSPAN * )draw_hspan_16to16_simd_tablend_sub;
+            }
+#endif
         }
         else if ( gr->format->depth == 1 )
         {
@@ -2745,18 +3323,18 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
     {
         if ( gr->format->depth == 8 )
         {
-            pcolorequiv = gr->format->palette ? gr->format->palette->colorequiv : sys_pixel_format->palette ? sys_pixel_format->palette->colorequiv : default_colorequiv ;
+            ctx.pcolorequiv = gr->format->palette ? gr->format->palette->colorequiv : sys_pixel_format->palette ? sys_pixel_format->palette->colorequiv : default_colorequiv ;
 
             if ( flags & B_TRANSLUCENT )
             {
                 if ( flags & B_ABLEND )
                 {
-                    blend_func = additive_blend32;
+                    ctx.blend_func = additive_blend32;
                     draw_hspan = ( DRAW_HSPAN * )draw_hspan_8to32_tablend;
                 }
                 else if ( flags & B_SBLEND )
                 {
-                    blend_func = substractive_blend32;
+                    ctx.blend_func = substractive_blend32;
                     draw_hspan = ( DRAW_HSPAN * )draw_hspan_8to32_tablend;
                 }
                 else
@@ -2766,12 +3344,12 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
             }
             else if ( flags & B_ABLEND )
             {
-                blend_func = additive_blend32;
+                ctx.blend_func = additive_blend32;
                 draw_hspan = ( DRAW_HSPAN * )draw_hspan_8to32_ablend;
             }
             else if ( flags & B_SBLEND )
             {
-                blend_func = substractive_blend32;
+                ctx.blend_func = substractive_blend32;
                 draw_hspan = ( DRAW_HSPAN * )draw_hspan_8to32_ablend;
             }
             else if ( flags & B_NOCOLORKEY )
@@ -2789,12 +3367,12 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
             {
                 if ( flags & B_ABLEND )
                 {
-                    blend_func = additive_blend32;
+                    ctx.blend_func = additive_blend32;
                     draw_hspan = ( DRAW_HSPAN * )draw_hspan_16to32_tablend;
                 }
                 else if ( flags & B_SBLEND )
                 {
-                    blend_func = substractive_blend32;
+                    ctx.blend_func = substractive_blend32;
                     draw_hspan = ( DRAW_HSPAN * )draw_hspan_16to32_tablend;
                 }
                 else
@@ -2804,12 +3382,12 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
             }
             else if ( flags & B_ABLEND )
             {
-                blend_func = additive_blend32;
+                ctx.blend_func = additive_blend32;
                 draw_hspan = ( DRAW_HSPAN * )draw_hspan_16to32_ablend;
             }
             else if ( flags & B_SBLEND )
             {
-                blend_func = substractive_blend32;
+                ctx.blend_func = substractive_blend32;
                 draw_hspan = ( DRAW_HSPAN * )draw_hspan_16to32_ablend;
             }
             else if ( flags & B_NOCOLORKEY )
@@ -2827,12 +3405,12 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
             {
                 if ( flags & B_ABLEND )
                 {
-                    blend_func = additive_blend32;
+                    ctx.blend_func = additive_blend32;
                     draw_hspan = ( DRAW_HSPAN * )draw_hspan_32to32_tablend;
                 }
                 else if ( flags & B_SBLEND )
                 {
-                    blend_func = substractive_blend32;
+                    ctx.blend_func = substractive_blend32;
                     draw_hspan = ( DRAW_HSPAN * )draw_hspan_32to32_tablend;
                 }
                 else
@@ -2842,12 +3420,12 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
             }
             else if ( flags & B_ABLEND )
             {
-                blend_func = additive_blend32;
+                ctx.blend_func = additive_blend32;
                 draw_hspan = ( DRAW_HSPAN * )draw_hspan_32to32_ablend;
             }
             else if ( flags & B_SBLEND )
             {
-                blend_func = substractive_blend32;
+                ctx.blend_func = substractive_blend32;
                 draw_hspan = ( DRAW_HSPAN * )draw_hspan_32to32_ablend;
             }
             else if ( flags & B_NOCOLORKEY )
@@ -2858,6 +3436,19 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
             {
                 draw_hspan = ( DRAW_HSPAN * )draw_hspan_32to32;
             }
+#ifdef BLIT_SIMD
+            if ( blit_simd )
+            {
+                if ( draw_hspan == ( DRAW_HSPAN * )draw_hspan_32to32 )
+                    draw_hspan = ( DRAW_HSPAN * )draw_hspan_32to32_simd_alpha;
+                else if ( draw_hspan == ( DRAW_HSPAN * )draw_hspan_32to32_translucent )
+                    draw_hspan = ( DRAW_HSPAN * )draw_hspan_32to32_simd_translucent;
+                else if ( draw_hspan == ( DRAW_HSPAN * )draw_hspan_32to32_ablend )
+                    draw_hspan = ( ctx.blend_func == additive_blend32 ) ? ( DRAW_HSPAN * )draw_hspan_32to32_simd_ablend_add : ( DRAW_HSPAN * )draw_hspan_32to32_simd_ablend_sub;
+                else if ( draw_hspan == ( DRAW_HSPAN * )draw_hspan_32to32_tablend )
+                    draw_hspan = ( ctx.blend_func == additive_blend32 ) ? ( DRAW_HSPAN * )draw_hspan_32to32_simd_tablend_add : ( DRAW_HSPAN * )draw_hspan_32to32_simd_tablend_sub;
+            }
+#endif
         }
         else if ( gr->format->depth == 1 )
         {
@@ -2926,7 +3517,7 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
 
     /* Calculate the initial pointers and advances */
 
-    posx = s;
+    ctx.posx = s;
     if ( dest->format->depth == 1 )
         scr = ( uint8_t * ) dest->data + dest->pitch * y + x / 8;
     else
@@ -2944,10 +3535,13 @@ void gr_blit( GRAPH * dest, REGION * clip, int scrx, int scry, int flags, GRAPH
     if ( flags & B_VMIRROR ) tex_inc = -gr->pitch; else tex_inc = gr->pitch ;
     if ( flags & B_HMIRROR ) direction = -1; else direction = 1;
 
-    if ( p > 0 ) draw_hspan( scr, tex, p, direction, l, scr_inc, tex_inc );
+    if ( p > 0 ) draw_hspan( &ctx, scr, tex, p, direction, l, scr_inc, tex_inc );
 
-    dest->info_flags &= ~GI_CLEAN;
-    dest->modified = 2 ;
+    if ( !gr_blit_defer_dest )
+    {
+        dest->info_flags &= ~GI_CLEAN;
+        dest->modified = 2 ;
+    }
 }
 
 /* --------------------------------------------------------------------------- */
@@ -30,8 +30,20 @@
 /* exports                                                                     */
 /* --------------------------------------------------------------------------- */
 
+#include "bgddl.h"
+
 #include "libblit.h"
 
+/* --------------------------------------------------------------------------- */
+/* Module initialization                                                       */
+
+void __bgdexport( libblit, module_initialize )()
+{
+    gr_blit_init() ;
+}
+
+/* --------------------------------------------------------------------------- */
+
 #include "libblit_exports.h"
 
 /* --------------------------------------------------------------------------- */
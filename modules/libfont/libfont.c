@@ -32,6 +32,7 @@
 #include <string.h>
 
 #include "bgdrtm.h"
+#include "savestate.h"
 
 #define __LIB_FONT
 #include "libfont.h"
@@ -451,7 +452,7 @@ int gr_font_newfrombitmap( GRAPH * map, int charset, int width, int height, int
             else
                 f->glyph[i].xadvance = width + 1;
 
-            bitmap->modified = 0 ;
+            bitmap_clear_modified( bitmap );
             bitmap->info_flags = 0 ;
         }
     }
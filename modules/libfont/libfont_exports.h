@@ -39,6 +39,10 @@
 
 void __bgdexport( libfont, module_initialize )()
 {
+    /* Las fuentes estan en el heap, se guardan con el */
+    savestate_register_ptr( fonts );
+    savestate_register_var( font_count );
+
     gr_font_systemfont( ( char * ) default_font );
 }
 
@@ -40,6 +40,9 @@ uint32_t * map_code_bmp = NULL ;
 int map_code_allocated = 0 ;
 int map_code_last = 0;
 
+/* Not part of save states on purpose, a serial must never be reused */
+static uint32_t bitmap_serial = 0 ;
+
 /* --------------------------------------------------------------------------- */
 
 PIXEL_FORMAT * bitmap_create_format( int bpp )
@@ -151,6 +154,7 @@ GRAPH * bitmap_new_ex( int code, int w, int h, int depth, void * data, int pitch
     gr->blend_table = NULL ;
 
     gr->modified = 0;
+    gr->serial = ++bitmap_serial ;
     gr->info_flags = GI_EXTERNAL_DATA ;
 
     return gr ;
@@ -204,6 +208,7 @@ GRAPH * bitmap_new( int code, int w, int h, int depth )
     gr->blend_table = NULL ;
 
     gr->modified = 0;
+    gr->serial = ++bitmap_serial ;
     gr->info_flags = 0;
 
     return gr ;
@@ -310,6 +315,18 @@ void bitmap_destroy( GRAPH * map )
     bgd_free( map ) ;
 }
 
+/* --------------------------------------------------------------------------- */
+
+/* Marks a bitmap as drawn, anything cached from a modified one is stale */
+
+void bitmap_clear_modified( GRAPH * map )
+{
+    if ( !map->modified ) return ;
+
+    map->modified = 0 ;
+    map->serial = ++bitmap_serial ;
+}
+
 /* --------------------------------------------------------------------------- */
 /* Análisis */
 
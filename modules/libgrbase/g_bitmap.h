@@ -92,6 +92,9 @@ typedef struct _bitmap
                                1 - bitmap is modified
                                2 - bitmap is modified and needs analysis
                              */
+    uint32_t serial;        /* Changes when the bitmap is created and when it is
+                               marked as not modified, caches built from its
+                               pixels compare it */
     int info_flags;         /* Analysis result (see bitmap_analize) */
 
     void * data;            /* Pointer to the bitmap data at current frame */
@@ -121,6 +124,7 @@ extern void bitmap_destroy_fake( GRAPH * map );
 extern void bitmap_add_cpoint( GRAPH *map, int x, int y );
 extern void bitmap_set_cpoint( GRAPH * map, uint32_t point, int x, int y );
 extern void bitmap_analize( GRAPH * bitmap );
+extern void bitmap_clear_modified( GRAPH * map );
 
 extern PIXEL_FORMAT * bitmap_create_format( int bpp );
 
@@ -33,6 +33,7 @@
 
 #include "bgddl.h"
 #include "dlvaracc.h"
+#include "savestate.h"
 
 /* --------------------------------------------------------------------------- */
 
@@ -49,6 +50,37 @@ static uint8_t * alpha8[ 256 ];
 static int alpha16_tables_ok = 0 ;
 static int alpha8_tables_ok = 0 ;
 
+/* Number of 16 bit alpha levels, fixed the first time they are used. With
+ * render threads that is the serial pass that prepares the frame */
+static int alpha16_steps = 0 ;
+
+/* --------------------------------------------------------------------------- */
+/*
+ *  FUNCTION : gr_conversion_savestate_register
+ *
+ *  The tables are built on demand in the heap, so their pointers must
+ *  follow the heap when a state is loaded.
+ *
+ *  PARAMS :
+ *      None
+ *
+ *  RETURN VALUE :
+ *      None
+ *
+ */
+
+void gr_conversion_savestate_register()
+{
+    savestate_register_ptr( convert565ToScreen );
+    savestate_register_ptr( convertScreenTo565 );
+    savestate_register_var( conversion_tables_ok );
+    savestate_register_ptr( alpha16 );
+    savestate_register_ptr( alpha8 );
+    savestate_register_var( alpha16_tables_ok );
+    savestate_register_var( alpha16_steps );
+    savestate_register_var( alpha8_tables_ok );
+}
+
 /* --------------------------------------------------------------------------- */
 /* used for variable access                                                    */
 /* --------------------------------------------------------------------------- */
@@ -93,6 +125,8 @@ static void init_alpha16_tables( int count )
     if ( count <= 0 ) count = 1;
     if ( count > 128 ) count = 128;
 
+    alpha16_steps = count;
+
     if ( alpha16_tables_ok == count ) return ;
 
     inc = 256 / count;
@@ -193,6 +227,9 @@ static void init_alpha8_tables( int count )
     else
         rgb = sys_pixel_format->palette->rgb ;
 
+    /* Para que gr_find_nearest_color use el indice de la paleta */
+    gr_make_palette_index();
+
     for ( i = 0; i < 256; i++ )
     {
         if ( i == next )
@@ -453,10 +490,61 @@ void gr_fade16( GRAPH * graph, int r, int g, int b )
 
 uint16_t * gr_alpha16( int alpha )
 {
-    if ( !alpha16_tables_ok ) init_alpha16_tables( GLODWORD( libgrbase, ALPHA_STEPS ) );
+    if ( !alpha16_tables_ok ) init_alpha16_tables( gr_alpha16_steps() );
     return alpha16[ alpha ];
 }
 
+/* --------------------------------------------------------------------------- */
+/*
+ *  FUNCTION : gr_alpha16_steps
+ *
+ *  Get the number of 16 bit alpha levels, taken from ALPHA_STEPS the first
+ *  time it is needed
+ *
+ *  PARAMS :
+ *      None
+ *
+ *  RETURN VALUE :
+ *      Number of levels
+ *
+ */
+
+int gr_alpha16_steps()
+{
+    if ( !alpha16_steps )
+    {
+        alpha16_steps = GLODWORD( libgrbase, ALPHA_STEPS ) ;
+        if ( alpha16_steps <= 0 ) alpha16_steps = 1;
+        if ( alpha16_steps > 128 ) alpha16_steps = 128;
+    }
+
+    return alpha16_steps ;
+}
+
+/* --------------------------------------------------------------------------- */
+/*
+ *  FUNCTION : gr_alpha16_factor
+ *
+ *  Get the multiplication factor (0 to 256) used by the alpha table of an
+ *  alpha value. Each color component c is ( c * factor ) >> 8 in that table,
+ *  so it allows to blend without the tables (they are not created here).
+ *
+ *  PARAMS :
+ *  alpha   Alpha value
+ *
+ *  RETURN VALUE :
+ *      Factor of the alpha table
+ *
+ */
+
+int gr_alpha16_factor( int alpha )
+{
+    int inc = 256 / gr_alpha16_steps() ;
+    alpha = ( alpha / inc ) * inc + inc / 2 ;
+
+    return ( alpha > 255 ) ? 256 : alpha ;
+}
+
 /* --------------------------------------------------------------------------- */
 /*
  *  FUNCTION : gr_alpha8
@@ -35,6 +35,10 @@ extern void gr_convert16_ScreenTo565( uint16_t * ptr, int len );
 extern void gr_convert16_565ToScreen( uint16_t * ptr, int len );
 extern void gr_fade16( GRAPH * graph, int r, int g, int b );
 extern uint16_t * gr_alpha16( int alpha );
+extern int gr_alpha16_steps();
+extern int gr_alpha16_factor( int alpha );
 extern uint8_t * gr_alpha8( int alpha );
 
+extern void gr_conversion_savestate_register();
+
 #endif
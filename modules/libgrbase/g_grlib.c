@@ -33,6 +33,7 @@
 
 #include "libgrbase.h"
 #include "bitwise_map.h"
+#include "savestate.h"
 
 /* --------------------------------------------------------------------------- */
 
@@ -348,6 +349,12 @@ GRAPH * bitmap_get( int libid, int mapcode )
 void grlib_init()
 {
     if ( !syslib ) syslib = grlib_create() ;
+
+    savestate_register_ptr( syslib );
+    savestate_register_ptr( libs_bmp );
+    savestate_register_var( libs_allocated );
+    savestate_register_var( libs_last );
+    savestate_register_ptr( libs );
 }
 
 /* --------------------------------------------------------------------------- */
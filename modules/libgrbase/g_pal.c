@@ -34,6 +34,14 @@
 
 #include "libgrbase.h"
 
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define PAL_SSE2
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#include <arm_neon.h>
+#define PAL_NEON
+#endif
+
 /* --------------------------------------------------------------------------- */
 
 PALETTE * first_palette = NULL ;
@@ -311,6 +319,241 @@ uint8_t default_palette[] =
 
 uint32_t default_colorequiv[256];
 
+/* --------------------------------------------------------------------------- */
+/* Indice de la paleta para buscar el color mas cercano                        */
+/*                                                                             */
+/* El cubo RGB se parte en 8x8x8 celdas, y cada una guarda por orden de indice */
+/* los colores que pueden ser el mas cercano a algun punto de ella. Buscar en  */
+/* toda la paleta solo mira los candidatos de una celda.                       */
+/*                                                                             */
+/* Las busquedas limitadas a un rango de indices (trans_table) recorren el     */
+/* rango con SIMD. Para eso se guarda tambien la paleta como r,g y b,0 en      */
+/* pares de 16 bits.                                                           */
+
+#define PAL_CELL_SHIFT  5                           /* 32 niveles por celda */
+#define PAL_CELLS       ( 256 >> PAL_CELL_SHIFT )   /* Celdas por componente */
+
+typedef struct
+{
+    rgb_component   rgb[ 256 ] ;        /* Copia de la paleta indexada */
+    int16_t         rg[ 256 * 2 ] ;
+    int16_t         b0[ 256 * 2 ] ;
+    uint16_t        cell_count[ PAL_CELLS * PAL_CELLS * PAL_CELLS ] ;
+    uint8_t         cell_list[ PAL_CELLS * PAL_CELLS * PAL_CELLS ][ 256 ] ;
+}
+PAL_INDEX ;
+
+/* Indice de la paleta del sistema. Lo rehace gr_make_palette_index y deja de
+   valer en cuanto cambia cualquier paleta */
+
+static PAL_INDEX sys_index ;
+static PALETTE * sys_index_pal = NULL ;     /* NULL es la paleta por defecto */
+static int sys_index_valid = 0 ;
+
+/* Distancias al cuadrado de cada valor de una componente al punto mas cercano
+   y al mas lejano de cada celda */
+
+static uint16_t cell_near[ PAL_CELLS ][ 256 ] ;
+static uint16_t cell_far[ PAL_CELLS ][ 256 ] ;
+static int cell_tables_ready = 0 ;
+
+/* --------------------------------------------------------------------------- */
+
+static void pal_index_build_cells( PAL_INDEX * pi )
+{
+    rgb_component * rgb = pi->rgb ;
+    uint8_t repeated[ 256 ] ;
+    unsigned int bound, d ;
+    int i, n, k, v, lo, hi, cr, cg, cb, cell = 0 ;
+
+    if ( !cell_tables_ready )
+    {
+        for ( k = 0; k < PAL_CELLS; k++ )
+        {
+            lo = k << PAL_CELL_SHIFT ;
+            hi = lo + ( 1 << PAL_CELL_SHIFT ) - 1 ;
+
+            for ( v = 0; v < 256; v++ )
+            {
+                d = ( v < lo ) ? lo - v : ( v > hi ) ? v - hi : 0 ;
+                cell_near[ k ][ v ] = d * d ;
+                d = ( v - lo > hi - v ) ? v - lo : hi - v ;
+                cell_far[ k ][ v ] = d * d ;
+            }
+        }
+        cell_tables_ready = 1 ;
+    }
+
+    /* Un color repetido nunca gana al de indice menor */
+
+    for ( i = 0; i < 256; i++ )
+        for ( repeated[ i ] = 0, n = 0; n < i && !repeated[ i ]; n++ )
+            repeated[ i ] = !memcmp( &rgb[ n ], &rgb[ i ], sizeof( rgb_component ) ) ;
+
+    /* El mas cercano a un punto de la celda, y los que empatan con el, estan
+       como mucho a la menor de las distancias a su punto mas lejano */
+
+    for ( cr = 0; cr < PAL_CELLS; cr++ )
+        for ( cg = 0; cg < PAL_CELLS; cg++ )
+            for ( cb = 0; cb < PAL_CELLS; cb++, cell++ )
+            {
+                bound = ~0 ;
+                for ( i = 0; i < 256; i++ )
+                {
+                    d = cell_far[ cr ][ rgb[ i ].r ] + cell_far[ cg ][ rgb[ i ].g ] + cell_far[ cb ][ rgb[ i ].b ] ;
+                    if ( d < bound ) bound = d ;
+                }
+
+                for ( i = 0, n = 0; i < 256; i++ )
+                    if ( !repeated[ i ] && cell_near[ cr ][ rgb[ i ].r ] + cell_near[ cg ][ rgb[ i ].g ] + cell_near[ cb ][ rgb[ i ].b ] <= bound )
+                        pi->cell_list[ cell ][ n++ ] = i ;
+
+                pi->cell_count[ cell ] = n ;
+            }
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void pal_index_build( PAL_INDEX * pi, rgb_component * rgb )
+{
+    int i ;
+
+    memcpy( pi->rgb, rgb, sizeof( pi->rgb ) ) ;
+
+    for ( i = 0; i < 256; i++ )
+    {
+        pi->rg[ i * 2 ] = rgb[ i ].r ;
+        pi->rg[ i * 2 + 1 ] = rgb[ i ].g ;
+        pi->b0[ i * 2 ] = rgb[ i ].b ;
+        pi->b0[ i * 2 + 1 ] = 0 ;
+    }
+
+    pal_index_build_cells( pi ) ;
+}
+
+/* --------------------------------------------------------------------------- */
+/*
+ * Same result as the linear search: the smallest distance, and on ties the
+ * lowest index. Each SIMD lane keeps the first minimum of its own entries.
+ */
+
+static int pal_index_find( PAL_INDEX * pi, int first, int last, int r, int g, int b )
+{
+    unsigned int smallest = ~0;
+    unsigned int distance;
+    int rd, gd, bd;
+    int i = first;
+    int pixel = 0;
+
+    /* Toda la paleta: solo los candidatos de la celda, por orden de indice */
+    if ( first == 0 && last == 255 && !( ( r | g | b ) & ~0xFF ) )
+    {
+        int cell = ( ( ( r >> PAL_CELL_SHIFT ) * PAL_CELLS ) + ( g >> PAL_CELL_SHIFT ) ) * PAL_CELLS + ( b >> PAL_CELL_SHIFT ) ;
+        uint8_t * list = pi->cell_list[ cell ] ;
+        int n = pi->cell_count[ cell ] ;
+
+        while ( n-- )
+        {
+            i = *list++ ;
+            rd = ( pi->rgb[i].r - r ) ;
+            gd = ( pi->rgb[i].g - g ) ;
+            bd = ( pi->rgb[i].b - b ) ;
+
+            distance = ( rd * rd ) + ( gd * gd ) + ( bd * bd ) ;
+            if ( distance < smallest )
+            {
+                pixel = i;
+                if ( !distance ) break;  /* Perfect match! */
+                smallest = distance;
+            }
+        }
+
+        return( pixel );
+    }
+
+#if defined( PAL_SSE2 ) || defined( PAL_NEON )
+    if ( last - first >= 3 && r >= 0 && r <= 255 && g >= 0 && g <= 255 && b >= 0 && b <= 255 )
+    {
+        int32_t lane_best[ 4 ], lane_index[ 4 ], n ;
+#if defined( PAL_SSE2 )
+        __m128i qrg = _mm_set1_epi32( ( g << 16 ) | r ), qb = _mm_set1_epi32( b ) ;
+        __m128i best = _mm_set1_epi32( 0x7fffffff ), index = _mm_setzero_si128() ;
+        __m128i cur = _mm_setr_epi32( i, i + 1, i + 2, i + 3 ), four = _mm_set1_epi32( 4 ) ;
+
+        for ( ; i + 3 <= last; i += 4 )
+        {
+            __m128i d = _mm_sub_epi16( _mm_loadu_si128( ( const __m128i * ) &pi->rg[ i * 2 ] ), qrg ) ;
+            __m128i e = _mm_sub_epi16( _mm_loadu_si128( ( const __m128i * ) &pi->b0[ i * 2 ] ), qb ) ;
+            __m128i dist = _mm_add_epi32( _mm_madd_epi16( d, d ), _mm_madd_epi16( e, e ) ) ;
+            __m128i lt = _mm_cmplt_epi32( dist, best ) ;
+
+            best = _mm_or_si128( _mm_and_si128( lt, dist ), _mm_andnot_si128( lt, best ) ) ;
+            index = _mm_or_si128( _mm_and_si128( lt, cur ), _mm_andnot_si128( lt, index ) ) ;
+            cur = _mm_add_epi32( cur, four ) ;
+
+            /* Perfect match! */
+            if ( _mm_movemask_epi8( _mm_cmpeq_epi32( dist, _mm_setzero_si128() ) ) ) { i += 4 ; break ; }
+        }
+
+        _mm_storeu_si128( ( __m128i * ) lane_best, best ) ;
+        _mm_storeu_si128( ( __m128i * ) lane_index, index ) ;
+#else
+        int16x4_t qr = vdup_n_s16( r ), qg = vdup_n_s16( g ), qb = vdup_n_s16( b ) ;
+        int32x4_t best = vdupq_n_s32( 0x7fffffff ), index = vdupq_n_s32( 0 ), four = vdupq_n_s32( 4 ) ;
+        int32_t lanes[ 4 ] = { i, i + 1, i + 2, i + 3 } ;
+        int32x4_t cur = vld1q_s32( lanes ) ;
+
+        for ( ; i + 3 <= last; i += 4 )
+        {
+            int16x4x2_t rg = vld2_s16( &pi->rg[ i * 2 ] ), b0 = vld2_s16( &pi->b0[ i * 2 ] ) ;
+            int16x4_t dr = vsub_s16( rg.val[ 0 ], qr ), dg = vsub_s16( rg.val[ 1 ], qg ), db = vsub_s16( b0.val[ 0 ], qb ) ;
+            int32x4_t dist = vmlal_s16( vmlal_s16( vmull_s16( dr, dr ), dg, dg ), db, db ) ;
+            uint32x4_t lt = vcltq_s32( dist, best ) ;
+            uint32x4_t zero = vceqq_s32( dist, vdupq_n_s32( 0 ) ) ;
+            uint32x2_t any = vorr_u32( vget_low_u32( zero ), vget_high_u32( zero ) ) ;
+
+            best = vbslq_s32( lt, dist, best ) ;
+            index = vbslq_s32( lt, cur, index ) ;
+            cur = vaddq_s32( cur, four ) ;
+
+            /* Perfect match! */
+            if ( vget_lane_u32( any, 0 ) | vget_lane_u32( any, 1 ) ) { i += 4 ; break ; }
+        }
+
+        vst1q_s32( lane_best, best ) ;
+        vst1q_s32( lane_index, index ) ;
+#endif
+        for ( n = 0; n < 4; n++ )
+        {
+            if ( ( unsigned int ) lane_best[ n ] < smallest || ( ( unsigned int ) lane_best[ n ] == smallest && lane_index[ n ] < pixel ) )
+            {
+                pixel = lane_index[ n ];
+                smallest = lane_best[ n ];
+            }
+        }
+
+        if ( !smallest ) return( pixel );
+    }
+#endif
+
+    for ( ; i <= last; ++i )
+    {
+        rd = ( pi->rgb[i].r - r ) ;
+        gd = ( pi->rgb[i].g - g ) ;
+        bd = ( pi->rgb[i].b - b ) ;
+
+        distance = ( rd * rd ) + ( gd * gd ) + ( bd * bd ) ;
+        if ( distance < smallest )
+        {
+            pixel = i;
+            if ( !distance ) break;  /* Perfect match! */
+            smallest = distance;
+        }
+    }
+
+    return( pixel );
+}
+
 /* --------------------------------------------------------------------------- */
 /*
  * Match an RGB value to a particular palette index
@@ -333,6 +576,10 @@ int find_nearest_color( PALETTE * pal, int first, int last, int r, int g, int b
     else
         palrgb = pal->rgb ;
 
+    /* La paleta indexada, si no ha cambiado ninguna desde gr_make_palette_index */
+    if ( sys_index_valid && ( pal ? pal : sys_pixel_format->palette ) == sys_index_pal )
+        return pal_index_find( &sys_index, first, last, r, g, b );
+
     for ( i = first; i <= last; ++i )
     {
         rd = ( palrgb[i].r - ( r /*& ~0x02 */) ) ;
@@ -416,6 +663,8 @@ void _get_rgb( PIXEL_FORMAT * format, int color, int *r, int *g, int *b )
 
 void pal_refresh( PALETTE * pal )
 {
+    gr_invalidate_palette_index() ;
+
     if ( sys_pixel_format->depth > 8 )
     {
         int n;
@@ -529,6 +778,8 @@ void pal_destroy( PALETTE * pal )
 
     if ( pal == first_palette ) first_palette = pal->next ;
 
+    if ( pal == sys_index_pal ) gr_invalidate_palette_index() ;
+
     bgd_free( pal );
 }
 
@@ -573,6 +824,8 @@ int pal_set( PALETTE * spal, int color, int num, uint8_t * pal )
         spal->rgb[ color ].g = *pal++ ;
         spal->rgb[ color++ ].b = *pal++ ;
     }
+
+    gr_invalidate_palette_index() ;
     return 1;
 }
 
@@ -641,6 +894,7 @@ void gr_roll_palette( int color0, int num, int inc )
         memcpy( &sys_pixel_format->palette->rgb[ color0 + num - inc ], &backup[ color0 ], sizeof( rgb_component ) * inc ) ;
     }
 
+    gr_invalidate_palette_index() ;
     palette_changed = 1 ;
 }
 
@@ -729,6 +983,30 @@ int gr_find_nearest_color( int r, int g, int b )
     return find_nearest_color( sys_pixel_format->palette, 0, 255, r, g, b ) ;
 }
 
+/* --------------------------------------------------------------------------- */
+/* Rehace el indice de la paleta del sistema si ha cambiado. Solo desde el
+   thread principal, fuera del dibujado, como trans_table */
+
+void gr_make_palette_index()
+{
+    PALETTE * pal = sys_pixel_format->palette ;
+
+    if ( sys_index_valid && sys_index_pal == pal ) return ;
+
+    sys_index_valid = 0;
+    pal_index_build( &sys_index, pal ? pal->rgb : ( rgb_component * ) default_palette );
+    sys_index_pal = pal;
+    sys_index_valid = 1;
+}
+
+/* --------------------------------------------------------------------------- */
+/* Cualquier cambio en una paleta deja el indice sin valor hasta que se rehaga */
+
+void gr_invalidate_palette_index()
+{
+    sys_index_valid = 0;
+}
+
 /* --------------------------------------------------------------------------- */
 
 void gr_make_trans_table()
@@ -739,10 +1017,8 @@ void gr_make_trans_table()
 
     if ( trans_table_updated ) return ;
 
-    if ( sys_pixel_format->palette )
-        rgb = sys_pixel_format->palette->rgb;
-    else
-        rgb = ( rgb_component * ) default_palette;
+    gr_make_palette_index();
+    rgb = sys_index.rgb;
 
     for ( a = 0; a < 256; a++ )
     {
@@ -753,7 +1029,7 @@ void gr_make_trans_table()
         for ( b = 0; b < a; b++ )
             trans_table[ a ][ b ] =
                 trans_table[ b ][ a ] =
-                    find_nearest_color( NULL, b, a, r1 + rgb[ b ].r / 2, g1 + rgb[ b ].g / 2, b1 + rgb[ b ].b / 2 ) ;
+                    pal_index_find( &sys_index, b, a, r1 + rgb[ b ].r / 2, g1 + rgb[ b ].g / 2, b1 + rgb[ b ].b / 2 ) ;
 
         trans_table[ a ][ a ] = a ;
         trans_table[ 0 ][ a ] = a ;
@@ -778,6 +1054,7 @@ void gr_set_rgb( int color, int r, int g, int b )
     sys_pixel_format->palette->rgb[ color ].g = g << 2;
     sys_pixel_format->palette->rgb[ color ].b = b << 2;
 
+    gr_invalidate_palette_index() ;
     palette_changed = 1 ;
 }
 
@@ -825,6 +1102,7 @@ void gr_set_colors( int color, int num, uint8_t * pal )
         sys_pixel_format->palette->rgb[ color++ ].b = *pal++ ;
     }
 
+    gr_invalidate_palette_index() ;
     palette_changed = 1 ;
 }
 
@@ -123,6 +123,8 @@ extern int gr_rgba_depth( int depth, int r, int g, int b, int a );
 extern void gr_get_rgb_depth( int depth, int color, int *r, int *g, int *b );
 extern void gr_get_rgba_depth( int depth, int color, int *r, int *g, int *b, int *a );
 extern int gr_find_nearest_color( int r, int g, int b );
+extern void gr_make_palette_index();
+extern void gr_invalidate_palette_index();
 extern void gr_make_trans_table();
 extern void gr_set_rgb( int color, int r, int g, int b );
 extern void gr_get_colors( int color, int num, uint8_t * pal );
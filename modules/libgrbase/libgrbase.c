@@ -31,6 +31,7 @@
 #include "bgddl.h"
 
 #include "libgrbase.h"
+#include "savestate.h"
 
 /* --------------------------------------------------------------------------- */
 
@@ -44,6 +45,22 @@ GRAPH * background = NULL ;
 GRAPH * scrbitmap = NULL ;
 
 
+/* --------------------------------------------------------------------------- */
+/* Save states                                                                 */
+
+extern uint32_t * map_code_bmp ;
+extern int map_code_allocated ;
+extern int map_code_last ;
+
+static void libgrbase_savestate_loaded()
+{
+    /* Palette, its nearest color index and transparency tables may belong to
+       the discarded frames */
+    gr_invalidate_palette_index() ;
+    palette_changed = 1 ;
+    trans_table_updated = 0 ;
+}
+
 /* --------------------------------------------------------------------------- */
 /* Module initialization                                                       */
 
@@ -54,6 +71,20 @@ void __bgdexport( libgrbase, module_initialize )()
     std_pixel_format32 = bitmap_create_format( 32 ) ;
 
     grlib_init() ;
+
+    savestate_register_ptr( std_pixel_format8 );
+    savestate_register_ptr( std_pixel_format16 );
+    savestate_register_ptr( std_pixel_format32 );
+    savestate_register_ptr( sys_pixel_format );
+    savestate_register_ptr( background );
+    savestate_register_ptr( scrbitmap );
+    savestate_register_ptr( first_palette );
+    savestate_register_ptr( map_code_bmp );
+    savestate_register_var( map_code_allocated );
+    savestate_register_var( map_code_last );
+    gr_conversion_savestate_register() ;
+
+    savestate_add_load_hook( libgrbase_savestate_loaded ) ;
 }
 
 /* --------------------------------------------------------------------------- */
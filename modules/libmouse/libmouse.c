@@ -138,7 +138,7 @@ static void do_mouse_events(void)
         }
         else if ( enable_scale || scale_mode != SCALE_NONE )
         {
-            SDL_WarpMouse( GLOINT32( libmouse, MOUSEX ) * 2 , GLOINT32( libmouse, MOUSEY ) * 2 ) ;
+            SDL_WarpMouse( GLOINT32( libmouse, MOUSEX ) * scale_factor , GLOINT32( libmouse, MOUSEY ) * scale_factor ) ;
         }
         else
         {
@@ -239,8 +239,8 @@ static void do_mouse_events(void)
                 }
                 else if ( enable_scale || scale_mode != SCALE_NONE )
                 {
-                    GLOINT32( libmouse, MOUSEX ) = e.motion.x / 2 ;
-                    GLOINT32( libmouse, MOUSEY ) = e.motion.y / 2 ;
+                    GLOINT32( libmouse, MOUSEX ) = e.motion.x / scale_factor ;
+                    GLOINT32( libmouse, MOUSEY ) = e.motion.y / scale_factor ;
                 }
                 else
                 {
@@ -425,7 +425,7 @@ static void mouse_draw( INSTANCE * i, REGION * clip )
             GLODWORD( libmouse, MOUSEFLAGS ),
             mouse_map ) ;
 
-    mouse_map->modified = 0;
+    bitmap_clear_modified( mouse_map );
 }
 
 /* --------------------------------------------------------------------------- */
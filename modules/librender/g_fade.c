@@ -151,12 +151,9 @@ void gr_fade_step()
     {
         if ( !fade_on && fade_to.r == 100 && fade_to.g == 100 && fade_to.b == 100 ) fade_set = 0;
 
+        /* En 8 bits el fade va en la paleta. En 16 y 32 bits se aplica al
+           volcar la pantalla, en gr_unlock_screen */
         activate_vpalette() ;
-
-        if ( scrbitmap->format->depth > 8 )
-        {
-            gr_fade16( scrbitmap, fade_pos.r, fade_pos.g, fade_pos.b );
-        }
     }
 }
 
@@ -34,6 +34,7 @@
 extern int fade_on ;               /* ¿Hay un fade activo?                  */
 extern int fade_set ;              /* ¿Hay un fade seteado pero inactivo?   */
 extern int fade_step ;             /* Si lo hay, posición (0=off)           */
+extern SDL_Color fade_pos ;        /* Nivel actual (100 = sin fade)         */
 
 extern SDL_Color vpalette[ 256 ] ;
 
@@ -300,10 +300,7 @@ void gr_draw_frame(void)
 
     /* Fading */
 
-    if ( ( fade_on || fade_set ) && frame_completed ) {
-        gr_fade_step() ;
-        if ( background ) background->modified = 1 ;
-    }
+    if ( ( fade_on || fade_set ) && frame_completed ) gr_fade_step() ;
 
     /* Update palette and screen */
 
@@ -42,6 +42,7 @@
 
 #include "librender.h"
 #include "resolution.h"
+#include "savestate.h"
 
 #include "sysprocs_st.h"
 
@@ -260,7 +261,254 @@ void draw_instance( INSTANCE * i, REGION * clip )
     if ( paletteid ) map->format->palette = palette;
     if ( blendop ) map->blend_table = blend_table;
 
-    if ( map->modified ) map->modified = 0;
+    /* With render threads this is done once the frame is drawn */
+    if ( render_threads == 1 ) bitmap_clear_modified( map );
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Graphics of the instances drawn with render threads. Their modified flag
+ * is cleared when the frame is done, not by the draw itself */
+
+static GRAPH ** drawn_graphs = NULL;
+static int drawn_graphs_count = 0;
+static int drawn_graphs_size = 0;
+
+/* --------------------------------------------------------------------------- */
+
+/* Do now what the blitter would do lazily while drawing, the render threads
+ * must not write data shared by other instances. Blend op and palette are
+ * swapped into the graphic for the draw, so those instances stay serial. */
+
+static void instance_prepare_parallel( INSTANCE * i, GRAPH * graph )
+{
+    GRAPH ** new_drawn_graphs;
+    int alpha = LOCDWORD( librender, i, ALPHA );
+    int flags = LOCDWORD( librender, i, FLAGS ) ^ LOCDWORD( librender, i, XGRAPH_FLAGS );
+    int parallel = !LOCDWORD( librender, i, BLENDOP ) && !LOCDWORD( librender, i, PALETTEID );
+
+    if ( graph->modified > 1 ) bitmap_analize( graph );
+
+    if ( graph->modified )
+    {
+        if ( drawn_graphs_count >= drawn_graphs_size )
+        {
+            new_drawn_graphs = ( GRAPH ** ) bgd_realloc( drawn_graphs, ( drawn_graphs_size + 256 ) * sizeof( GRAPH * ) );
+            if ( new_drawn_graphs )
+            {
+                drawn_graphs = new_drawn_graphs;
+                drawn_graphs_size += 256;
+            }
+        }
+
+        /* If there is no room it just stays modified one more frame */
+        if ( drawn_graphs_count < drawn_graphs_size ) drawn_graphs[ drawn_graphs_count++ ] = graph;
+    }
+
+    if ( parallel && ( graph->blend_table || alpha != 255 || ( flags & B_TRANSLUCENT ) ) )
+    {
+        if ( !trans_table_updated ) gr_make_trans_table();
+
+        /* 16 bits blends take the alpha tables, or with SIMD their number of
+           steps, for translucency too. Both are fixed here, the threads only
+           read them */
+        if ( sys_pixel_format->depth == 16 && ( alpha != 255 || ( flags & B_TRANSLUCENT ) ) ) gr_alpha16( 0 );
+        else if ( sys_pixel_format->depth == 8 && alpha != 255 ) gr_alpha8( 0 );
+    }
+
+    gr_object_set_parallel( LOCDWORD( librender, i, OBJECTID ), parallel );
+}
+
+/* --------------------------------------------------------------------------- */
+
+void instance_clear_drawn_graphs( void )
+{
+    while ( drawn_graphs_count ) bitmap_clear_modified( drawn_graphs[ --drawn_graphs_count ] );
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Running or frozen instances drawn by the planes of other modules (scroll,
+ * Mode 7...), by CTYPE. Gathered while the objects info is updated, that
+ * already visits every instance, so the planes don't walk the whole instance
+ * list every frame. Only valid while the frame is drawn. */
+
+#define INSTANCE_HASH(i)    (( int )((( uintptr_t )( i ) >> 4 ) * 2654435761u ))
+
+static INSTANCE ** ctype_instances[ MAX_CTYPES ];
+static int ctype_instances_count[ MAX_CTYPES ];
+static int ctype_instances_size[ MAX_CTYPES ];
+
+/* --------------------------------------------------------------------------- */
+
+static void instance_gather_ctype( INSTANCE * i )
+{
+    INSTANCE ** new_list;
+    int ctype = LOCDWORD( librender, i, CTYPE );
+    int status = LOCDWORD( librender, i, STATUS ) & ~STATUS_WAITING_MASK;
+
+    if ( ctype <= C_SCREEN || ctype >= MAX_CTYPES ) return;
+    if ( status != STATUS_RUNNING && status != STATUS_FROZEN ) return;
+
+    if ( ctype_instances_count[ ctype ] >= ctype_instances_size[ ctype ] )
+    {
+        new_list = ( INSTANCE ** ) bgd_realloc( ctype_instances[ ctype ], ( ctype_instances_size[ ctype ] + 256 ) * sizeof( INSTANCE * ) );
+        if ( !new_list ) return;
+
+        ctype_instances[ ctype ] = new_list;
+        ctype_instances_size[ ctype ] += 256;
+    }
+
+    ctype_instances[ ctype ][ ctype_instances_count[ ctype ]++ ] = i;
+}
+
+/* --------------------------------------------------------------------------- */
+
+void instance_clear_ctype_lists( void )
+{
+    memset( ctype_instances_count, 0, sizeof( ctype_instances_count ) );
+}
+
+/* --------------------------------------------------------------------------- */
+/*
+ *  FUNCTION : instance_ctype_list
+ *
+ *  Returns the running or frozen instances with the given CTYPE this frame,
+ *  in no particular order
+ *
+ *  PARAMS :
+ *      ctype       CTYPE value (C_SCROLL, C_M7...)
+ *      count       Pointer to receive the number of instances
+ *
+ *  RETURN VALUE :
+ *      Pointer to the instances
+ */
+
+INSTANCE ** instance_ctype_list( int ctype, int * count )
+{
+    if ( ctype <= C_SCREEN || ctype >= MAX_CTYPES )
+    {
+        * count = 0;
+        return NULL;
+    }
+
+    * count = ctype_instances_count[ ctype ];
+    return ctype_instances[ ctype ];
+}
+
+/* --------------------------------------------------------------------------- */
+/*
+ *  FUNCTION : instance_list_sort
+ *
+ *  Sorts the instances of a plane this frame, starting from the order they
+ *  had the last one. The order barely changes between frames, so an insertion
+ *  sort has almost nothing to move. The instances new to the plane are sorted
+ *  apart and merged. The old list is only a hint, its instances may not
+ *  exist anymore and are never dereferenced.
+ *
+ *  PARAMS :
+ *      list        Sorted list of the plane, replaced by the new one
+ *      current     Instances of the plane this frame
+ *      count       Number of instances
+ *      compare     Comparison function, as in qsort
+ *
+ *  RETURN VALUE :
+ *      None
+ */
+
+void instance_list_sort( INSTANCE_LIST * list, INSTANCE ** current, int count, int ( * compare )( const void *, const void * ) )
+{
+    INSTANCE ** new_items, ** sorted, * i;
+    int * hash, mask, n, m, k, kept, slot;
+
+    if ( count > list->size )
+    {
+        if (( new_items = ( INSTANCE ** ) bgd_realloc( list->items, count * sizeof( INSTANCE * ) ) ) ) list->items = new_items;
+        if (( sorted = ( INSTANCE ** ) bgd_realloc( list->sorted, count * sizeof( INSTANCE * ) ) ) ) list->sorted = sorted;
+        if (( hash = ( int * ) bgd_realloc( list->hash, count * 4 * sizeof( int ) ) ) ) list->hash = hash;
+
+        if ( !new_items || !sorted || !hash )
+        {
+            list->count = 0;
+            return;
+        }
+
+        list->size = count;
+    }
+
+    if ( !count )
+    {
+        list->count = 0;
+        return;
+    }
+
+    /* Hash this frame instances by address: index + 1, negative once taken */
+
+    for ( mask = 1; mask < count * 2; mask <<= 1 );
+    mask--;
+
+    hash = list->hash;
+    memset( hash, 0, ( mask + 1 ) * sizeof( int ) );
+
+    for ( n = 0; n < count; n++ )
+    {
+        slot = INSTANCE_HASH( current[ n ] ) & mask;
+        while ( hash[ slot ] ) slot = ( slot + 1 ) & mask;
+        hash[ slot ] = n + 1;
+    }
+
+    /* The ones still there keep their last order */
+
+    for ( kept = n = 0; n < list->count; n++ )
+    {
+        slot = INSTANCE_HASH( list->items[ n ] ) & mask;
+        while ( hash[ slot ] && current[ abs( hash[ slot ] ) - 1 ] != list->items[ n ] ) slot = ( slot + 1 ) & mask;
+        if ( hash[ slot ] > 0 )
+        {
+            list->sorted[ kept++ ] = list->items[ n ];
+            hash[ slot ] = -hash[ slot ];
+        }
+    }
+
+    /* Insertion sort of those, stable */
+
+    for ( n = 1; n < kept; n++ )
+    {
+        i = list->sorted[ n ];
+        for ( k = n; k > 0 && compare( &list->sorted[ k - 1 ], &i ) > 0; k-- ) list->sorted[ k ] = list->sorted[ k - 1 ];
+        list->sorted[ k ] = i;
+    }
+
+    /* The new ones are sorted apart and merged after the old ones of the same key */
+
+    for ( k = kept, slot = 0; slot <= mask; slot++ )
+        if ( hash[ slot ] > 0 ) list->sorted[ k++ ] = current[ hash[ slot ] - 1 ];
+
+    if ( count > kept ) qsort( &list->sorted[ kept ], count - kept, sizeof( INSTANCE * ), compare );
+
+    for ( n = 0, k = kept, m = 0; m < count; m++ )
+    {
+        if ( k >= count || ( n < kept && compare( &list->sorted[ n ], &list->sorted[ k ] ) <= 0 ) )
+            list->items[ m ] = list->sorted[ n++ ];
+        else
+            list->items[ m ] = list->sorted[ k++ ];
+    }
+
+    list->count = count;
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* The lists are in the heap, their pointers are saved with it */
+
+void gr_instance_savestate_register( void )
+{
+    savestate_register_ptr( drawn_graphs );
+    savestate_register_var( drawn_graphs_count );
+    savestate_register_var( drawn_graphs_size );
+    savestate_register_ptr( ctype_instances );
+    savestate_register_var( ctype_instances_count );
+    savestate_register_var( ctype_instances_size );
 }
 
 /* --------------------------------------------------------------------------- */
@@ -284,6 +532,8 @@ int draw_instance_info( INSTANCE * i, REGION * region, int * z, int * drawme )
 
     * drawme = 0;
 
+    if ( LOCDWORD( librender, i, CTYPE ) != C_SCREEN ) instance_gather_ctype( i );
+
     LOCDWORD( librender, i, GRAPHPTR ) = int_from_ptr( graph = instance_graph( i ) );
     if ( !graph )
     {
@@ -307,6 +557,7 @@ int draw_instance_info( INSTANCE * i, REGION * region, int * z, int * drawme )
     if ( LOCDWORD( librender, i, CTYPE ) == C_SCREEN && ( status == STATUS_RUNNING || status == STATUS_FROZEN ) )
         * drawme = 1;
 
+    if ( render_threads > 1 && * drawme ) instance_prepare_parallel( i, graph );
 
     coordx = LOCINT32( librender, i, COORDX );
     coordy = LOCINT32( librender, i, COORDY );
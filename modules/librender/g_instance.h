@@ -32,11 +32,34 @@
 #include <bgddl.h>
 #include <g_bitmap.h>
 
+/* --------------------------------------------------------------------------- */
+
+#define MAX_CTYPES          8
+
+/* Instances of a plane, sorted, kept from one frame to the next */
+
+typedef struct _instance_list
+{
+    INSTANCE ** items;
+    INSTANCE ** sorted;
+    int * hash;
+    int count;
+    int size;
+}
+INSTANCE_LIST;
+
+/* --------------------------------------------------------------------------- */
+
 extern void instance_get_bbox( INSTANCE * i, GRAPH * gr, REGION * dest );
 extern void draw_instance_at( INSTANCE * i, REGION * r, int x, int y, GRAPH * dest ) ;
 extern void draw_instance( INSTANCE * i, REGION * clip ) ;
 extern void instance_update_bbox( INSTANCE * i ) ;
 extern GRAPH * instance_graph( INSTANCE * i ) ;
 extern int instance_visible( INSTANCE * i );
+extern void instance_clear_drawn_graphs( void );
+extern void instance_clear_ctype_lists( void );
+extern INSTANCE ** instance_ctype_list( int ctype, int * count );
+extern void gr_instance_savestate_register( void );
+extern void instance_list_sort( INSTANCE_LIST * list, INSTANCE ** current, int count, int ( * compare )( const void *, const void * ) );
 
 #endif
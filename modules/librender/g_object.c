@@ -28,24 +28,43 @@
 #include <string.h>
 
 #include "librender.h"
+#include "savestate.h"
 
 /* --------------------------------------------------------------------------- */
 
 static int sequencer = 0;
 
-CONTAINER * sorted_object_list = NULL;
+/* Sorted by key, higher first */
+
+static CONTAINER * containers = NULL;
+static int containers_count = 0;
+static int containers_size = 0;
 
 /* --------------------------------------------------------------------------- */
 
-CONTAINER * search_container( int key )
+/* Index of the first container with a key lower or equal than key */
+
+static int container_index( int key )
 {
-    CONTAINER * ctr = NULL;
+    int lo = 0, hi = containers_count, mid;
 
-    if ( !sorted_object_list ) return NULL;
+    while ( lo < hi )
+    {
+        mid = ( lo + hi ) >> 1;
+        if ( containers[mid].key > key ) lo = mid + 1;
+        else                             hi = mid;
+    }
+
+    return lo;
+}
+
+/* --------------------------------------------------------------------------- */
 
-    for ( ctr = sorted_object_list; ctr && ctr->key > key; ctr = ctr->next );
+CONTAINER * search_container( int key )
+{
+    int n = container_index( key );
 
-    if ( ctr && ctr->key == key ) return ctr;
+    if ( n < containers_count && containers[n].key == key ) return &containers[n];
 
     return NULL;
 }
@@ -54,65 +73,37 @@ CONTAINER * search_container( int key )
 
 CONTAINER * get_container( int key )
 {
-    CONTAINER * ctr = NULL, * prev_ctr = NULL, * new_ctr = NULL;
+    CONTAINER * new_containers;
+    int n = container_index( key );
 
-    if ( sorted_object_list )
-    {
-        for ( ctr = sorted_object_list; ctr && ctr->key > key; ctr = ctr->next )
-        {
-            prev_ctr = ctr;
-        }
-        if ( ctr && ctr->key == key ) return ctr;
-    }
-
-    new_ctr = ( CONTAINER * ) bgd_malloc( sizeof( CONTAINER ) );
-    if ( !new_ctr ) return NULL;
+    if ( n < containers_count && containers[n].key == key ) return &containers[n];
 
-    new_ctr->key = key;
-    new_ctr->first_in_key = NULL;
-
-    if ( ctr == sorted_object_list )
+    if ( containers_count >= containers_size )
     {
-        if ( !sorted_object_list )
-        {
-            /* Only happen "!sorted_object_list" when "ctr == sorted_object_list" (NULL) */
-            sorted_object_list = new_ctr;
-            new_ctr->next = NULL;
-            new_ctr->prev = NULL;
+        new_containers = ( CONTAINER * ) bgd_realloc( containers, ( containers_size + 64 ) * sizeof( CONTAINER ) );
+        if ( !new_containers ) return NULL;
 
-            return new_ctr;
-        }
-
-        sorted_object_list = new_ctr;
+        containers = new_containers;
+        containers_size += 64;
     }
 
-    if ( ctr )
-    {
-        new_ctr->next = ctr;
-        new_ctr->prev = ctr->prev;
-        if ( ctr->prev ) ctr->prev->next = new_ctr;
-        ctr->prev = new_ctr;
-    }
-    else
-    {
-        // prev_ctr implicit exist
-        new_ctr->next = NULL;
-        new_ctr->prev = prev_ctr;
-        prev_ctr->next = new_ctr;
-    }
+    memmove( &containers[n + 1], &containers[n], ( containers_count - n ) * sizeof( CONTAINER ) );
+    containers_count++;
 
-    return new_ctr;
+    containers[n].key = key;
+    containers[n].first_in_key = NULL;
+
+    return &containers[n];
 }
 
 /* --------------------------------------------------------------------------- */
 
 void destroy_container( CONTAINER * ctr )
 {
-    if ( ctr->next ) ctr->next->prev = ctr->prev;
-    if ( ctr->prev ) ctr->prev->next = ctr->next;
-    if ( ctr == sorted_object_list ) sorted_object_list = ctr->next ;
+    int n = ctr - containers;
 
-    bgd_free( ctr );
+    memmove( &containers[n], &containers[n + 1], ( containers_count - n - 1 ) * sizeof( CONTAINER ) );
+    containers_count--;
 }
 
 /* --------------------------------------------------------------------------- */
@@ -157,6 +148,7 @@ int gr_new_object( int z, OBJ_INFO * info, OBJ_DRAW * draw, void * what )
     object->draw = draw;
     object->what = what;
     object->ready = 0;
+    object->parallel = 0;
     object->bbox.x = -2;
     object->bbox.y = -2;
     object->bbox.x2 = -2;
@@ -218,23 +210,45 @@ void gr_destroy_object( int id )
     bgd_free( object );
 }
 
+/* --------------------------------------------------------------------------- */
+/*
+ *  FUNCTION : gr_object_set_parallel
+ *
+ *  Tell if the draw function of an object can run in the render
+ *  threads, concurrently with itself and other parallel objects,
+ *  each call with a clipping region in a different band of the screen.
+ *  Usually called by the info function, only the current frame counts.
+ *
+ *  PARAMS :
+ *      id              ID returned by gr_new_object
+ *      parallel        1 if the object can be drawn in parallel
+ *
+ *  RETURN VALUE :
+ *      None
+ */
+
+void gr_object_set_parallel( int id, int parallel )
+{
+    OBJECT * object = ( OBJECT * ) ptr_from_int( id ) ;
+
+    if ( object ) object->parallel = parallel ;
+}
+
 /* --------------------------------------------------------------------------- */
 
 void gr_update_objects_mark_rects( int restore, int dump )
 {
-    CONTAINER * ctr = NULL, * next_ctr, * fix_ctr;
-    OBJECT * object, * next_object ;
-    int ready, key;
+    CONTAINER * ctr = NULL, * fix_ctr;
+    OBJECT * object, * next_object, * moved = NULL, * last_moved = NULL ;
+    int ready, key, n, count;
 
-    if ( !sorted_object_list ) return ;
+    if ( !containers_count ) return ;
 
     sequencer++;
 
-    next_ctr = sorted_object_list;
-    while (( ctr = next_ctr ) )
+    for ( n = 0; n < containers_count; n++ )
     {
-        /* Get Next Container */
-        next_ctr = ctr->next ;
+        ctr = &containers[n];
 
         key = ctr->key;
 
@@ -254,7 +268,8 @@ void gr_update_objects_mark_rects( int restore, int dump )
                 /* NOTE: Returned bbox must be ordered !!! */
                 object->changed = ( *object->info )( object->what, &object->bbox, &object->z, &object->ready );
 
-                /* Move to correct container */
+                /* Move to correct container once the scan is done, it can't
+                   change the container array while it is being walked */
                 if ( object->z != key )
                 {
                     /* Remove from list */
@@ -262,19 +277,10 @@ void gr_update_objects_mark_rects( int restore, int dump )
                     if ( object->prev ) object->prev->next = object->next;
                     if ( object == ctr->first_in_key ) ctr->first_in_key = object->next;
 
-                    if ( !ctr->first_in_key ) destroy_container( ctr );
-
-                    /* Get new or exist container */
-                    fix_ctr = get_container( object->z );
-                    if ( !fix_ctr ) continue; /* Error */
-
-                    /* Put new object first */
-                    if ( fix_ctr->first_in_key ) fix_ctr->first_in_key->prev = object;
-
-                    object->prev = NULL;
-                    object->next = fix_ctr->first_in_key;
-
-                    fix_ctr->first_in_key = object;
+                    object->next = NULL;
+                    if ( last_moved ) last_moved->next = object;
+                    else              moved = object;
+                    last_moved = object;
                 }
 
                 if (
@@ -303,39 +309,206 @@ void gr_update_objects_mark_rects( int restore, int dump )
             }
         }
     }
+
+    /* Put moved objects first in their new containers, in scan order */
+    while (( object = moved ))
+    {
+        moved = object->next;
+
+        /* Get new or exist container */
+        fix_ctr = get_container( object->z );
+        if ( !fix_ctr ) continue; /* Error */
+
+        if ( fix_ctr->first_in_key ) fix_ctr->first_in_key->prev = object;
+
+        object->prev = NULL;
+        object->next = fix_ctr->first_in_key;
+
+        fix_ctr->first_in_key = object;
+    }
+
+    /* Drop the containers left empty */
+    for ( count = n = 0; n < containers_count; n++ )
+        if ( containers[n].first_in_key ) containers[count++] = containers[n];
+
+    containers_count = count;
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void draw_object_rects( OBJECT * object, REGION * rects, int count )
+{
+    for ( ; count--; rects++ )
+    {
+        if (
+            object->bbox.x2 < rects->x || object->bbox.x > rects->x2 ||
+            object->bbox.y2 < rects->y || object->bbox.y > rects->y2
+        )
+            continue;
+        ( *object->draw )( object->what, rects ) ;
+    }
 }
 
 /* --------------------------------------------------------------------------- */
 
-void gr_draw_objects( REGION * updaterects, int count )
+/* Parallel drawing: consecutive parallel objects are drawn by the render
+ * threads, each one clipping to its own horizontal band of the screen.
+ * Any other object waits for them and is drawn alone, keeping the Z order.
+ * Rebuilt every frame, but in the heap, so their pointers are saved with it. */
+
+static OBJECT ** run_objects = NULL;
+static int run_count = 0;
+static int run_size = 0;
+
+static REGION * band_rects = NULL;          /* band_rects_size rects per band */
+static int band_rects_size = 0;
+static int band_rects_count[ MAX_RENDER_THREADS ];
+
+/* --------------------------------------------------------------------------- */
+
+static void draw_run_band( int worker, void * data )
 {
-    CONTAINER * ctr = NULL;
-    OBJECT * object;
-    REGION * prect;
+    OBJECT ** object = run_objects;
     int n;
 
-    ctr = sorted_object_list;
-    while ( ctr )
+    for ( n = run_count; n--; object++ )
+        draw_object_rects( *object, band_rects + worker * band_rects_size, band_rects_count[ worker ] );
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void draw_run( void )
+{
+    if ( !run_count ) return;
+
+    gr_blit_defer_dest = 1;
+    gr_render_threads_run( draw_run_band, NULL );
+    gr_blit_defer_dest = 0;
+
+    /* Parallel objects only draw instances, always on the screen */
+    scrbitmap->info_flags &= ~GI_CLEAN;
+    scrbitmap->modified = 2;
+
+    run_count = 0;
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Split the update rects in one band per thread, rects = NULL for the whole screen */
+
+static int split_band_rects( REGION * rects, int count )
+{
+    REGION * new_band_rects, * band;
+    int b, n, y, y2;
+
+    if ( !rects ) count = 1;
+
+    if ( band_rects_size < count )
     {
-        object = ctr->first_in_key;
-        while ( object )
+        new_band_rects = ( REGION * ) bgd_realloc( band_rects, count * MAX_RENDER_THREADS * sizeof( REGION ) );
+        if ( !new_band_rects ) return -1;
+
+        band_rects = new_band_rects;
+        band_rects_size = count;
+    }
+
+    for ( b = 0; b < render_threads; b++ )
+    {
+        band = band_rects + b * band_rects_size;
+        y  = scr_height * b / render_threads;
+        y2 = scr_height * ( b + 1 ) / render_threads - 1;
+
+        if ( !rects )
         {
-            if ( object->ready )
+            band->x = 0;
+            band->y = y;
+            band->x2 = scr_width - 1;
+            band->y2 = y2;
+            band_rects_count[ b ] = ( y <= y2 );
+            continue;
+        }
+
+        band_rects_count[ b ] = 0;
+        for ( n = 0; n < count; n++ )
+        {
+            *band = rects[ n ];
+            if ( band->y < y ) band->y = y;
+            if ( band->y2 > y2 ) band->y2 = y2;
+            if ( band->y > band->y2 ) continue;
+
+            band++;
+            band_rects_count[ b ]++;
+        }
+    }
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void draw_objects_parallel( REGION * updaterects, int count )
+{
+    CONTAINER * ctr = containers, * last_ctr = containers + containers_count;
+    OBJECT * object, ** new_run_objects;
+
+    run_count = 0;
+
+    for ( ; ctr < last_ctr; ctr++ )
+    {
+        for ( object = ctr->first_in_key; object; object = object->next )
+        {
+            if ( !object->ready ) continue;
+
+            if ( object->parallel )
             {
-                prect = updaterects;
-                for ( n = count; n--; prect++ )
+                if ( run_count >= run_size )
+                {
+                    new_run_objects = ( OBJECT ** ) bgd_realloc( run_objects, ( run_size + 256 ) * sizeof( OBJECT * ) );
+                    if ( new_run_objects )
+                    {
+                        run_objects = new_run_objects;
+                        run_size += 256;
+                    }
+                }
+
+                if ( run_count < run_size )
                 {
-                    if (
-                        object->bbox.x2 < prect->x || object->bbox.x > prect->x2 ||
-                        object->bbox.y2 < prect->y || object->bbox.y > prect->y2
-                    )
-                        continue;
-                    ( *object->draw )( object->what, prect ) ;
+                    run_objects[ run_count++ ] = object;
+                    continue;
                 }
             }
+
+            draw_run();
+
+            if ( updaterects ) draw_object_rects( object, updaterects, count );
+            else               ( *object->draw )( object->what, NULL ) ;
+        }
+    }
+
+    draw_run();
+}
+
+/* --------------------------------------------------------------------------- */
+
+void gr_draw_objects( REGION * updaterects, int count )
+{
+    CONTAINER * ctr = containers, * last_ctr = containers + containers_count;
+    OBJECT * object;
+
+    if ( render_threads > 1 && !split_band_rects( updaterects, count ) )
+    {
+        draw_objects_parallel( updaterects, count );
+        return;
+    }
+
+    for ( ; ctr < last_ctr; ctr++ )
+    {
+        object = ctr->first_in_key;
+        while ( object )
+        {
+            if ( object->ready ) draw_object_rects( object, updaterects, count );
             object = object->next ;
         }
-        ctr = ctr->next ;
     }
 }
 
@@ -343,11 +516,16 @@ void gr_draw_objects( REGION * updaterects, int count )
 
 void gr_draw_objects_complete( void )
 {
-    CONTAINER * ctr = NULL;
+    CONTAINER * ctr = containers, * last_ctr = containers + containers_count;
     OBJECT * object;
 
-    ctr = sorted_object_list;
-    while ( ctr )
+    if ( render_threads > 1 && !split_band_rects( NULL, 0 ) )
+    {
+        draw_objects_parallel( NULL, 0 );
+        return;
+    }
+
+    for ( ; ctr < last_ctr; ctr++ )
     {
         object = ctr->first_in_key;
         while ( object )
@@ -356,8 +534,23 @@ void gr_draw_objects_complete( void )
                 ( *object->draw )( object->what, NULL ) ;
             object = object->next ;
         }
-        ctr = ctr->next ;
     }
 }
 
 /* --------------------------------------------------------------------------- */
+
+/* --------------------------------------------------------------------------- */
+
+void gr_object_savestate_register( void )
+{
+    savestate_register_var( sequencer );
+    savestate_register_ptr( containers );
+    savestate_register_var( containers_count );
+    savestate_register_var( containers_size );
+    savestate_register_ptr( run_objects );
+    savestate_register_var( run_size );
+    savestate_register_ptr( band_rects );
+    savestate_register_var( band_rects_size );
+}
+
+/* --------------------------------------------------------------------------- */
@@ -40,6 +40,7 @@ typedef struct _object
     void * what ;
     int changed ;
     int ready ;         /* Ready to draw */
+    int parallel ;      /* Draw can run in the render threads */
     REGION bbox ;
     REGION bbox_saved ;
 
@@ -50,30 +51,28 @@ typedef struct _object
 }
 OBJECT ;
 
+/* Containers live in an array sorted by key (higher first), so a pointer
+ * to one is only valid until the next get_container or destroy_container */
+
 typedef struct _container
 {
     int key ;
     OBJECT * first_in_key ;
-
-    struct _container * prev ;
-    struct _container * next ;
 }
 CONTAINER ;
 
 /* --------------------------------------------------------------------------- */
 
-//extern CONTAINER * sorted_object_list;
-
-/* --------------------------------------------------------------------------- */
-
 extern CONTAINER * search_container( int key ) ;
 extern CONTAINER * get_container( int key ) ;
 extern void destroy_container( CONTAINER * ctr ) ;
 extern int gr_new_object( int z, OBJ_INFO * info, OBJ_DRAW * draw, void * what );
 extern void gr_destroy_object( int id ) ;
+extern void gr_object_set_parallel( int id, int parallel ) ;
 extern void gr_update_objects_mark_rects( int restore, int dump ) ;
 extern void gr_draw_objects( REGION * updaterects, int count ) ;
 extern void gr_draw_objects_complete( void ) ;
+extern void gr_object_savestate_register( void ) ;
 
 /* --------------------------------------------------------------------------- */
 
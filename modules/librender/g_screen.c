@@ -31,6 +31,15 @@
 #include <string.h>
 
 #include "librender.h"
+#include "savestate.h"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define SR_SSE2
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#include <arm_neon.h>
+#define SR_NEON
+#endif
 
 /* --------------------------------------------------------------------------- */
 
@@ -69,13 +78,16 @@ void gr_draw_screen( GRAPH * dest, int restore_type, int dump_type )
 
     scrbitmap = dest ;
 
+    gr_render_threads_update();
+
     if ( background && background->modified )
     {
         restore_type = 1;
         dump_type = 1;
     }
 
-    /* Update the object list */
+    /* Update the object list, this also gathers the instances of the planes */
+    instance_clear_ctype_lists();
     gr_update_objects_mark_rects( restore_type, dump_type );
 
     /* Restore the background */
@@ -133,11 +145,13 @@ void gr_draw_screen( GRAPH * dest, int restore_type, int dump_type )
         gr_draw_objects_complete();
     }
 
+    instance_clear_drawn_graphs();
+
     /* Reset the zone-to-update array for the next frame */
     gr_rects_clear();
 
-    if ( background && background->modified ) background->modified = 0;
-    if ( scrbitmap && scrbitmap->modified ) scrbitmap->modified = 0;
+    if ( background ) bitmap_clear_modified( background );
+    if ( scrbitmap ) bitmap_clear_modified( scrbitmap );
 
     scrbitmap = orig_scrbitmap;
 }
@@ -171,7 +185,7 @@ int gr_lock_screen()
 
         if ( !scrbitmap )
         {
-            scrbitmap = bitmap_new( 0, screen->w / 2, screen->h / 2, sys_pixel_format->depth ) ;
+            scrbitmap = bitmap_new( 0, screen->w / scale_factor, screen->h / scale_factor, sys_pixel_format->depth ) ;
             bitmap_add_cpoint( scrbitmap, 0, 0 ) ;
         }
     }
@@ -190,249 +204,840 @@ int gr_lock_screen()
 
 /* --------------------------------------------------------------------------- */
 
-void gr_unlock_screen()
+/* Tramo periodico de scale_resolution_table_w (pantalla sin girar). En las
+   proporciones enteras y en las fraccionarias habituales la tabla se repite
+   cada pocos pixeles, asi que la fila se puede copiar con un patron fijo en
+   lugar de leer la tabla pixel a pixel */
+
+#define SR_MAX_PERIOD   16
+
+#define SR_GATHER       0       /* Sin patron, se usa la tabla */
+#define SR_COPY         1       /* 1:1 */
+#define SR_REPLICATE    2       /* Cada pixel de origen se repite period veces */
+#define SR_PATTERN      3       /* Patron de period pixeles que avanza step */
+
+typedef struct
 {
-    if ( !screen_locked || !screen->pixels ) return ;
+    int kind;
+    int start;                      /* Primer pixel de destino del tramo */
+    int count;                      /* Pixeles de destino del tramo, multiplo de period */
+    int end;                        /* Fin de los pixeles validos (distintos de -1) */
+    int period;                     /* Pixeles de destino de cada periodo */
+    int step;                       /* Pixeles de origen que avanza cada periodo */
+    int pattern[ SR_MAX_PERIOD ];   /* Pixel de origen de cada pixel del periodo */
+}
+SR_SPAN;
 
-    screen_locked = 0 ;
+/* --------------------------------------------------------------------------- */
 
-    if ( scale_resolution != -1 )
+static void scale_resolution_span( SR_SPAN * span )
+{
+    int * table = scale_resolution_table_w;
+    int width = scale_screen->w;
+    int start = 0, end = width, best = 0;
+    int p, w, j;
+
+    if ( scale_resolution_aspectratio )
     {
-        uint8_t  * src8  = screen->pixels, * dst8  = scale_screen->pixels , * pdst = scale_screen->pixels ;
-        uint16_t * src16 = screen->pixels, * dst16 = scale_screen->pixels ;
-        uint32_t * src32 = screen->pixels, * dst32 = scale_screen->pixels ;
-        int h, w;
+        while ( start < width && table[ start ] == -1 ) start++;
+        for ( end = start; end < width && table[ end ] != -1; end++ ) ;
+    }
+
+    span->kind = SR_GATHER;
+    span->start = start;
+    span->count = end - start;
+    span->end = end;
+    span->period = 1;
+    span->step = 0;
 
-        switch ( scale_screen->format->BitsPerPixel )
+    /* Periodo que cubre mas pixeles seguidos desde el inicio. Se comprueba
+       la tabla entera porque los errores de redondeo pueden romper el patron */
+    for ( p = 1; p <= SR_MAX_PERIOD && start + p < end && best < end - start; p++ )
+    {
+        int step = table[ start + p ] - table[ start ];
+
+        for ( w = start; w + p < end && table[ w + p ] - table[ w ] == step; w++ ) ;
+
+        if ( ( w + p - start ) / p * p > best )
         {
-            case    8:
-                    if ( scale_resolution_orientation == 1 || scale_resolution_orientation == 3 )
-                    {
-                        if ( scale_resolution_aspectratio )
-                        {
-                            for ( w = 0; w < scale_screen->w; w++ )
-                            {
-                                if ( scale_resolution_table_w[w] != -1 )
-                                {
-                                    src8 = (uint8_t*)screen->pixels + scale_resolution_table_w[w];
-                                    for ( h = scale_screen->h - 1; h-- ; )
-                                    {
-                                        if ( scale_resolution_table_h[h] != -1 ) *dst8 = src8[scale_resolution_table_h[h]];
-                                        dst8 += scale_screen->pitch ;
-                                    }
-                                }
-                                dst8 = pdst += scale_screen->format->BytesPerPixel ;
-                            }
-                        }
-                        else
-                        {
-                            for ( w = 0; w < scale_screen->w; w++ )
+            best = ( w + p - start ) / p * p;
+            span->period = p;
+            span->step = step;
+        }
+    }
+
+    /* Menos de dos periodos no compensa */
+    if ( best < 2 * span->period ) return;
+
+    span->count = best;
+
+    for ( j = 0; j < span->period; j++ ) span->pattern[ j ] = table[ start + j ] - table[ start ];
+
+    if ( span->period == 1 && span->step == 1 )
+    {
+        span->kind = SR_COPY;
+        return;
+    }
+
+    span->kind = SR_REPLICATE;
+    if ( span->step != 1 || span->period > 4 ) span->kind = SR_PATTERN;
+    for ( j = 0; j < span->period; j++ ) if ( span->pattern[ j ] ) span->kind = SR_PATTERN;
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Repiten cada uno de los n pixeles de origen k veces (2, 3 o 4) */
+
+#if defined( SR_SSE2 )
+/* Los 8 valores de 16 bits de v, repetidos 3 veces cada uno, en o[0..2] */
+
+static void sr_triple16_sse2( __m128i v, __m128i * o )
+{
+    o[0] = _mm_shufflehi_epi16( _mm_shufflelo_epi16( _mm_shuffle_epi32( v, _MM_SHUFFLE( 1, 0, 1, 0 ) ), _MM_SHUFFLE( 1, 0, 0, 0 ) ), _MM_SHUFFLE( 2, 2, 1, 1 ) );
+    o[1] = _mm_shufflehi_epi16( _mm_shufflelo_epi16( _mm_shuffle_epi32( v, _MM_SHUFFLE( 2, 2, 1, 1 ) ), _MM_SHUFFLE( 1, 1, 1, 0 ) ), _MM_SHUFFLE( 1, 0, 0, 0 ) );
+    o[2] = _mm_shufflehi_epi16( _mm_shufflelo_epi16( _mm_shuffle_epi32( v, _MM_SHUFFLE( 3, 2, 3, 2 ) ), _MM_SHUFFLE( 2, 2, 1, 1 ) ), _MM_SHUFFLE( 3, 3, 3, 2 ) );
+}
+#endif
+
+static void sr_replicate8( uint8_t * dst, const uint8_t * src, int n, int k )
+{
+    int i;
+
+#if defined( SR_SSE2 )
+    if ( k == 2 )
+    {
+        for ( ; n >= 16; n -= 16, src += 16, dst += 32 )
+        {
+            __m128i v = _mm_loadu_si128( ( const __m128i * ) src );
+            _mm_storeu_si128( ( __m128i * ) dst, _mm_unpacklo_epi8( v, v ) );
+            _mm_storeu_si128( ( __m128i * ) ( dst + 16 ), _mm_unpackhi_epi8( v, v ) );
+        }
+    }
+    else if ( k == 3 )
+    {
+        /* Se repite en 16 bits y se vuelve a empaquetar */
+        __m128i zero = _mm_setzero_si128(), lo[ 3 ], hi[ 3 ];
+
+        for ( ; n >= 16; n -= 16, src += 16, dst += 48 )
+        {
+            __m128i v = _mm_loadu_si128( ( const __m128i * ) src );
+            sr_triple16_sse2( _mm_unpacklo_epi8( v, zero ), lo );
+            sr_triple16_sse2( _mm_unpackhi_epi8( v, zero ), hi );
+            _mm_storeu_si128( ( __m128i * ) dst, _mm_packus_epi16( lo[0], lo[1] ) );
+            _mm_storeu_si128( ( __m128i * ) ( dst + 16 ), _mm_packus_epi16( lo[2], hi[0] ) );
+            _mm_storeu_si128( ( __m128i * ) ( dst + 32 ), _mm_packus_epi16( hi[1], hi[2] ) );
+        }
+    }
+    else if ( k == 4 )
+    {
+        for ( ; n >= 16; n -= 16, src += 16, dst += 64 )
+        {
+            __m128i v = _mm_loadu_si128( ( const __m128i * ) src );
+            __m128i lo = _mm_unpacklo_epi8( v, v ), hi = _mm_unpackhi_epi8( v, v );
+            _mm_storeu_si128( ( __m128i * ) dst, _mm_unpacklo_epi16( lo, lo ) );
+            _mm_storeu_si128( ( __m128i * ) ( dst + 16 ), _mm_unpackhi_epi16( lo, lo ) );
+            _mm_storeu_si128( ( __m128i * ) ( dst + 32 ), _mm_unpacklo_epi16( hi, hi ) );
+            _mm_storeu_si128( ( __m128i * ) ( dst + 48 ), _mm_unpackhi_epi16( hi, hi ) );
+        }
+    }
+#elif defined( SR_NEON )
+    for ( ; n >= 16; n -= 16, src += 16, dst += 16 * k )
+    {
+        uint8x16_t v = vld1q_u8( src );
+        switch ( k )
+        {
+            case 2: { uint8x16x2_t r = { { v, v } };       vst2q_u8( dst, r ); break; }
+            case 3: { uint8x16x3_t r = { { v, v, v } };    vst3q_u8( dst, r ); break; }
+            case 4: { uint8x16x4_t r = { { v, v, v, v } }; vst4q_u8( dst, r ); break; }
+        }
+    }
+#endif
+
+    while ( n-- )
+    {
+        for ( i = 0; i < k; i++ ) *dst++ = *src;
+        src++;
+    }
+}
+
+static void sr_replicate16( uint16_t * dst, const uint16_t * src, int n, int k )
+{
+    int i;
+
+#if defined( SR_SSE2 )
+    if ( k == 2 )
+    {
+        for ( ; n >= 8; n -= 8, src += 8, dst += 16 )
+        {
+            __m128i v = _mm_loadu_si128( ( const __m128i * ) src );
+            _mm_storeu_si128( ( __m128i * ) dst, _mm_unpacklo_epi16( v, v ) );
+            _mm_storeu_si128( ( __m128i * ) ( dst + 8 ), _mm_unpackhi_epi16( v, v ) );
+        }
+    }
+    else if ( k == 3 )
+    {
+        __m128i o[ 3 ];
+
+        for ( ; n >= 8; n -= 8, src += 8, dst += 24 )
+        {
+            sr_triple16_sse2( _mm_loadu_si128( ( const __m128i * ) src ), o );
+            _mm_storeu_si128( ( __m128i * ) dst, o[0] );
+            _mm_storeu_si128( ( __m128i * ) ( dst + 8 ), o[1] );
+            _mm_storeu_si128( ( __m128i * ) ( dst + 16 ), o[2] );
+        }
+    }
+    else if ( k == 4 )
+    {
+        for ( ; n >= 8; n -= 8, src += 8, dst += 32 )
+        {
+            __m128i v = _mm_loadu_si128( ( const __m128i * ) src );
+            __m128i lo = _mm_unpacklo_epi16( v, v ), hi = _mm_unpackhi_epi16( v, v );
+            _mm_storeu_si128( ( __m128i * ) dst, _mm_unpacklo_epi32( lo, lo ) );
+            _mm_storeu_si128( ( __m128i * ) ( dst + 8 ), _mm_unpackhi_epi32( lo, lo ) );
+            _mm_storeu_si128( ( __m128i * ) ( dst + 16 ), _mm_unpacklo_epi32( hi, hi ) );
+            _mm_storeu_si128( ( __m128i * ) ( dst + 24 ), _mm_unpackhi_epi32( hi, hi ) );
+        }
+    }
+#elif defined( SR_NEON )
+    for ( ; n >= 8; n -= 8, src += 8, dst += 8 * k )
+    {
+        uint16x8_t v = vld1q_u16( src );
+        switch ( k )
+        {
+            case 2: { uint16x8x2_t r = { { v, v } };       vst2q_u16( dst, r ); break; }
+            case 3: { uint16x8x3_t r = { { v, v, v } };    vst3q_u16( dst, r ); break; }
+            case 4: { uint16x8x4_t r = { { v, v, v, v } }; vst4q_u16( dst, r ); break; }
+        }
+    }
+#endif
+
+    while ( n-- )
+    {
+        for ( i = 0; i < k; i++ ) *dst++ = *src;
+        src++;
+    }
+}
+
+static void sr_replicate32( uint32_t * dst, const uint32_t * src, int n, int k )
+{
+    int i;
+
+#if defined( SR_SSE2 )
+    for ( ; n >= 4; n -= 4, src += 4, dst += 4 * k )
+    {
+        __m128i v = _mm_loadu_si128( ( const __m128i * ) src );
+        switch ( k )
+        {
+            case 2:
+                _mm_storeu_si128( ( __m128i * ) dst, _mm_unpacklo_epi32( v, v ) );
+                _mm_storeu_si128( ( __m128i * ) ( dst + 4 ), _mm_unpackhi_epi32( v, v ) );
+                break;
+
+            case 3:
+                _mm_storeu_si128( ( __m128i * ) dst, _mm_shuffle_epi32( v, _MM_SHUFFLE( 1, 0, 0, 0 ) ) );
+                _mm_storeu_si128( ( __m128i * ) ( dst + 4 ), _mm_shuffle_epi32( v, _MM_SHUFFLE( 2, 2, 1, 1 ) ) );
+                _mm_storeu_si128( ( __m128i * ) ( dst + 8 ), _mm_shuffle_epi32( v, _MM_SHUFFLE( 3, 3, 3, 2 ) ) );
+                break;
+
+            case 4:
+                _mm_storeu_si128( ( __m128i * ) dst, _mm_shuffle_epi32( v, _MM_SHUFFLE( 0, 0, 0, 0 ) ) );
+                _mm_storeu_si128( ( __m128i * ) ( dst + 4 ), _mm_shuffle_epi32( v, _MM_SHUFFLE( 1, 1, 1, 1 ) ) );
+                _mm_storeu_si128( ( __m128i * ) ( dst + 8 ), _mm_shuffle_epi32( v, _MM_SHUFFLE( 2, 2, 2, 2 ) ) );
+                _mm_storeu_si128( ( __m128i * ) ( dst + 12 ), _mm_shuffle_epi32( v, _MM_SHUFFLE( 3, 3, 3, 3 ) ) );
+                break;
+        }
+    }
+#elif defined( SR_NEON )
+    for ( ; n >= 4; n -= 4, src += 4, dst += 4 * k )
+    {
+        uint32x4_t v = vld1q_u32( src );
+        switch ( k )
+        {
+            case 2: { uint32x4x2_t r = { { v, v } };       vst2q_u32( dst, r ); break; }
+            case 3: { uint32x4x3_t r = { { v, v, v } };    vst3q_u32( dst, r ); break; }
+            case 4: { uint32x4x4_t r = { { v, v, v, v } }; vst4q_u32( dst, r ); break; }
+        }
+    }
+#endif
+
+    while ( n-- )
+    {
+        for ( i = 0; i < k; i++ ) *dst++ = *src;
+        src++;
+    }
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Pixeles [from, to) de una fila leyendo la tabla */
+
+static void sr_gather( uint8_t * dst, uint8_t * src, int from, int to, int bpp )
+{
+    int * table = scale_resolution_table_w;
+    int check = scale_resolution_aspectratio;
+    int w;
+
+    switch ( bpp )
+    {
+        case    1:
+                for ( w = from; w < to; w++ )
+                    if ( !check || table[w] != -1 ) dst[w] = src[table[w]];
+                break;
+
+        case    2:
+                for ( w = from; w < to; w++ )
+                    if ( !check || table[w] != -1 ) ( ( uint16_t * ) dst )[w] = ( ( uint16_t * ) src )[table[w]];
+                break;
+
+        case    4:
+                for ( w = from; w < to; w++ )
+                    if ( !check || table[w] != -1 ) ( ( uint32_t * ) dst )[w] = ( ( uint32_t * ) src )[table[w]];
+                break;
+    }
+}
+
+/* Pixeles del tramo periodico de una fila */
+
+static void sr_span( uint8_t * dst, uint8_t * src, SR_SPAN * span, int bpp )
+{
+    int i, j, n = span->count / span->period;
+
+    if ( span->kind == SR_GATHER )
+    {
+        sr_gather( dst, src, span->start, span->start + span->count, bpp );
+        return;
+    }
+
+    dst += span->start * bpp;
+    src += scale_resolution_table_w[ span->start ] * bpp;
+
+    switch ( span->kind )
+    {
+        case    SR_COPY:
+                memcpy( dst, src, span->count * bpp );
+                break;
+
+        case    SR_REPLICATE:
+                switch ( bpp )
+                {
+                    case 1: sr_replicate8( dst, src, n, span->period ); break;
+                    case 2: sr_replicate16( ( uint16_t * ) dst, ( uint16_t * ) src, n, span->period ); break;
+                    case 4: sr_replicate32( ( uint32_t * ) dst, ( uint32_t * ) src, n, span->period ); break;
+                }
+                break;
+
+        case    SR_PATTERN:
+                switch ( bpp )
+                {
+                    case    1:
+                            if ( span->period == 1 )
                             {
-                                src8 = (uint8_t*)screen->pixels + scale_resolution_table_w[w];
-                                for ( h = scale_screen->h - 1; h-- ; )
-                                {
-                                    *dst8 = src8[scale_resolution_table_h[h]];
-                                    dst8 += scale_screen->pitch ;
-                                }
+                                for ( i = 0; i < n; i++, src += span->step ) *dst++ = *src;
+                                break;
                             }
-                            dst8 = pdst += scale_screen->format->BytesPerPixel ;
-                        }
-                    }
-                    else
-                    {
-                        if ( scale_resolution_aspectratio )
+                            for ( i = 0; i < n; i++, src += span->step )
+                                for ( j = 0; j < span->period; j++ ) *dst++ = src[ span->pattern[j] ];
+                            break;
+
+                    case    2:
                         {
-                            for ( h = 0; h < scale_screen->h; h++ )
+                            uint16_t * d = ( uint16_t * ) dst, * s = ( uint16_t * ) src;
+                            if ( span->period == 1 )
                             {
-                                if ( scale_resolution_table_h[h] != -1 )
-                                {
-                                    src8 = (uint8_t*)screen->pixels + scale_resolution_table_h[h];
-                                    for ( w = 0; w < scale_screen->w; w++ )
-                                    {
-                                        if ( scale_resolution_table_w[w] != -1 ) *dst8 = src8[scale_resolution_table_w[w]];
-                                        dst8++;
-                                    }
-                                }
-                                dst8 = pdst += scale_screen->pitch ;
+                                for ( i = 0; i < n; i++, s += span->step ) *d++ = *s;
+                                break;
                             }
+                            for ( i = 0; i < n; i++, s += span->step )
+                                for ( j = 0; j < span->period; j++ ) *d++ = s[ span->pattern[j] ];
+                            break;
                         }
-                        else
+
+                    case    4:
                         {
-                            for ( h = 0; h < scale_screen->h; h++ )
+                            uint32_t * d = ( uint32_t * ) dst, * s = ( uint32_t * ) src;
+                            if ( span->period == 1 )
                             {
-                                src8 = (uint8_t*)screen->pixels + scale_resolution_table_h[h];
-                                for ( w = 0; w < scale_screen->w; w++ )
-                                {
-                                    *dst8 = src8[scale_resolution_table_w[w]];
-                                    dst8++;
-                                }
-                                dst8 = pdst += scale_screen->pitch ;
+                                for ( i = 0; i < n; i++, s += span->step ) *d++ = *s;
+                                break;
                             }
+                            for ( i = 0; i < n; i++, s += span->step )
+                                for ( j = 0; j < span->period; j++ ) *d++ = s[ span->pattern[j] ];
+                            break;
                         }
-                    }
-                    break;
+                }
+                break;
+    }
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Fade de 15, 16 y 32 bits. No se toca scrbitmap: se aplica a cada banda de
+   la salida (copia de scale_resolution, escalado o pantalla directa) justo
+   despues de generarla.
+
+   Cada canal se calcula igual que la paleta en 8 bits:
+       nivel <= 100:   c * nivel / 100
+       nivel >  100:   c + ( max - c ) * ( nivel - 100 ) / 100
+   que es ( c & keep ) + ( ( c ^ flip ) * k ) >> 15, con k redondeado hacia
+   arriba para que la division entera salga exacta. Posicion y bits de cada
+   canal salen de sys_pixel_format, como en gr_fade16 */
+
+typedef struct
+{
+    int shift[ 3 ];             /* B, G, R */
+    uint32_t max[ 3 ];
+    uint32_t others;            /* Bits que no son de color (alfa, bit libre en 15 bits) */
+    uint16_t k[ 3 ];
+    uint16_t flip[ 3 ];
+    uint16_t keep[ 3 ];
+
+    /* En 32 bits, los mismos valores por byte de dos pixeles */
+    uint16_t lk[ 8 ];
+    uint16_t lflip[ 8 ];
+    uint16_t lkeep[ 8 ];
+}
+SCR_FADE;
+
+#define SCR_FADE_ROWS   8       /* Filas de origen por tramo al escalar con fade */
+
+static SCR_FADE scr_fade;
+static int scr_fading = 0;
+
+/* --------------------------------------------------------------------------- */
+
+static int scr_fade_setup( GRAPH * dest )
+{
+    PIXEL_FORMAT * format = sys_pixel_format;
+    int level[ 3 ] = { fade_pos.b, fade_pos.g, fade_pos.r };
+    int c, l, lane;
+
+    scr_fading = 0;
+
+    if ( fade_pos.r == 100 && fade_pos.g == 100 && fade_pos.b == 100 ) return 0;
+
+    /* Como gr_fade16, solo pixeles de 2 o 4 bytes con el formato del sistema */
+    if ( !format || format->depth <= 8 || dest->format->depthb != format->depthb ) return 0;
+    if ( format->depthb != 2 && format->depthb != 4 ) return 0;
+
+    scr_fade.shift[0] = format->Bshift; scr_fade.max[0] = 0xFF >> format->Bloss;
+    scr_fade.shift[1] = format->Gshift; scr_fade.max[1] = 0xFF >> format->Gloss;
+    scr_fade.shift[2] = format->Rshift; scr_fade.max[2] = 0xFF >> format->Rloss;
+    scr_fade.others = ~( format->Rmask | format->Gmask | format->Bmask );
+
+    for ( lane = 0; lane < 8; lane++ )
+    {
+        scr_fade.lk[ lane ] = 32768;
+        scr_fade.lflip[ lane ] = scr_fade.lkeep[ lane ] = 0;
+    }
 
-            case    16:
-                    if ( scale_resolution_orientation == 1 || scale_resolution_orientation == 3 )
+    for ( c = 0; c < 3; c++ )
+    {
+        l = level[ c ];
+        if ( l <= 100 )
+        {
+            scr_fade.k[ c ] = ( l * 32768 + 99 ) / 100;
+            scr_fade.flip[ c ] = scr_fade.keep[ c ] = 0;
+        }
+        else
+        {
+            scr_fade.k[ c ] = ( ( l - 100 ) * 32768 + 99 ) / 100;
+            scr_fade.flip[ c ] = scr_fade.max[ c ];
+            scr_fade.keep[ c ] = 0xFFFF;
+        }
+
+        if ( format->depthb == 4 )
+        {
+            /* Los vectores trabajan por bytes */
+            if ( ( scr_fade.shift[ c ] & 7 ) || scr_fade.max[ c ] != 0xFF ) return 0;
+
+            lane = scr_fade.shift[ c ] / 8;
+            scr_fade.lk[ lane ] = scr_fade.lk[ lane + 4 ] = scr_fade.k[ c ];
+            scr_fade.lflip[ lane ] = scr_fade.lflip[ lane + 4 ] = scr_fade.flip[ c ];
+            scr_fade.lkeep[ lane ] = scr_fade.lkeep[ lane + 4 ] = scr_fade.keep[ c ];
+        }
+    }
+
+    return ( scr_fading = 1 );
+}
+
+/* --------------------------------------------------------------------------- */
+
+#if defined( SR_SSE2 )
+static __m128i scr_fade_sse2( __m128i x, __m128i k, __m128i flip, __m128i keep )
+{
+    return _mm_add_epi16( _mm_and_si128( x, keep ), _mm_mulhi_epu16( _mm_slli_epi16( _mm_xor_si128( x, flip ), 1 ), k ) );
+}
+#elif defined( SR_NEON )
+static uint16x8_t scr_fade_neon( uint16x8_t x, uint16x8_t k, uint16x8_t flip, uint16x8_t keep )
+{
+    uint16x8_t t = veorq_u16( x, flip );
+    uint16x8_t m = vcombine_u16( vshrn_n_u32( vmull_u16( vget_low_u16( t ), vget_low_u16( k ) ), 15 ),
+                                 vshrn_n_u32( vmull_u16( vget_high_u16( t ), vget_high_u16( k ) ), 15 ) );
+    return vaddq_u16( vandq_u16( x, keep ), m );
+}
+#endif
+
+/* Fade de un pixel */
+
+static uint32_t scr_fade_pixel( uint32_t v )
+{
+    uint32_t r = v & scr_fade.others, x;
+    int c;
+
+    for ( c = 0; c < 3; c++ )
+    {
+        x = ( v >> scr_fade.shift[c] ) & scr_fade.max[c];
+        r |= ( ( x & scr_fade.keep[c] ) + ( ( ( x ^ scr_fade.flip[c] ) * scr_fade.k[c] ) >> 15 ) ) << scr_fade.shift[c];
+    }
+
+    return r;
+}
+
+/* Aplica el fade a n pixeles seguidos */
+
+static void scr_fade_row( uint8_t * p, int n, int bpp )
+{
+    if ( bpp == 4 )
+    {
+        uint32_t * p32;
+
+#if defined( SR_SSE2 )
+        __m128i k = _mm_loadu_si128( ( const __m128i * ) scr_fade.lk );
+        __m128i flip = _mm_loadu_si128( ( const __m128i * ) scr_fade.lflip );
+        __m128i keep = _mm_loadu_si128( ( const __m128i * ) scr_fade.lkeep );
+        __m128i zero = _mm_setzero_si128();
+
+        for ( ; n >= 4; n -= 4, p += 16 )
+        {
+            __m128i v = _mm_loadu_si128( ( const __m128i * ) p );
+            __m128i lo = scr_fade_sse2( _mm_unpacklo_epi8( v, zero ), k, flip, keep );
+            __m128i hi = scr_fade_sse2( _mm_unpackhi_epi8( v, zero ), k, flip, keep );
+            _mm_storeu_si128( ( __m128i * ) p, _mm_packus_epi16( lo, hi ) );
+        }
+#elif defined( SR_NEON )
+        uint16x8_t k = vld1q_u16( scr_fade.lk );
+        uint16x8_t flip = vld1q_u16( scr_fade.lflip );
+        uint16x8_t keep = vld1q_u16( scr_fade.lkeep );
+
+        for ( ; n >= 4; n -= 4, p += 16 )
+        {
+            uint8x16_t v = vld1q_u8( p );
+            uint16x8_t lo = scr_fade_neon( vmovl_u8( vget_low_u8( v ) ), k, flip, keep );
+            uint16x8_t hi = scr_fade_neon( vmovl_u8( vget_high_u8( v ) ), k, flip, keep );
+            vst1q_u8( p, vcombine_u8( vmovn_u16( lo ), vmovn_u16( hi ) ) );
+        }
+#endif
+
+        for ( p32 = ( uint32_t * ) p; n--; p32++ ) *p32 = scr_fade_pixel( *p32 );
+    }
+    else if ( bpp == 2 )
+    {
+        uint16_t * p16;
+
+#if defined( SR_SSE2 )
+        __m128i kb = _mm_set1_epi16( scr_fade.k[0] ), fb = _mm_set1_epi16( scr_fade.flip[0] ), mb = _mm_set1_epi16( scr_fade.keep[0] );
+        __m128i kg = _mm_set1_epi16( scr_fade.k[1] ), fg = _mm_set1_epi16( scr_fade.flip[1] ), mg = _mm_set1_epi16( scr_fade.keep[1] );
+        __m128i kr = _mm_set1_epi16( scr_fade.k[2] ), fr = _mm_set1_epi16( scr_fade.flip[2] ), mr = _mm_set1_epi16( scr_fade.keep[2] );
+        __m128i sb = _mm_cvtsi32_si128( scr_fade.shift[0] ), xb = _mm_set1_epi16( scr_fade.max[0] );
+        __m128i sg = _mm_cvtsi32_si128( scr_fade.shift[1] ), xg = _mm_set1_epi16( scr_fade.max[1] );
+        __m128i sr = _mm_cvtsi32_si128( scr_fade.shift[2] ), xr = _mm_set1_epi16( scr_fade.max[2] );
+        __m128i others = _mm_set1_epi16( ( uint16_t ) scr_fade.others );
+
+        for ( ; n >= 8; n -= 8, p += 16 )
+        {
+            __m128i v = _mm_loadu_si128( ( const __m128i * ) p );
+            __m128i r = scr_fade_sse2( _mm_and_si128( _mm_srl_epi16( v, sr ), xr ), kr, fr, mr );
+            __m128i g = scr_fade_sse2( _mm_and_si128( _mm_srl_epi16( v, sg ), xg ), kg, fg, mg );
+            __m128i b = scr_fade_sse2( _mm_and_si128( _mm_srl_epi16( v, sb ), xb ), kb, fb, mb );
+            v = _mm_or_si128( _mm_and_si128( v, others ), _mm_sll_epi16( b, sb ) );
+            v = _mm_or_si128( v, _mm_or_si128( _mm_sll_epi16( r, sr ), _mm_sll_epi16( g, sg ) ) );
+            _mm_storeu_si128( ( __m128i * ) p, v );
+        }
+#elif defined( SR_NEON )
+        uint16x8_t kb = vdupq_n_u16( scr_fade.k[0] ), fb = vdupq_n_u16( scr_fade.flip[0] ), mb = vdupq_n_u16( scr_fade.keep[0] );
+        uint16x8_t kg = vdupq_n_u16( scr_fade.k[1] ), fg = vdupq_n_u16( scr_fade.flip[1] ), mg = vdupq_n_u16( scr_fade.keep[1] );
+        uint16x8_t kr = vdupq_n_u16( scr_fade.k[2] ), fr = vdupq_n_u16( scr_fade.flip[2] ), mr = vdupq_n_u16( scr_fade.keep[2] );
+        int16x8_t sb = vdupq_n_s16( scr_fade.shift[0] ), nb = vdupq_n_s16( -scr_fade.shift[0] );
+        int16x8_t sg = vdupq_n_s16( scr_fade.shift[1] ), ng = vdupq_n_s16( -scr_fade.shift[1] );
+        int16x8_t sr = vdupq_n_s16( scr_fade.shift[2] ), nr = vdupq_n_s16( -scr_fade.shift[2] );
+        uint16x8_t xb = vdupq_n_u16( scr_fade.max[0] ), xg = vdupq_n_u16( scr_fade.max[1] ), xr = vdupq_n_u16( scr_fade.max[2] );
+        uint16x8_t others = vdupq_n_u16( ( uint16_t ) scr_fade.others );
+
+        for ( ; n >= 8; n -= 8, p += 16 )
+        {
+            uint16x8_t v = vld1q_u16( ( const uint16_t * ) p );
+            uint16x8_t r = scr_fade_neon( vandq_u16( vshlq_u16( v, nr ), xr ), kr, fr, mr );
+            uint16x8_t g = scr_fade_neon( vandq_u16( vshlq_u16( v, ng ), xg ), kg, fg, mg );
+            uint16x8_t b = scr_fade_neon( vandq_u16( vshlq_u16( v, nb ), xb ), kb, fb, mb );
+            v = vorrq_u16( vandq_u16( v, others ), vshlq_u16( b, sb ) );
+            v = vorrq_u16( v, vorrq_u16( vshlq_u16( r, sr ), vshlq_u16( g, sg ) ) );
+            vst1q_u16( ( uint16_t * ) p, v );
+        }
+#endif
+
+        for ( p16 = ( uint16_t * ) p; n--; p16++ ) *p16 = ( uint16_t ) scr_fade_pixel( *p16 );
+    }
+}
+
+/* Fade de un rectangulo de la salida */
+
+static void scr_fade_rect( uint8_t * p, int pitch, int x, int w, int rows, int bpp )
+{
+    for ( p += x * bpp; rows-- > 0; p += pitch ) scr_fade_row( p, w, bpp );
+}
+
+/* Fade en el sitio de una banda de la pantalla, cuando no hay copia */
+
+static void scr_fade_band( int worker, void * data )
+{
+    int first = screen->h * worker / render_threads, last = screen->h * ( worker + 1 ) / render_threads;
+
+    scr_fade_rect( ( uint8_t * ) screen->pixels + first * screen->pitch, screen->pitch, 0, screen->w, last - first, screen->format->BytesPerPixel );
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Copia con scale_resolution de una banda: columnas del destino si la pantalla
+   esta girada, filas si no. Cada thread de render hace la suya */
+
+static void scale_resolution_band( int worker, void * data )
+{
+    int rotated = ( scale_resolution_orientation == 1 || scale_resolution_orientation == 3 );
+    int count = rotated ? scale_screen->w : scale_screen->h;
+    int first = count * worker / render_threads, last = count * ( worker + 1 ) / render_threads;
+    uint8_t  * pdst = ( uint8_t * ) scale_screen->pixels + first * ( rotated ? scale_screen->format->BytesPerPixel : scale_screen->pitch ) ;
+    uint8_t  * src8  = screen->pixels, * dst8  = pdst ;
+    uint16_t * src16 = screen->pixels, * dst16 = ( uint16_t * ) pdst ;
+    uint32_t * src32 = screen->pixels, * dst32 = ( uint32_t * ) pdst ;
+    int h, w;
+
+    if ( !rotated )
+    {
+        SR_SPAN * span = ( SR_SPAN * ) data;
+        int bpp = scale_screen->format->BytesPerPixel;
+        int dup = ( span->end - span->start ) * bpp;
+
+        for ( h = first; h < last; h++, pdst += scale_screen->pitch )
+        {
+            if ( scale_resolution_aspectratio && scale_resolution_table_h[h] == -1 ) continue;
+
+            src8 = ( uint8_t * ) screen->pixels + scale_resolution_table_h[h];
+
+            /* Misma fila de origen que la anterior, se copia tal cual */
+            if ( h > first && scale_resolution_table_h[h] == scale_resolution_table_h[h - 1] )
+            {
+                sr_gather( pdst, src8, 0, span->start, bpp );
+                memcpy( pdst + span->start * bpp, pdst - scale_screen->pitch + span->start * bpp, dup );
+                sr_gather( pdst, src8, span->end, scale_screen->w, bpp );
+                continue;
+            }
+
+            sr_gather( pdst, src8, 0, span->start, bpp );
+            sr_span( pdst, src8, span, bpp );
+            sr_gather( pdst, src8, span->start + span->count, scale_screen->w, bpp );
+
+            /* Las filas repetidas se copian de esta, ya con el fade */
+            if ( scr_fading ) scr_fade_row( pdst + span->start * bpp, span->end - span->start, bpp );
+        }
+        return;
+    }
+
+    switch ( scale_screen->format->BitsPerPixel )
+    {
+        case    8:
+                if ( scale_resolution_aspectratio )
+                {
+                    for ( w = first; w < last; w++ )
                     {
-                        if ( scale_resolution_aspectratio )
-                        {
-                            int inc = scale_screen->pitch / scale_screen->format->BytesPerPixel;
-                            for ( w = 0; w < scale_screen->w; w++ )
-                            {
-                                if ( scale_resolution_table_w[w] != -1 )
-                                {
-                                    src16 = (uint16_t*)((uint8_t*)screen->pixels + scale_resolution_table_w[w]);
-                                    for ( h = scale_screen->h - 1; h-- ; )
-                                    {
-                                        if ( scale_resolution_table_h[h] != -1 ) *dst16 = src16[scale_resolution_table_h[h]];
-                                        dst16 += inc;
-                                    }
-                                }
-                                dst16 = ( uint16_t * ) ( pdst += scale_screen->format->BytesPerPixel ) ;
-                            }
-                        }
-                        else
+                        if ( scale_resolution_table_w[w] != -1 )
                         {
-                            int inc = scale_screen->pitch / scale_screen->format->BytesPerPixel;
-                            for ( w = 0; w < scale_screen->w; w++ )
+                            src8 = (uint8_t*)screen->pixels + scale_resolution_table_w[w];
+                            for ( h = scale_screen->h - 1; h-- ; )
                             {
-                                src16 = (uint16_t*)((uint8_t*)screen->pixels + scale_resolution_table_w[w]);
-                                for ( h = scale_screen->h - 1; h-- ; )
-                                {
-                                    *dst16 = src16[scale_resolution_table_h[h]];
-                                    dst16 += inc;
-                                }
-                                dst16 = ( uint16_t * ) ( pdst += scale_screen->format->BytesPerPixel ) ;
+                                if ( scale_resolution_table_h[h] != -1 ) *dst8 = src8[scale_resolution_table_h[h]];
+                                dst8 += scale_screen->pitch ;
                             }
                         }
+                        dst8 = pdst += scale_screen->format->BytesPerPixel ;
                     }
-                    else
+                }
+                else
+                {
+                    for ( w = first; w < last; w++ )
                     {
-                        if ( scale_resolution_aspectratio )
+                        src8 = (uint8_t*)screen->pixels + scale_resolution_table_w[w];
+                        for ( h = scale_screen->h - 1; h-- ; )
                         {
-                            for ( h = 0; h < scale_screen->h; h++ )
-                            {
-                                if ( scale_resolution_table_h[h] != -1 )
-                                {
-                                    src16 = (uint16_t*)((uint8_t*)screen->pixels + scale_resolution_table_h[h]);
-                                    for ( w = 0; w < scale_screen->w; w++ )
-                                    {
-                                        if ( scale_resolution_table_w[w] != -1 ) *dst16 = src16[scale_resolution_table_w[w]];
-                                        dst16++;
-                                    }
-                                }
-                                dst16 = ( uint16_t * ) ( pdst += scale_screen->pitch ) ;
-                            }
-                        }
-                        else
-                        {
-                            for ( h = 0; h < scale_screen->h; h++ )
-                            {
-                                src16 = (uint16_t*)((uint8_t*)screen->pixels + scale_resolution_table_h[h]);
-                                for ( w = 0; w < scale_screen->w; w++ )
-                                {
-                                    *dst16 = src16[scale_resolution_table_w[w]];
-                                    dst16++;
-                                }
-                                dst16 = ( uint16_t * ) ( pdst += scale_screen->pitch ) ;
-                            }
+                            *dst8 = src8[scale_resolution_table_h[h]];
+                            dst8 += scale_screen->pitch ;
                         }
+                        dst8 = pdst += scale_screen->format->BytesPerPixel ;
                     }
-                    break;
+                }
+                break;
 
-            case    32:
-                    if ( scale_resolution_orientation == 1 || scale_resolution_orientation == 3 )
+        case    16:
+                if ( scale_resolution_aspectratio )
+                {
+                    int inc = scale_screen->pitch / scale_screen->format->BytesPerPixel;
+                    for ( w = first; w < last; w++ )
                     {
-                        if ( scale_resolution_aspectratio )
+                        if ( scale_resolution_table_w[w] != -1 )
                         {
-                            int inc = scale_screen->pitch / scale_screen->format->BytesPerPixel;
-                            for ( w = 0; w < scale_screen->w; w++ )
+                            src16 = (uint16_t*)((uint8_t*)screen->pixels + scale_resolution_table_w[w]);
+                            for ( h = scale_screen->h - 1; h-- ; )
                             {
-                                if ( scale_resolution_table_w[w] != -1 )
-                                {
-                                    src32 = (uint32_t*)((uint8_t*)screen->pixels + scale_resolution_table_w[w]);
-                                    for ( h = scale_screen->h - 1; h-- ; )
-                                    {
-                                        if ( scale_resolution_table_h[h] != -1 ) *dst32 = src32[scale_resolution_table_h[h]];
-                                        dst32 += inc;
-                                    }
-                                }
-                                dst32 = ( uint32_t * ) ( pdst += scale_screen->format->BytesPerPixel ) ;
+                                if ( scale_resolution_table_h[h] != -1 ) *dst16 = src16[scale_resolution_table_h[h]];
+                                dst16 += inc;
                             }
                         }
-                        else
+                        dst16 = ( uint16_t * ) ( pdst += scale_screen->format->BytesPerPixel ) ;
+                    }
+                }
+                else
+                {
+                    int inc = scale_screen->pitch / scale_screen->format->BytesPerPixel;
+                    for ( w = first; w < last; w++ )
+                    {
+                        src16 = (uint16_t*)((uint8_t*)screen->pixels + scale_resolution_table_w[w]);
+                        for ( h = scale_screen->h - 1; h-- ; )
                         {
-                            int inc = scale_screen->pitch / scale_screen->format->BytesPerPixel;
-                            for ( w = 0; w < scale_screen->w; w++ )
-                            {
-                                src32 = (uint32_t*)((uint8_t*)screen->pixels + scale_resolution_table_w[w]);
-                                for ( h = scale_screen->h - 1; h-- ; )
-                                {
-                                    *dst32 = src32[scale_resolution_table_h[h]];
-                                    dst32 += inc;
-                                }
-                                dst32 = ( uint32_t * ) ( pdst += scale_screen->format->BytesPerPixel ) ;
-                            }
+                            *dst16 = src16[scale_resolution_table_h[h]];
+                            dst16 += inc;
                         }
+                        dst16 = ( uint16_t * ) ( pdst += scale_screen->format->BytesPerPixel ) ;
                     }
-                    else
+                }
+                break;
+
+        case    32:
+                if ( scale_resolution_aspectratio )
+                {
+                    int inc = scale_screen->pitch / scale_screen->format->BytesPerPixel;
+                    for ( w = first; w < last; w++ )
                     {
-                        if ( scale_resolution_aspectratio )
+                        if ( scale_resolution_table_w[w] != -1 )
                         {
-                            for ( h = 0; h < scale_screen->h; h++ )
+                            src32 = (uint32_t*)((uint8_t*)screen->pixels + scale_resolution_table_w[w]);
+                            for ( h = scale_screen->h - 1; h-- ; )
                             {
-                                if ( scale_resolution_table_h[h] != -1 )
-                                {
-                                    src32 = (uint32_t*)((uint8_t*)screen->pixels + scale_resolution_table_h[h]);
-                                    for ( w = 0; w < scale_screen->w; w++ )
-                                    {
-                                        if ( scale_resolution_table_w[w] != -1 ) *dst32 = src32[scale_resolution_table_w[w]];
-                                        dst32++;
-                                    }
-                                }
-                                dst32 = ( uint32_t * ) ( pdst += scale_screen->pitch ) ;
+                                if ( scale_resolution_table_h[h] != -1 ) *dst32 = src32[scale_resolution_table_h[h]];
+                                dst32 += inc;
                             }
                         }
-                        else
+                        dst32 = ( uint32_t * ) ( pdst += scale_screen->format->BytesPerPixel ) ;
+                    }
+                }
+                else
+                {
+                    int inc = scale_screen->pitch / scale_screen->format->BytesPerPixel;
+                    for ( w = first; w < last; w++ )
+                    {
+                        src32 = (uint32_t*)((uint8_t*)screen->pixels + scale_resolution_table_w[w]);
+                        for ( h = scale_screen->h - 1; h-- ; )
                         {
-                            for ( h = 0; h < scale_screen->h; h++ )
-                            {
-                                src32 = (uint32_t*)((uint8_t*)screen->pixels + scale_resolution_table_h[h]);
-                                for ( w = 0; w < scale_screen->w; w++ )
-                                {
-                                    *dst32 = src32[scale_resolution_table_w[w]];
-                                    dst32++;
-                                }
-                                dst32 = ( uint32_t * ) ( pdst += scale_screen->pitch ) ;
-                            }
+                            *dst32 = src32[scale_resolution_table_h[h]];
+                            dst32 += inc;
                         }
+                        dst32 = ( uint32_t * ) ( pdst += scale_screen->format->BytesPerPixel ) ;
                     }
-                    break;
+                }
+                break;
+    }
+
+    /* Fade de las columnas de la banda. Solo las filas y columnas que se han
+       escrito: la fila h de destino sale de scale_resolution_table_h[ scale_screen->h - 2 - h ]
+       y la ultima no se escribe */
+    if ( scr_fading )
+    {
+        int bpp = scale_screen->format->BytesPerPixel;
+
+        if ( scale_resolution_aspectratio )
+        {
+            while ( first < last && scale_resolution_table_w[first] == -1 ) first++;
+            while ( last > first && scale_resolution_table_w[last - 1] == -1 ) last--;
         }
 
+        pdst = ( uint8_t * ) scale_screen->pixels;
+        for ( h = 0; h < scale_screen->h - 1; h++, pdst += scale_screen->pitch )
+            if ( !scale_resolution_aspectratio || scale_resolution_table_h[ scale_screen->h - 2 - h ] != -1 )
+                scr_fade_row( pdst + first * bpp, last - first, bpp );
+    }
+}
+
+/* --------------------------------------------------------------------------- */
+
+typedef struct
+{
+    SCALER * scaler;
+    GRAPH * src;
+}
+SCALE_JOB;
+
+/* Escala una banda horizontal del origen */
+
+static void scale_band( int worker, void * data )
+{
+    SCALE_JOB * job = ( SCALE_JOB * ) data;
+    int y = job->src->height * worker / render_threads;
+    int rows = job->src->height * ( worker + 1 ) / render_threads - y;
+    int n;
+
+    if ( !scr_fading )
+    {
+        if ( rows > 0 ) ( *job->scaler )( job->src->data, job->src->pitch, screen->pixels, screen->pitch, job->src->width, job->src->height, y, rows );
+        return;
+    }
+
+    /* Con fade se escala por tramos y se aplica a cada tramo mientras sigue en cache */
+    for ( ; rows > 0; y += n, rows -= n )
+    {
+        n = ( rows < SCR_FADE_ROWS ) ? rows : SCR_FADE_ROWS;
+        ( *job->scaler )( job->src->data, job->src->pitch, screen->pixels, screen->pitch, job->src->width, job->src->height, y, n );
+        scr_fade_rect( ( uint8_t * ) screen->pixels + y * scale_factor * screen->pitch, screen->pitch, 0, screen->w, n * scale_factor, screen->format->BytesPerPixel );
+    }
+}
+
+/* --------------------------------------------------------------------------- */
+
+void gr_unlock_screen()
+{
+    if ( !screen_locked || !screen->pixels ) return ;
+
+    screen_locked = 0 ;
+
+    scr_fade_setup( scrbitmap );
+
+    if ( scale_resolution != -1 )
+    {
+        SR_SPAN span;
+
+        scale_resolution_span( &span );
+        gr_render_threads_run( scale_resolution_band, &span );
+
         if ( SDL_MUSTLOCK( scale_screen ) ) SDL_UnlockSurface( scale_screen ) ;
         if ( waitvsync ) gr_wait_vsync();
         SDL_Flip( scale_screen ) ;
     }
     else if ( enable_scale )
     {
+        SCALE_JOB job = { NULL, NULL };
         GRAPH * scr;
 
         if ( scrbitmap->format->depth == 8 )
         {
-            uint8_t * original, * poriginal;
-            uint16_t * extra, * pextra;
+            uint8_t * original, * poriginal, * pextra;
             int n = scrbitmap->height, length;
 
             if (
                 !scrbitmap_extra ||
                 scrbitmap_extra->width != scrbitmap->width ||
-                scrbitmap_extra->height != scrbitmap->height
+                scrbitmap_extra->height != scrbitmap->height ||
+                scrbitmap_extra->format->depth != screen->format->BitsPerPixel
             )
             {
                 if ( scrbitmap_extra ) bitmap_destroy( scrbitmap_extra );
-                scrbitmap_extra = bitmap_new( 0, scrbitmap->width, scrbitmap->height, 16 );
+                scrbitmap_extra = bitmap_new( 0, scrbitmap->width, scrbitmap->height, screen->format->BitsPerPixel == 32 ? 32 : 16 );
             }
 
             poriginal = scrbitmap->data;
@@ -441,11 +1046,19 @@ void gr_unlock_screen()
             while ( n-- )
             {
                 original = poriginal;
-                extra = pextra;
                 length = scrbitmap->width;
-                while ( length-- ) *extra++ = sys_pixel_format->palette->colorequiv[ *original++ ];
+                if ( scrbitmap_extra->format->depth == 32 )
+                {
+                    uint32_t * extra = ( uint32_t * ) pextra;
+                    while ( length-- ) *extra++ = sys_pixel_format->palette->colorequiv[ *original++ ];
+                }
+                else
+                {
+                    uint16_t * extra = ( uint16_t * ) pextra;
+                    while ( length-- ) *extra++ = sys_pixel_format->palette->colorequiv[ *original++ ];
+                }
                 poriginal += scrbitmap->pitch;
-                pextra = ( uint16_t * )((( uint8_t * ) pextra ) + scrbitmap_extra->pitch );
+                pextra += scrbitmap_extra->pitch;
             }
 
             scr = scrbitmap_extra;
@@ -459,19 +1072,34 @@ void gr_unlock_screen()
         switch ( scale_mode )
         {
             case SCALE_SCALE2X:
-                scale2x( scr->data, scr->pitch, screen->pixels, screen->pitch, scr->width, scr->height );
+                job.scaler = ( scr->format->depth == 32 ) ? scale2x_32 : scale2x;
                 break;
 
             case SCALE_HQ2X:
-                hq2x( scr->data, scr->pitch, screen->pixels, screen->pitch, scr->width, scr->height );
+                hq_init( 2, scr->width, scr->height, scr->format->depth );
+                job.scaler = ( scr->format->depth == 32 ) ? hq2x_32 : hq2x;
                 break;
 
             case SCALE_SCANLINE2X:
-                scanline2x( scr->data, scr->pitch, screen->pixels, screen->pitch, scr->width, scr->height );
+                job.scaler = ( scr->format->depth == 32 ) ? scanline2x_32 : scanline2x;
                 break;
 
             case SCALE_NOFILTER:
-                scale_normal2x( scr->data, scr->pitch, screen->pixels, screen->pitch, scr->width, scr->height );
+                job.scaler = ( scr->format->depth == 32 ) ? scale_normal2x_32 : scale_normal2x;
+                break;
+
+            case SCALE_SCALE3X:
+                job.scaler = ( scr->format->depth == 32 ) ? scale3x_32 : scale3x;
+                break;
+
+            case SCALE_SCALE3X_SMOOTH:
+                hq_init( 3, scr->width, scr->height, scr->format->depth );
+                job.scaler = ( scr->format->depth == 32 ) ? scale3x_smooth_32 : scale3x_smooth;
+                break;
+
+            case SCALE_HQ2X_TWICE:
+                hq_init( 4, scr->width, scr->height, scr->format->depth );
+                job.scaler = ( scr->format->depth == 32 ) ? hq2x_twice_32 : hq2x_twice;
                 break;
 
             case SCALE_NONE:
@@ -479,13 +1107,28 @@ void gr_unlock_screen()
                 break;
         }
 
+        /* Las bandas son independientes, cada thread de render escala la suya */
+        if ( job.scaler )
+        {
+            job.src = scr;
+            gr_render_threads_run( scale_band, &job );
+        }
+
         if ( SDL_MUSTLOCK( screen ) ) SDL_UnlockSurface( screen ) ;
         if ( waitvsync ) gr_wait_vsync();
         SDL_Flip( screen ) ;
     }
     else if ( scrbitmap->info_flags & GI_EXTERNAL_DATA )
     {
-        if ( double_buffer ||
+        /* Sin copia el fade se aplica sobre la propia pantalla. Hay que volcarla
+           entera y redibujar todo en el siguiente frame */
+        if ( scr_fading )
+        {
+            gr_render_threads_run( scr_fade_band, NULL );
+            if ( background ) background->modified = 1 ;
+        }
+
+        if ( double_buffer || scr_fading ||
                 (
                     updaterects_count == 1 &&
                     updaterects[0].x == 0 &&
@@ -526,3 +1169,12 @@ extern void suspend_bgd();
 }
 
 /* --------------------------------------------------------------------------- */
+
+/* The 8 bits screen converted for the scaler is a heap bitmap */
+
+void gr_screen_savestate_register()
+{
+    savestate_register_ptr( scrbitmap_extra );
+}
+
+/* --------------------------------------------------------------------------- */
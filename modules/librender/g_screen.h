@@ -32,5 +32,6 @@
 extern void gr_draw_screen( GRAPH * dest, int restore_type, int dump_type ) ;
 extern int gr_lock_screen() ;
 extern void gr_unlock_screen() ;
+extern void gr_screen_savestate_register() ;
 
 #endif
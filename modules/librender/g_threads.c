@@ -0,0 +1,205 @@
+/*
+ *  Copyright © 2006-2019 SplinterGU (Fenix/Bennugd)
+ *
+ *  This file is part of Bennu - Game Development
+ *
+ *  This software is provided 'as-is', without any express or implied
+ *  warranty. In no event will the authors be held liable for any damages
+ *  arising from the use of this software.
+ *
+ *  Permission is granted to anyone to use this software for any purpose,
+ *  including commercial applications, and to alter it and redistribute it
+ *  freely, subject to the following restrictions:
+ *
+ *     1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *     2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *     3. This notice may not be removed or altered from any source
+ *     distribution.
+ *
+ */
+
+#include <stdlib.h>
+
+#include <SDL.h>
+
+#include "librender.h"
+
+/* --------------------------------------------------------------------------- */
+
+typedef struct
+{
+    SDL_Thread * thread ;
+    SDL_sem * start ;
+    int index ;
+}
+RENDER_WORKER ;
+
+/* Threads drawing the current frame, 1 when drawing serially */
+
+int render_threads = 1 ;
+
+static RENDER_WORKER workers[ MAX_RENDER_THREADS ] ;
+static int workers_count = 0 ;
+static int workers_wanted = 1 ;
+
+static SDL_sem * workers_done = NULL ;
+static int workers_quit = 0 ;
+
+static RENDER_JOB * current_job = NULL ;
+static void * current_data = NULL ;
+
+/* --------------------------------------------------------------------------- */
+
+static int render_worker( void * data )
+{
+    RENDER_WORKER * worker = ( RENDER_WORKER * ) data ;
+
+    for ( ;; )
+    {
+        SDL_SemWait( worker->start ) ;
+        if ( workers_quit ) break ;
+
+        ( *current_job )( worker->index, current_data ) ;
+
+        SDL_SemPost( workers_done ) ;
+    }
+
+    return 0 ;
+}
+
+/* --------------------------------------------------------------------------- */
+/*
+ *  FUNCTION : gr_render_threads_shutdown
+ *
+ *  Stop all the render threads
+ *
+ *  PARAMS :
+ *      None
+ *
+ *  RETURN VALUE :
+ *      None
+ *
+ */
+
+void gr_render_threads_shutdown( void )
+{
+    int n ;
+
+    workers_quit = 1 ;
+
+    for ( n = 1; n <= workers_count; n++ ) SDL_SemPost( workers[ n ].start ) ;
+
+    for ( n = 1; n <= workers_count; n++ )
+    {
+        SDL_WaitThread( workers[ n ].thread, NULL ) ;
+        SDL_DestroySemaphore( workers[ n ].start ) ;
+    }
+
+    if ( workers_done ) SDL_DestroySemaphore( workers_done ) ;
+    workers_done = NULL ;
+
+    workers_count = 0 ;
+    workers_wanted = 1 ;
+    workers_quit = 0 ;
+
+    render_threads = 1 ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void start_workers( int count )
+{
+    RENDER_WORKER * worker ;
+
+    if ( !workers_done && !( workers_done = SDL_CreateSemaphore( 0 ) ) ) return ;
+
+    while ( workers_count + 1 < count )
+    {
+        worker = &workers[ workers_count + 1 ] ;
+        worker->index = workers_count + 1 ;
+
+        if ( !( worker->start = SDL_CreateSemaphore( 0 ) ) ) return ;
+        if ( !( worker->thread = SDL_CreateThread( render_worker, ( void * ) worker ) ) )
+        {
+            SDL_DestroySemaphore( worker->start ) ;
+            return ;
+        }
+
+        workers_count++ ;
+    }
+}
+
+/* --------------------------------------------------------------------------- */
+/*
+ *  FUNCTION : gr_render_threads_update
+ *
+ *  Start or stop render threads to match the configured count.
+ *  Called before drawing each frame, sets render_threads.
+ *
+ *  PARAMS :
+ *      None
+ *
+ *  RETURN VALUE :
+ *      None
+ *
+ */
+
+void gr_render_threads_update( void )
+{
+    int count = 1 ;
+
+#if LIBRETRO_CORE
+    count = libretro_render_threads ;
+#endif
+
+    if ( count < 1 ) count = 1 ;
+    if ( count > MAX_RENDER_THREADS ) count = MAX_RENDER_THREADS ;
+
+    if ( count != workers_wanted )
+    {
+        gr_render_threads_shutdown() ;
+        if ( count > 1 ) start_workers( count ) ;
+        workers_wanted = count ;
+    }
+
+    /* Thread creation may fail, use what we got */
+    render_threads = workers_count + 1 ;
+}
+
+/* --------------------------------------------------------------------------- */
+/*
+ *  FUNCTION : gr_render_threads_run
+ *
+ *  Run a job in all the render threads and wait for it to finish.
+ *  The calling thread runs it as worker 0.
+ *
+ *  PARAMS :
+ *      job             Function called once by every worker
+ *      data            User-defined parameter passed to job
+ *
+ *  RETURN VALUE :
+ *      None
+ *
+ */
+
+void gr_render_threads_run( RENDER_JOB * job, void * data )
+{
+    int n ;
+
+    current_job = job ;
+    current_data = data ;
+
+    for ( n = 1; n < render_threads; n++ ) SDL_SemPost( workers[ n ].start ) ;
+
+    ( *job )( 0, data ) ;
+
+    for ( n = 1; n < render_threads; n++ ) SDL_SemWait( workers_done ) ;
+}
+
+/* --------------------------------------------------------------------------- */
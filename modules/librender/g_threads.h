@@ -0,0 +1,54 @@
+/*
+ *  Copyright © 2006-2019 SplinterGU (Fenix/Bennugd)
+ *
+ *  This file is part of Bennu - Game Development
+ *
+ *  This software is provided 'as-is', without any express or implied
+ *  warranty. In no event will the authors be held liable for any damages
+ *  arising from the use of this software.
+ *
+ *  Permission is granted to anyone to use this software for any purpose,
+ *  including commercial applications, and to alter it and redistribute it
+ *  freely, subject to the following restrictions:
+ *
+ *     1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *     2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *     3. This notice may not be removed or altered from any source
+ *     distribution.
+ *
+ */
+
+#include <stdlib.h>
+
+#ifndef __G_THREADS_H
+#define __G_THREADS_H
+
+/* --------------------------------------------------------------------------- */
+
+#define MAX_RENDER_THREADS  8
+
+/* Work done by every thread, worker 0 is the calling one */
+
+typedef void ( RENDER_JOB )( int worker, void * data );
+
+/* --------------------------------------------------------------------------- */
+
+extern int render_threads ;
+
+#if LIBRETRO_CORE
+extern int libretro_render_threads ;    /* Core option, set by libretro.c */
+#endif
+
+extern void gr_render_threads_update( void ) ;
+extern void gr_render_threads_run( RENDER_JOB * job, void * data ) ;
+extern void gr_render_threads_shutdown( void ) ;
+
+/* --------------------------------------------------------------------------- */
+
+#endif
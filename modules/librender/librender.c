@@ -36,6 +36,7 @@
 #include "dlvaracc.h"
 
 #include "librender.h"
+#include "savestate.h"
 
 /* --------------------------------------------------------------------------- */
 /* Son las variables que se desea acceder.                           */
@@ -119,6 +120,48 @@ HOOK __bgdexport( librender, handler_hooks )[] =
     {    0, NULL          }
 } ;
 
+/* --------------------------------------------------------------------------- */
+/* Save states                                                                 */
+
+extern int fade_inc ;
+extern SDL_Color fade_from ;
+extern SDL_Color fade_to ;
+extern SDL_Color fade_pos ;
+
+static void librender_savestate_loaded()
+{
+    /* The screen surface is not part of the state, redraw it completely */
+    if ( background ) background->modified = 1 ;
+}
+
+/* --------------------------------------------------------------------------- */
+/* Module initialization                                                       */
+
+void __bgdexport( librender, module_initialize )()
+{
+    gr_object_savestate_register() ;
+    gr_instance_savestate_register() ;
+    gr_screen_savestate_register() ;
+    hq_savestate_register() ;
+
+    savestate_register_var( fade_inc );
+    savestate_register_var( fade_on );
+    savestate_register_var( fade_set );
+    savestate_register_var( fade_step );
+    savestate_register_var( fade_from );
+    savestate_register_var( fade_to );
+    savestate_register_var( fade_pos );
+
+    savestate_add_load_hook( librender_savestate_loaded ) ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+void __bgdexport( librender, module_finalize )()
+{
+    gr_render_threads_shutdown() ;
+}
+
 /* --------------------------------------------------------------------------- */
 /* exports                                                                     */
 /* --------------------------------------------------------------------------- */
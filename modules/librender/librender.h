@@ -49,6 +49,7 @@
 #include "g_object.h"
 #include "g_rects.h"
 #include "g_screen.h"
+#include "g_threads.h"
 #endif
 
 #include "scaler.h"
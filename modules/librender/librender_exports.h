@@ -61,6 +61,9 @@ DLCONSTANT __bgdexport( librender, constants_def )[] =
     { "SCALE_SCANLINE2X",   TYPE_DWORD, SCALE_SCANLINE2X },
     { "SCALE_NORMAL2X",     TYPE_DWORD, SCALE_NOFILTER   },
     { "SCALE_NOFILTER",     TYPE_DWORD, SCALE_NOFILTER   },
+    { "SCALE_SCALE3X",      TYPE_DWORD, SCALE_SCALE3X    },
+    { "SCALE_SCALE3X_SMOOTH", TYPE_DWORD, SCALE_SCALE3X_SMOOTH },
+    { "SCALE_HQ2X_TWICE",   TYPE_DWORD, SCALE_HQ2X_TWICE },
 
     { NULL          , 0         ,  0  }
 } ;
@@ -31,7 +31,15 @@
 
 #define SCALE_NONE          0x0000
 
+/* Todos los escaladores procesan las filas [y, y + rows) del origen, de
+   width x height pixels, y escriben las filas correspondientes del destino.
+   srcPtr y dstPtr apuntan siempre al principio de las imagenes completas,
+   asi cada thread puede escalar su propia banda */
+
+typedef void ( SCALER )( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows );
+
 #include "scaler_scale2x.h"
+#include "scaler_scale3x.h"
 #include "scaler_hq2x.h"
 #include "scaler_scanline.h"
 #include "scaler_normal.h"
@@ -36,62 +36,73 @@
 /* --------------------------------------------------------------------------- */
 
 #include "librender.h"
+#include "savestate.h"
 
 /* --------------------------------------------------------------------------- */
 
 #define PIXEL00_0 *(q) = w5;
-#define PIXEL00_10 *(q) = interpolate16_2(3,1,w5, w1);
-#define PIXEL00_11 *(q) = interpolate16_2(3,1,w5, w4);
-#define PIXEL00_12 *(q) = interpolate16_2(3,1,w5, w2);
-#define PIXEL00_20 *(q) = interpolate16_3(2,1,1,w5, w4, w2);
-#define PIXEL00_21 *(q) = interpolate16_3(2,1,1,w5, w1, w2);
-#define PIXEL00_22 *(q) = interpolate16_3(2,1,1,w5, w1, w4);
-#define PIXEL00_60 *(q) = interpolate16_3(5,2,1,w5, w2, w4);
-#define PIXEL00_61 *(q) = interpolate16_3(5,2,1,w5, w4, w2);
-#define PIXEL00_70 *(q) = interpolate16_3(6,1,1,w5, w4, w2);
-#define PIXEL00_90 *(q) = interpolate16_3(2,3,3,w5, w4, w2);
-#define PIXEL00_100 *(q) = interpolate16_3(14,1,1,w5, w4, w2);
+#define PIXEL00_10 *(q) = interpolate_2(3,1,w5, w1);
+#define PIXEL00_11 *(q) = interpolate_2(3,1,w5, w4);
+#define PIXEL00_12 *(q) = interpolate_2(3,1,w5, w2);
+#define PIXEL00_20 *(q) = interpolate_3(2,1,1,w5, w4, w2);
+#define PIXEL00_21 *(q) = interpolate_3(2,1,1,w5, w1, w2);
+#define PIXEL00_22 *(q) = interpolate_3(2,1,1,w5, w1, w4);
+#define PIXEL00_60 *(q) = interpolate_3(5,2,1,w5, w2, w4);
+#define PIXEL00_61 *(q) = interpolate_3(5,2,1,w5, w4, w2);
+#define PIXEL00_70 *(q) = interpolate_3(6,1,1,w5, w4, w2);
+#define PIXEL00_90 *(q) = interpolate_3(2,3,3,w5, w4, w2);
+#define PIXEL00_100 *(q) = interpolate_3(14,1,1,w5, w4, w2);
 
 #define PIXEL01_0 *(q+1) = w5;
-#define PIXEL01_10 *(q+1) = interpolate16_2(3,1,w5, w3);
-#define PIXEL01_11 *(q+1) = interpolate16_2(3,1,w5, w2);
-#define PIXEL01_12 *(q+1) = interpolate16_2(3,1,w5, w6);
-#define PIXEL01_20 *(q+1) = interpolate16_3(2,1,1,w5, w2, w6);
-#define PIXEL01_21 *(q+1) = interpolate16_3(2,1,1,w5, w3, w6);
-#define PIXEL01_22 *(q+1) = interpolate16_3(2,1,1,w5, w3, w2);
-#define PIXEL01_60 *(q+1) = interpolate16_3(5,2,1,w5, w6, w2);
-#define PIXEL01_61 *(q+1) = interpolate16_3(5,2,1,w5, w2, w6);
-#define PIXEL01_70 *(q+1) = interpolate16_3(6,1,1,w5, w2, w6);
-#define PIXEL01_90 *(q+1) = interpolate16_3(2,3,3,w5, w2, w6);
-#define PIXEL01_100 *(q+1) = interpolate16_3(14,1,1,w5, w2, w6);
+#define PIXEL01_10 *(q+1) = interpolate_2(3,1,w5, w3);
+#define PIXEL01_11 *(q+1) = interpolate_2(3,1,w5, w2);
+#define PIXEL01_12 *(q+1) = interpolate_2(3,1,w5, w6);
+#define PIXEL01_20 *(q+1) = interpolate_3(2,1,1,w5, w2, w6);
+#define PIXEL01_21 *(q+1) = interpolate_3(2,1,1,w5, w3, w6);
+#define PIXEL01_22 *(q+1) = interpolate_3(2,1,1,w5, w3, w2);
+#define PIXEL01_60 *(q+1) = interpolate_3(5,2,1,w5, w6, w2);
+#define PIXEL01_61 *(q+1) = interpolate_3(5,2,1,w5, w2, w6);
+#define PIXEL01_70 *(q+1) = interpolate_3(6,1,1,w5, w2, w6);
+#define PIXEL01_90 *(q+1) = interpolate_3(2,3,3,w5, w2, w6);
+#define PIXEL01_100 *(q+1) = interpolate_3(14,1,1,w5, w2, w6);
 
 #define PIXEL10_0 *(q+nextlineDst) = w5;
-#define PIXEL10_10 *(q+nextlineDst) = interpolate16_2(3,1,w5, w7);
-#define PIXEL10_11 *(q+nextlineDst) = interpolate16_2(3,1,w5, w8);
-#define PIXEL10_12 *(q+nextlineDst) = interpolate16_2(3,1,w5, w4);
-#define PIXEL10_20 *(q+nextlineDst) = interpolate16_3(2,1,1,w5, w8, w4);
-#define PIXEL10_21 *(q+nextlineDst) = interpolate16_3(2,1,1,w5, w7, w4);
-#define PIXEL10_22 *(q+nextlineDst) = interpolate16_3(2,1,1,w5, w7, w8);
-#define PIXEL10_60 *(q+nextlineDst) = interpolate16_3(5,2,1,w5, w4, w8);
-#define PIXEL10_61 *(q+nextlineDst) = interpolate16_3(5,2,1,w5, w8, w4);
-#define PIXEL10_70 *(q+nextlineDst) = interpolate16_3(6,1,1,w5, w8, w4);
-#define PIXEL10_90 *(q+nextlineDst) = interpolate16_3(2,3,3,w5, w8, w4);
-#define PIXEL10_100 *(q+nextlineDst) = interpolate16_3(14,1,1,w5, w8, w4);
+#define PIXEL10_10 *(q+nextlineDst) = interpolate_2(3,1,w5, w7);
+#define PIXEL10_11 *(q+nextlineDst) = interpolate_2(3,1,w5, w8);
+#define PIXEL10_12 *(q+nextlineDst) = interpolate_2(3,1,w5, w4);
+#define PIXEL10_20 *(q+nextlineDst) = interpolate_3(2,1,1,w5, w8, w4);
+#define PIXEL10_21 *(q+nextlineDst) = interpolate_3(2,1,1,w5, w7, w4);
+#define PIXEL10_22 *(q+nextlineDst) = interpolate_3(2,1,1,w5, w7, w8);
+#define PIXEL10_60 *(q+nextlineDst) = interpolate_3(5,2,1,w5, w4, w8);
+#define PIXEL10_61 *(q+nextlineDst) = interpolate_3(5,2,1,w5, w8, w4);
+#define PIXEL10_70 *(q+nextlineDst) = interpolate_3(6,1,1,w5, w8, w4);
+#define PIXEL10_90 *(q+nextlineDst) = interpolate_3(2,3,3,w5, w8, w4);
+#define PIXEL10_100 *(q+nextlineDst) = interpolate_3(14,1,1,w5, w8, w4);
 
 #define PIXEL11_0 *(q+1+nextlineDst) = w5;
-#define PIXEL11_10 *(q+1+nextlineDst) = interpolate16_2(3,1,w5, w9);
-#define PIXEL11_11 *(q+1+nextlineDst) = interpolate16_2(3,1,w5, w6);
-#define PIXEL11_12 *(q+1+nextlineDst) = interpolate16_2(3,1,w5, w8);
-#define PIXEL11_20 *(q+1+nextlineDst) = interpolate16_3(2,1,1,w5, w6, w8);
-#define PIXEL11_21 *(q+1+nextlineDst) = interpolate16_3(2,1,1,w5, w9, w8);
-#define PIXEL11_22 *(q+1+nextlineDst) = interpolate16_3(2,1,1,w5, w9, w6);
-#define PIXEL11_60 *(q+1+nextlineDst) = interpolate16_3(5,2,1,w5, w8, w6);
-#define PIXEL11_61 *(q+1+nextlineDst) = interpolate16_3(5,2,1,w5, w6, w8);
-#define PIXEL11_70 *(q+1+nextlineDst) = interpolate16_3(6,1,1,w5, w6, w8);
-#define PIXEL11_90 *(q+1+nextlineDst) = interpolate16_3(2,3,3,w5, w6, w8);
-#define PIXEL11_100 *(q+1+nextlineDst) = interpolate16_3(14,1,1,w5, w6, w8);
-
-#define YUV(x) RGBtoYUV[w ## x]
+#define PIXEL11_10 *(q+1+nextlineDst) = interpolate_2(3,1,w5, w9);
+#define PIXEL11_11 *(q+1+nextlineDst) = interpolate_2(3,1,w5, w6);
+#define PIXEL11_12 *(q+1+nextlineDst) = interpolate_2(3,1,w5, w8);
+#define PIXEL11_20 *(q+1+nextlineDst) = interpolate_3(2,1,1,w5, w6, w8);
+#define PIXEL11_21 *(q+1+nextlineDst) = interpolate_3(2,1,1,w5, w9, w8);
+#define PIXEL11_22 *(q+1+nextlineDst) = interpolate_3(2,1,1,w5, w9, w6);
+#define PIXEL11_60 *(q+1+nextlineDst) = interpolate_3(5,2,1,w5, w8, w6);
+#define PIXEL11_61 *(q+1+nextlineDst) = interpolate_3(5,2,1,w5, w6, w8);
+#define PIXEL11_70 *(q+1+nextlineDst) = interpolate_3(6,1,1,w5, w6, w8);
+#define PIXEL11_90 *(q+1+nextlineDst) = interpolate_3(2,3,3,w5, w6, w8);
+#define PIXEL11_100 *(q+1+nextlineDst) = interpolate_3(14,1,1,w5, w6, w8);
+
+#define YUV(x) YUV_ ## x
+
+#define YUV_1 y0[ -1 ]
+#define YUV_2 y0[ 0 ]
+#define YUV_3 y0[ 1 ]
+#define YUV_4 y1[ -1 ]
+#define YUV_5 y1[ 0 ]
+#define YUV_6 y1[ 1 ]
+#define YUV_7 y2[ -1 ]
+#define YUV_8 y2[ 0 ]
+#define YUV_9 y2[ 1 ]
 
 /* --------------------------------------------------------------------------- */
 
@@ -105,12 +116,12 @@ static uint32_t   *RGBtoYUV;
 
 /* --------------------------------------------------------------------------- */
 /**
- * Interpolate two 16 bit pixels with the weights specified in the template
+ * Interpolate two 16 or 32 bit pixels with the weights specified in the template
  * parameters. Used by the hq scaler family.
  * @note w1 and w2 must sum up to 2, 4, 8 or 16.
  */
 
-static inline uint16_t interpolate16_2( int w1, int w2, uint16_t p1, uint16_t p2 )
+static inline uint32_t interpolate_2( uint32_t w1, uint32_t w2, uint32_t p1, uint32_t p2 )
 {
     return (((( p1 & ( sys_pixel_format->Rmask | sys_pixel_format->Bmask ) ) * w1 + ( p2 & ( sys_pixel_format->Rmask | sys_pixel_format->Bmask ) ) * w2 ) / ( w1 + w2 ) ) & ( sys_pixel_format->Rmask | sys_pixel_format->Bmask ) ) |
             (((( p1 & sys_pixel_format->Gmask ) * w1 + ( p2 & sys_pixel_format->Gmask ) * w2 ) / ( w1 + w2 ) ) & sys_pixel_format->Gmask );
@@ -118,12 +129,12 @@ static inline uint16_t interpolate16_2( int w1, int w2, uint16_t p1, uint16_t p2
 
 /* --------------------------------------------------------------------------- */
 /**
- * Interpolate three 16 bit pixels with the weights specified in the template
+ * Interpolate three 16 or 32 bit pixels with the weights specified in the template
  * parameters. Used by the hq scaler family.
  * @note w1, w2 and w3 must sum up to 2, 4, 8 or 16.
  */
 
-static inline uint16_t interpolate16_3( int w1, int w2, int w3, uint16_t p1, uint16_t p2, uint16_t p3 )
+static inline uint32_t interpolate_3( uint32_t w1, uint32_t w2, uint32_t w3, uint32_t p1, uint32_t p2, uint32_t p3 )
 {
     return (((( p1 & ( sys_pixel_format->Rmask | sys_pixel_format->Bmask ) ) * w1 + ( p2 & ( sys_pixel_format->Rmask | sys_pixel_format->Bmask ) ) * w2 + ( p3 & ( sys_pixel_format->Rmask | sys_pixel_format->Bmask ) ) * w3 ) / ( w1 + w2 + w3 ) ) & ( sys_pixel_format->Rmask | sys_pixel_format->Bmask ) ) |
             (((( p1 & sys_pixel_format->Gmask ) * w1 + ( p2 & sys_pixel_format->Gmask ) * w2 + ( p3 & sys_pixel_format->Gmask ) * w3 ) / ( w1 + w2 + w3 ) ) & sys_pixel_format->Gmask );
@@ -172,8 +183,11 @@ static inline int diffYUV( int yuv1, int yuv2 )
 
 /* --------------------------------------------------------------------------- */
 
-static void inline hq2x_main( int w1, int w2, int w3, int w4, int w5, int w6, int w7, int w8, int w9,
-        uint32_t nextlineSrc, uint32_t nextlineDst, uint16_t *p, uint16_t *q, int skiplastline )
+/* Calcula el bloque de 2x2 de w5 en q (con nextlineDst de paso) a partir de
+   los pixels vecinos y sus valores YUV en las filas y0, y1 e y2 */
+
+static void inline hq2x_main( uint32_t w1, uint32_t w2, uint32_t w3, uint32_t w4, uint32_t w5, uint32_t w6, uint32_t w7, uint32_t w8, uint32_t w9,
+        const uint32_t *y0, const uint32_t *y1, const uint32_t *y2, uint32_t nextlineDst, uint32_t *q, int skiplastline )
 {
     int pattern = 0;
 
@@ -2539,137 +2553,293 @@ void InitLUT()
 
 /* --------------------------------------------------------------------------- */
 
-void hq2x( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height )
+/* Buffers de trabajo de cada banda. Los threads de render no piden memoria
+   al heap, se piden aqui antes de lanzarlos */
+
+static uint32_t *hq_buffers[ MAX_RENDER_THREADS ];
+static size_t hq_buffers_size[ MAX_RENDER_THREADS ];   /* En uint32_t */
+
+/* --------------------------------------------------------------------------- */
+
+/* Las tablas y los buffers estan en el heap, sus punteros se guardan con el */
+
+void hq_savestate_register()
+{
+    savestate_register_var( hq2xinited );
+    savestate_register_ptr( LUT16to32 );
+    savestate_register_ptr( RGBtoYUV );
+    savestate_register_ptr( hq_buffers );
+    savestate_register_var( hq_buffers_size );
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Filas de trabajo de hq_scale: 3 filas del origen, su YUV y la salida */
+
+static size_t hq_lines_size( int factor, int width )
 {
-    register int w1, w2, w3, w4, w5, w6, w7, w8, w9;
+    return 6 * ( width + 2 ) + factor * factor * width;
+}
+
+/* --------------------------------------------------------------------------- */
 
-    const uint32_t nextlineSrc = srcPitch / sizeof( uint16_t );
-    uint16_t *p = ( uint16_t * )srcPtr;
-    const uint32_t nextlineDst = dstPitch / sizeof( uint16_t );
-    uint16_t *q = ( uint16_t * )dstPtr;
+/* Prepara la tabla YUV de 16 bits y el buffer de cada banda. Se llama antes
+   de lanzar los threads que escalan, los escaladores solo leen la tabla */
 
-    int tmpWidth;
+void hq_init( int factor, int width, int height, int bpp )
+{
+    uint32_t *buffer;
+    size_t size;
+    int n;
 
-    if ( !hq2xinited )
+    if ( bpp == 16 && !hq2xinited )
     {
         InitLUT();
         hq2xinited = 1;
     }
 
-    //  +----+----+----+
-    //  |    |    |    |
-    //  | w1 | w2 | w3 |
-    //  +----+----+----+
-    //  |    |    |    |
-    //  | w4 | w5 | w6 |
-    //  +----+----+----+
-    //  |    |    |    |
-    //  | w7 | w8 | w9 |
-    //  +----+----+----+
+    /* hq2x dos veces guarda ademas la banda intermedia a 2x, con una fila mas
+       por arriba y por abajo */
+    if ( factor == 4 )
+        size = width * ( bpp / 8 ) * ( height / render_threads + 3 ) + hq_lines_size( 2, width * 2 );
+    else
+        size = hq_lines_size( factor, width );
 
+    for ( n = 0; n < render_threads; n++ )
+    {
+        if ( hq_buffers_size[ n ] >= size ) continue;
 
-    /********************* Primera fila **************************/
-    w1 = 0; w4 = 0; w7 = 0;
-    w2 = 0; w5 = *( p ); w8 = *( p + nextlineSrc );
+        if ( !( buffer = ( uint32_t * ) bgd_realloc( hq_buffers[ n ], size * sizeof( uint32_t ) ) ) ) continue;
 
-    tmpWidth = width - 1;
-    while ( tmpWidth-- )
-    {
-        p++;
+        hq_buffers[ n ] = buffer;
+        hq_buffers_size[ n ] = size;
+    }
+}
+
+/* --------------------------------------------------------------------------- */
 
-        w3 = 0; w6 = *( p ); w9 = *( p + nextlineSrc );
+/* Buffer de la banda que contiene la fila y, las mismas que reparte scale_band */
 
-        hq2x_main( w1, w2, w3, w4, w5, w6, w7, w8, w9, nextlineSrc, nextlineDst, p, q, 0 );
+static uint32_t *hq_band_buffer( int height, int y )
+{
+    int n = render_threads - 1;
 
-        w1 = w2; w4 = w5; w7 = w8;
-        w2 = w3; w5 = w6; w8 = w9;
+    while ( n > 0 && y < height * n / render_threads ) n--;
 
-        q += 2;
-    }
+    return hq_buffers[ n ];
+}
 
-    /* Ultima columna de la primera fila */
-    p++;
+/* --------------------------------------------------------------------------- */
 
-    w3 = 0; w6 = 0; w9 = 0;
+/* YUV de un pixel de 32 bits, igual que InitLUT para los de 16 bits */
 
-    hq2x_main( w1, w2, w3, w4, w5, w6, w7, w8, w9, nextlineSrc, nextlineDst, p, q, 0 );
+static inline uint32_t yuv32( uint32_t color )
+{
+    int r = ( color & sys_pixel_format->Rmask ) >> sys_pixel_format->Rshift;
+    int g = ( color & sys_pixel_format->Gmask ) >> sys_pixel_format->Gshift;
+    int b = ( color & sys_pixel_format->Bmask ) >> sys_pixel_format->Bshift;
 
-    w1 = w2; w4 = w5; w7 = w8;
-    w2 = w3; w5 = w6; w8 = w9;
+    return ((( r + g + b ) >> 2 ) << 16 ) | (( 128 + (( r - b ) >> 2 ) ) << 8 ) | ( 128 + (( -r + 2 * g - b ) >> 3 ) );
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Carga una fila del origen (16 o 32 bits) en line[0..width-1] junto con su YUV.
+   Las columnas -1 y width, y las filas fuera de la imagen, quedan a 0 como en
+   el hq2x original */
+
+static void hq_load_line( uint32_t *line, uint32_t *yuv, const uint8_t *src, int width, int bpp )
+{
+    int n;
 
-    q += 2;
+    line[ -1 ] = line[ width ] = 0;
 
-    /* Proxima linea */
-    p += nextlineSrc - width;
-    q += ( nextlineDst - width ) * 2;
+    if ( !src )
+        memset( line, 0, width * sizeof( uint32_t ) );
+    else if ( bpp == 16 )
+        for ( n = 0; n < width; n++ ) line[ n ] = (( const uint16_t * ) src )[ n ];
+    else
+        memcpy( line, src, width * sizeof( uint32_t ) );
 
-    height -= 2;
+    if ( bpp == 16 )
+        for ( n = -1; n <= width; n++ ) yuv[ n ] = RGBtoYUV[ line[ n ] ];
+    else
+        for ( n = -1; n <= width; n++ ) yuv[ n ] = yuv32( line[ n ] );
+}
 
-    /********************* cuerpo principal **************************/
+/* --------------------------------------------------------------------------- */
 
-    while ( height-- )
+static void hq_store_line( uint8_t *dst, const uint32_t *line, int count, int bpp )
+{
+    if ( bpp == 16 )
     {
-//  w1 = *(p - 1 - nextlineSrc); w4 = *(p - 1); w7 = *(p - 1 + nextlineSrc);
-        w1 = 0; w4 = 0; w7 = 0;
-        w2 = *( p - nextlineSrc ); w5 = *( p ); w8 = *( p + nextlineSrc );
+        uint16_t *q = ( uint16_t * ) dst;
+        while ( count-- ) *q++ = *line++;
+    }
+    else
+        memcpy( dst, line, count * sizeof( uint32_t ) );
+}
 
-        tmpWidth = width - 1;
-        while ( tmpWidth-- )
-        {
-            p++;
+/* --------------------------------------------------------------------------- */
 
-            w3 = *( p - nextlineSrc ); w6 = *( p ); w9 = *( p + nextlineSrc );
+static void hq2x_line( uint32_t *q, int width, uint32_t *s[ 3 ], uint32_t *y[ 3 ] )
+{
+    int x;
 
-            hq2x_main( w1, w2, w3, w4, w5, w6, w7, w8, w9, nextlineSrc, nextlineDst, p, q, 0 );
+    for ( x = 0; x < width; x++ )
+    {
+        hq2x_main( s[ 0 ][ x - 1 ], s[ 0 ][ x ], s[ 0 ][ x + 1 ],
+                   s[ 1 ][ x - 1 ], s[ 1 ][ x ], s[ 1 ][ x + 1 ],
+                   s[ 2 ][ x - 1 ], s[ 2 ][ x ], s[ 2 ][ x + 1 ],
+                   y[ 0 ] + x, y[ 1 ] + x, y[ 2 ] + x, width * 2, q + x * 2, 0 );
+    }
+}
 
-            w1 = w2; w4 = w5; w7 = w8;
-            w2 = w3; w5 = w6; w8 = w9;
+/* --------------------------------------------------------------------------- */
 
-            q += 2;
-        }
+/* scale3x suavizado: reglas del scale3x (AdvanceMAME) comparando por
+   distancia YUV como el hq2x, y mezclando 3:1 con el pixel central en vez de
+   copiar el vecino. No es el hq3x original, que usa sus propias tablas de
+   patrones */
 
-        /* Ultima columna de la fila N */
-        p++;
+#define SMOOTH_SAME(a,b)  ( w##a == w##b || !diffYUV( YUV( a ), YUV( b ) ) )
+#define SMOOTH_MIX(a)     interpolate_2( 3, 1, w##a, w5 )
 
-        w3 = 0; w6 = 0; w9 = 0;
+static void scale3x_smooth_line( uint32_t *q, int width, uint32_t *s[ 3 ], uint32_t *y[ 3 ] )
+{
+    uint32_t *q0 = q, *q1 = q + width * 3, *q2 = q + width * 6;
+    const uint32_t *y0, *y1, *y2;
+    int x, e42, e26, e48, e86;
+
+    for ( x = 0; x < width; x++, q0 += 3, q1 += 3, q2 += 3 )
+    {
+        uint32_t w1 = s[ 0 ][ x - 1 ], w2 = s[ 0 ][ x ], w3 = s[ 0 ][ x + 1 ];
+        uint32_t w4 = s[ 1 ][ x - 1 ], w5 = s[ 1 ][ x ], w6 = s[ 1 ][ x + 1 ];
+        uint32_t w7 = s[ 2 ][ x - 1 ], w8 = s[ 2 ][ x ], w9 = s[ 2 ][ x + 1 ];
 
-        hq2x_main( w1, w2, w3, w4, w5, w6, w7, w8, w9, nextlineSrc, nextlineDst, p, q, 0 );
+        q0[ 0 ] = q0[ 1 ] = q0[ 2 ] = q1[ 0 ] = q1[ 1 ] = q1[ 2 ] = q2[ 0 ] = q2[ 1 ] = q2[ 2 ] = w5;
 
-        w1 = w2; w4 = w5; w7 = w8;
-        w2 = w3; w5 = w6; w8 = w9;
+        y0 = y[ 0 ] + x; y1 = y[ 1 ] + x; y2 = y[ 2 ] + x;
 
-        q += 2;
+        if ( SMOOTH_SAME( 2, 8 ) || SMOOTH_SAME( 4, 6 ) ) continue;
 
-        p += nextlineSrc - width;
-        q += ( nextlineDst - width ) * 2;
+        e42 = SMOOTH_SAME( 4, 2 );
+        e26 = SMOOTH_SAME( 2, 6 );
+        e48 = SMOOTH_SAME( 4, 8 );
+        e86 = SMOOTH_SAME( 8, 6 );
+
+        if ( e42 ) q0[ 0 ] = SMOOTH_MIX( 4 );
+        if ( ( e42 && !SMOOTH_SAME( 5, 3 ) ) || ( e26 && !SMOOTH_SAME( 5, 1 ) ) ) q0[ 1 ] = SMOOTH_MIX( 2 );
+        if ( e26 ) q0[ 2 ] = SMOOTH_MIX( 6 );
+        if ( ( e42 && !SMOOTH_SAME( 5, 7 ) ) || ( e48 && !SMOOTH_SAME( 5, 1 ) ) ) q1[ 0 ] = SMOOTH_MIX( 4 );
+        if ( ( e26 && !SMOOTH_SAME( 5, 9 ) ) || ( e86 && !SMOOTH_SAME( 5, 3 ) ) ) q1[ 2 ] = SMOOTH_MIX( 6 );
+        if ( e48 ) q2[ 0 ] = SMOOTH_MIX( 4 );
+        if ( ( e48 && !SMOOTH_SAME( 5, 9 ) ) || ( e86 && !SMOOTH_SAME( 5, 7 ) ) ) q2[ 1 ] = SMOOTH_MIX( 8 );
+        if ( e86 ) q2[ 2 ] = SMOOTH_MIX( 6 );
     }
+}
 
-    /********************* ultima linea **************************/
+#undef SMOOTH_SAME
+#undef SMOOTH_MIX
 
-    w1 = 0; w4 = 0; w7 = 0;
-    w2 = *( p - nextlineSrc ); w5 = *( p ); w8 = 0;
+/* --------------------------------------------------------------------------- */
 
-    tmpWidth = width - 1;
-    while ( tmpWidth-- )
+/* Escala las filas [y, y + rows) manteniendo las 3 filas vecinas (pixels y
+   YUV) en buffers de 32 bits, asi el mismo codigo sirve para 16 y 32 bits.
+   srcPtr contiene las filas del origen a partir de srcFirst, y dstPtr apunta
+   a la primera fila de salida de la banda. buffer es el de la banda, esto se
+   llama desde los threads de render */
+
+static void hq_scale( int factor, uint32_t *buffer, uint8_t *srcPtr, uint32_t srcPitch, int srcFirst, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows, int bpp )
+{
+    uint32_t *s[ 3 ], *yuv[ 3 ], *out, *aux;
+    int n, row;
+
+    if ( !buffer || width < 1 || rows < 1 ) return;
+
+    for ( n = 0; n < 3; n++ )
     {
-        p++;
+        s[ n ] = buffer + ( width + 2 ) * n + 1;
+        yuv[ n ] = buffer + ( width + 2 ) * ( n + 3 ) + 1;
+    }
+    out = buffer + 6 * ( width + 2 );
 
-        w3 = *( p - nextlineSrc ); w6 = *( p ); w9 = 0;
+    hq_load_line( s[ 0 ], yuv[ 0 ], y > 0 ? srcPtr + ( y - 1 - srcFirst ) * srcPitch : NULL, width, bpp );
+    hq_load_line( s[ 1 ], yuv[ 1 ], srcPtr + ( y - srcFirst ) * srcPitch, width, bpp );
 
-        hq2x_main( w1, w2, w3, w4, w5, w6, w7, w8, w9, nextlineSrc, nextlineDst, p, q, 0 );
+    for ( row = y; row < y + rows; row++ )
+    {
+        hq_load_line( s[ 2 ], yuv[ 2 ], row + 1 < height ? srcPtr + ( row + 1 - srcFirst ) * srcPitch : NULL, width, bpp );
+
+        if ( factor == 3 )
+            scale3x_smooth_line( out, width, s, yuv );
+        else
+            hq2x_line( out, width, s, yuv );
 
-        w1 = w2; w4 = w5; w7 = w8;
-        w2 = w3; w5 = w6; w8 = w9;
+        for ( n = 0; n < factor; n++ )
+            hq_store_line( dstPtr + (( row - y ) * factor + n ) * dstPitch, out + n * factor * width, factor * width, bpp );
 
-        q += 2;
+        aux = s[ 0 ]; s[ 0 ] = s[ 1 ]; s[ 1 ] = s[ 2 ]; s[ 2 ] = aux;
+        aux = yuv[ 0 ]; yuv[ 0 ] = yuv[ 1 ]; yuv[ 1 ] = yuv[ 2 ]; yuv[ 2 ] = aux;
     }
+}
 
-    /* Ultima columna de la utima fila */
-    p++;
+/* --------------------------------------------------------------------------- */
+
+/* hq2x dos veces (4x): dos pasadas de hq2x, no el hq4x original con sus
+   propias tablas de patrones. La banda intermedia incluye una fila mas por
+   arriba y por abajo para que la segunda pasada tenga sus vecinas. Va al
+   principio del buffer de la banda, y las filas de trabajo detras */
 
-    w3 = 0; w6 = 0; w9 = 0;
+static void hq2x_twice_scale( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows, int bpp )
+{
+    int first = y > 0 ? y - 1 : 0, last = y + rows < height ? y + rows + 1 : height;
+    uint32_t pitch = width * 2 * ( bpp / 8 );
+    uint32_t *buffer = hq_band_buffer( height, y ), *lines;
+    uint8_t *tmp = ( uint8_t * ) buffer;
 
-    hq2x_main( w1, w2, w3, w4, w5, w6, w7, w8, w9, nextlineSrc, nextlineDst, p, q, 1 );
+    if ( !buffer || width < 1 || rows < 1 ) return;
+
+    lines = buffer + ( pitch * ( last - first ) * 2 + 3 ) / 4;
+
+    hq_scale( 2, lines, srcPtr, srcPitch, 0, tmp, pitch, width, height, first, last - first, bpp );
+    hq_scale( 2, lines, tmp, pitch, first * 2, dstPtr + y * 4 * dstPitch, dstPitch, width * 2, height * 2, y * 2, rows * 2, bpp );
+}
+
+/* --------------------------------------------------------------------------- */
+
+void hq2x( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows )
+{
+    hq_scale( 2, hq_band_buffer( height, y ), srcPtr, srcPitch, 0, dstPtr + y * 2 * dstPitch, dstPitch, width, height, y, rows, 16 );
+}
+
+void hq2x_32( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows )
+{
+    hq_scale( 2, hq_band_buffer( height, y ), srcPtr, srcPitch, 0, dstPtr + y * 2 * dstPitch, dstPitch, width, height, y, rows, 32 );
+}
+
+/* --------------------------------------------------------------------------- */
+
+void scale3x_smooth( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows )
+{
+    hq_scale( 3, hq_band_buffer( height, y ), srcPtr, srcPitch, 0, dstPtr + y * 3 * dstPitch, dstPitch, width, height, y, rows, 16 );
+}
+
+void scale3x_smooth_32( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows )
+{
+    hq_scale( 3, hq_band_buffer( height, y ), srcPtr, srcPitch, 0, dstPtr + y * 3 * dstPitch, dstPitch, width, height, y, rows, 32 );
+}
+
+/* --------------------------------------------------------------------------- */
+
+void hq2x_twice( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows )
+{
+    hq2x_twice_scale( srcPtr, srcPitch, dstPtr, dstPitch, width, height, y, rows, 16 );
+}
+
+void hq2x_twice_32( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows )
+{
+    hq2x_twice_scale( srcPtr, srcPitch, dstPtr, dstPitch, width, height, y, rows, 32 );
 }
 
 /* --------------------------------------------------------------------------- */
@@ -31,7 +31,14 @@
 
 /* Rutinas del ScummVM's HQ2x algorithm */
 
-extern void hq2x( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height );
+extern void hq_init( int factor, int width, int height, int bpp );
+extern void hq_savestate_register();
+extern void hq2x( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows );
+extern void hq2x_32( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows );
+extern void scale3x_smooth( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows );
+extern void scale3x_smooth_32( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows );
+extern void hq2x_twice( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows );
+extern void hq2x_twice_32( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows );
 
 #define SCALE_HQ2X          0x0002
 
@@ -29,7 +29,8 @@
 #ifndef __SCALER_NORMAL2X_H
 #define __SCALER_NORMAL2X_H
 
-extern void scale_normal2x( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height );
+extern void scale_normal2x( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows );
+extern void scale_normal2x_32( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows );
 
 #define SCALE_NOFILTER      0x0004
 
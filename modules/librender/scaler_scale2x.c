@@ -120,39 +120,112 @@ static void internal_scale2x_16_def( uint16_t *dst0, uint16_t* dst1, const uint1
 
 /* --------------------------------------------------------------------------- */
 
-void scale2x( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height )
+static void internal_scale2x_32_def( uint32_t *dst0, uint32_t* dst1, const uint32_t* src0, const uint32_t* src1, const uint32_t* src2, unsigned count )
 {
-    uint16_t *dst0 = ( uint16_t * )dstPtr;
-    uint16_t *dst1 = dst0 + ( dstPitch / 2 );
+    /* first pixel */
+    dst0[0] = src1[0];
+    dst1[0] = src1[0];
 
-    uint16_t *src0 = ( uint16_t * )srcPtr;
-    uint16_t *src1 = src0 + ( srcPitch / 2 );
-    uint16_t *src2 = src1 + ( srcPitch / 2 );
+    if ( src1[1] == src0[0] && src2[0] != src0[0] )
+        dst0[1] = src0[0];
+    else
+        dst0[1] = src1[0];
 
-    int count;
+    if ( src1[1] == src2[0] && src0[0] != src2[0] )
+        dst1[1] = src2[0];
+    else
+        dst1[1] = src1[0];
 
-    internal_scale2x_16_def( dst0, dst1, src0, src0, src1, width );
+    ++src0;
+    ++src1;
+    ++src2;
 
-    count = height;
+    dst0 += 2;
+    dst1 += 2;
 
+    /* central pixels */
     count -= 2;
     while ( count )
     {
-        dst0 += dstPitch;
-        dst1 += dstPitch;
+        if ( src1[-1] == src0[0] && src2[0] != src0[0] && src1[1] != src0[0] )
+            dst0[0] = src0[0];
+        else
+            dst0[0] = src1[0];
+
+        if ( src1[1] == src0[0] && src2[0] != src0[0] && src1[-1] != src0[0] )
+            dst0[1] = src0[0];
+        else
+            dst0[1] = src1[0];
+
+        if ( src1[-1] == src2[0] && src0[0] != src2[0] && src1[1] != src2[0] )
+            dst1[0] = src2[0];
+        else
+            dst1[0] = src1[0];
+
+        if ( src1[1] == src2[0] && src0[0] != src2[0] && src1[-1] != src2[0] )
+            dst1[1] = src2[0];
+        else
+            dst1[1] = src1[0];
 
-        internal_scale2x_16_def( dst0, dst1, src0, src1, src2, width );
+        ++src0;
+        ++src1;
+        ++src2;
 
-        src0 = src1;
-        src1 = src2;
-        src2 += srcPitch / 2;
+        dst0 += 2;
+        dst1 += 2;
 
         --count;
     }
-    dst0 += dstPitch;
-    dst1 += dstPitch;
 
-    internal_scale2x_16_def( dst0, dst1, src0, src1, src1, width );
+    /* last pixel */
+    if ( src1[-1] == src0[0] && src2[0] != src0[0] )
+        dst0[0] = src0[0];
+    else
+        dst0[0] = src1[0];
+
+    if ( src1[-1] == src2[0] && src0[0] != src2[0] )
+        dst1[0] = src2[0];
+    else
+        dst1[0] = src1[0];
+
+    dst0[1] = src1[0];
+    dst1[1] = src1[0];
+}
+
+/* --------------------------------------------------------------------------- */
+
+void scale2x( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows )
+{
+    uint16_t *src0, *src1, *src2;
+
+    for ( ; rows--; y++ )
+    {
+        src1 = ( uint16_t * )( srcPtr + y * srcPitch );
+        src0 = y ? ( uint16_t * )(( uint8_t * )src1 - srcPitch ) : src1;
+        src2 = y + 1 < height ? ( uint16_t * )(( uint8_t * )src1 + srcPitch ) : src1;
+
+        internal_scale2x_16_def( ( uint16_t * )( dstPtr + ( y * 2     ) * dstPitch ),
+                                 ( uint16_t * )( dstPtr + ( y * 2 + 1 ) * dstPitch ),
+                                 src0, src1, src2, width );
+    }
+}
+
+/* --------------------------------------------------------------------------- */
+
+void scale2x_32( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows )
+{
+    uint32_t *src0, *src1, *src2;
+
+    for ( ; rows--; y++ )
+    {
+        src1 = ( uint32_t * )( srcPtr + y * srcPitch );
+        src0 = y ? ( uint32_t * )(( uint8_t * )src1 - srcPitch ) : src1;
+        src2 = y + 1 < height ? ( uint32_t * )(( uint8_t * )src1 + srcPitch ) : src1;
+
+        internal_scale2x_32_def( ( uint32_t * )( dstPtr + ( y * 2     ) * dstPitch ),
+                                 ( uint32_t * )( dstPtr + ( y * 2 + 1 ) * dstPitch ),
+                                 src0, src1, src2, width );
+    }
 }
 
 /* --------------------------------------------------------------------------- */
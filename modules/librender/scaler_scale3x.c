@@ -0,0 +1,170 @@
+/*
+ *  Copyright © 2001, 2002, 2003, 2004 Andrea Mazzoleni
+ *
+ *  Copyright © 2006-2019 SplinterGU (Fenix/Bennugd)
+ *  Copyright © 2002-2006 Fenix Team (Fenix)
+ *  Copyright © 1999-2002 José Luis Cebrián Pagüe (Fenix)
+ *
+ *  This file is part of Bennu - Game Development
+ *
+ *  This software is provided 'as-is', without any express or implied
+ *  warranty. In no event will the authors be held liable for any damages
+ *  arising from the use of this software.
+ *
+ *  Permission is granted to anyone to use this software for any purpose,
+ *  including commercial applications, and to alter it and redistribute it
+ *  freely, subject to the following restrictions:
+ *
+ *     1. The origin of this software must not be misrepresented; you must not
+ *     claim that you wrote the original software. If you use this software
+ *     in a product, an acknowledgment in the product documentation would be
+ *     appreciated but is not required.
+ *
+ *     2. Altered source versions must be plainly marked as such, and must not be
+ *     misrepresented as being the original software.
+ *
+ *     3. This notice may not be removed or altered from any source
+ *     distribution.
+ *
+ */
+
+/*
+ * You can find an high level description of the effect at :
+ *
+ * http://scale2x.sourceforge.net/scale3x.html
+ *
+ * Alternatively at the previous license terms, you are allowed to use this
+ * code in your program with these conditions:
+ * - the program is not used in commercial activities.
+ * - the whole source code of the program is released with the binary.
+ * - derivative works of the program are allowed.
+ */
+
+/* --------------------------------------------------------------------------- */
+
+#include "librender.h"
+
+/* --------------------------------------------------------------------------- */
+
+static void internal_scale3x_16_def( uint16_t *dst0, uint16_t *dst1, uint16_t *dst2, const uint16_t *src0, const uint16_t *src1, const uint16_t *src2, unsigned count )
+{
+    unsigned x, l, r;
+
+    for ( x = 0; x < count; x++ )
+    {
+        uint16_t A, B, C, D, E, F, G, H, I;
+
+        l = x ? x - 1 : 0;
+        r = x + 1 < count ? x + 1 : x;
+
+        A = src0[l]; B = src0[x]; C = src0[r];
+        D = src1[l]; E = src1[x]; F = src1[r];
+        G = src2[l]; H = src2[x]; I = src2[r];
+
+        if ( B != H && D != F )
+        {
+            dst0[0] = D == B ? D : E;
+            dst0[1] = ( D == B && E != C ) || ( B == F && E != A ) ? B : E;
+            dst0[2] = B == F ? F : E;
+            dst1[0] = ( D == B && E != G ) || ( D == H && E != A ) ? D : E;
+            dst1[1] = E;
+            dst1[2] = ( B == F && E != I ) || ( H == F && E != C ) ? F : E;
+            dst2[0] = D == H ? D : E;
+            dst2[1] = ( D == H && E != I ) || ( H == F && E != G ) ? H : E;
+            dst2[2] = H == F ? F : E;
+        }
+        else
+        {
+            dst0[0] = dst0[1] = dst0[2] = E;
+            dst1[0] = dst1[1] = dst1[2] = E;
+            dst2[0] = dst2[1] = dst2[2] = E;
+        }
+
+        dst0 += 3;
+        dst1 += 3;
+        dst2 += 3;
+    }
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void internal_scale3x_32_def( uint32_t *dst0, uint32_t *dst1, uint32_t *dst2, const uint32_t *src0, const uint32_t *src1, const uint32_t *src2, unsigned count )
+{
+    unsigned x, l, r;
+
+    for ( x = 0; x < count; x++ )
+    {
+        uint32_t A, B, C, D, E, F, G, H, I;
+
+        l = x ? x - 1 : 0;
+        r = x + 1 < count ? x + 1 : x;
+
+        A = src0[l]; B = src0[x]; C = src0[r];
+        D = src1[l]; E = src1[x]; F = src1[r];
+        G = src2[l]; H = src2[x]; I = src2[r];
+
+        if ( B != H && D != F )
+        {
+            dst0[0] = D == B ? D : E;
+            dst0[1] = ( D == B && E != C ) || ( B == F && E != A ) ? B : E;
+            dst0[2] = B == F ? F : E;
+            dst1[0] = ( D == B && E != G ) || ( D == H && E != A ) ? D : E;
+            dst1[1] = E;
+            dst1[2] = ( B == F && E != I ) || ( H == F && E != C ) ? F : E;
+            dst2[0] = D == H ? D : E;
+            dst2[1] = ( D == H && E != I ) || ( H == F && E != G ) ? H : E;
+            dst2[2] = H == F ? F : E;
+        }
+        else
+        {
+            dst0[0] = dst0[1] = dst0[2] = E;
+            dst1[0] = dst1[1] = dst1[2] = E;
+            dst2[0] = dst2[1] = dst2[2] = E;
+        }
+
+        dst0 += 3;
+        dst1 += 3;
+        dst2 += 3;
+    }
+}
+
+/* --------------------------------------------------------------------------- */
+
+void scale3x( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows )
+{
+    uint16_t *src0, *src1, *src2;
+
+    for ( ; rows--; y++ )
+    {
+        src1 = ( uint16_t * )( srcPtr + y * srcPitch );
+        src0 = y ? ( uint16_t * )(( uint8_t * )src1 - srcPitch ) : src1;
+        src2 = y + 1 < height ? ( uint16_t * )(( uint8_t * )src1 + srcPitch ) : src1;
+
+        internal_scale3x_16_def( ( uint16_t * )( dstPtr + ( y * 3     ) * dstPitch ),
+                                 ( uint16_t * )( dstPtr + ( y * 3 + 1 ) * dstPitch ),
+                                 ( uint16_t * )( dstPtr + ( y * 3 + 2 ) * dstPitch ),
+                                 src0, src1, src2, width );
+    }
+}
+
+/* --------------------------------------------------------------------------- */
+
+void scale3x_32( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows )
+{
+    uint32_t *src0, *src1, *src2;
+
+    for ( ; rows--; y++ )
+    {
+        src1 = ( uint32_t * )( srcPtr + y * srcPitch );
+        src0 = y ? ( uint32_t * )(( uint8_t * )src1 - srcPitch ) : src1;
+        src2 = y + 1 < height ? ( uint32_t * )(( uint8_t * )src1 + srcPitch ) : src1;
+
+        internal_scale3x_32_def( ( uint32_t * )( dstPtr + ( y * 3     ) * dstPitch ),
+                                 ( uint32_t * )( dstPtr + ( y * 3 + 1 ) * dstPitch ),
+                                 ( uint32_t * )( dstPtr + ( y * 3 + 2 ) * dstPitch ),
+                                 src0, src1, src2, width );
+    }
+}
+
+/* --------------------------------------------------------------------------- */
+
@@ -38,15 +38,43 @@
 
 /* --------------------------------------------------------------------------- */
 
-void scanline2x( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height )
+void scanline2x( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows )
 {
     const uint32_t nextlineSrc = srcPitch / sizeof( uint16_t );
-    const uint16_t *p = ( const uint16_t * )srcPtr;
+    const uint16_t *p = ( const uint16_t * )( srcPtr + y * srcPitch );
 
     const uint32_t nextlineDst = dstPitch / sizeof( uint16_t );
-    uint16_t *q = ( uint16_t * )dstPtr;
+    uint16_t *q = ( uint16_t * )( dstPtr + y * 2 * dstPitch );
 
-    while ( height-- )
+    while ( rows-- )
+    {
+        int tmpWidth = width;
+        while ( tmpWidth-- )
+        {
+            *q = *p;
+            *( q + nextlineDst ) = 0;
+            q++;
+            *q = *p;
+            *( q + nextlineDst ) = 0;
+            q++;
+            p++;
+        }
+        p += nextlineSrc - width;
+        q += ( nextlineDst - width ) * 2;
+    }
+}
+
+/* --------------------------------------------------------------------------- */
+
+void scanline2x_32( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows )
+{
+    const uint32_t nextlineSrc = srcPitch / sizeof( uint32_t );
+    const uint32_t *p = ( const uint32_t * )( srcPtr + y * srcPitch );
+
+    const uint32_t nextlineDst = dstPitch / sizeof( uint32_t );
+    uint32_t *q = ( uint32_t * )( dstPtr + y * 2 * dstPitch );
+
+    while ( rows-- )
     {
         int tmpWidth = width;
         while ( tmpWidth-- )
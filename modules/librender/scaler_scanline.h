@@ -29,7 +29,8 @@
 #ifndef __SCALER_SCANLINE2X_H
 #define __SCALER_SCANLINE2X_H
 
-extern void scanline2x( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height );
+extern void scanline2x( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows );
+extern void scanline2x_32( uint8_t *srcPtr, uint32_t srcPitch, uint8_t *dstPtr, uint32_t dstPitch, int width, int height, int y, int rows );
 
 #define SCALE_SCANLINE2X    0x0003
 
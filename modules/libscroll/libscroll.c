@@ -33,6 +33,7 @@
 
 #include "bgddl.h"
 #include "dlvaracc.h"
+#include "savestate.h"
 
 #include "libgrbase.h"
 #include "libblit.h"
@@ -58,6 +59,15 @@ int scrolls_objects[ 10 ] = { 0 };
 
 scrolldata scrolls[ 10 ] ;
 
+/* Instancias de cada scroll, ordenadas como en el frame anterior */
+
+static INSTANCE_LIST scroll_instances[ 10 ] ;
+
+/* Instancias del scroll que se dibuja, antes de ordenarlas */
+
+static INSTANCE ** proclist = NULL ;
+static int proclist_reserved = 0 ;
+
 /* --------------------------------------------------------------------------- */
 
 /* Locals */
@@ -109,6 +119,357 @@ DLVARFIXUP __bgdexport( libscroll, globals_fixup )[] =
 static void draw_scroll( int n, REGION * clip );
 static int info_scroll( int n, REGION * clip, int * z, int * drawme );
 
+/* --------------------------------------------------------------------------- */
+/* Caché de las capas del scroll                                               */
+/*                                                                             */
+/* El fondo y el primer plano se componen en un buffer circular del tamaño de  */
+/* la región. Si el scroll se mueve solo se componen las franjas nuevas, y se  */
+/* recompone entero cuando los gráficos cambian.                               */
+/* --------------------------------------------------------------------------- */
+
+typedef struct
+{
+    GRAPH * bitmap ;            /* Buffer circular con las dos capas compuestas */
+    int ok ;
+
+    GRAPH * graph ;
+    GRAPH * back ;
+    uint32_t graph_serial ;
+    uint32_t back_serial ;
+    int flags1, flags2 ;
+
+    int posx0, posy0 ;          /* Posición del primer plano en la composición */
+    int x1, y1 ;                /* Fase del fondo en la composición */
+    int ox, oy ;                /* Origen del buffer circular */
+    REGION cover ;              /* Zona (relativa a la región) que cubren ambas capas */
+}
+SCROLL_CACHE ;
+
+static SCROLL_CACHE scroll_cache[ 10 ] ;
+
+/* --------------------------------------------------------------------------- */
+
+/* Centro con el que se colocan las baldosas, y lo que se desplazan
+   realmente una vez que gr_blit aplica su propio centro */
+
+static void scroll_layer_center( GRAPH * gr, int flags, int * cx, int * cy, int * offx, int * offy )
+{
+    int bx, by ;
+
+    if ( gr->ncpoints > 0 && gr->cpoints[0].x >= 0 )
+    {
+        *cx = gr->cpoints[0].x ;
+        *cy = gr->cpoints[0].y ;
+    }
+    else
+    {
+        *cx = gr->width / 2 ;
+        *cy = gr->height / 2 ;
+    }
+
+    if ( gr->ncpoints && gr->cpoints[0].x != CPOINT_UNDEFINED )
+    {
+        bx = gr->cpoints[0].x ;
+        by = gr->cpoints[0].y ;
+    }
+    else
+    {
+        bx = gr->width / 2 ;
+        by = gr->height / 2 ;
+    }
+
+    if ( flags & B_HMIRROR ) bx = gr->width  - 1 - bx ;
+    if ( flags & B_VMIRROR ) by = gr->height - 1 - by ;
+
+    *offx = *cx - bx ;
+    *offy = *cy - by ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Dibuja una capa en mosaico. La región empieza en (x, y), termina en
+   (x2, y2) y en su esquina está el punto (px, py) del gráfico */
+
+static void scroll_draw_layer( GRAPH * dest, REGION * clip, int x, int y, int x2, int y2, int px, int py, int flags, GRAPH * gr )
+{
+    int cx, cy, offx, offy, tx, ty ;
+
+    scroll_layer_center( gr, flags, &cx, &cy, &offx, &offy ) ;
+
+    for ( ty = y - py ; ty < y2 ; ty += gr->height )
+    {
+        if ( ty + offy + ( int ) gr->height <= clip->y ) continue ;
+        if ( ty + offy > clip->y2 ) break ;
+
+        for ( tx = x - px ; tx < x2 ; tx += gr->width )
+        {
+            if ( tx + offx + ( int ) gr->width <= clip->x ) continue ;
+            if ( tx + offx > clip->x2 ) break ;
+
+            gr_blit( dest, clip, tx + cx, ty + cy, flags, gr ) ;
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Zona de una región de w x h que cubren las baldosas de la capa */
+
+static void scroll_layer_cover( GRAPH * gr, int flags, int w, int h, int px, int py, REGION * cover )
+{
+    int cx, cy, offx, offy ;
+
+    scroll_layer_center( gr, flags, &cx, &cy, &offx, &offy ) ;
+
+    if ( w - 2 + px < 0 || h - 2 + py < 0 )
+    {
+        cover->x = cover->y = 0 ;
+        cover->x2 = cover->y2 = -1 ;
+        return ;
+    }
+
+    cover->x  = MAX( 0, offx - px ) ;
+    cover->y  = MAX( 0, offy - py ) ;
+    cover->x2 = MIN( w - 1, offx - px + ( ( w - 2 + px ) / ( int ) gr->width  + 1 ) * ( int ) gr->width  - 1 ) ;
+    cover->y2 = MIN( h - 1, offy - py + ( ( h - 2 + py ) / ( int ) gr->height + 1 ) * ( int ) gr->height - 1 ) ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Compone las capas en una zona (relativa a la región) del buffer circular */
+
+static void scroll_cache_render( int n, REGION * area, GRAPH * graph, GRAPH * back, SCROLL_EXTRA_DATA * data )
+{
+    SCROLL_CACHE * c = &scroll_cache[n] ;
+    int w = c->bitmap->width, h = c->bitmap->height ;
+    int i, j, tx, ty ;
+    REGION r ;
+
+    if ( region_is_empty( area ) ) return ;
+
+    for ( j = 0 ; j < 2 ; j++ )
+    {
+        ty = j ? c->oy - h : c->oy ;
+        r.y  = MAX( area->y,  j ? h - c->oy : 0 ) + ty ;
+        r.y2 = MIN( area->y2, j ? h - 1 : h - 1 - c->oy ) + ty ;
+        if ( r.y > r.y2 ) continue ;
+
+        for ( i = 0 ; i < 2 ; i++ )
+        {
+            tx = i ? c->ox - w : c->ox ;
+            r.x  = MAX( area->x,  i ? w - c->ox : 0 ) + tx ;
+            r.x2 = MIN( area->x2, i ? w - 1 : w - 1 - c->ox ) + tx ;
+            if ( r.x > r.x2 ) continue ;
+
+            gr_clear_region( c->bitmap, &r ) ;
+            if ( back ) scroll_draw_layer( c->bitmap, &r, tx, ty, tx + w - 1, ty + h - 1, scrolls[n].x1, scrolls[n].y1, data->flags2, back ) ;
+            scroll_draw_layer( c->bitmap, &r, tx, ty, tx + w - 1, ty + h - 1, scrolls[n].x0, scrolls[n].y0, data->flags1, graph ) ;
+        }
+    }
+
+    /* Ya no hay que analizarlo, y nunca tiene GI_NOCOLORKEY */
+    bitmap_clear_modified( c->bitmap );
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Recuerda dónde estaban las capas este frame */
+
+static void scroll_cache_moved( int n )
+{
+    scroll_cache[n].posx0 = scrolls[n].posx0 ;
+    scroll_cache[n].posy0 = scrolls[n].posy0 ;
+    scroll_cache[n].x1 = scrolls[n].x1 ;
+    scroll_cache[n].y1 = scrolls[n].y1 ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Dibuja las capas desde la caché. Devuelve 0 si hay que dibujarlas
+   directamente: solo las copias opacas de 8 y 16 bits dan lo mismo
+   compuestas de antemano (a 32 bits gr_blit mezcla cada pixel con el
+   destino), y con un solo gráfico que ya cubre la región no se gana nada */
+
+static int scroll_draw_cached( int n, GRAPH * dest, REGION * clip, GRAPH * graph, GRAPH * back, SCROLL_EXTRA_DATA * data )
+{
+    SCROLL_CACHE * c = &scroll_cache[n] ;
+    REGION * region = scrolls[n].region ;
+    int w = region->x2 - region->x + 1 ;
+    int h = region->y2 - region->y + 1 ;
+    int depth = ( dest ? dest : scrbitmap )->format->depth ;
+    int dx, dy, i, j, tx, ty, y, y2 ;
+    REGION cover, area, keep, r ;
+
+    if ( depth != 8 && depth != 16 ) return 0 ;
+    if ( w < 1 || h < 1 ) return 0 ;
+    if ( !back && graph->width >= ( uint32_t ) w && graph->height >= ( uint32_t ) h ) return 0 ;
+
+    if ( graph->format->depth != depth || graph->blend_table || ( data->flags1 & ~( B_HMIRROR | B_VMIRROR ) ) ) return 0 ;
+    if ( back && ( back->format->depth != depth || back->blend_table || ( data->flags2 & ~( B_HMIRROR | B_VMIRROR ) ) ) ) return 0 ;
+
+    /* Gráficos modificados: este frame se dibujan directamente, y se
+       recompone el siguiente si ya no cambian */
+
+    if ( graph->modified || ( back && back->modified ) )
+    {
+        if ( graph->modified > 1 ) bitmap_analize( graph ) ;
+        bitmap_clear_modified( graph ) ;
+        if ( back )
+        {
+            if ( back->modified > 1 ) bitmap_analize( back ) ;
+            bitmap_clear_modified( back ) ;
+        }
+        scroll_cache_moved( n ) ;
+        c->ok = 0 ;
+        return 0 ;
+    }
+
+    if ( !c->bitmap || c->bitmap->width != ( uint32_t ) w || c->bitmap->height != ( uint32_t ) h || c->bitmap->format->depth != depth )
+    {
+        if ( c->bitmap ) bitmap_destroy( c->bitmap ) ;
+        c->bitmap = bitmap_new( 0, w, h, depth ) ;
+        c->ok = 0 ;
+        if ( !c->bitmap ) return 0 ;
+        bitmap_add_cpoint( c->bitmap, 0, 0 ) ;
+    }
+
+    if ( c->graph != graph || c->graph_serial != graph->serial ||
+         c->back != back || ( back && c->back_serial != back->serial ) ||
+         c->flags1 != data->flags1 || c->flags2 != data->flags2 )
+    {
+        c->ok = 0 ;
+    }
+
+    dx = scrolls[n].posx0 - c->posx0 ;
+    dy = scrolls[n].posy0 - c->posy0 ;
+
+    scroll_layer_cover( graph, data->flags1, w, h, scrolls[n].x0, scrolls[n].y0, &cover ) ;
+
+    if ( back )
+    {
+        scroll_layer_cover( back, data->flags2, w, h, scrolls[n].x1, scrolls[n].y1, &r ) ;
+        region_union( &cover, &r ) ;
+
+        /* El fondo se mueve distinto (ratio): no se puede desplazar lo compuesto */
+
+        if ( ( ( ( c->x1 + dx ) % ( int ) back->width  + ( int ) back->width  ) % ( int ) back->width  != scrolls[n].x1 ||
+               ( ( c->y1 + dy ) % ( int ) back->height + ( int ) back->height ) % ( int ) back->height != scrolls[n].y1 ) )
+        {
+            scroll_cache_moved( n ) ;
+            c->ok = 0 ;
+            return 0 ;
+        }
+    }
+
+    /* Lo que sigue valiendo es lo que ambas capas cubrían antes y cubren ahora */
+
+    keep = c->cover ;
+    keep.x -= dx ; keep.x2 -= dx ;
+    keep.y -= dy ; keep.y2 -= dy ;
+    region_union( &keep, &cover ) ;
+
+    if ( !c->ok || region_is_empty( &keep ) )
+    {
+        c->ox = c->oy = 0 ;
+
+        area.x = 0 ; area.x2 = w - 1 ;
+        area.y = 0 ; area.y2 = h - 1 ;
+        scroll_cache_render( n, &area, graph, back, data ) ;
+    }
+    else
+    {
+        c->ox = ( ( c->ox + dx ) % w + w ) % w ;
+        c->oy = ( ( c->oy + dy ) % h + h ) % h ;
+
+        /* Franjas de arriba y abajo, y a los lados de lo que se conserva */
+
+        area.x = 0 ; area.x2 = w - 1 ;
+        area.y = 0 ; area.y2 = keep.y - 1 ;
+        scroll_cache_render( n, &area, graph, back, data ) ;
+
+        area.y = keep.y2 + 1 ; area.y2 = h - 1 ;
+        scroll_cache_render( n, &area, graph, back, data ) ;
+
+        area.y = keep.y ; area.y2 = keep.y2 ;
+        area.x = 0 ; area.x2 = keep.x - 1 ;
+        scroll_cache_render( n, &area, graph, back, data ) ;
+
+        area.x = keep.x2 + 1 ; area.x2 = w - 1 ;
+        scroll_cache_render( n, &area, graph, back, data ) ;
+    }
+
+    c->ok = 1 ;
+    c->graph = graph ;
+    c->back = back ;
+    c->graph_serial = graph->serial ;
+    c->back_serial = back ? back->serial : 0 ;
+    c->flags1 = data->flags1 ;
+    c->flags2 = data->flags2 ;
+    c->cover = cover ;
+    scroll_cache_moved( n ) ;
+
+    /* Copia el buffer circular, en hasta cuatro trozos */
+
+    for ( j = 0 ; j < 2 ; j++ )
+    {
+        ty = j ? c->oy - h : c->oy ;
+        y  = region->y + ( j ? h - c->oy : 0 ) ;
+        y2 = region->y + ( j ? h - 1 : h - 1 - c->oy ) ;
+        if ( y > y2 ) continue ;
+
+        for ( i = 0 ; i < 2 ; i++ )
+        {
+            tx = i ? c->ox - w : c->ox ;
+            r.x  = region->x + ( i ? w - c->ox : 0 ) ;
+            r.x2 = region->x + ( i ? w - 1 : w - 1 - c->ox ) ;
+            r.y  = y ;
+            r.y2 = y2 ;
+            if ( r.x > r.x2 ) continue ;
+
+            region_union( &r, clip ) ;
+            if ( !region_is_empty( &r ) ) gr_blit( dest, &r, region->x - tx, region->y - ty, 0, c->bitmap ) ;
+        }
+    }
+
+    return 1 ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Libera la caché de un scroll */
+
+static void scroll_cache_free( int n )
+{
+    if ( scroll_cache[n].bitmap ) bitmap_destroy( scroll_cache[n].bitmap ) ;
+    scroll_cache[n].bitmap = NULL ;
+    scroll_cache[n].ok = 0 ;
+}
+
+/* --------------------------------------------------------------------------- */
+/* Module initialization                                                       */
+
+void __bgdexport( libscroll, module_initialize )()
+{
+    /* Los scrolls y sus cachés apuntan al heap, se guardan con él */
+    savestate_register_var( scrolls );
+    savestate_check_field( scrolls, region );
+    savestate_check_field( scrolls, camera );
+    savestate_check_field( scrolls, region1 );
+    savestate_check_field( scrolls, region2 );
+    savestate_check_field( scrolls, follows );
+    savestate_register_var( scrolls_objects );
+    savestate_register_var( scroll_cache );
+    savestate_check_field( scroll_cache, bitmap );
+    savestate_check_field( scroll_cache, graph );
+    savestate_check_field( scroll_cache, back );
+    savestate_register_var( scroll_instances );
+    savestate_check_field( scroll_instances, items );
+    savestate_check_field( scroll_instances, sorted );
+    savestate_check_field( scroll_instances, hash );
+    savestate_register_ptr( proclist );
+    savestate_register_var( proclist_reserved );
+}
+
 /* --------------------------------------------------------------------------- */
 
 void scroll_region( int n, REGION * r )
@@ -162,6 +523,8 @@ void scroll_stop( int n )
             scrolls_objects[n] = 0;
             scrolls[n].active = 0 ;
         }
+
+        scroll_cache_free( n );
     }
 }
 
@@ -335,18 +698,15 @@ static int compare_instances( const void * ptr1, const void * ptr2 )
 
 void scroll_draw( int n, REGION * clipping )
 {
-    int nproc, x, y, cx, cy ;
+    int nproc, x, y ;
 
-    static INSTANCE ** proclist = 0;
-    static int proclist_reserved = 0;
-    int proclist_count;
+    int proclist_count, count;
     REGION r;
-    int status;
 
     GRAPH * graph, * back, * dest = NULL;
 
     SCROLL_EXTRA_DATA * data;
-    INSTANCE * i;
+    INSTANCE * i, ** list, ** new_proclist;
 
     if ( n < 0 || n > 9 ) return ;
 
@@ -362,110 +722,52 @@ void scroll_draw( int n, REGION * clipping )
 
     data = &(( SCROLL_EXTRA_DATA * ) & GLODWORD( libscroll, SCROLLS ) )[n] ;
 
-    /* Dibuja el fondo */
+    /* Dibuja el fondo y el primer plano */
 
     r = *scrolls[n].region;
     if ( !dest && clipping ) region_union( &r, clipping );
 
-    if ( back )
+    if ( !scroll_draw_cached( n, dest, &r, graph, back, data ) )
     {
-        if ( back->ncpoints > 0 && back->cpoints[0].x >= 0 )
-        {
-            cx = back->cpoints[0].x ;
-            cy = back->cpoints[0].y ;
-        }
-        else
-        {
-            cx = back->width / 2 ;
-            cy = back->height / 2 ;
-        }
-
-        y = scrolls[n].region->y - scrolls[n].y1 ;
-
-        while ( y < scrolls[n].region->y2 )
-        {
-            x = scrolls[n].region->x - scrolls[n].x1 ;
-            while ( x < scrolls[n].region->x2 )
-            {
-                gr_blit( dest, &r, x + cx, y + cy, data->flags2, back ) ;
-                x += back->width ;
-            }
-            y += back->height ;
-        }
+        if ( back ) scroll_draw_layer( dest, &r, scrolls[n].region->x, scrolls[n].region->y, scrolls[n].region->x2, scrolls[n].region->y2, scrolls[n].x1, scrolls[n].y1, data->flags2, back ) ;
+        scroll_draw_layer( dest, &r, scrolls[n].region->x, scrolls[n].region->y, scrolls[n].region->x2, scrolls[n].region->y2, scrolls[n].x0, scrolls[n].y0, data->flags1, graph ) ;
     }
 
-    /* Dibuja el primer plano */
+    /* Ordena las instancias del scroll, partiendo del orden del frame anterior */
 
-    if ( graph->ncpoints > 0 && graph->cpoints[0].x >= 0 )
-    {
-        cx = graph->cpoints[0].x ;
-        cy = graph->cpoints[0].y ;
-    }
-    else
-    {
-        cx = graph->width / 2 ;
-        cy = graph->height / 2 ;
-    }
+    list = instance_ctype_list( C_SCROLL, &count ) ;
+    proclist_count = 0 ;
 
-    y = scrolls[n].region->y - scrolls[n].y0 ;
-    while ( y < scrolls[n].region->y2 )
+    if ( count > proclist_reserved )
     {
-        x = scrolls[n].region->x - scrolls[n].x0 ;
-        while ( x < scrolls[n].region->x2 )
-        {
-            gr_blit( dest, &r, x + cx, y + cy, data->flags1, graph ) ;
-            x += graph->width ;
-        }
-        y += graph->height ;
-    }
+        new_proclist = ( INSTANCE ** ) bgd_realloc( proclist, sizeof( INSTANCE * ) * count ) ;
+        if ( !new_proclist ) return ;
 
-    /* Crea una lista ordenada de instancias a dibujar */
+        proclist = new_proclist ;
+        proclist_reserved = count ;
+    }
 
-    i = first_instance ;
-    proclist_count = 0 ;
-    while ( i )
+    for ( nproc = 0 ; nproc < count ; nproc++ )
     {
-        if ( LOCDWORD( libscroll, i, CTYPE ) == C_SCROLL &&
-                (
-                    (( status = LOCDWORD( libscroll, i, STATUS ) ) & ~STATUS_WAITING_MASK ) == STATUS_RUNNING ||
-                    ( status & ~STATUS_WAITING_MASK ) == STATUS_FROZEN
-                )
-           )
-        {
-            if ( LOCDWORD( libscroll, i, CNUMBER ) && !( LOCDWORD( libscroll, i, CNUMBER ) & ( 1 << n ) ) )
-            {
-                i = i->next ;
-                continue ;
-            }
-
-            if ( proclist_count == proclist_reserved )
-            {
-                proclist_reserved += 16 ;
-                proclist = ( INSTANCE ** ) bgd_realloc( proclist, sizeof( INSTANCE * ) * proclist_reserved ) ;
-            }
-
-            proclist[proclist_count++] = i ;
-        }
-        i = i->next ;
+        i = list[nproc] ;
+        if ( LOCDWORD( libscroll, i, CNUMBER ) && !( LOCDWORD( libscroll, i, CNUMBER ) & ( 1 << n ) ) ) continue ;
+        proclist[proclist_count++] = i ;
     }
 
-    if ( proclist_count )
-    {
-        /* Ordena la listilla */
+    instance_list_sort( &scroll_instances[n], proclist, proclist_count, compare_instances ) ;
 
-        qsort( proclist, proclist_count, sizeof( INSTANCE * ), compare_instances ) ;
+    /* Visualiza los procesos */
 
-        /* Visualiza los procesos */
+    for ( nproc = 0 ; nproc < scroll_instances[n].count ; nproc++ )
+    {
+        i = scroll_instances[n].items[nproc] ;
 
-        for ( nproc = 0 ; nproc < proclist_count ; nproc++ )
-        {
-            x = LOCDWORD( libscroll, proclist[nproc], COORDX ) ;
-            y = LOCDWORD( libscroll, proclist[nproc], COORDY ) ;
+        x = LOCDWORD( libscroll, i, COORDX ) ;
+        y = LOCDWORD( libscroll, i, COORDY ) ;
 
-            RESOLXY( libscroll, proclist[nproc], x, y );
+        RESOLXY( libscroll, i, x, y );
 
-            draw_instance_at( proclist[nproc], &r, x - scrolls[n].posx0 + scrolls[n].region->x, y - scrolls[n].posy0 + scrolls[n].region->y, dest ) ;
-        }
+        draw_instance_at( i, &r, x - scrolls[n].posx0 + scrolls[n].region->x, y - scrolls[n].posy0 + scrolls[n].region->y, dest ) ;
     }
 }
 
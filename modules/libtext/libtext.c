@@ -42,6 +42,7 @@
 #include "librender.h"
 
 #include "libtext.h"
+#include "savestate.h"
 
 #include "libtext_exports.h"
 
@@ -53,6 +54,43 @@ int fntcolor32 = 0xFFFFFFFF;
 
 /* --------------------------------------------------------------------------- */
 
+/* A text run is the string of a text object with its glyphs already put
+ * together in a single bitmap, so the whole text is drawn with one blit.
+ * The glyphs are copied as they are, in their own depth and without any
+ * color, because the text color and TEXT_FLAGS are applied by gr_blit
+ * when the run is drawn. The run is kept while the string and the glyphs
+ * of the font don't change.
+ */
+
+typedef struct _text_run_glyph
+{
+    GRAPH * bitmap ;
+    uint32_t serial ;
+    PALETTE * palette ;
+    int xoffset ;
+    int yoffset ;
+    int xadvance ;
+    int x ;                 /* Top-left of the glyph in the text */
+    int y ;
+} TEXT_RUN_GLYPH;
+
+typedef struct _text_run
+{
+    char * text ;
+    int len ;
+    int on ;                /* Type and raw value of the variable, the text is  */
+    int value ;             /* not formatted again while they don't change      */
+    FONT * font ;
+    int charset ;
+    int width ;
+    int height ;
+    int put ;               /* 1 - The glyphs can't be joined, use gr_text_put */
+    GRAPH * graph ;         /* NULL if there isn't anything to draw */
+    int x ;                 /* Top-left of the bitmap in the text */
+    int y ;
+    TEXT_RUN_GLYPH * glyphs ;
+} TEXT_RUN;
+
 typedef struct _text
 {
     int id ;
@@ -78,6 +116,7 @@ typedef struct _text
     int _y ;
     int _width;
     int _height;
+    TEXT_RUN * run ;
 } TEXT;
 
 TEXT texts[MAX_TEXTS] ;
@@ -85,6 +124,19 @@ TEXT texts[MAX_TEXTS] ;
 int text_nextid = 1 ;
 int text_count  = 0 ;
 
+/* --------------------------------------------------------------------------- */
+/* Module initialization                                                       */
+
+void __bgdexport( libtext, module_initialize )()
+{
+    savestate_register_var( texts );
+    savestate_check_field( texts, text );
+    savestate_check_field( texts, var );
+    savestate_check_field( texts, run );
+    savestate_register_var( text_nextid );
+    savestate_register_var( text_count );
+}
+
 /* --------------------------------------------------------------------------- */
 
 int gr_text_height_no_margin( int fontid, const unsigned char * text );
@@ -187,6 +239,256 @@ static const char * get_text( TEXT * text )
     return NULL;
 }
 
+/* --------------------------------------------------------------------------- */
+
+static int text_var_value( TEXT * text, int * value )
+{
+    switch ( text->on )
+    {
+        case TEXT_INT:
+        case TEXT_DWORD:
+        case TEXT_FLOAT:
+            *value = *( int * )text->var;
+            return 1;
+
+        case TEXT_BYTE:
+        case TEXT_SBYTE:
+        case TEXT_CHAR:
+            *value = *( uint8_t * )text->var;
+            return 1;
+
+        case TEXT_WORD:
+        case TEXT_SHORT:
+            *value = *( uint16_t * )text->var;
+            return 1;
+    }
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Same as get_text, but numeric variables are not formatted again if the
+ * value is the same than the one of the text run */
+
+static const char * get_text_cached( TEXT * text )
+{
+    int value;
+
+    if ( text->run && text->run->on == text->on && text_var_value( text, &value ) && value == text->run->value ) return text->run->text;
+
+    return get_text( text );
+}
+
+/* --------------------------------------------------------------------------- */
+
+static int text_glyph( FONT * f, const unsigned char c )
+{
+    switch ( f->charset )
+    {
+        case CHARSET_ISO8859:
+            return dos_to_win[c];
+
+        case CHARSET_CP850:
+            return c;
+    }
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void text_run_destroy( TEXT_RUN * run )
+{
+    if ( !run ) return;
+    if ( run->graph ) bitmap_destroy( run->graph );
+    bgd_free( run );
+}
+
+/* --------------------------------------------------------------------------- */
+
+static int text_run_valid( TEXT_RUN * run, const char * str, FONT * font )
+{
+    struct _glyph * g;
+    TEXT_RUN_GLYPH * rg;
+    int n;
+
+    if ( run->font != font || run->charset != font->charset ) return 0;
+    if ( run->text != str && strcmp( run->text, str ) ) return 0;
+
+    /* Glyphs pixels can't be changed in place, set_glyph and a new font
+     * replace the bitmaps, so the bitmap and its serial are enough */
+
+    for ( n = 0, rg = run->glyphs ; n < run->len ; n++, rg++ )
+    {
+        g = &font->glyph[ text_glyph( font, ( unsigned char ) str[n] ) ];
+        if ( g->bitmap != rg->bitmap || g->xoffset != rg->xoffset || g->yoffset != rg->yoffset || g->xadvance != rg->xadvance ) return 0;
+        if ( g->bitmap && ( g->bitmap->serial != rg->serial || g->bitmap->format->palette != rg->palette ) ) return 0;
+    }
+
+    return 1;
+}
+
+/* --------------------------------------------------------------------------- */
+/*
+ *  FUNCTION : text_run_new
+ *
+ *  Join the glyphs of a string in a new text run. If the glyphs can't be
+ *  drawn as a single bitmap with the same result (different depths or
+ *  palettes, blend tables, overlapped glyphs...) the run only keeps
+ *  the string and its size, and the text is drawn with gr_text_put.
+ *
+ *  PARAMS :
+ *  text   Pointer to the text object
+ *  str    String of the text
+ *  font   Font of the text
+ *
+ *  RETURN VALUE :
+ *      Pointer to the new text run or NULL if no memory
+ *
+ */
+
+static TEXT_RUN * text_run_new( TEXT * text, const char * str, FONT * font )
+{
+    int len = strlen( str ), n, m, row, x = 0, depth = 0;
+    int minx = 0x7FFFFFFF, miny = 0x7FFFFFFF, maxx = -0x7FFFFFFF, maxy = -0x7FFFFFFF;
+    TEXT_RUN_GLYPH * rg, * rg2;
+    PALETTE * palette = NULL;
+    struct _glyph * g;
+    TEXT_RUN * run;
+    GRAPH * ch;
+
+    run = ( TEXT_RUN * ) bgd_malloc( sizeof( TEXT_RUN ) + len * sizeof( TEXT_RUN_GLYPH ) + len + 1 );
+    if ( !run ) return NULL;
+
+    run->glyphs = ( TEXT_RUN_GLYPH * )( run + 1 );
+    run->text = ( char * )( run->glyphs + len );
+    memcpy( run->text, str, len + 1 );
+    run->len = len;
+    run->on = text_var_value( text, &run->value ) ? text->on : 0;
+    run->font = font;
+    run->charset = font->charset;
+    run->width = gr_text_width( text->fontid, ( const unsigned char * ) str );
+    run->height = gr_text_height_no_margin( text->fontid, ( const unsigned char * ) str );
+    run->put = 0;
+    run->graph = NULL;
+    run->x = 0;
+    run->y = 0;
+
+    /* Place the glyphs and check if they can be joined */
+
+    for ( n = 0, rg = run->glyphs ; n < len ; n++, rg++ )
+    {
+        g = &font->glyph[ text_glyph( font, ( unsigned char ) str[n] ) ];
+        ch = g->bitmap;
+
+        rg->bitmap = ch;
+        rg->serial = ch ? ch->serial : 0;
+        rg->palette = ch ? ch->format->palette : NULL;
+        rg->xoffset = g->xoffset;
+        rg->yoffset = g->yoffset;
+        rg->xadvance = g->xadvance;
+
+        if ( ch && !run->put )
+        {
+            if ( ch->modified > 1 ) bitmap_analize( ch );
+
+            if ( !depth )
+            {
+                depth = ch->format->depth;
+                palette = ch->format->palette;
+            }
+
+            if ( ch->format->depth != depth || ch->format->palette != palette || ch->blend_table ||
+                 ( depth != 1 && depth != 8 && depth != 16 && depth != 32 ) ||
+                 ( depth == 32 && ( ch->info_flags & GI_NOCOLORKEY ) ) )
+            {
+                run->put = 1;
+            }
+            else
+            {
+                if ( ch->ncpoints && ch->cpoints[0].x != CPOINT_UNDEFINED )
+                {
+                    rg->x = x + g->xoffset - ch->cpoints[0].x;
+                    rg->y = g->yoffset - ch->cpoints[0].y;
+                }
+                else
+                {
+                    rg->x = x + g->xoffset - ( int )ch->width / 2;
+                    rg->y = g->yoffset - ( int )ch->height / 2;
+                }
+
+                /* Glyphs must not overlap, every pixel is drawn only once */
+
+                for ( rg2 = run->glyphs ; rg2 < rg ; rg2++ )
+                {
+                    if ( rg2->bitmap &&
+                         rg->x < rg2->x + ( int )rg2->bitmap->width && rg2->x < rg->x + ( int )ch->width &&
+                         rg->y < rg2->y + ( int )rg2->bitmap->height && rg2->y < rg->y + ( int )ch->height )
+                    {
+                        run->put = 1;
+                        break;
+                    }
+                }
+
+                if ( minx > rg->x ) minx = rg->x;
+                if ( miny > rg->y ) miny = rg->y;
+                if ( maxx < rg->x + ( int )ch->width ) maxx = rg->x + ch->width;
+                if ( maxy < rg->y + ( int )ch->height ) maxy = rg->y + ch->height;
+            }
+        }
+
+        x += g->xadvance;
+    }
+
+    if ( run->put || !depth ) return run;
+
+    /* Join the glyphs */
+
+    run->graph = bitmap_new( 0, maxx - minx, maxy - miny, depth );
+    if ( !run->graph )
+    {
+        run->put = 1;
+        return run;
+    }
+
+    run->x = minx;
+    run->y = miny;
+
+    memset( run->graph->data, 0, run->graph->pitch * run->graph->height );
+    bitmap_add_cpoint( run->graph, 0, 0 );
+
+    if ( palette )
+    {
+        run->graph->format->palette = palette;
+        pal_use( palette );
+    }
+
+    for ( n = 0, rg = run->glyphs ; n < len ; n++, rg++ )
+    {
+        if ( !( ch = rg->bitmap ) ) continue;
+
+        for ( row = 0 ; row < ( int )ch->height ; row++ )
+        {
+            uint8_t * src = ( uint8_t * ) ch->data + ch->pitch * row;
+            uint8_t * dst = ( uint8_t * ) run->graph->data + run->graph->pitch * ( rg->y - miny + row );
+            int gx = rg->x - minx;
+
+            if ( depth == 1 )
+            {
+                for ( m = 0 ; m < ( int )ch->width ; m++ )
+                    if ( src[m >> 3] & ( 0x80 >> ( m & 7 ) ) ) dst[( gx + m ) >> 3] |= 0x80 >> (( gx + m ) & 7 );
+            }
+            else
+            {
+                memcpy( dst + gx * ( depth >> 3 ), src, ch->widthb );
+            }
+        }
+    }
+
+    return run;
+}
+
 /* --------------------------------------------------------------------------- */
 /*
  *  FUNCTION : info_text
@@ -204,7 +506,7 @@ static const char * get_text( TEXT * text )
 
 static int info_text( TEXT * text, REGION * bbox, int * z, int * drawme )
 {
-    const char * str = get_text( text );
+    const char * str = get_text_cached( text );
     REGION prev = *bbox;
     FONT * font;
     int changed = 0;
@@ -235,12 +537,39 @@ static int info_text( TEXT * text, REGION * bbox, int * z, int * drawme )
 
     * z = text->z;
 
+    /* Update the text run */
+
+    if ( text->run )
+    {
+        if ( text_run_valid( text->run, str, font ) )
+        {
+            text->run->on = text_var_value( text, &text->run->value ) ? text->on : 0;
+        }
+        else
+        {
+            str = get_text( text );
+            text_run_destroy( text->run );
+            text->run = NULL;
+        }
+    }
+
+    if ( !text->run ) text->run = text_run_new( text, str, font );
+
     /* Calculate the text dimensions */
 
     text->_x = text->x;
     text->_y = text->y;
-    text->_width = gr_text_width( text->fontid, ( const unsigned char * ) str );
-    text->_height = gr_text_height_no_margin( text->fontid, ( const unsigned char * ) str );
+
+    if ( text->run )
+    {
+        text->_width = text->run->width;
+        text->_height = text->run->height;
+    }
+    else
+    {
+        text->_width = gr_text_width( text->fontid, ( const unsigned char * ) str );
+        text->_height = gr_text_height_no_margin( text->fontid, ( const unsigned char * ) str );
+    }
 
     /* Update the font's maxheight (if needed) */
 
@@ -344,6 +673,39 @@ static int info_text( TEXT * text, REGION * bbox, int * z, int * drawme )
     return changed;
 }
 
+/* --------------------------------------------------------------------------- */
+
+/* Set the pixel color for a text and save the previous one */
+
+static void text_color_push( GRAPH * dest, int color8, int color16, int color32, int * save )
+{
+    save[0] = pixel_color8;
+    save[1] = pixel_color16;
+    save[2] = pixel_color32;
+
+    if ( color8 == -1 )
+    {
+        gr_setcolor(( dest->format->depth == 8 ) ? gr_find_nearest_color( 255, 255, 255 ) : gr_rgb_depth( dest->format->depth, 255, 255, 255 ) );
+    }
+    else
+    {
+        pixel_color8 = color8;
+        pixel_color16 = color16;
+        pixel_color32 = color32;
+    }
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void text_color_pop( int * save )
+{
+    pixel_color8 = save[0];
+    pixel_color16 = save[1];
+    pixel_color32 = save[2];
+}
+
+/* --------------------------------------------------------------------------- */
+
 /* --------------------------------------------------------------------------- */
 /*
  *  FUNCTION : draw_text
@@ -361,7 +723,8 @@ static int info_text( TEXT * text, REGION * bbox, int * z, int * drawme )
 
 void draw_text( TEXT * text, REGION * clip )
 {
-    const char * str = get_text( text );
+    const char * str = get_text_cached( text );
+    TEXT_RUN * run = text->run;
     int save8, save16, save32;
     FONT * font;
 
@@ -375,6 +738,21 @@ void draw_text( TEXT * text, REGION * clip )
         return;
     }
 
+    /* Draw the text run, mirrored texts keep the order of the glyphs */
+
+    if ( run && !run->put && run->font == font && ( run->text == str || !strcmp( run->text, str ) ) &&
+         !( GLODWORD( libtext, TEXT_FLAGS ) & ( B_HMIRROR | B_VMIRROR | B_NOCOLORKEY ) ) )
+    {
+        int pixel[3];
+
+        if ( !run->graph ) return;
+
+        text_color_push( scrbitmap, text->color8, text->color16, text->color32, pixel );
+        gr_blit( 0, clip, text->_x + run->x, text->_y + run->y, GLODWORD( libtext, TEXT_FLAGS ), run->graph );
+        text_color_pop( pixel );
+        return;
+    }
+
     /* Draw the text */
 
     save8 = fntcolor8;
@@ -438,6 +816,7 @@ int gr_text_new2( int fontid, int x, int y, int z, int alignment, const char * t
     texts[textid].objectid = gr_new_object( texts[textid].z, ( OBJ_INFO * ) info_text, ( OBJ_DRAW * ) draw_text, ( void * ) &texts[textid] );
     texts[textid].last_value = 0 ;
     texts[textid].last_z = 0 ;
+    texts[textid].run = NULL ;
 
     return textid ;
 }
@@ -521,6 +900,8 @@ void gr_text_destroy( int textid )
             {
                 gr_destroy_object( texts[textid].objectid );
                 if ( texts[textid].text ) bgd_free( texts[textid].text ) ;
+                text_run_destroy( texts[textid].run ) ;
+                texts[textid].run = NULL ;
                 texts[textid].on = 0 ;
             }
         }
@@ -534,6 +915,8 @@ void gr_text_destroy( int textid )
 
         gr_destroy_object( texts[textid].objectid );
         if ( texts[textid].text ) bgd_free( texts[textid].text ) ;
+        text_run_destroy( texts[textid].run ) ;
+        texts[textid].run = NULL ;
         texts[textid].on = 0 ;
         if ( textid == text_nextid - 1 )
         {
@@ -665,7 +1048,7 @@ int gr_text_put( GRAPH * dest, REGION * clip, int fontid, int x, int y, const un
     FONT   * f ;
     uint8_t  current_char;
     int flags ;
-    int save8, save16, save32;
+    int save[3];
 
     if ( !text || !*text ) return -1;
     if ( fontid < 0 || fontid >= MAX_FONTS || !fonts[fontid] ) return 0; // Incorrect font type
@@ -676,20 +1059,7 @@ int gr_text_put( GRAPH * dest, REGION * clip, int fontid, int x, int y, const un
 
     flags = GLODWORD( libtext, TEXT_FLAGS );
 
-    save8 = pixel_color8;
-    save16 = pixel_color16;
-    save32 = pixel_color32;
-
-    if ( fntcolor8 == -1 )
-    {
-        gr_setcolor(( dest->format->depth == 8 ) ? gr_find_nearest_color( 255, 255, 255 ) : gr_rgb_depth( dest->format->depth, 255, 255, 255 ) );
-    }
-    else
-    {
-        pixel_color8 = fntcolor8;
-        pixel_color16 = fntcolor16;
-        pixel_color32 = fntcolor32;
-    }
+    text_color_push( dest, fntcolor8, fntcolor16, fntcolor32, save );
 
     while ( *text )
     {
@@ -717,9 +1087,7 @@ int gr_text_put( GRAPH * dest, REGION * clip, int fontid, int x, int y, const un
         text++ ;
     }
 
-    pixel_color8 = save8;
-    pixel_color16 = save16;
-    pixel_color32 = save32;
+    text_color_pop( save );
 
     return 1;
 }
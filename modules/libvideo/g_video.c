@@ -37,6 +37,7 @@
 #include "dlvaracc.h"
 
 #include "libvideo.h"
+#include "savestate.h"
 
 #ifdef _WIN32
 
@@ -109,6 +110,7 @@ int hardware_scr = 0 ;
 int grab_input = 0 ;
 int frameless = 0 ;
 int scale_mode = SCALE_NONE ;
+int scale_factor = 1 ;
 int waitvsync = 0 ;
 
 int scale_resolution = -1 ;
@@ -265,6 +267,26 @@ int gr_set_icon( GRAPH * map )
 
 /* --------------------------------------------------------------------------- */
 
+static int gr_scale_factor( int mode )
+{
+    switch ( mode )
+    {
+        case SCALE_NONE:
+            return 1;
+
+        case SCALE_SCALE3X:
+        case SCALE_SCALE3X_SMOOTH:
+            return 3;
+
+        case SCALE_HQ2X_TWICE:
+            return 4;
+    }
+
+    return 2;
+}
+
+/* --------------------------------------------------------------------------- */
+
 int gr_set_mode( int width, int height, int depth )
 {
 #if LIBRETRO_CORE
@@ -356,14 +378,20 @@ extern int bennugd_content_height;
 
         if ( enable_scale )
         {
-            enable_16bits = 1;
-            depth = 16;
+            /* Los escaladores trabajan en 16 o 32 bits */
+            if ( depth != 32 )
+            {
+                enable_16bits = 1;
+                depth = 16;
+            }
 
-            surface_width  *= 2;
-            surface_height *= 2;
+            surface_width  *= gr_scale_factor( scale_mode );
+            surface_height *= gr_scale_factor( scale_mode );
         }
     }
 
+    scale_factor = gr_scale_factor( scale_mode );
+
     /* Inicializa el modo grï¿½fico */
 
     if ( scrbitmap )
@@ -422,10 +450,11 @@ extern int bennugd_content_height;
                                        scale_screen->format->Amask
                                      );
 
-        /* scale tables */
+        /* scale tables, en enteros para que el patron de la tabla sea exacto */
 
         int     lim_w = 0, lim_h = 0, pitch_w = 0, pitch_h = 0;
-        double  fw = 0.0, fh = 0.0, fx = 0.0, fy = 0.0;
+        double  fw = 0.0, fh = 0.0;
+        int     num_w = 0, den_w = 1, num_h = 0, den_h = 1, ix = 0, iy = 0;
         int     h, w;
         int     start_w = 0, start_h = 0, fix = 1;
 
@@ -442,6 +471,9 @@ extern int bennugd_content_height;
                     pitch_w = 1;
                     pitch_h = screen->pitch;
 
+                    num_w = screen->w; den_w = scale_screen->w;
+                    num_h = screen->h; den_h = scale_screen->h;
+
                     fw = (double)screen->w / (double)scale_screen->w;
                     fh = (double)screen->h / (double)scale_screen->h;
                     break;
@@ -454,6 +486,9 @@ extern int bennugd_content_height;
                     pitch_w = screen->pitch;
                     pitch_h = 1;
 
+                    num_h = screen->w; den_h = scale_screen->h;
+                    num_w = screen->h; den_w = scale_screen->w;
+
                     fh = (double)screen->w / (double)scale_screen->h;
                     fw = (double)screen->h / (double)scale_screen->w;
                     break;
@@ -481,12 +516,14 @@ extern int bennugd_content_height;
             if ( scale_screen->w > scale_screen->h )
             {
                 fw = fh;
+                num_w = num_h; den_w = den_h;
                 scale_resolution_aspectratio_offx = ( scale_screen->w - lim_w / fw ) / 2 ;
                 scale_resolution_aspectratio_offy = 0;
             }
             else
             {
                 fh = fw;
+                num_h = num_w; den_h = den_w;
                 scale_resolution_aspectratio_offx = 0;
                 scale_resolution_aspectratio_offy = ( scale_screen->h - lim_h / fh ) / 2 ;
             }
@@ -501,8 +538,8 @@ extern int bennugd_content_height;
                 scale_resolution_table_w[ start_w - w * fix ] = -1;
             else
             {
-                scale_resolution_table_w[ start_w - w * fix ] = ( fx < lim_w ) ? pitch_w * ( int ) fx : -1 ;
-                fx += fw;
+                int x = ix++ * num_w / den_w;
+                scale_resolution_table_w[ start_w - w * fix ] = ( x < lim_w ) ? pitch_w * x : -1 ;
             }
         }
 
@@ -512,8 +549,8 @@ extern int bennugd_content_height;
                 scale_resolution_table_h[ start_h - h * fix ] = -1;
             else
             {
-                scale_resolution_table_h[ start_h - h * fix ] = ( fy < lim_h ) ? pitch_h * ( int ) fy : -1 ;
-                fy += fh;
+                int y = iy++ * num_h / den_h;
+                scale_resolution_table_h[ start_h - h * fix ] = ( y < lim_h ) ? pitch_h * y : -1 ;
             }
         }
     }
@@ -576,8 +613,8 @@ extern int bennugd_content_height;
 */
     /* Bitmaps de fondo */
 
-    scr_width = screen->w / ( scale_mode != 0 ? 2 : 1 ) ;
-    scr_height = screen->h / ( scale_mode != 0 ? 2 : 1 ) ;
+    scr_width = screen->w / scale_factor ;
+    scr_height = screen->h / scale_factor ;
 
     /* Only allow background with same properties that video mode */
     if (
@@ -626,6 +663,9 @@ void __bgdexport( libvideo, module_initialize )()
 #endif
     apptitle = appname;
 
+    /* Scrolls and Mode 7 point to the regions */
+    savestate_register_var( regions );
+
 #if LIBRETRO_CORE
 extern int libretro_width;
 extern int libretro_height;
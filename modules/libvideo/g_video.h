@@ -53,6 +53,9 @@
 /* Scaler */
 #define SCALE_NONE          0x0000
 #define SCALE_SCALE2X       0x0001
+#define SCALE_SCALE3X       0x0005
+#define SCALE_SCALE3X_SMOOTH    0x0006  /* scale3x blended as hq2x does, not hq3x */
+#define SCALE_HQ2X_TWICE        0x0007  /* 4x, hq2x applied twice, not hq4x */
 
 /* Scale resolution orientation */
 #define SRO_NORMAL          0
@@ -87,6 +90,7 @@ extern int hardware_scr ;
 extern int grab_input ;
 extern int frameless ;
 extern int scale_mode ;
+extern int scale_factor ;
 
 extern int waitvsync ;
 
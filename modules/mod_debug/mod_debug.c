@@ -844,6 +844,7 @@ static void eval_local( DCB_PROC * proc, INSTANCE * i ) {
             result.type = T_VARIABLE ;
             result.var  = dcb.locvar[n] ;
             result.data = ( uint8_t * )i->locdata + dcb.locvar[n].Offset ;
+            instance_touch( i ) ;
             get_token() ;
             return ;
         }
@@ -1760,6 +1761,7 @@ static void console_do( const char * command ) {
         i = findproc( NULL, action, ptr );
 
         if ( show_locals ) {
+            if ( i ) instance_sync_locals( i );
             for ( var = 0 ; var < dcb.data.NLocVars ; var++ ) {
                 DCB_VAR * v = &dcb.locvar[var] ;
                 show_var( *v, 0, i ? ( char* )i->locdata + v->Offset : 0, "[LOC]", 0 ) ;
@@ -1992,6 +1994,7 @@ static void console_do( const char * command ) {
                     LOCDWORD( mod_debug, i, STATUS ) = ( LOCDWORD( mod_debug, i, STATUS ) & STATUS_WAITING_MASK ) | STATUS_FROZEN ;
                     break;
             }
+            instance_status_changed( i );
             strcpy( action, oaction );
             ptr = optr;
         }
@@ -2027,6 +2030,7 @@ static void console_do( const char * command ) {
                 LOCDWORD( mod_debug, i, STATUS ) = ( LOCDWORD( mod_debug, i, STATUS ) & STATUS_WAITING_MASK ) | STATUS_FROZEN ;
                 break;
         }
+        instance_status_changed( i );
         console_printf( "\25407OK" );
         return ;
     }
@@ -41,6 +41,8 @@
 #include "librender.h"
 #include "libdraw.h"
 
+#include "savestate.h"
+
 /* --------------------------------------------------------------------------- */
 
 /* Dibujo de primitivas */
@@ -556,6 +558,15 @@ static int moddraw_map_put_pixel( INSTANCE * my, int * params )
     return 1 ;
 }
 
+/* ----------------------------------------------------------------- */
+
+void __bgdexport( mod_draw, module_initialize )()
+{
+    savestate_register_ptr( drawing_objects );
+    savestate_register_ptr( drawing_graph );
+    savestate_register_var( drawing_z );
+}
+
 /* ----------------------------------------------------------------- */
 /* exports                                                           */
 /* ----------------------------------------------------------------- */
@@ -43,6 +43,8 @@
 
 #include "libscroll.h"
 
+#include "savestate.h"
+
 /* --------------------------------------------------------------------------- */
 
 enum {
@@ -405,41 +407,42 @@ static int grproc_get_real_point( INSTANCE * my, int * params )
 /* --------------------------------------------------------------------------- */
 /* Rutinas de utilidad local */
 
+/* Flags, angle and scale an instance is drawn with by draw_at */
+
+static void get_draw_params( INSTANCE * i, int * flags, int * angle, int * scalex, int * scaley )
+{
+    *scalex = LOCINT32( mod_grproc, i, GRAPHSIZEX );
+    *scaley = LOCINT32( mod_grproc, i, GRAPHSIZEY );
+    if ( *scalex == 100 && *scaley == 100 ) *scalex = *scaley = LOCINT32( mod_grproc, i, GRAPHSIZE );
+
+    *flags = LOCDWORD( mod_grproc, i, FLAGS ) & ( B_HMIRROR | B_VMIRROR );
+
+    // PATCH - XGRAPH DOES NOT ROTATE DESTINATION GRAPHIC
+    *angle = LOCDWORD( mod_grproc, i, XGRAPH ) ? 0 : LOCINT32( mod_grproc, i, ANGLE );
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void draw_graph_at( GRAPH * dest, int x, int y, REGION * r, GRAPH * map, int flags, int angle, int scalex, int scaley )
+{
+    if ( angle || scaley != 100 || scalex != 100 )
+        gr_rotated_blit( dest, r, x, y, flags, angle, scalex, scaley, map ) ;
+    else
+        gr_blit( dest, r, x, y, flags, map ) ;
+}
+
+/* --------------------------------------------------------------------------- */
+
 static void draw_at( GRAPH * dest, int x, int y, REGION * r, INSTANCE * i )
 {
     GRAPH * map ;
-    int scalex, scaley;
-
-    scalex = LOCINT32( mod_grproc, i, GRAPHSIZEX );
-    scaley = LOCINT32( mod_grproc, i, GRAPHSIZEY );
-    if ( scalex == 100 && scaley == 100 ) scalex = scaley = LOCINT32( mod_grproc, i, GRAPHSIZE );
+    int flags, angle, scalex, scaley;
 
     map = instance_graph( i ) ;
     if ( !map ) return ;
 
-    // PATCH - XGRAPH DOES NOT ROTATE DESTINATION GRAPHIC
-    if ( LOCINT32( mod_grproc, i, ANGLE ) || scaley != 100 || scalex != 100 )
-    {
-        if ( LOCDWORD( mod_grproc, i, XGRAPH ) && scalex == 100 && scaley == 100 )
-        {
-            gr_blit( dest, r, x, y, LOCDWORD( mod_grproc, i, FLAGS ) & ( B_HMIRROR | B_VMIRROR ), map ) ;
-        }
-        else
-        {
-            if ( LOCDWORD( mod_grproc, i, XGRAPH ) )
-            {
-                gr_rotated_blit( dest, r, x, y, LOCDWORD( mod_grproc, i, FLAGS ) & ( B_HMIRROR | B_VMIRROR ), 0, scalex, scaley, map ) ;
-            }
-            else
-            {
-                gr_rotated_blit( dest, r, x, y, LOCDWORD( mod_grproc, i, FLAGS ) & ( B_HMIRROR | B_VMIRROR ), LOCINT32( mod_grproc, i, ANGLE ), scalex, scaley, map ) ;
-            }
-        }
-    }
-    else
-    {
-        gr_blit( dest, r, x, y, LOCDWORD( mod_grproc, i, FLAGS ) & ( B_HMIRROR | B_VMIRROR ), map ) ;
-    }
+    get_draw_params( i, &flags, &angle, &scalex, &scaley );
+    draw_graph_at( dest, x, y, r, map, flags, angle, scalex, scaley );
 }
 
 /* --------------------------------------------------------------------------- */
@@ -692,13 +695,192 @@ static int check_collision_box( INSTANCE * proc1, REGION * bbox1, INSTANCE * pro
     return 1;
 }
 
+/* --------------------------------------------------------------------------- */
+/* Collision masks                                                             */
+/*                                                                             */
+/* A mask holds one bit per pixel of a graph drawn with a given flags, angle   */
+/* and scale, as draw_at would draw it. Masks are cached by those values and   */
+/* the graph serial, so they are rebuilt only when the graph changes. While a  */
+/* graph is flagged as modified its mask is rebuilt on every use, the serial   */
+/* only changes once the renderer clears the flag.                             */
+/*                                                                             */
+/* The cache is in the bgd heap and goes into the save states with it. Graph   */
+/* serials are never reused, so after a load a mask only matches its graph.    */
+/* --------------------------------------------------------------------------- */
+
+#define MASK_CACHE_SIZE     512
+
+typedef struct
+{
+    GRAPH * graph ;
+    uint32_t serial ;
+    int flags, angle, scalex, scaley ;
+
+    int x, y ;              /* Position of the mask relative to the graph center */
+    int width, height ;
+    int pitch ;             /* In words, one spare word for unaligned reads */
+    uint32_t * bits ;
+}
+COLLISION_MASK ;
+
+static COLLISION_MASK * mask_cache = NULL ;
+
+/* --------------------------------------------------------------------------- */
+
+static int mask_build( COLLISION_MASK * mask, GRAPH * map, int flags, int angle, int scalex, int scaley )
+{
+    REGION bbox, clip ;
+    GRAPH * bmp ;
+    uint8_t * line ;
+    uint32_t * bits ;
+    int x, y, cx, cy, on ;
+
+    bgd_free( mask->bits ) ;
+    mask->bits = NULL ;
+    mask->graph = NULL ;
+
+    /* gr_get_bbox rounds toward zero, keep the corners positive */
+    gr_get_bbox( &bbox, NULL, 0, 0, flags, angle, scalex, scaley, map ) ;
+    cx = ( bbox.x < 0 ? -bbox.x : 0 ) + 2 ;
+    cy = ( bbox.y < 0 ? -bbox.y : 0 ) + 2 ;
+    gr_get_bbox( &bbox, NULL, cx, cy, flags, angle, scalex, scaley, map ) ;
+
+    mask->x = bbox.x - cx ;
+    mask->y = bbox.y - cy ;
+    mask->width = bbox.x2 - bbox.x + 1 ;
+    mask->height = bbox.y2 - bbox.y + 1 ;
+    if ( mask->width < 1 || mask->height < 1 ) return 0 ;
+
+    mask->pitch = ( mask->width + 31 ) / 32 + 1 ;
+    mask->bits = ( uint32_t * ) bgd_calloc( mask->pitch * mask->height, sizeof( uint32_t ) ) ;
+    if ( !mask->bits ) return 0 ;
+
+    bmp = bitmap_new( 0, mask->width, mask->height, sys_pixel_format->depth ) ;
+    if ( !bmp )
+    {
+        bgd_free( mask->bits ) ;
+        mask->bits = NULL ;
+        return 0 ;
+    }
+
+    memset( bmp->data, 0, bmp->pitch * bmp->height ) ;
+
+    clip.x = clip.y = 0 ;
+    clip.x2 = mask->width - 1 ;
+    clip.y2 = mask->height - 1 ;
+    draw_graph_at( bmp, cx - bbox.x, cy - bbox.y, &clip, map, flags, angle, scalex, scaley ) ;
+
+    for ( y = 0 ; y < mask->height ; y++ )
+    {
+        line = ( uint8_t * ) bmp->data + bmp->pitch * y ;
+        bits = mask->bits + mask->pitch * y ;
+
+        for ( x = 0 ; x < mask->width ; x++ )
+        {
+            switch ( sys_pixel_format->depth )
+            {
+                case    32:
+                    on = ( ( uint32_t * ) line )[x] != 0 ;
+                    break;
+
+                case    16:
+                    on = ( ( uint16_t * ) line )[x] != 0 ;
+                    break;
+
+                default:
+                    on = line[x] != 0 ;
+                    break;
+            }
+
+            if ( on ) bits[ x >> 5 ] |= 1u << ( x & 31 ) ;
+        }
+    }
+
+    bitmap_destroy( bmp ) ;
+
+    mask->graph = map ;
+    mask->serial = map->serial ;
+    mask->flags = flags ;
+    mask->angle = angle ;
+    mask->scalex = scalex ;
+    mask->scaley = scaley ;
+
+    return 1 ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+static inline int mask_matches( COLLISION_MASK * mask, GRAPH * map, int flags, int angle, int scalex, int scaley )
+{
+    return mask->graph == map && mask->serial == map->serial && !map->modified &&
+           mask->flags == flags && mask->angle == angle && mask->scalex == scalex && mask->scaley == scaley ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* The mask of an instance, never in the slot of avoid unless it is the same */
+
+static COLLISION_MASK * instance_mask( INSTANCE * i, COLLISION_MASK * avoid )
+{
+    COLLISION_MASK * mask ;
+    GRAPH * map ;
+    int flags, angle, scalex, scaley ;
+    uint32_t hash ;
+
+    map = instance_graph( i ) ;
+    if ( !map ) return NULL ;
+
+    get_draw_params( i, &flags, &angle, &scalex, &scaley );
+
+    if ( !mask_cache )
+    {
+        mask_cache = ( COLLISION_MASK * ) bgd_calloc( MASK_CACHE_SIZE, sizeof( COLLISION_MASK ) ) ;
+        if ( !mask_cache ) return NULL ;
+    }
+
+    hash = ( uint32_t )( ( uintptr_t ) map >> 4 ) ;
+    hash = hash * 31 + angle ;
+    hash = hash * 31 + scalex ;
+    hash = hash * 31 + scaley ;
+    hash = hash * 31 + flags ;
+    hash ^= hash >> 16 ;
+
+    mask = &mask_cache[ hash & ( MASK_CACHE_SIZE - 1 ) ] ;
+    if ( mask_matches( mask, map, flags, angle, scalex, scaley ) ) return mask ;
+
+    if ( mask == avoid )
+    {
+        mask = &mask_cache[ ( hash ^ 1 ) & ( MASK_CACHE_SIZE - 1 ) ] ;
+        if ( mask_matches( mask, map, flags, angle, scalex, scaley ) ) return mask ;
+    }
+
+    if ( !mask_build( mask, map, flags, angle, scalex, scaley ) ) return NULL ;
+
+    return mask ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* 32 mask bits starting at any bit of a line */
+
+static inline uint32_t mask_word( uint32_t * line, int bit )
+{
+    uint32_t w = line[ bit >> 5 ] >> ( bit & 31 ) ;
+
+    if ( bit & 31 ) w |= line[ ( bit >> 5 ) + 1 ] << ( 32 - ( bit & 31 ) ) ;
+
+    return w ;
+}
+
 /* --------------------------------------------------------------------------- */
 
 static int check_collision( INSTANCE * proc1, REGION * bbox3, INSTANCE * proc2 )
 {
     REGION bbox1, bbox2 ;
-    int x, y, w, h ;
-    GRAPH * bmp1 = NULL, * bmp2 = NULL ;
+    COLLISION_MASK * mask1, * mask2 ;
+    uint32_t * line1, * line2, word ;
+    int x, y, x1, y1, x2, y2, n ;
+    GRAPH * bmp2 ;
 
     bbox1 = *bbox3;
 
@@ -710,128 +892,418 @@ static int check_collision( INSTANCE * proc1, REGION * bbox3, INSTANCE * proc2 )
 
     // Solo si las regiones de ambos bbox se superponen
 
-    w = bbox1.x2 - bbox1.x + 1 ;
-    h = bbox1.y2 - bbox1.y + 1 ;
-    bbox2.x = bbox2.y = 0 ;
-    bbox2.x2 = w - 1 ;
-    bbox2.y2 = h - 1 ;
+    mask1 = instance_mask( proc1, NULL ) ; if ( !mask1 ) return 0 ;
+    mask2 = instance_mask( proc2, mask1 ) ; if ( !mask2 ) return 0 ;
+
+    /* Screen position of both masks */
+
+    x1 = LOCINT32( mod_grproc, proc1, COORDX ) ;
+    y1 = LOCINT32( mod_grproc, proc1, COORDY ) ;
+    RESOLXY( mod_grproc, proc1, x1, y1 );
+    x1 += mask1->x ;
+    y1 += mask1->y ;
+
+    x2 = LOCINT32( mod_grproc, proc2, COORDX ) ;
+    y2 = LOCINT32( mod_grproc, proc2, COORDY ) ;
+    RESOLXY( mod_grproc, proc2, x2, y2 );
+    x2 += mask2->x ;
+    y2 += mask2->y ;
 
-    bmp1 = bitmap_new( 0, w, h, sys_pixel_format->depth ) ;
-    if ( !bmp1 ) return 0;
+    /* Overlap of the bounding boxes and both masks */
 
-    bmp2 = bitmap_new( 0, w, h, sys_pixel_format->depth ) ;
-    if ( !bmp2 )
+    if ( bbox1.x < x1 ) bbox1.x = x1 ;
+    if ( bbox1.x < x2 ) bbox1.x = x2 ;
+    if ( bbox1.y < y1 ) bbox1.y = y1 ;
+    if ( bbox1.y < y2 ) bbox1.y = y2 ;
+    if ( bbox1.x2 > x1 + mask1->width - 1 ) bbox1.x2 = x1 + mask1->width - 1 ;
+    if ( bbox1.x2 > x2 + mask2->width - 1 ) bbox1.x2 = x2 + mask2->width - 1 ;
+    if ( bbox1.y2 > y1 + mask1->height - 1 ) bbox1.y2 = y1 + mask1->height - 1 ;
+    if ( bbox1.y2 > y2 + mask2->height - 1 ) bbox1.y2 = y2 + mask2->height - 1 ;
+
+    if ( bbox1.x > bbox1.x2 || bbox1.y > bbox1.y2 ) return 0 ;
+
+    for ( y = bbox1.y ; y <= bbox1.y2 ; y++ )
     {
-        bitmap_destroy( bmp1 ) ;
-        return 0;
+        line1 = mask1->bits + mask1->pitch * ( y - y1 ) ;
+        line2 = mask2->bits + mask2->pitch * ( y - y2 ) ;
+
+        for ( x = bbox1.x ; x <= bbox1.x2 ; x += 32 )
+        {
+            word = mask_word( line1, x - x1 ) & mask_word( line2, x - x2 ) ;
+
+            n = bbox1.x2 - x + 1 ;
+            if ( n < 32 ) word &= ( 1u << n ) - 1 ;
+
+            if ( word ) return 1 ;
+        }
     }
 
-    memset( bmp1->data, 0, bmp1->pitch * h ) ;
-    memset( bmp2->data, 0, bmp2->pitch * h ) ;
+    return 0 ;
+}
+
+/* --------------------------------------------------------------------------- */
+/* Broad phase                                                                 */
+/*                                                                             */
+/* Scans by type (or of all processes) use a spatial hash of the bounding     */
+/* boxes of the scanned processes, built on the first scan of the frame and    */
+/* dropped at the frame end. Boxes are grown to the square around the circle   */
+/* used by collision_circle, so every test only needs the overlapping cells.   */
+/*                                                                             */
+/* Processes that run or are created after the build may move, they are       */
+/* tested whatever the cells. Positions changed from other processes are seen  */
+/* from the next frame on.                                                     */
+/* --------------------------------------------------------------------------- */
 
-    x = LOCINT32( mod_grproc, proc1, COORDX ) ;
-    y = LOCINT32( mod_grproc, proc1, COORDY ) ;
-    RESOLXY( mod_grproc, proc1, x, y );
+#define GRID_CELL_SHIFT     6       /* 64x64 pixel cells */
+#define GRID_MAX_CELLS      64      /* Boxes over more cells are always tested */
+#define GRID_SLOTS          128     /* Grids per frame, by process type */
+
+typedef struct
+{
+    int id ;
+    uint32_t type ;
+    REGION box ;
+    int has_box ;
+    int always ;            /* Large, dirty or new: tested whatever the cells */
+    int stamp ;             /* Last query that collected it */
+}
+GRID_ENTRY ;
+
+typedef struct
+{
+    uint32_t type ;         /* 0 for all processes */
+    int frame ;
+
+    GRID_ENTRY * entries ;
+    int count, size ;
+
+    int * buckets ;         /* First cell index of every bucket, nbuckets + 1 */
+    int * cells ;           /* Entry indexes, grouped by bucket */
+    int nbuckets, ncells ;
+
+    int * always ;          /* Entry indexes tested in every query */
+    int nalways, always_size ;
+
+    int * ids ;             /* Open addressing, process id -> entry index + 1 */
+    int nids ;
+}
+GRID ;
+
+static GRID grids[ GRID_SLOTS ] ;
+static int grid_frame = 1 ;
+static int grid_stamp = 0 ;
+
+static int * grid_found = NULL ;
+static int grid_found_size = 0 ;
 
-    x -= bbox1.x ;
-    y -= bbox1.y ;
-    draw_at( bmp1, x, y, &bbox2, proc1 ) ;
+/* --------------------------------------------------------------------------- */
+
+static inline uint32_t grid_cell_hash( int cx, int cy )
+{
+    return ( uint32_t ) cx * 73856093u ^ ( uint32_t ) cy * 19349663u ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* Box used by the broad phase: bounding box and collision circle */
+
+static int grid_box( INSTANCE * i, REGION * box )
+{
+    GRAPH * map ;
+    int cx, cy, r ;
 
-    x = LOCINT32( mod_grproc, proc2, COORDX ) ;
-    y = LOCINT32( mod_grproc, proc2, COORDY ) ;
-    RESOLXY( mod_grproc, proc2, x, y );
+    map = instance_graph( i ) ; if ( !map ) return 0 ;
+    instance_get_bbox( i, map, box );
 
-    x -= bbox1.x ;
-    y -= bbox1.y ;
-    draw_at( bmp2, x, y, &bbox2, proc2 ) ;
+    cx = box->x + ( box->x2 - box->x + 1 ) / 2 ;
+    cy = box->y + ( box->y2 - box->y + 1 ) / 2 ;
+    r = ( box->x2 - box->x + 1 + box->y2 - box->y + 1 ) / 4 + 2 ;
 
-    if ( sys_pixel_format->depth == 32 )
+    if ( box->x > cx - r ) box->x = cx - r ;
+    if ( box->y > cy - r ) box->y = cy - r ;
+    if ( box->x2 < cx + r ) box->x2 = cx + r ;
+    if ( box->y2 < cy + r ) box->y2 = cy + r ;
+
+    return 1 ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+static int grid_add_always( GRID * grid, int n )
+{
+    int * always ;
+
+    if ( grid->nalways >= grid->always_size )
     {
-        uint32_t * ptr1 = ( uint32_t * ) bmp1->data ;
-        uint32_t * ptr2 = ( uint32_t * ) bmp2->data ;
+        always = ( int * ) bgd_realloc( grid->always, ( grid->always_size + 64 ) * sizeof( int ) ) ;
+        if ( !always ) return 0 ;
+        grid->always = always ;
+        grid->always_size += 64 ;
+    }
 
-        uint8_t * _ptr1 = ( uint8_t * ) ptr1 ;
-        uint8_t * _ptr2 = ( uint8_t * ) ptr2 ;
+    grid->entries[n].always = 1 ;
+    grid->always[ grid->nalways++ ] = n ;
 
-        for ( y = 0 ; y < h ; y++ )
-        {
-            for ( x = 0 ; x < w ; x++, ptr1++, ptr2++ )
-            {
-                if ( *ptr1 && *ptr2 )
-                {
-                    bitmap_destroy( bmp1 ) ;
-                    bitmap_destroy( bmp2 ) ;
-                    return 1;
-                }
-            }
-            ptr1 = ( uint32_t * )( _ptr1 += bmp1->pitch );
-            ptr2 = ( uint32_t * )( _ptr2 += bmp2->pitch );
-        }
+    return 1 ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+static int grid_add_entry( GRID * grid, INSTANCE * i )
+{
+    GRID_ENTRY * e ;
+
+    if ( grid->count >= grid->size )
+    {
+        e = ( GRID_ENTRY * ) bgd_realloc( grid->entries, ( grid->size + 256 ) * sizeof( GRID_ENTRY ) ) ;
+        if ( !e ) return -1 ;
+        grid->entries = e ;
+        grid->size += 256 ;
+    }
+
+    e = &grid->entries[ grid->count ] ;
+    e->id = LOCDWORD( mod_grproc, i, PROCESS_ID ) ;
+    e->type = LOCDWORD( mod_grproc, i, PROCESS_TYPE ) ;
+    e->has_box = grid_box( i, &e->box ) ;
+    e->always = 0 ;
+    e->stamp = 0 ;
+
+    return grid->count++ ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+static int grid_build( GRID * grid, uint32_t type )
+{
+    INSTANCE * i, * ctx = NULL ;
+    GRID_ENTRY * e ;
+    int n, cx, cy, * p, total ;
+    uint32_t slot ;
+
+    grid->type = type ;
+    grid->frame = 0 ;
+    grid->count = grid->nalways = 0 ;
+
+    /* Entries, in scan order */
+
+    if ( type )
+    {
+        while ( ( i = instance_get_by_type( type, &ctx ) ) )
+            if ( grid_add_entry( grid, i ) < 0 ) return 0 ;
     }
     else
     {
-        if ( sys_pixel_format->depth == 16 )
-        {
-            uint16_t * ptr1 = ( uint16_t * ) bmp1->data ;
-            uint16_t * ptr2 = ( uint16_t * ) bmp2->data ;
+        for ( i = first_instance ; i ; i = i->next )
+            if ( grid_add_entry( grid, i ) < 0 ) return 0 ;
+    }
 
-            uint8_t * _ptr1 = ( uint8_t * ) ptr1 ;
-            uint8_t * _ptr2 = ( uint8_t * ) ptr2 ;
+    /* Count the cells of every bucket */
 
-            for ( y = 0 ; y < h ; y++ )
-            {
-                for ( x = 0 ; x < w ; x++, ptr1++, ptr2++ )
-                {
-                    if ( *ptr1 && *ptr2 )
-                    {
-                        bitmap_destroy( bmp1 ) ;
-                        bitmap_destroy( bmp2 ) ;
-                        return 1;
-                    }
-                }
-                ptr1 = ( uint16_t * )( _ptr1 += bmp1->pitch );
-                ptr2 = ( uint16_t * )( _ptr2 += bmp2->pitch );
-            }
+    for ( grid->nbuckets = 64 ; grid->nbuckets < grid->count * 2 ; grid->nbuckets <<= 1 ) ;
+
+    bgd_free( grid->buckets ) ;
+    grid->buckets = ( int * ) bgd_calloc( grid->nbuckets + 1, sizeof( int ) ) ;
+    if ( !grid->buckets ) return 0 ;
+
+    total = 0 ;
+    for ( n = 0 ; n < grid->count ; n++ )
+    {
+        e = &grid->entries[n] ;
+        if ( !e->has_box ) continue ;
+
+        if ( ( ( e->box.x2 >> GRID_CELL_SHIFT ) - ( e->box.x >> GRID_CELL_SHIFT ) + 1 ) *
+             ( ( e->box.y2 >> GRID_CELL_SHIFT ) - ( e->box.y >> GRID_CELL_SHIFT ) + 1 ) > GRID_MAX_CELLS )
+        {
+            if ( !grid_add_always( grid, n ) ) return 0 ;
+            continue ;
         }
-        else
+
+        for ( cy = e->box.y >> GRID_CELL_SHIFT ; cy <= e->box.y2 >> GRID_CELL_SHIFT ; cy++ )
+            for ( cx = e->box.x >> GRID_CELL_SHIFT ; cx <= e->box.x2 >> GRID_CELL_SHIFT ; cx++, total++ )
+                grid->buckets[ ( grid_cell_hash( cx, cy ) & ( grid->nbuckets - 1 ) ) + 1 ]++ ;
+    }
+
+    for ( n = 0 ; n < grid->nbuckets ; n++ ) grid->buckets[ n + 1 ] += grid->buckets[n] ;
+
+    /* Fill the cells, buckets[b] runs as the fill position and ends at the next start */
+
+    if ( total > grid->ncells )
+    {
+        p = ( int * ) bgd_realloc( grid->cells, total * sizeof( int ) ) ;
+        if ( !p ) return 0 ;
+        grid->cells = p ;
+        grid->ncells = total ;
+    }
+
+    for ( n = 0 ; n < grid->count ; n++ )
+    {
+        e = &grid->entries[n] ;
+        if ( !e->has_box || e->always ) continue ;
+
+        for ( cy = e->box.y >> GRID_CELL_SHIFT ; cy <= e->box.y2 >> GRID_CELL_SHIFT ; cy++ )
+            for ( cx = e->box.x >> GRID_CELL_SHIFT ; cx <= e->box.x2 >> GRID_CELL_SHIFT ; cx++ )
+                grid->cells[ grid->buckets[ grid_cell_hash( cx, cy ) & ( grid->nbuckets - 1 ) ]++ ] = n ;
+    }
+
+    for ( n = grid->nbuckets ; n > 0 ; n-- ) grid->buckets[n] = grid->buckets[ n - 1 ] ;
+    grid->buckets[0] = 0 ;
+
+    /* Process ids, to find the entries of the processes that run later */
+
+    bgd_free( grid->ids ) ;
+    grid->nids = grid->nbuckets ;
+    grid->ids = ( int * ) bgd_calloc( grid->nids, sizeof( int ) ) ;
+    if ( !grid->ids ) return 0 ;
+
+    for ( n = 0 ; n < grid->count ; n++ )
+    {
+        for ( slot = grid->entries[n].id & ( grid->nids - 1 ) ; grid->ids[ slot ] ; slot = ( slot + 1 ) & ( grid->nids - 1 ) ) ;
+        grid->ids[ slot ] = n + 1 ;
+    }
+
+    grid->frame = grid_frame ;
+
+    return 1 ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* The grid of a type built this frame or, if create is set, a free slot for it */
+
+static GRID * grid_find( uint32_t type, int create )
+{
+    GRID * grid ;
+    int n ;
+
+    for ( n = 0 ; n < GRID_SLOTS ; n++ )
+    {
+        grid = &grids[ ( type + n ) % GRID_SLOTS ] ;
+        if ( grid->frame != grid_frame ) return create ? grid : NULL ;
+        if ( grid->type == type ) return grid ;
+    }
+
+    /* More types than slots in a frame, reuse the first one */
+    return create ? &grids[ type % GRID_SLOTS ] : NULL ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+static GRID * grid_get( uint32_t type )
+{
+    GRID * grid = grid_find( type, 1 ) ;
+
+    if ( grid->frame == grid_frame && grid->type == type ) return grid ;
+    if ( !grid_build( grid, type ) ) return NULL ;
+
+    return grid ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+/* The process will run or was just created, its box can't be trusted anymore */
+
+static void grid_touch( uint32_t type, INSTANCE * r, int is_new )
+{
+    GRID * grid = grid_find( type, 0 ) ;
+    uint32_t slot ;
+    int n, id ;
+
+    if ( !grid ) return ;
+
+    if ( is_new )
+    {
+        if ( ( n = grid_add_entry( grid, r ) ) < 0 || !grid_add_always( grid, n ) ) grid->frame = 0 ;
+        return ;
+    }
+
+    id = LOCDWORD( mod_grproc, r, PROCESS_ID ) ;
+
+    for ( slot = id & ( grid->nids - 1 ) ; ( n = grid->ids[ slot ] ) ; slot = ( slot + 1 ) & ( grid->nids - 1 ) )
+    {
+        if ( grid->entries[ n - 1 ].id != id ) continue ;
+        if ( !grid->entries[ n - 1 ].always && !grid_add_always( grid, n - 1 ) ) grid->frame = 0 ;
+        return ;
+    }
+}
+
+/* --------------------------------------------------------------------------- */
+
+static int grid_compare( const void * a, const void * b )
+{
+    return *( int * ) a - *( int * ) b ;
+}
+
+/* Indexes of the entries that may collide with box, in scan order */
+
+static int grid_query( GRID * grid, REGION * box, int ** found )
+{
+    GRID_ENTRY * e ;
+    int count = 0, n, m, cx, cy, * p, * last ;
+    uint32_t b ;
+
+    if ( grid_found_size < grid->count )
+    {
+        p = ( int * ) bgd_realloc( grid_found, grid->count * sizeof( int ) ) ;
+        if ( !p ) return 0 ;
+        grid_found = p ;
+        grid_found_size = grid->count ;
+    }
+
+    grid_stamp++ ;
+
+    if ( ( ( box->x2 >> GRID_CELL_SHIFT ) - ( box->x >> GRID_CELL_SHIFT ) + 1 ) *
+         ( ( box->y2 >> GRID_CELL_SHIFT ) - ( box->y >> GRID_CELL_SHIFT ) + 1 ) > GRID_MAX_CELLS )
+    {
+        /* Big enough to look at every entry */
+        for ( n = 0 ; n < grid->count ; n++ )
         {
-            uint8_t * ptr1 = ( uint8_t * )bmp1->data ;
-            uint8_t * ptr2 = ( uint8_t * )bmp2->data ;
+            e = &grid->entries[n] ;
+            if ( e->always || ( e->has_box && e->box.x <= box->x2 && e->box.x2 >= box->x && e->box.y <= box->y2 && e->box.y2 >= box->y ) )
+                grid_found[ count++ ] = n ;
+        }
 
-            uint8_t * _ptr1 = ptr1 ;
-            uint8_t * _ptr2 = ptr2 ;
+        *found = grid_found ;
+        return count ;
+    }
 
-            for ( y = 0 ; y < h ; y++ )
+    for ( cy = box->y >> GRID_CELL_SHIFT ; cy <= box->y2 >> GRID_CELL_SHIFT ; cy++ )
+    {
+        for ( cx = box->x >> GRID_CELL_SHIFT ; cx <= box->x2 >> GRID_CELL_SHIFT ; cx++ )
+        {
+            b = grid_cell_hash( cx, cy ) & ( grid->nbuckets - 1 ) ;
+            last = grid->cells + grid->buckets[ b + 1 ] ;
+
+            for ( p = grid->cells + grid->buckets[b] ; p < last ; p++ )
             {
-                for ( x = 0 ; x < w ; x++, ptr1++, ptr2++ )
-                {
-                    if ( *ptr1 && *ptr2 )
-                    {
-                        bitmap_destroy( bmp1 ) ;
-                        bitmap_destroy( bmp2 ) ;
-                        return 1;
-                    }
-                }
-                ptr1 = _ptr1 += bmp1->pitch;
-                ptr2 = _ptr2 += bmp2->pitch;
+                e = &grid->entries[ *p ] ;
+                if ( e->stamp == grid_stamp || e->always ) continue ;
+                e->stamp = grid_stamp ;
+
+                if ( e->box.x <= box->x2 && e->box.x2 >= box->x && e->box.y <= box->y2 && e->box.y2 >= box->y )
+                    grid_found[ count++ ] = *p ;
             }
         }
     }
 
-    bitmap_destroy( bmp1 ) ;
-    bitmap_destroy( bmp2 ) ;
-    return 0;
+    for ( m = 0 ; m < grid->nalways ; m++ )
+        grid_found[ count++ ] = grid->always[m] ;
+
+    qsort( grid_found, count, sizeof( int ), grid_compare ) ;
+
+    *found = grid_found ;
+    return count ;
 }
 
 /* --------------------------------------------------------------------------- */
 
 static int __collision( INSTANCE * my, int id, int colltype )
 {
-    INSTANCE * ptr, ** ctx ;
-    int status, p ;
+    INSTANCE * ptr ;
+    int status, n, count, start, * found ;
     int ( *colfunc )( INSTANCE *, REGION *, INSTANCE * );
-    REGION bbox1 ;
+    REGION bbox1, box ;
     GRAPH * bmp1 ;
+    GRID * grid ;
 
     if ( id == -1 ) return ( check_collision_with_mouse( my, colltype ) ) ? 1 : 0 ;
 
@@ -861,50 +1333,36 @@ static int __collision( INSTANCE * my, int id, int colltype )
     /* Checks only for a single instance */
     if ( id >= FIRST_INSTANCE_ID ) return ( ( ( ptr = instance_get( id ) ) && ctype == LOCDWORD( mod_grproc, ptr, CTYPE ) ) ? colfunc( my, &bbox1, ptr ) : 0 ) ;
 
-    /* we must use full list of instances or get types from it */
-    ptr = first_instance ;
+    /* Scan of all processes (id 0) or of a type, from the last one found */
+    grid = grid_get( id ) ; if ( !grid ) return 0 ;
 
     if ( !id )
     {
         LOCDWORD( mod_grproc, my, GRPROC_TYPE_SCAN ) = 0 ;
-        if ( ( p = LOCDWORD( mod_grproc, my, GRPROC_ID_SCAN ) ) )
-        {
-            ptr = instance_get( p ) ;
-            if ( ptr ) ptr = ptr->next ;
-        }
-
-        while ( ptr )
+        start = LOCDWORD( mod_grproc, my, GRPROC_ID_SCAN ) ;
+    }
+    else
+    {
+        LOCDWORD( mod_grproc, my, GRPROC_ID_SCAN ) = 0 ;
+        if ( LOCDWORD( mod_grproc, my, GRPROC_TYPE_SCAN ) != id ) /* Check if type change from last call */
         {
-            if ( ptr != my &&
-                 ctype == LOCDWORD( mod_grproc, ptr, CTYPE ) &&
-                  (
-                    ( status = ( LOCDWORD( mod_grproc, ptr, STATUS ) & ~STATUS_WAITING_MASK ) ) == STATUS_RUNNING ||
-                    status == STATUS_FROZEN
-                  ) && colfunc( my, &bbox1, ptr )
-                )
-            {
-                LOCDWORD( mod_grproc, my, GRPROC_ID_SCAN ) = LOCDWORD( mod_grproc, ptr, PROCESS_ID ) ;
-                return LOCDWORD( mod_grproc, ptr, PROCESS_ID ) ;
-            }
-            ptr = ptr->next ;
+            LOCDWORD( mod_grproc, my, GRPROC_CONTEXT ) = 0 ;
+            LOCDWORD( mod_grproc, my, GRPROC_TYPE_SCAN ) = id ;
         }
-        return 0 ;
+        start = LOCDWORD( mod_grproc, my, GRPROC_CONTEXT ) ;
     }
 
-    LOCDWORD( mod_grproc, my, GRPROC_ID_SCAN ) = 0 ;
-    /* Check if already in scan by type and we reach limit */
-    uint32_t* context_address = (uint32_t*)LOCADDR( mod_grproc, my, GRPROC_CONTEXT );
-    INSTANCE* context = (INSTANCE*)ptr_from_int(*context_address);    
-    ctx = &context;
-    if ( LOCDWORD( mod_grproc, my, GRPROC_TYPE_SCAN ) != id ) /* Check if type change from last call */
-    {
-        *ctx = NULL;
-        LOCDWORD( mod_grproc, my, GRPROC_TYPE_SCAN ) = id;
-    }
+    grid_box( my, &box ) ;
+    count = grid_query( grid, &box, &found ) ;
 
-    while ( ( ptr = instance_get_by_type( id, ctx ) ) )
+    for ( n = 0 ; n < count ; n++ )
     {
-        if ( ptr != my &&
+        if ( found[n] < start ) continue ;
+
+        ptr = instance_get( grid->entries[ found[n] ].id ) ;
+
+        if ( ptr && ptr != my &&
+             LOCDWORD( mod_grproc, ptr, PROCESS_TYPE ) == grid->entries[ found[n] ].type &&
              ctype == LOCDWORD( mod_grproc, ptr, CTYPE ) &&
              (
                 ( status = ( LOCDWORD( mod_grproc, ptr, STATUS ) & ~STATUS_WAITING_MASK ) ) == STATUS_RUNNING ||
@@ -913,12 +1371,14 @@ static int __collision( INSTANCE * my, int id, int colltype )
              colfunc( my, &bbox1, ptr )
            )
         {
-            *context_address = (uint32_t)int_from_ptr(context);
+            /* Next call goes on after this one */
+            if ( !id ) LOCDWORD( mod_grproc, my, GRPROC_ID_SCAN ) = found[n] + 1 ;
+            else       LOCDWORD( mod_grproc, my, GRPROC_CONTEXT ) = found[n] + 1 ;
             return LOCDWORD( mod_grproc, ptr, PROCESS_ID ) ;
         }
     }
 
-    *context_address = (uint32_t)int_from_ptr(context);
+    if ( id ) LOCDWORD( mod_grproc, my, GRPROC_CONTEXT ) = 0 ;
     return 0 ;
 }
 
@@ -950,6 +1410,49 @@ void __bgdexport( mod_grproc, process_exec_hook )( INSTANCE * r )
     LOCDWORD( mod_grproc, r, GRPROC_ID_SCAN ) = 0;
     LOCDWORD( mod_grproc, r, GRPROC_TYPE_SCAN ) = 0;
     LOCDWORD( mod_grproc, r, GRPROC_CONTEXT ) = 0;
+
+    grid_touch( LOCDWORD( mod_grproc, r, PROCESS_TYPE ), r, 0 );
+    grid_touch( 0, r, 0 );
+}
+
+/* ----------------------------------------------------------------- */
+
+void __bgdexport( mod_grproc, instance_create_hook )( INSTANCE * r )
+{
+    grid_touch( LOCDWORD( mod_grproc, r, PROCESS_TYPE ), r, 1 );
+    grid_touch( 0, r, 1 );
+}
+
+/* ----------------------------------------------------------------- */
+
+static void grproc_end_frame()
+{
+    grid_frame++;
+}
+
+/* ----------------------------------------------------------------- */
+
+HOOK __bgdexport( mod_grproc, handler_hooks )[] =
+{
+    {   0, grproc_end_frame },
+    {   0, NULL             }
+} ;
+
+/* ----------------------------------------------------------------- */
+
+void __bgdexport( mod_grproc, module_initialize )()
+{
+    savestate_register_ptr( mask_cache );
+    savestate_register_var( grids );
+    savestate_check_field( grids, entries );
+    savestate_check_field( grids, buckets );
+    savestate_check_field( grids, cells );
+    savestate_check_field( grids, always );
+    savestate_check_field( grids, ids );
+    savestate_register_var( grid_frame );
+    savestate_register_var( grid_stamp );
+    savestate_register_ptr( grid_found );
+    savestate_register_var( grid_found_size );
 }
 
 /* ----------------------------------------------------------------- */
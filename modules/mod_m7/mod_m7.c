@@ -28,6 +28,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 
 #include <math.h>
 
@@ -41,6 +43,7 @@
 #include "libblit.h"
 
 #include "instance.h"
+#include "savestate.h"
 
 #include "resolution.h"
 
@@ -63,9 +66,9 @@ extern int trans_table_updated ;
 #define ROTATEDX(x,y,sina,cosa) (fixmul(x,cosa) - fixmul(y,sina))
 #define ROTATEDY(x,y,sina,cosa) (fixmul(x,sina) + fixmul(y,cosa))
 
-/* Esta estructura guarda información que se recalcula a cada frame.
- * Quizá no sería necesario recalcularlo todo. El incremento podría
- * quedar constante mientras no variara la altura, p.ej. */
+/* Esta estructura guarda la información de cada línea. Las posiciones son
+ * relativas a la cámara, así que sólo dependen del ángulo, la altura, el
+ * foco y el tamaño de la región, y se recalculan cuando alguno cambia. */
 
 typedef struct _lineinfo
 {
@@ -78,7 +81,7 @@ typedef struct _lineinfo
 }
 LINEINFO ;
 
-static LINEINFO lines[1280] ;
+#define MAX_LINES   1280
 
 /* --------------------------------------------------------------------------- */
 
@@ -100,6 +103,16 @@ typedef struct _mode7
     GRAPH * indoor ;
     GRAPH * outdoor ;
     GRAPH * dest ;
+
+    /* Lines cache and the view it was made for */
+    int lines_ok ;
+    int lines_angle ;
+    fixed lines_camera_z ;
+    int lines_focus ;
+    int lines_width ;
+    int lines_height ;
+    int lines_horizon ;
+    LINEINFO lines[MAX_LINES + 1] ;
 }
 MODE7 ;
 
@@ -125,6 +138,15 @@ MODE7_INFO ;
 
 static MODE7 mode7_inf[10] = { { 0 } } ;
 
+/* Procesos de cada modo 7, ordenados como en el frame anterior */
+
+static INSTANCE_LIST mode7_instances[10] ;
+
+/* Procesos del modo 7 que se dibuja, antes de ordenarlos */
+
+static INSTANCE ** proclist = NULL ;
+static int proclist_reserved = 0 ;
+
 /* --------------------------------------------------------------------------- */
 /* Globals */
 enum {
@@ -188,327 +210,404 @@ static int compare_by_distance( const void * ptr1, const void * ptr2 )
 }
 
 /* --------------------------------------------------------------------------- */
+/* Dibujo del suelo
+ *
+ * Cada línea se divide en tramos: el que cae dentro del mapa interior se
+ * dibuja sin comprobar los límites en cada pixel, y el resto con el mapa
+ * exterior o el color de fondo. Las líneas se reparten entre los threads
+ * de render, si los hay.
+ */
 
-#define M7_8bpp() \
-                baseline = ptr ; \
- \
-                for ( x = 0 ; x < width ; x++ ) \
-                { \
-                    sx = fixtoi( bmp_x ) ; \
-                    sy = fixtoi( bmp_y ) ; \
- \
-                    if ( indoor && sx >= 0 && sx < indoor->width && sy >= 0 && sy < indoor->height ) \
-                    { \
-                        c = (( uint8_t* )indoor->data )[indoor->pitch*sy + sx] ; \
-                        if ( c > 0 ) *ptr   = c ; \
-                        ptr++ ; \
-                    } \
-                    else \
-                    { \
-                        if ( outdoor ) c = (( uint8_t* )outdoor->data )[outdoor->pitch*( sy & outdoor_vmask ) + ( sx & outdoor_hmask )] ; \
-                        else           c = dat->color ; \
-                        if ( c > 0 ) *ptr   = c ; \
-                        ptr++ ; \
-                    } \
- \
-                    bmp_x += hinc ; \
-                    bmp_y += vinc ; \
-                } \
- \
-                ptr = baseline + (( jump > 0 ) ? dest->pitch : -( int )dest->pitch ) ;
+typedef struct _mode7_draw
+{
+    MODE7 * mode7 ;
+    MODE7_INFO * dat ;
+    GRAPH * dest ;
+    fixed camera_x ;
+    fixed camera_y ;
+    int outdoor_hmask ;
+    int outdoor_vmask ;
+    int width ;
+    int first_y ;       /* Primera línea, las demás siguen en pasos de jump */
+    int jump ;
+    int count ;         /* Número de líneas */
+    uint8_t * first_ptr ;
+}
+MODE7_DRAW ;
 
+#define M7_FIXTOI(x)        (( int )(( x ) / FIXED_PREC ))
 
-#define M7_16bpp() \
-                baseline = ( uint8_t * ) ptr16 ; \
- \
-                for ( x = 0 ; x < width ; x++ ) \
-                { \
-                    sx = fixtoi( bmp_x ) ; \
-                    sy = fixtoi( bmp_y ) ; \
- \
-                    if ( indoor && sx >= 0 && sx < indoor->width && sy >= 0 && sy < indoor->height ) \
-                    { \
-                        c16 = *( uint16_t* )&((( uint8_t* )indoor->data )[indoor->pitch*sy + (sx<<1)]) ; \
-                        if ( c16 > 0 ) *ptr16 = c16 ; \
-                        ptr16++ ; \
-                    } \
-                    else \
-                    { \
-                        if ( outdoor ) c16 = *( uint16_t* )&((( uint8_t* )outdoor->data )[outdoor->pitch*( sy & outdoor_vmask ) + (( sx & outdoor_hmask ) << 1)]) ; \
-                        else           c16 = dat->color ; \
-                        if ( c16 > 0 ) *ptr16 = c16 ; \
-                        ptr16++ ; \
-                    } \
- \
-                    bmp_x += hinc ; \
-                    bmp_y += vinc ; \
-                } \
- \
-                ptr16 = ( uint16_t * ) ( baseline + (( jump > 0 ) ? dest->pitch : -( int )dest->pitch ) );
+#define M7_TEXEL(type,shift,map,sx,sy) \
+        ( *( type * )(( uint8_t * )( map )->data + ( map )->pitch * ( sy ) + (( sx ) << ( shift ) ) ) )
 
+/* --------------------------------------------------------------------------- */
 
-#define M7_32bpp() \
-                baseline = ( uint8_t * ) ptr32 ; \
- \
-                for ( x = 0 ; x < width ; x++ ) \
-                { \
-                    sx = fixtoi( bmp_x ) ; \
-                    sy = fixtoi( bmp_y ) ; \
- \
-                    if ( indoor && sx >= 0 && sx < indoor->width && sy >= 0 && sy < indoor->height ) \
-                    { \
-                        c32 = *( uint32_t* )&((( uint8_t* )indoor->data )[indoor->pitch*sy + (sx<<2)]) ; \
-                        if ( c32 > 0 ) *ptr32 = c32 ; \
-                        ptr32++ ; \
-                    } \
-                    else \
-                    { \
-                        if ( outdoor ) c32 = *( uint32_t* )&((( uint8_t* )outdoor->data )[outdoor->pitch*( sy & outdoor_vmask ) + (( sx & outdoor_hmask ) << 2)]) ; \
-                        else           c32 = dat->color ; \
-                        if ( c32 > 0 ) *ptr32 = c32 ; \
-                        ptr32++ ; \
-                    } \
- \
-                    bmp_x += hinc ; \
-                    bmp_y += vinc ; \
-                } \
- \
-                ptr32 = ( uint32_t * ) ( baseline + (( jump > 0 ) ? dest->pitch : -( int )dest->pitch ) );
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define M7_SSE2
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#include <arm_neon.h>
+#define M7_NEON
+#endif
 
+/* Guarda 16 bytes de texels (4 de 32 bits u 8 de 16 bits), salvo los que
+ * son 0. Los texels se leen de uno en uno y se escriben juntos. */
 
-#define M7_t8bpp() \
-                baseline = ptr ; \
- \
-                for ( x = 0 ; x < width ; x++ ) \
-                { \
-                    sx = fixtoi( bmp_x ) ; \
-                    sy = fixtoi( bmp_y ) ; \
- \
-                    if ( indoor && sx >= 0 && sx < indoor->width && sy >= 0 && sy < indoor->height ) \
-                    { \
-                        *ptr = trans_table[(( uint8_t* )indoor->data )[indoor->pitch*sy + sx]][*ptr] ; \
-                        ptr++ ; \
-                    } \
-                    else \
-                    { \
-                        if ( outdoor ) *ptr = trans_table[(( uint8_t* )outdoor->data )[outdoor->pitch*( sy & outdoor_vmask ) + ( sx & outdoor_hmask )]][*ptr] ; \
-                        else           *ptr = trans_table[dat->color][*ptr] ; \
-                        ptr++ ; \
-                    } \
- \
-                    bmp_x += hinc ; \
-                    bmp_y += vinc ; \
-                } \
- \
-                ptr = baseline + (( jump > 0 ) ? dest->pitch : -( int )dest->pitch ) ;
+#if defined( M7_SSE2 )
 
+static inline void m7_put16_32( uint32_t * ptr, const uint32_t * texel )
+{
+    __m128i c = _mm_loadu_si128(( const __m128i * ) texel ) ;
+    __m128i m = _mm_cmpeq_epi32( c, _mm_setzero_si128() ) ;
+    __m128i d = _mm_loadu_si128(( const __m128i * ) ptr ) ;
+    _mm_storeu_si128(( __m128i * ) ptr, _mm_or_si128( _mm_and_si128( m, d ), _mm_andnot_si128( m, c ) ) ) ;
+}
 
-#define M7_t16bpp() \
-                baseline = ( uint8_t * ) ptr16 ; \
- \
-                for ( x = 0 ; x < width ; x++ ) \
-                { \
-                    sx = fixtoi( bmp_x ) ; \
-                    sy = fixtoi( bmp_y ) ; \
- \
-                    if ( indoor && sx >= 0 && sx < indoor->width && sy >= 0 && sy < indoor->height ) \
-                    { \
-                        *ptr16 = colorghost[*ptr16]+colorghost[*( uint16_t* )&((( uint8_t* )indoor->data )[indoor->pitch*sy + (sx<<1)])]; \
-                        ptr16++ ; \
-                    } \
-                    else \
-                    { \
-                        if ( outdoor ) *ptr16 = colorghost[*ptr16]+colorghost[*( uint16_t* )&((( uint8_t* )outdoor->data )[outdoor->pitch*( sy & outdoor_vmask ) + ((sx& outdoor_hmask)<<1)])]; \
-                        else           *ptr16 = colorghost[*ptr16]+colorghost[dat->color]; \
-                        ptr16++ ; \
-                    } \
- \
-                    bmp_x += hinc ; \
-                    bmp_y += vinc ; \
-                } \
- \
-                ptr16 = ( uint16_t * ) ( baseline + (( jump > 0 ) ? dest->pitch : -( int )dest->pitch ) ); \
+static inline void m7_put16_16( uint16_t * ptr, const uint16_t * texel )
+{
+    __m128i c = _mm_loadu_si128(( const __m128i * ) texel ) ;
+    __m128i m = _mm_cmpeq_epi16( c, _mm_setzero_si128() ) ;
+    __m128i d = _mm_loadu_si128(( const __m128i * ) ptr ) ;
+    _mm_storeu_si128(( __m128i * ) ptr, _mm_or_si128( _mm_and_si128( m, d ), _mm_andnot_si128( m, c ) ) ) ;
+}
 
+#elif defined( M7_NEON )
 
-#define M7_t32bpp() \
-                baseline = ( uint8_t * ) ptr32 ; \
- \
-                for ( x = 0 ; x < width ; x++ ) \
-                { \
-                    sx = fixtoi( bmp_x ) ; \
-                    sy = fixtoi( bmp_y ) ; \
- \
-                    if ( indoor && sx >= 0 && sx < indoor->width && sy >= 0 && sy < indoor->height ) \
-                    { \
-                        c32 = *( uint32_t* )&((( uint8_t* )indoor->data )[indoor->pitch*sy + (sx<<2)]); \
-                        _f = c32 & 0xff000000; \
-                        if ( _f != 0xff000000 ) \
-                        { \
-                            _f = ( _f >> 24 ) * 128 / 255 ; \
-                            _f2 = 255 - _f ; \
- \
-                            r = ((( c32 & 0x00ff0000 ) * _f ) + (( *ptr32 & 0x00ff0000 ) * _f2 ) ) >> 8 ; \
-                            g = ((( c32 & 0x0000ff00 ) * _f ) + (( *ptr32 & 0x0000ff00 ) * _f2 ) ) >> 8 ; \
-                            b = ((( c32 & 0x000000ff ) * _f ) + (( *ptr32 & 0x000000ff ) * _f2 ) ) >> 8 ; \
-                        } \
-                        else \
-                        { \
-                            r = ((( c32 & 0x00ff0000 ) * 128 ) + (( *ptr32 & 0x00ff0000 ) * 128 ) ) >> 8 ; \
-                            g = ((( c32 & 0x0000ff00 ) * 128 ) + (( *ptr32 & 0x0000ff00 ) * 128 ) ) >> 8 ; \
-                            b = ((( c32 & 0x000000ff ) * 128 ) + (( *ptr32 & 0x000000ff ) * 128 ) ) >> 8 ; \
-                        } \
- \
-                        if ( r > 0x00ff0000 ) r = 0x00ff0000 ; else r &= 0x00ff0000 ; \
-                        if ( g > 0x0000ff00 ) g = 0x0000ff00 ; else g &= 0x0000ff00 ; \
-                        if ( b > 0x000000ff ) b = 0x000000ff ; else b &= 0x000000ff ; \
- \
-                        *ptr32 = ( MAX( c32 & 0xff000000, *ptr32 & 0xff000000 ) ) | r | g | b ; \
-                        ptr32++ ; \
-                    } \
-                    else \
-                    { \
-                        if ( outdoor ) \
-                        { \
-                            c32 = *( uint32_t* )&((( uint8_t* )outdoor->data )[outdoor->pitch*( sy & outdoor_vmask ) + (( sx & outdoor_hmask ) << 2)]) ; \
-                            _f = c32 & 0xff000000; \
-                            if ( _f != 0xff000000 ) \
-                            { \
-                                _f = ( _f >> 24 ) * 128 / 255 ; \
-                                _f2 = 255 - _f ; \
- \
-                                r = ((( c32 & 0x00ff0000 ) * _f ) + (( *ptr32 & 0x00ff0000 ) * _f2 ) ) >> 8 ; \
-                                g = ((( c32 & 0x0000ff00 ) * _f ) + (( *ptr32 & 0x0000ff00 ) * _f2 ) ) >> 8 ; \
-                                b = ((( c32 & 0x000000ff ) * _f ) + (( *ptr32 & 0x000000ff ) * _f2 ) ) >> 8 ; \
-                            } \
-                            else \
-                            { \
-                                r = ((( c32 & 0x00ff0000 ) * 128 ) + (( *ptr32 & 0x00ff0000 ) * 128 ) ) >> 8 ; \
-                                g = ((( c32 & 0x0000ff00 ) * 128 ) + (( *ptr32 & 0x0000ff00 ) * 128 ) ) >> 8 ; \
-                                b = ((( c32 & 0x000000ff ) * 128 ) + (( *ptr32 & 0x000000ff ) * 128 ) ) >> 8 ; \
-                            } \
- \
-                            if ( r > 0x00ff0000 ) r = 0x00ff0000 ; else r &= 0x00ff0000 ; \
-                            if ( g > 0x0000ff00 ) g = 0x0000ff00 ; else g &= 0x0000ff00 ; \
-                            if ( b > 0x000000ff ) b = 0x000000ff ; else b &= 0x000000ff ; \
- \
-                            *ptr32 = ( MAX( c32 & 0xff000000, *ptr32 & 0xff000000 ) ) | r | g | b ; \
-                        } \
-                        else \
-                        { \
-                            c32 = dat->color ; \
-                            _f = c32 & 0xff000000; \
-                            if ( _f != 0xff000000 ) \
-                            { \
-                                _f = ( _f >> 24 ) * 128 / 255 ; \
-                                _f2 = 255 - _f ; \
- \
-                                r = ((( c32 & 0x00ff0000 ) * _f ) + (( *ptr32 & 0x00ff0000 ) * _f2 ) ) >> 8 ; \
-                                g = ((( c32 & 0x0000ff00 ) * _f ) + (( *ptr32 & 0x0000ff00 ) * _f2 ) ) >> 8 ; \
-                                b = ((( c32 & 0x000000ff ) * _f ) + (( *ptr32 & 0x000000ff ) * _f2 ) ) >> 8 ; \
-                            } \
-                            else \
-                            { \
-                                r = ((( c32 & 0x00ff0000 ) * 128 ) + (( *ptr32 & 0x00ff0000 ) * 128 ) ) >> 8 ; \
-                                g = ((( c32 & 0x0000ff00 ) * 128 ) + (( *ptr32 & 0x0000ff00 ) * 128 ) ) >> 8 ; \
-                                b = ((( c32 & 0x000000ff ) * 128 ) + (( *ptr32 & 0x000000ff ) * 128 ) ) >> 8 ; \
-                            } \
- \
-                            if ( r > 0x00ff0000 ) r = 0x00ff0000 ; else r &= 0x00ff0000 ; \
-                            if ( g > 0x0000ff00 ) g = 0x0000ff00 ; else g &= 0x0000ff00 ; \
-                            if ( b > 0x000000ff ) b = 0x000000ff ; else b &= 0x000000ff ; \
- \
-                            *ptr32 = ( MAX( c32 & 0xff000000, *ptr32 & 0xff000000 ) ) | r | g | b ; \
-                        } \
-                        ptr32++ ; \
-                    } \
- \
-                    bmp_x += hinc ; \
-                    bmp_y += vinc ; \
-                } \
- \
-                ptr32 = ( uint32_t * ) ( baseline + (( jump > 0 ) ? dest->pitch : -( int )dest->pitch ) ); \
+static inline void m7_put16_32( uint32_t * ptr, const uint32_t * texel )
+{
+    uint32x4_t c = vld1q_u32( texel ) ;
+    vst1q_u32( ptr, vbslq_u32( vceqq_u32( c, vdupq_n_u32( 0 ) ), vld1q_u32( ptr ), c ) ) ;
+}
 
+static inline void m7_put16_16( uint16_t * ptr, const uint16_t * texel )
+{
+    uint16x8_t c = vld1q_u16( texel ) ;
+    vst1q_u16( ptr, vbslq_u16( vceqq_u16( c, vdupq_n_u16( 0 ) ), vld1q_u16( ptr ), c ) ) ;
+}
 
-static void draw_mode7( int n, REGION * clip )
+#endif
+
+/* --------------------------------------------------------------------------- */
+
+static inline uint32_t m7_blend32( uint32_t c32, uint32_t d32 )
 {
-    fixed   bmp_x, bmp_y ;
-    fixed   base_x,   base_y,   base_z ;
-    fixed   camera_x, camera_y, camera_z ;
-    fixed   point_x,  point_y,  point_z ;
-    fixed   cosa,  sina  ;
-    fixed   angle ;
-    fixed   hinc, vinc ;
+    unsigned int _f, _f2 ;
+    int r, g, b ;
 
-    if ( n < 0 || n > 9 ) return ;
+    _f = c32 & 0xff000000 ;
+    if ( _f != 0xff000000 )
+    {
+        _f = ( _f >> 24 ) * 128 / 255 ;
+        _f2 = 255 - _f ;
 
-    MODE7 * mode7 = &mode7_inf[n];
+        r = ((( c32 & 0x00ff0000 ) * _f ) + (( d32 & 0x00ff0000 ) * _f2 ) ) >> 8 ;
+        g = ((( c32 & 0x0000ff00 ) * _f ) + (( d32 & 0x0000ff00 ) * _f2 ) ) >> 8 ;
+        b = ((( c32 & 0x000000ff ) * _f ) + (( d32 & 0x000000ff ) * _f2 ) ) >> 8 ;
+    }
+    else
+    {
+        r = ((( c32 & 0x00ff0000 ) * 128 ) + (( d32 & 0x00ff0000 ) * 128 ) ) >> 8 ;
+        g = ((( c32 & 0x0000ff00 ) * 128 ) + (( d32 & 0x0000ff00 ) * 128 ) ) >> 8 ;
+        b = ((( c32 & 0x000000ff ) * 128 ) + (( d32 & 0x000000ff ) * 128 ) ) >> 8 ;
+    }
 
-    if ( !mode7->id ) return ;
+    if ( r > 0x00ff0000 ) r = 0x00ff0000 ; else r &= 0x00ff0000 ;
+    if ( g > 0x0000ff00 ) g = 0x0000ff00 ; else g &= 0x0000ff00 ;
+    if ( b > 0x000000ff ) b = 0x000000ff ; else b &= 0x000000ff ;
 
-    int horizon_y   = -1;
-    int jump ;
+    return ( MAX( c32 & 0xff000000, d32 & 0xff000000 ) ) | r | g | b ;
+}
 
-    int outdoor_hmask = 0 ;
-    int outdoor_vmask = 0 ;
+/* --------------------------------------------------------------------------- */
+/*
+ *  FUNCTION : m7_inside
+ *
+ *  Find the steps of a line where a coordinate is inside a map side,
+ *  that is, fixtoi( pos + n * inc ) is in [0, size) for n in [*from, *to)
+ *
+ *  PARAMS :
+ *      pos             Fixed point coordinate of the first pixel
+ *      inc             Fixed point increment per pixel
+ *      size            Size of the map side
+ *      count           Pixels of the line
+ *      from, to        Steps inside the map
+ *
+ *  RETURN VALUE :
+ *      None
+ *
+ */
 
-    uint32_t  sx, sy ;
-    int x, y, z, height, width ;
-    uint8_t  * ptr  , * baseline  , c ;
-    uint16_t * ptr16,               c16 ;
-    uint32_t * ptr32,               c32 ;
+static void m7_inside( fixed pos, fixed inc, int size, int count, int * from, int * to )
+{
+    fixed lo = -FIXED_PREC ;                /* fixtoi truncates, ( -1, 0 ) is 0 */
+    fixed hi = ( fixed ) size * FIXED_PREC ;
+    fixed a, b ;
 
-    GRAPH * indoor  = mode7->indoor ;
-    GRAPH * outdoor = mode7->outdoor ;
-    GRAPH * dest ;
-    GRAPH * pgr ;
+    if ( inc > 0 )
+    {
+        a = ( pos > lo ) ? 0 : ( lo - pos ) / inc + 1 ;
+        b = ( pos >= hi ) ? 0 : ( hi - pos + inc - 1 ) / inc ;
+    }
+    else if ( inc < 0 )
+    {
+        a = ( pos < hi ) ? 0 : ( pos - hi ) / -inc + 1 ;
+        b = ( pos <= lo ) ? 0 : ( pos - lo - inc - 1 ) / -inc ;
+    }
+    else
+    {
+        a = 0 ;
+        b = ( pos > lo && pos < hi ) ? count : 0 ;
+    }
 
-    MODE7_INFO * dat  = &(( MODE7_INFO * ) & GLODWORD( mod_m7, M7STRUCTS ) )[n] ;
+    if ( a > count ) a = count ;
+    if ( b > count ) b = count ;
+    if ( b < a ) b = a ;
 
-    INSTANCE   * camera ;
+    *from = a ;
+    *to = b ;
+}
 
-    static INSTANCE ** proclist = 0  ;
-    static int proclist_reserved = 0 ;
-    int proclist_count, nproc ;
+/* --------------------------------------------------------------------------- */
 
-    INSTANCE * i ;
+/* Comprueba que las coordenadas de una línea no desbordan, ni al sumar los
+ * incrementos ni al pasarlas a entero, así que fixtoi es monótona en ella */
 
-    dest = mode7->dest ? mode7->dest : scrbitmap ;
+static int m7_linear( fixed pos, fixed inc, int count )
+{
+    fixed end ;
 
-    /* only if scr_depth == outdoor depth == indoor_depth */
-    if ( ( outdoor && outdoor->format->depth != dest->format->depth ) ||
-         (  indoor &&  indoor->format->depth != dest->format->depth ) ) return;
+    if ( pos <= -( LONG_MAX / 2 ) || pos >= LONG_MAX / 2 || inc <= -( LONG_MAX / 2 ) / count || inc >= ( LONG_MAX / 2 ) / count ) return 0 ;
 
-    /* Averigua la posición inicial de dibujo */
+    end = pos + inc * ( count - 1 ) ;
 
-    camera = instance_get( dat->camera_id ) ;
-    if ( !camera ) return ;
+    return pos / FIXED_PREC > -( INT_MAX / 2 ) && pos / FIXED_PREC < INT_MAX / 2 &&
+           end / FIXED_PREC > -( INT_MAX / 2 ) && end / FIXED_PREC < INT_MAX / 2 ;
+}
 
-    angle = LOCINT32( mod_m7, camera, ANGLE ) ;
+/* --------------------------------------------------------------------------- */
 
-    cosa = fixcos( -angle ) ;
-    sina = fixsin( -angle ) ;
+/* Dibuja una línea. PUT escribe un texel, PUT16 16 bytes de texels o nada.
+ * Sin from < 0 se comprueban los límites del mapa interior en cada pixel */
+
+#define M7_LINE(name,type,shift,PUT,PUT16) \
+static void name( MODE7_DRAW * d, type * ptr, fixed bmp_x, fixed bmp_y, fixed hinc, fixed vinc, int from, int to ) \
+{ \
+    GRAPH * indoor = d->mode7->indoor, * outdoor = d->mode7->outdoor ; \
+    int hmask = d->outdoor_hmask, vmask = d->outdoor_vmask ; \
+    type * end = ptr + d->width, * stop ; \
+    type texel[ 16 / sizeof( type ) ] ; \
+    uint32_t sx, sy ; \
+    type c = d->dat->color ; \
+    int n ; \
+ \
+    ( void ) texel ; ( void ) n ; \
+ \
+    if ( from < 0 ) \
+    { \
+        for ( ; ptr < end ; ptr++ ) \
+        { \
+            sx = M7_FIXTOI( bmp_x ) ; \
+            sy = M7_FIXTOI( bmp_y ) ; \
+ \
+            if ( indoor && sx < indoor->width && sy < indoor->height ) c = M7_TEXEL( type, shift, indoor, sx, sy ) ; \
+            else if ( outdoor ) c = M7_TEXEL( type, shift, outdoor, sx & hmask, sy & vmask ) ; \
+            else c = d->dat->color ; \
+            PUT( ptr, c ) ; \
+ \
+            bmp_x += hinc ; \
+            bmp_y += vinc ; \
+        } \
+        return ; \
+    } \
+ \
+    M7_OUTSIDE( type, shift, PUT, PUT16, ptr + from ) ; \
+ \
+    stop = ptr + ( to - from ) ; \
+    PUT16( type, shift, indoor, sx, sy ) ; \
+    for ( ; ptr < stop ; ptr++ ) \
+    { \
+        sx = M7_FIXTOI( bmp_x ) ; \
+        sy = M7_FIXTOI( bmp_y ) ; \
+        c = M7_TEXEL( type, shift, indoor, sx, sy ) ; \
+        PUT( ptr, c ) ; \
+        bmp_x += hinc ; \
+        bmp_y += vinc ; \
+    } \
+ \
+    M7_OUTSIDE( type, shift, PUT, PUT16, end ) ; \
+}
 
-    /* Averigua la posición de inicio */
+#define M7_OUTSIDE(type,shift,PUT,PUT16,limit) \
+    stop = limit ; \
+    if ( outdoor ) \
+    { \
+        PUT16( type, shift, outdoor, sx & hmask, sy & vmask ) ; \
+        for ( ; ptr < stop ; ptr++ ) \
+        { \
+            sx = M7_FIXTOI( bmp_x ) ; \
+            sy = M7_FIXTOI( bmp_y ) ; \
+            c = M7_TEXEL( type, shift, outdoor, sx & hmask, sy & vmask ) ; \
+            PUT( ptr, c ) ; \
+            bmp_x += hinc ; \
+            bmp_y += vinc ; \
+        } \
+    } \
+    else \
+    { \
+        c = d->dat->color ; \
+        bmp_x += hinc * ( stop - ptr ) ; \
+        bmp_y += vinc * ( stop - ptr ) ; \
+        for ( ; ptr < stop ; ptr++ ) PUT( ptr, c ) ; \
+    }
 
-    camera_x = itofix( LOCINT32( mod_m7, camera, COORDX ) ) ;
-    camera_y = itofix( LOCINT32( mod_m7, camera, COORDY ) ) ;
-    camera_z = itofix( dat->height ) ;
+/* Lee los texels de 16 bytes de pixels de una vez mientras quepan */
+
+#if defined( M7_SSE2 ) || defined( M7_NEON )
+#define M7_GATHER(type,shift,map,SX,SY) \
+        for ( ; ptr + 16 / sizeof( type ) <= stop ; ptr += 16 / sizeof( type ) ) \
+        { \
+            for ( n = 0 ; n < 16 / sizeof( type ) ; n++ ) \
+            { \
+                sx = M7_FIXTOI( bmp_x ) ; \
+                sy = M7_FIXTOI( bmp_y ) ; \
+                texel[n] = M7_TEXEL( type, shift, map, SX, SY ) ; \
+                bmp_x += hinc ; \
+                bmp_y += vinc ; \
+            } \
+            m7_put16_##type( ptr, texel ) ; \
+        }
+#else
+#define M7_GATHER(type,shift,map,SX,SY)
+#endif
 
-    RESOLXY( mod_m7, camera, camera_x, camera_y );
+#define M7_NOGATHER(type,shift,map,SX,SY)
 
-    camera_x -= cosa * dat->distance ;
-    camera_y -= sina * dat->distance ;
+#define M7_PUT(ptr,c)       if ( c ) *( ptr ) = c
+#define M7_PUT_T8(ptr,c)    *( ptr ) = trans_table[c][*( ptr )]
+#define M7_PUT_T16(ptr,c)   *( ptr ) = colorghost[*( ptr )] + colorghost[c]
+#define M7_PUT_T32(ptr,c)   *( ptr ) = m7_blend32( c, *( ptr ) )
 
-    if ( dat->flags & B_VMIRROR ) camera_z = -camera_z ;
+#define m7_put16_uint16_t   m7_put16_16
+#define m7_put16_uint32_t   m7_put16_32
 
-    /* Bucle para sacar las sub-posiciones de cada línea */
+M7_LINE( draw_line8,   uint8_t,  0, M7_PUT,     M7_NOGATHER )
+M7_LINE( draw_line16,  uint16_t, 1, M7_PUT,     M7_GATHER   )
+M7_LINE( draw_line32,  uint32_t, 2, M7_PUT,     M7_GATHER   )
+M7_LINE( draw_line_t8,  uint8_t,  0, M7_PUT_T8,  M7_NOGATHER )
+M7_LINE( draw_line_t16, uint16_t, 1, M7_PUT_T16, M7_NOGATHER )
+M7_LINE( draw_line_t32, uint32_t, 2, M7_PUT_T32, M7_NOGATHER )
 
-    width  = mode7->region->x2 - mode7->region->x + 1 ;
-    height = mode7->region->y2 - mode7->region->y + 1 ;
+/* --------------------------------------------------------------------------- */
+
+static void draw_mode7_lines( MODE7_DRAW * d, int first, int last )
+{
+    GRAPH * indoor = d->mode7->indoor ;
+    LINEINFO * line ;
+    fixed bmp_x, bmp_y, hinc, vinc ;
+    int k, y, from, to, from2, to2 ;
+    int translucent = d->dat->flags & B_TRANSLUCENT ;
+    int pitch = ( d->jump > 0 ) ? d->dest->pitch : -( int )d->dest->pitch ;
+    uint8_t * ptr = d->first_ptr + first * pitch ;
+
+    for ( k = first ; k < last ; k++, ptr += pitch )
+    {
+        y = d->first_y + k * d->jump ;
+        line = &d->mode7->lines[y] ;
 
-    if ( !height || !width ) return ;
+        if ( d->dat->flags & B_HMIRROR )
+        {
+            bmp_x = line->right_bmp_x + d->camera_x ;
+            bmp_y = line->right_bmp_y + d->camera_y ;
+            hinc  = -line->hinc ;
+            vinc  = -line->vinc ;
+        }
+        else
+        {
+            bmp_x = line->left_bmp_x + d->camera_x ;
+            bmp_y = line->left_bmp_y + d->camera_y ;
+            hinc  = line->hinc ;
+            vinc  = line->vinc ;
+        }
 
-//    horizon_y = 0 ;
+        /* Los tramos sólo sirven si las coordenadas no desbordan en la línea */
+
+        from = -1 ;
+        to = -1 ;
+
+        if ( m7_linear( bmp_x, hinc, d->width ) && m7_linear( bmp_y, vinc, d->width ) )
+        {
+            if ( indoor )
+            {
+                m7_inside( bmp_x, hinc, indoor->width, d->width, &from, &to ) ;
+                m7_inside( bmp_y, vinc, indoor->height, d->width, &from2, &to2 ) ;
+                if ( from < from2 ) from = from2 ;
+                if ( to > to2 ) to = to2 ;
+                if ( to < from ) to = from ;
+            }
+            else
+            {
+                from = to = d->width ;
+            }
+        }
+
+        switch ( d->dest->format->depth )
+        {
+            case    8:
+                    if ( translucent ) draw_line_t8( d, ( uint8_t * ) ptr, bmp_x, bmp_y, hinc, vinc, from, to ) ;
+                    else               draw_line8( d, ( uint8_t * ) ptr, bmp_x, bmp_y, hinc, vinc, from, to ) ;
+                    break ;
+
+            case    16:
+                    if ( translucent ) draw_line_t16( d, ( uint16_t * ) ptr, bmp_x, bmp_y, hinc, vinc, from, to ) ;
+                    else               draw_line16( d, ( uint16_t * ) ptr, bmp_x, bmp_y, hinc, vinc, from, to ) ;
+                    break ;
+
+            case    32:
+                    if ( translucent ) draw_line_t32( d, ( uint32_t * ) ptr, bmp_x, bmp_y, hinc, vinc, from, to ) ;
+                    else               draw_line32( d, ( uint32_t * ) ptr, bmp_x, bmp_y, hinc, vinc, from, to ) ;
+                    break ;
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void draw_mode7_band( int worker, void * data )
+{
+    MODE7_DRAW * d = ( MODE7_DRAW * ) data ;
+
+    draw_mode7_lines( d, d->count * worker / render_threads, d->count * ( worker + 1 ) / render_threads ) ;
+}
+
+/* --------------------------------------------------------------------------- */
+/*
+ *  FUNCTION : update_mode7_lines
+ *
+ *  Calculate the position of the sides of every line, relative to the
+ *  camera, if the view has changed since the last frame
+ *
+ *  RETURN VALUE :
+ *      Line of the horizon or -1 if there is none
+ *
+ */
+
+static int update_mode7_lines( MODE7 * mode7, MODE7_INFO * dat, int angle, fixed camera_z, int width, int height )
+{
+    fixed   base_x, base_y, base_z ;
+    fixed   point_x, point_y, point_z ;
+    fixed   cosa, sina ;
+    LINEINFO * lines = mode7->lines ;
+    int y ;
+
+    if ( mode7->lines_ok &&
+         mode7->lines_angle == angle && mode7->lines_camera_z == camera_z && mode7->lines_focus == dat->focus &&
+         mode7->lines_width == width && mode7->lines_height == height )
+        return mode7->lines_horizon ;
+
+    cosa = fixcos( -angle ) ;
+    sina = fixsin( -angle ) ;
+
+    mode7->lines_horizon = -1 ;
 
     for ( y = height ; y >= 0 ; y-- )
     {
@@ -518,24 +617,30 @@ static void draw_mode7( int n, REGION * clip )
         base_y = -itofix( dat->focus / 2 ) ;
         base_z = itofix( dat->focus / 2 ) - itofix( y * dat->focus / height ) ;
 
-        /* Rota dicho punto según el ángulo del proceso */
+        /* Rota dicho punto según el ángulo del proceso, la cámara está en el origen */
 
-        point_x = ROTATEDX( base_x, base_y, sina, cosa ) + camera_x ;
-        point_y = ROTATEDY( base_x, base_y, sina, cosa ) + camera_y ;
+        point_x = ROTATEDX( base_x, base_y, sina, cosa ) ;
+        point_y = ROTATEDY( base_x, base_y, sina, cosa ) ;
         point_z = base_z + camera_z ;
 
         /* Aplica la fórmula (ver mode7.txt) */
 
         if ( point_z == camera_z )
         {
-            horizon_y = y ;
+            /* Varias líneas pueden caer en el horizonte, las que se llegan
+             * a dibujar usan la línea de debajo */
+
+            if ( y < height ) lines[y] = lines[y + 1] ;
+            else              memset( &lines[y], 0, sizeof( LINEINFO ) ) ;
+
+            mode7->lines_horizon = y ;
             continue ;
         }
 
         //if (point_z >= camera_z) break ;
 
-        lines[y].left_bmp_x = fixdiv( fixmul(( point_x - camera_x ), -camera_z ), ( point_z - camera_z ) ) + camera_x ;
-        lines[y].left_bmp_y = fixdiv( fixmul(( point_y - camera_y ), -camera_z ), ( point_z - camera_z ) ) + camera_y ;
+        lines[y].left_bmp_x = fixdiv( fixmul( point_x, -camera_z ), ( point_z - camera_z ) ) ;
+        lines[y].left_bmp_y = fixdiv( fixmul( point_y, -camera_z ), ( point_z - camera_z ) ) ;
 
         /* Lo mismo para el punto (width,y) */
 
@@ -543,14 +648,14 @@ static void draw_mode7( int n, REGION * clip )
         base_y = itofix( dat->focus / 2 ) ;
         base_z = itofix( dat->focus / 2 ) - itofix( y * dat->focus / height ) ;
 
-        point_x = ROTATEDX( base_x, base_y, sina, cosa ) + camera_x ;
-        point_y = ROTATEDY( base_x, base_y, sina, cosa ) + camera_y ;
+        point_x = ROTATEDX( base_x, base_y, sina, cosa ) ;
+        point_y = ROTATEDY( base_x, base_y, sina, cosa ) ;
         point_z = base_z + camera_z ;
 
         //if (point_z >= camera_z) break ;
 
-        lines[y].right_bmp_x = fixdiv( fixmul(( point_x - camera_x ), -camera_z ), ( point_z - camera_z ) ) + camera_x ;
-        lines[y].right_bmp_y = fixdiv( fixmul(( point_y - camera_y ), -camera_z ), ( point_z - camera_z ) ) + camera_y ;
+        lines[y].right_bmp_x = fixdiv( fixmul( point_x, -camera_z ), ( point_z - camera_z ) ) ;
+        lines[y].right_bmp_y = fixdiv( fixmul( point_y, -camera_z ), ( point_z - camera_z ) ) ;
 
         /* Averigua el incremento necesario para cada paso de la línea */
 
@@ -558,288 +663,199 @@ static void draw_mode7( int n, REGION * clip )
         lines[y].vinc = ( lines[y].right_bmp_y - lines[y].left_bmp_y ) / width ;
     }
 
+    mode7->lines_ok = 1 ;
+    mode7->lines_angle = angle ;
+    mode7->lines_camera_z = camera_z ;
+    mode7->lines_focus = dat->focus ;
+    mode7->lines_width = width ;
+    mode7->lines_height = height ;
+
+    return mode7->lines_horizon ;
+}
+
+/* --------------------------------------------------------------------------- */
+
+static void draw_mode7( int n, REGION * clip )
+{
+    fixed   bmp_x, bmp_y ;
+    fixed   base_x,   base_y,   base_z ;
+    fixed   camera_x, camera_y, camera_z ;
+    fixed   cosa,  sina  ;
+    fixed   angle ;
+
+    if ( n < 0 || n > 9 ) return ;
+
+    MODE7 * mode7 = &mode7_inf[n];
+
+    if ( !mode7->id ) return ;
+
+    int horizon_y ;
+    int jump ;
+
+    int x, y, z, height, width ;
+
+    GRAPH * indoor  = mode7->indoor ;
+    GRAPH * outdoor = mode7->outdoor ;
+    GRAPH * dest ;
+    GRAPH * pgr ;
+
+    MODE7_INFO * dat  = &(( MODE7_INFO * ) & GLODWORD( mod_m7, M7STRUCTS ) )[n] ;
+    MODE7_DRAW draw ;
+
+    INSTANCE   * camera ;
+
+    int proclist_count, nproc, count ;
+
+    INSTANCE * i, ** list, ** new_proclist ;
+
+    dest = mode7->dest ? mode7->dest : scrbitmap ;
+
+    /* only if scr_depth == outdoor depth == indoor_depth */
+    if ( ( outdoor && outdoor->format->depth != dest->format->depth ) ||
+         (  indoor &&  indoor->format->depth != dest->format->depth ) ) return;
+
+    /* Averigua la posición inicial de dibujo */
+
+    camera = instance_get( dat->camera_id ) ;
+    if ( !camera ) return ;
+
+    angle = LOCINT32( mod_m7, camera, ANGLE ) ;
+
+    cosa = fixcos( -angle ) ;
+    sina = fixsin( -angle ) ;
+
+    /* Averigua la posición de inicio */
+
+    camera_x = itofix( LOCINT32( mod_m7, camera, COORDX ) ) ;
+    camera_y = itofix( LOCINT32( mod_m7, camera, COORDY ) ) ;
+    camera_z = itofix( dat->height ) ;
+
+    RESOLXY( mod_m7, camera, camera_x, camera_y );
+
+    camera_x -= cosa * dat->distance ;
+    camera_y -= sina * dat->distance ;
+
+    if ( dat->flags & B_VMIRROR ) camera_z = -camera_z ;
+
+    /* Sub-posiciones de cada línea */
+
+    width  = mode7->region->x2 - mode7->region->x + 1 ;
+    height = mode7->region->y2 - mode7->region->y + 1 ;
+
+    if ( !height || !width || height > MAX_LINES ) return ;
+
+//    horizon_y = 0 ;
+
+    horizon_y = update_mode7_lines( mode7, dat, angle, camera_z, width, height ) ;
+
     /* Bucle principal */
 
     if ( horizon_y == -1 ) return ;
 
-    y = horizon_y ;
-    ptr32 = ( uint32_t * ) ( ptr16 = ( uint16_t * ) ( ptr = ( uint8_t * )dest->data + dest->pitch * y + mode7->region->x ) ) ;
+    draw.mode7 = mode7 ;
+    draw.dat = dat ;
+    draw.dest = dest ;
+    draw.camera_x = camera_x ;
+    draw.camera_y = camera_y ;
+    draw.width = width ;
+
+    draw.outdoor_hmask = 0 ;
+    draw.outdoor_vmask = 0 ;
 
     if ( outdoor )
     {
-        outdoor_hmask = outdoor_vmask = 0xFFFFFFFF ;
-        while ( ~( outdoor_hmask << 1 ) < ( int )outdoor->width - 1 ) outdoor_hmask <<= 1 ;
-        while ( ~( outdoor_vmask << 1 ) < ( int )outdoor->height - 1 ) outdoor_vmask <<= 1 ;
-        outdoor_hmask = ~outdoor_hmask ;
-        outdoor_vmask = ~outdoor_vmask ;
+        draw.outdoor_hmask = draw.outdoor_vmask = 0xFFFFFFFF ;
+        while ( ~( draw.outdoor_hmask << 1 ) < ( int )outdoor->width - 1 ) draw.outdoor_hmask <<= 1 ;
+        while ( ~( draw.outdoor_vmask << 1 ) < ( int )outdoor->height - 1 ) draw.outdoor_vmask <<= 1 ;
+        draw.outdoor_hmask = ~draw.outdoor_hmask ;
+        draw.outdoor_vmask = ~draw.outdoor_vmask ;
     }
 
     jump = ( camera_z < 0 ) ? -1 : 1 ;
-    ptr32 = ( uint32_t * ) ( ptr16 = ( uint16_t * ) ( ptr += (( jump > 0 ) ? dest->pitch : -( int )dest->pitch ) ) ) ;
-    y   += jump ;
 
-    if ( !( dat->flags & B_TRANSLUCENT ) )
+    draw.jump = jump ;
+    draw.first_y = horizon_y + jump ;
+    draw.count = ( jump > 0 ) ? height - draw.first_y : draw.first_y + 1 ;
+    draw.first_ptr = ( uint8_t * )dest->data + dest->pitch * draw.first_y + mode7->region->x ;
+
+    if ( draw.count > 0 )
     {
-        if ( dat->flags & B_HMIRROR )
-        {
-            switch( dest->format->depth )
-            {
-                case    8:
-                        for ( ; y < height && y >= 0 ; y += jump )
-                        {
-                            bmp_x = lines[y].right_bmp_x ;
-                            bmp_y = lines[y].right_bmp_y ;
-                            hinc  = -lines[y].hinc ;
-                            vinc  = -lines[y].vinc ;
-
-                            M7_8bpp();
-                        }
-                        break;
-
-                case    16:
-                        for ( ; y < height && y >= 0 ; y += jump )
-                        {
-                            bmp_x = lines[y].right_bmp_x ;
-                            bmp_y = lines[y].right_bmp_y ;
-                            hinc  = -lines[y].hinc ;
-                            vinc  = -lines[y].vinc ;
-
-                            M7_16bpp();
-                        }
-                        break;
-
-                case    32:
-                        for ( ; y < height && y >= 0 ; y += jump )
-                        {
-                            bmp_x = lines[y].right_bmp_x ;
-                            bmp_y = lines[y].right_bmp_y ;
-                            hinc  = -lines[y].hinc ;
-                            vinc  = -lines[y].vinc ;
-
-                            M7_32bpp();
-                        }
-                        break;
-            }
-        }
-        else
-        {
-            switch( dest->format->depth )
-            {
-                case    8:
-                        for ( ; y < height && y >= 0 ; y += jump )
-                        {
-                            bmp_x = lines[y].left_bmp_x ;
-                            bmp_y = lines[y].left_bmp_y ;
-                            hinc  = lines[y].hinc ;
-                            vinc  = lines[y].vinc ;
-
-                            M7_8bpp();
-                        }
-                        break;
-
-                case    16:
-                        for ( ; y < height && y >= 0 ; y += jump )
-                        {
-                            bmp_x = lines[y].left_bmp_x ;
-                            bmp_y = lines[y].left_bmp_y ;
-                            hinc  = lines[y].hinc ;
-                            vinc  = lines[y].vinc ;
-
-                            M7_16bpp();
-                        }
-                        break;
-
-                case    32:
-                        for ( ; y < height && y >= 0 ; y += jump )
-                        {
-                            bmp_x = lines[y].left_bmp_x ;
-                            bmp_y = lines[y].left_bmp_y ;
-                            hinc  = lines[y].hinc ;
-                            vinc  = lines[y].vinc ;
-
-                            M7_32bpp();
-                        }
-                        break;
-            }
-        }
-    }
-    else /* translucent */
-    {
-        if ( dat->flags & B_HMIRROR )
-        {
-            switch( dest->format->depth )
-            {
-                case    8:
-                        for ( ; y < height && y >= 0 ; y += jump )
-                        {
-                            bmp_x = lines[y].right_bmp_x ;
-                            bmp_y = lines[y].right_bmp_y ;
-                            hinc  = -lines[y].hinc ;
-                            vinc  = -lines[y].vinc ;
-
-                            M7_t8bpp();
-                        }
-                        break;
-
-                case    16:
-                        for ( ; y < height && y >= 0 ; y += jump )
-                        {
-                            bmp_x = lines[y].right_bmp_x ;
-                            bmp_y = lines[y].right_bmp_y ;
-                            hinc  = -lines[y].hinc ;
-                            vinc  = -lines[y].vinc ;
-
-                            M7_t16bpp();
-                        }
-                        break;
-
-                case    32:
-                    {
-                        unsigned int _f, _f2;
-                        int r, g, b;
-
-                        for ( ; y < height && y >= 0 ; y += jump )
-                        {
-                            bmp_x = lines[y].right_bmp_x ;
-                            bmp_y = lines[y].right_bmp_y ;
-                            hinc  = -lines[y].hinc ;
-                            vinc  = -lines[y].vinc ;
-
-                            M7_t32bpp();
-                        }
-                        break;
-                    }
-            }
-        }
-        else
-        {
-            switch( dest->format->depth )
-            {
-                case    8:
-                        for ( ; y < height && y >= 0 ; y += jump )
-                        {
-                            bmp_x = lines[y].left_bmp_x ;
-                            bmp_y = lines[y].left_bmp_y ;
-                            hinc  = lines[y].hinc ;
-                            vinc  = lines[y].vinc ;
-
-                            M7_t8bpp();
-                        }
-                        break;
-
-                case    16:
-                        for ( ; y < height && y >= 0 ; y += jump )
-                        {
-                            bmp_x = lines[y].left_bmp_x ;
-                            bmp_y = lines[y].left_bmp_y ;
-                            hinc  = lines[y].hinc ;
-                            vinc  = lines[y].vinc ;
-
-                            M7_t16bpp();
-                        }
-                        break;
-
-                case    32:
-                    {
-                        unsigned int _f, _f2;
-                        int r, g, b;
-
-                        for ( ; y < height && y >= 0 ; y += jump )
-                        {
-                            bmp_x = lines[y].left_bmp_x ;
-                            bmp_y = lines[y].left_bmp_y ;
-                            hinc  = lines[y].hinc ;
-                            vinc  = lines[y].vinc ;
-
-                            M7_t32bpp();
-                        }
-                        break;
-                    }
-            }
-        }
+        if ( render_threads > 1 ) gr_render_threads_run( draw_mode7_band, &draw ) ;
+        else                      draw_mode7_lines( &draw, 0, draw.count ) ;
     }
 
-    /* Crea una lista ordenada de instancias a dibujar */
+    /* Crea una lista ordenada de instancias a dibujar, partiendo del orden
+       del frame anterior */
 
-    i = first_instance ;
+    list = instance_ctype_list( C_M7, &count ) ;
     proclist_count = 0 ;
-    while ( i )
+
+    if ( count > proclist_reserved )
     {
-        if (
-            (
-                ( LOCDWORD( mod_m7, i, STATUS ) & ~STATUS_WAITING_MASK ) == STATUS_RUNNING ||
-                ( LOCDWORD( mod_m7, i, STATUS ) & ~STATUS_WAITING_MASK ) == STATUS_FROZEN
-            )
-            && LOCDWORD( mod_m7, i, CTYPE ) == C_M7 )
-        {
-            if ( LOCDWORD( mod_m7, i, CNUMBER ) && !( LOCDWORD( mod_m7, i, CNUMBER ) & ( 1 << n ) ) )
-            {
-                i = i->next ;
-                continue ;
-            }
+        new_proclist = ( INSTANCE ** ) bgd_realloc( proclist, sizeof( INSTANCE * ) * count ) ;
+        if ( !new_proclist ) return ;
 
-            if ( proclist_count == proclist_reserved )
-            {
-                proclist_reserved += 16 ;
-                proclist = ( INSTANCE ** ) bgd_realloc( proclist, sizeof( INSTANCE * ) * proclist_reserved ) ;
-            }
+        proclist = new_proclist ;
+        proclist_reserved = count ;
+    }
 
-            /* Averigua la distancia a la cámara */
+    for ( nproc = 0 ; nproc < count ; nproc++ )
+    {
+        i = list[nproc] ;
 
-            x = LOCINT32( mod_m7, i, COORDX ) ;
-            y = LOCINT32( mod_m7, i, COORDY ) ;
+        if ( LOCDWORD( mod_m7, i, CNUMBER ) && !( LOCDWORD( mod_m7, i, CNUMBER ) & ( 1 << n ) ) ) continue ;
 
-            RESOLXY( mod_m7, i, x, y );
+        /* Averigua la distancia a la cámara */
 
-            x -= fixtoi( camera_x ) ;
-            y -= fixtoi( camera_y ) ;
+        x = LOCINT32( mod_m7, i, COORDX ) ;
+        y = LOCINT32( mod_m7, i, COORDY ) ;
 
-            LOCINT32( mod_m7, i, DISTANCE_1 ) = ftofix( sqrt(( double )(x * x) + ( double )(y * y) ) ) ;
+        RESOLXY( mod_m7, i, x, y );
 
-            proclist[proclist_count++] = i ;
-        }
-        i = i->next ;
+        x -= fixtoi( camera_x ) ;
+        y -= fixtoi( camera_y ) ;
+
+        LOCINT32( mod_m7, i, DISTANCE_1 ) = ftofix( sqrt(( double )(x * x) + ( double )(y * y) ) ) ;
+
+        proclist[proclist_count++] = i ;
     }
 
-    if ( proclist_count )
-    {
-        /* Ordena la listilla */
+    instance_list_sort( &mode7_instances[n], proclist, proclist_count, compare_by_distance ) ;
 
-        qsort( proclist, proclist_count, sizeof( INSTANCE * ), compare_by_distance ) ;
+    /* Visualiza los procesos */
 
-        /* Visualiza los procesos */
+    for ( nproc = 0 ; nproc < mode7_instances[n].count ; nproc++ )
+    {
+        i = mode7_instances[n].items[nproc] ;
 
-        for ( nproc = 0 ; nproc < proclist_count ; nproc++ )
-        {
-            pgr = instance_graph( proclist[nproc] ) ;
-            if ( !pgr ) continue ;
+        pgr = instance_graph( i ) ;
+        if ( !pgr ) continue ;
 
-            if ( LOCINT32( mod_m7, proclist[nproc], DISTANCE_1 ) <= 0 ) continue ;
+        if ( LOCINT32( mod_m7, i, DISTANCE_1 ) <= 0 ) continue ;
 
-            base_x = itofix( LOCINT32( mod_m7, proclist[nproc], COORDX ) ) ;
-            base_y = itofix( LOCINT32( mod_m7, proclist[nproc], COORDY ) ) ;
-            base_z = itofix( LOCINT32( mod_m7, proclist[nproc], HEIGHT ) ) ;
+        base_x = itofix( LOCINT32( mod_m7, i, COORDX ) ) ;
+        base_y = itofix( LOCINT32( mod_m7, i, COORDY ) ) ;
+        base_z = itofix( LOCINT32( mod_m7, i, HEIGHT ) ) ;
 
-            RESOLXYZ( mod_m7, proclist[nproc], base_x, base_y, base_z );
+        RESOLXYZ( mod_m7, i, base_x, base_y, base_z );
 
-            base_x = /*itofix( */base_x /*)*/ - camera_x ;
-            base_y = /*itofix( */base_y /*)*/ - camera_y ;
-            base_z = /*itofix( */base_z /*)*/ + /*dat->*/height - camera_z  ;
+        base_x = /*itofix( */base_x /*)*/ - camera_x ;
+        base_y = /*itofix( */base_y /*)*/ - camera_y ;
+        base_z = /*itofix( */base_z /*)*/ + /*dat->*/height - camera_z  ;
 
-            x = ROTATEDX( base_x, base_y, cosa, sina ) ;
-            y = ROTATEDY( base_x, base_y, cosa, sina ) ;
-            z = base_z ;
+        x = ROTATEDX( base_x, base_y, cosa, sina ) ;
+        y = ROTATEDY( base_x, base_y, cosa, sina ) ;
+        z = base_z ;
 
-            if ( y <= 0 ) continue ;
+        if ( y <= 0 ) continue ;
 
-            bmp_x = ( long )( -(( float )dat->focus /*FOCAL_DIST*/ * fixtof( x ) / fixtof( y ) ) * ( float )width / ( float ) dat->focus ) ;
-            bmp_y = ( long )( -(( float )dat->focus /*FOCAL_DIST*/ * fixtof( z ) / fixtof( y ) ) * ( float )height / ( float ) dat->focus ) ;
+        bmp_x = ( long )( -(( float )dat->focus /*FOCAL_DIST*/ * fixtof( x ) / fixtof( y ) ) * ( float )width / ( float ) dat->focus ) ;
+        bmp_y = ( long )( -(( float )dat->focus /*FOCAL_DIST*/ * fixtof( z ) / fixtof( y ) ) * ( float )height / ( float ) dat->focus ) ;
 
-            x = LOCINT32( mod_m7, proclist[nproc], GRAPHSIZE ) ;
-            LOCINT32( mod_m7, proclist[nproc], GRAPHSIZE ) = dat->focus * 8 / fixtof( LOCDWORD( mod_m7, proclist[nproc], DISTANCE_1 ) ) ;
-            draw_instance_at( proclist[nproc], mode7->region, mode7->region->x + width / 2  + bmp_x, mode7->region->y + height / 2 + bmp_y, mode7->dest ) ;
-            LOCINT32( mod_m7, proclist[nproc], GRAPHSIZE ) = x ;
-        }
+        x = LOCINT32( mod_m7, i, GRAPHSIZE ) ;
+        LOCINT32( mod_m7, i, GRAPHSIZE ) = dat->focus * 8 / fixtof( LOCDWORD( mod_m7, i, DISTANCE_1 ) ) ;
+        draw_instance_at( i, mode7->region, mode7->region->x + width / 2  + bmp_x, mode7->region->y + height / 2 + bmp_y, mode7->dest ) ;
+        LOCINT32( mod_m7, i, GRAPHSIZE ) = x ;
     }
 }
 
@@ -882,6 +898,7 @@ static int __m7_start( int n, int fileid, int inid, int outid, int region, int h
     mode7_inf[n].indoor  = inid ? bitmap_get( fileid, inid ) : NULL ;
     mode7_inf[n].outdoor = outid ? bitmap_get( fileid, outid ) : NULL ;
     mode7_inf[n].region  = region_get( region ) ;
+    mode7_inf[n].lines_ok = 0 ;
 
     if ( mode7_inf[n].id ) gr_destroy_object( mode7_inf[n].id );
     mode7_inf[n].id = gr_new_object( dat->z, ( OBJ_INFO * ) info_mode7, ( OBJ_DRAW * ) draw_mode7, ( void * )(size_t)n );
@@ -917,6 +934,40 @@ static int modm7_stop( INSTANCE * my, int * params )
     return 1 ;
 }
 
+/* --------------------------------------------------------------------------- */
+/* Save states                                                                 */
+
+/* Se guardan los punteros al heap de cada modo 7 (objeto, region y graficos).
+   La cache de lineas no, se recalcula en el siguiente frame */
+
+static void modm7_savestate_loaded()
+{
+    int n ;
+
+    for ( n = 0 ; n < 10 ; n++ ) mode7_inf[n].lines_ok = 0 ;
+}
+
+void __bgdexport( mod_m7, module_initialize )()
+{
+    int n ;
+
+    for ( n = 0 ; n < 10 ; n++ ) savestate_register( &mode7_inf[n], offsetof( MODE7, lines_ok ) ) ;
+    savestate_check_field( mode7_inf, region ) ;
+    savestate_check_field( mode7_inf, indoor ) ;
+    savestate_check_field( mode7_inf, outdoor ) ;
+    savestate_check_field( mode7_inf, dest ) ;
+
+    savestate_register_var( mode7_instances ) ;
+    savestate_check_field( mode7_instances, items ) ;
+    savestate_check_field( mode7_instances, sorted ) ;
+    savestate_check_field( mode7_instances, hash ) ;
+
+    savestate_register_ptr( proclist ) ;
+    savestate_register_var( proclist_reserved ) ;
+
+    savestate_add_load_hook( modm7_savestate_loaded ) ;
+}
+
 /* ----------------------------------------------------------------- */
 /* exports                                                           */
 /* ----------------------------------------------------------------- */
@@ -134,7 +134,7 @@ static GRAPH * gr_read_map( file * fp )
     gr->format->palette = pal;
 /*    pal_use( pal ); */
 
-    gr->modified = 0 ;
+    bitmap_clear_modified( gr );
     bitmap_analize( gr );
 
     return gr ;
@@ -167,7 +167,7 @@ GRAPH * gr_read_pcx( const char * filename )
         return NULL;
     }
 
-    bitmap->modified = 0 ;
+    bitmap_clear_modified( bitmap );
     bitmap_analize( bitmap );
 
     return bitmap ;
@@ -39,6 +39,7 @@
 /* --------------------------------------------------------------------------- */
 
 #include "mod_path.h"
+#include "savestate.h"
 
 /* --------------------------------------------------------------------------- */
 
@@ -386,6 +387,16 @@ static int modpathfind_path_wall( INSTANCE * my, int * params )
     return path_set_wall( params[0] ) ;
 }
 
+/* ----------------------------------------------------------------- */
+
+/* The last path is read point by point in later frames */
+
+void __bgdexport( mod_path, module_initialize )()
+{
+    savestate_register_ptr( path_result ) ;
+    savestate_register_ptr( path_result_pointer ) ;
+}
+
 /* ----------------------------------------------------------------- */
 /* exports                                                           */
 /* ----------------------------------------------------------------- */
@@ -87,6 +87,7 @@ static void _modproc_kill_all()
     while ( i )
     {
         LOCDWORD( mod_proc, i, STATUS ) = STATUS_KILLED ;
+        instance_status_changed( i ) ;
         i = i->next ;
     }
 }
@@ -256,6 +257,8 @@ static int modproc_signal( INSTANCE * my, int * params )
                 default:
                     return 1 ;
             }
+
+            instance_status_changed( i ) ;
         }
 
         if ( params[1] >= S_TREE )
@@ -432,7 +435,10 @@ static int modproc_let_me_alone( INSTANCE * my, int * params )
     while ( i )
     {
         if ( i != my && ( LOCDWORD( mod_proc, i, STATUS ) & ~STATUS_WAITING_MASK ) != STATUS_DEAD )
+        {
             LOCDWORD( mod_proc, i, STATUS ) = ( LOCDWORD( mod_proc, i, STATUS ) & STATUS_WAITING_MASK ) | STATUS_KILLED ;
+            instance_status_changed( i ) ;
+        }
         i = i->next ;
     }
     if ( LOCDWORD( mod_proc, my, STATUS ) > STATUS_KILLED ) LOCDWORD( mod_proc, my, STATUS ) = STATUS_RUNNING;